@@ -41,6 +41,10 @@ public:
     ~Audio() 
     {
         if( testSound ) testSound->release();
+        // release recycled sound buffers
+        StaticSound::releaseVoices();
+        // stop background stream decoding
+        StreamDecoder::shutdown();
         // release sound device
         if( iDirectSound8 ) iDirectSound8->Release();
         // reset COM 
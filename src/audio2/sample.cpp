@@ -0,0 +1,83 @@
+
+#include "headers.h"
+#include "sample.h"
+#include "ogg.h"
+
+/**
+ * class implementation
+ */
+
+Sample::Samples Sample::_samples;
+Sample::SampleList Sample::_unused;
+unsigned int Sample::_cacheSize = 0;
+
+Sample::Sample(const char* resourceName)
+{
+    _resourceName = resourceName;
+    _refCount = 0;
+    _unusedI = _unused.end();
+
+    // decode entire ogg file
+    OggFile oggFile( resourceName );
+    _numChannels  = oggFile.getNumChannels();
+    _samplingRate = oggFile.getSamplingRate();
+    _data.resize( oggFile.getSize() );
+    if( _data.size() ) _data.resize( oggFile.readBlock( &_data[0], _data.size() ) );
+
+    _cacheSize += _data.size();
+}
+
+Sample::~Sample()
+{
+    _cacheSize -= _data.size();
+}
+
+void Sample::addRef(void)
+{
+    if( _unusedI != _unused.end() )
+    {
+        _unused.erase( _unusedI );
+        _unusedI = _unused.end();
+    }
+    _refCount++;
+}
+
+void Sample::release(void)
+{
+    assert( _refCount );
+    _refCount--;
+    if( !_refCount )
+    {
+        _unused.push_front( this );
+        _unusedI = _unused.begin();
+        evict( SAMPLE_CACHE_BUDGET );
+    }
+}
+
+Sample* Sample::acquire(const char* resourceName)
+{
+    Sample* sample;
+    SampleI sampleI = _samples.find( resourceName );
+    if( sampleI != _samples.end() )
+    {
+        sample = sampleI->second;
+    }
+    else
+    {
+        sample = new Sample( resourceName );
+        _samples.insert( Samples::value_type( resourceName, sample ) );
+    }
+    sample->addRef();
+    return sample;
+}
+
+void Sample::evict(unsigned int budget)
+{
+    while( _cacheSize > budget && _unused.size() )
+    {
+        Sample* sample = _unused.back();
+        _unused.pop_back();
+        _samples.erase( sample->_resourceName );
+        delete sample;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef SAMPLE_INCLUDED
+#define SAMPLE_INCLUDED
+
+#include "headers.h"
+
+#define SAMPLE_CACHE_BUDGET ( 16 * 1024 * 1024 ) // bytes of decoded PCM kept in cache
+
+/**
+ * decoded PCM data of ogg file, shared by static sounds of same resource
+ * samples are reference counted, unreferenced samples are kept in cache
+ * and evicted in least recently used order when cache exceeds its budget
+ */
+
+class Sample
+{
+private:
+    typedef std::map<std::string,Sample*> Samples;
+    typedef Samples::iterator SampleI;
+    typedef std::list<Sample*> SampleList;
+    typedef SampleList::iterator SampleListI;
+private:
+    static Samples      _samples;   // all decoded samples
+    static SampleList   _unused;    // unreferenced samples, recently used first
+    static unsigned int _cacheSize; // total size of decoded samples
+private:
+    std::string       _resourceName;
+    unsigned int      _numChannels;
+    unsigned int      _samplingRate;
+    std::vector<char> _data;
+    unsigned int      _refCount;
+    SampleListI       _unusedI;
+private:
+    Sample(const char* resourceName);
+    ~Sample();
+public:
+    inline const char* getResourceName(void) { return _resourceName.c_str(); }
+    inline unsigned int getNumChannels(void) { return _numChannels; }
+    inline unsigned int getSamplingRate(void) { return _samplingRate; }
+    inline unsigned int getSize(void) { return _data.size(); }
+    inline const void* getData(void) { return _data.size() ? &_data[0] : NULL; }
+public:
+    void addRef(void);
+    void release(void);
+public:
+    /**
+     * returns referenced sample of resource, decodes resource only if sample isn't cached
+     */
+    static Sample* acquire(const char* resourceName);
+    /**
+     * evicts unreferenced samples until cache size fits to budget
+     */
+    static void evict(unsigned int budget);
+};
+
+#endif
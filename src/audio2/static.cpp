@@ -14,6 +14,8 @@ const Vector3f defaultVel( 0,0,0 );
 DWORD StaticSound::minSecondarySampleRate = 0;
 DWORD StaticSound::maxSecondarySampleRate = 0;
 
+StaticSound::Voices StaticSound::_idleVoices;
+
 StaticSound::StaticSound(const char* resourceName, IDirectSound8* iDirectSound8)
 {
     _resourceName          = resourceName;
@@ -22,15 +24,78 @@ StaticSound::StaticSound(const char* resourceName, IDirectSound8* iDirectSound8)
     _iDirectSoundBuffer8   = NULL;
     _iDirectSound3DBuffer8 = NULL;
 
-    // open sound file
-    OggFile* oggFile = new OggFile( resourceName );
+    // obtain decoded sound data
+    _sample = Sample::acquire( resourceName );
+
+    // take idle buffer of the same sample, or create new one
+    if( !acquireVoice() ) createVoice();
+
+    // reset management
+    _isPlaying = false;
+    _isLooping = false;
+    _iDirectSoundFXWavesReverb8 = NULL;
+    _fxWavesReverbIsActual = false;
+}
+
+StaticSound::~StaticSound()
+{
+    if( isPlaying() ) stop();
+    
+    // buffers with effects are not recycled
+    if( _fxWavesReverbIsActual )
+    {
+        if( _iDirectSound3DBuffer8 ) _iDirectSound3DBuffer8->Release();
+        _iDirectSoundBuffer8->Release();    
+        _iDirectSoundBuffer->Release();
+        _sample->release();
+    }
+    else
+    {
+        recycleVoice();
+    }
+}
+
+/**
+ * voice pool
+ */
 
+bool StaticSound::acquireVoice(void)
+{
+    for( VoiceI voiceI = _idleVoices.begin(); voiceI != _idleVoices.end(); voiceI++ )
+    {
+        if( voiceI->sample == _sample )
+        {
+            _iDirectSoundBuffer    = voiceI->iDirectSoundBuffer;
+            _iDirectSoundBuffer8   = voiceI->iDirectSoundBuffer8;
+            _iDirectSound3DBuffer8 = voiceI->iDirectSound3DBuffer8;
+            _idleVoices.erase( voiceI );
+
+            // idle voice holds its own sample reference
+            _sample->release();
+
+            // restore state of newly created buffer
+            _dsCR( _iDirectSoundBuffer8->SetCurrentPosition( 0 ) );
+            _dsCR( _iDirectSoundBuffer8->SetVolume( DSBVOLUME_MAX ) );
+            _dsCR( _iDirectSoundBuffer8->SetFrequency( DSBFREQUENCY_ORIGINAL ) );
+            if( _iDirectSound3DBuffer8 )
+            {
+                _dsCR( _iDirectSound3DBuffer8->SetAllParameters( &_relativeParameters, DS3D_IMMEDIATE ) );
+                _dsCR( _iDirectSound3DBuffer8->SetMode( DS3DMODE_NORMAL, DS3D_IMMEDIATE ) );
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void StaticSound::createVoice(void)
+{
     // define sound buffer
     ZeroMemory( &_bufferFormat, sizeof(WAVEFORMATEX) ); 
     ZeroMemory( &_bufferDesc, sizeof(DSBUFFERDESC) );
     _bufferFormat.wFormatTag      = WAVE_FORMAT_PCM;
-    _bufferFormat.nChannels       = oggFile->getNumChannels();
-    _bufferFormat.nSamplesPerSec  = oggFile->getSamplingRate();
+    _bufferFormat.nChannels       = _sample->getNumChannels();
+    _bufferFormat.nSamplesPerSec  = _sample->getSamplingRate();
     _bufferFormat.wBitsPerSample  = 16;
     _bufferFormat.nBlockAlign     = _bufferFormat.wBitsPerSample / 8 * _bufferFormat.nChannels;
     _bufferFormat.nAvgBytesPerSec = _bufferFormat.nSamplesPerSec * _bufferFormat.nBlockAlign;
@@ -38,11 +103,11 @@ StaticSound::StaticSound(const char* resourceName, IDirectSound8* iDirectSound8)
     _bufferDesc.dwFlags = DSBCAPS_CTRLFX | 
                           DSBCAPS_CTRLFREQUENCY | 
                           DSBCAPS_CTRLVOLUME;
-    if( oggFile->getNumChannels() == 1 )
+    if( _sample->getNumChannels() == 1 )
     {
         _bufferDesc.dwFlags = _bufferDesc.dwFlags | DSBCAPS_CTRL3D;// | DSBCAPS_MUTE3DATMAXDISTANCE;
     }
-    _bufferDesc.dwBufferBytes   = oggFile->getSize();
+    _bufferDesc.dwBufferBytes   = _sample->getSize();
     _bufferDesc.lpwfxFormat     = &_bufferFormat;
     _bufferDesc.guid3DAlgorithm = DS3DALG_DEFAULT;
 
@@ -70,11 +135,11 @@ StaticSound::StaticSound(const char* resourceName, IDirectSound8* iDirectSound8)
         0
     ) );
     assert( bufferSize2 == 0 );
-    oggFile->readBlock( bufferData1, bufferSize1 );
+    memcpy( bufferData1, _sample->getData(), bufferSize1 );
     _dsCR( _iDirectSoundBuffer->Unlock( bufferData1, bufferSize1, bufferData2, bufferSize2 ) );
 
     // obtain 3D manager from sound manager
-    if( oggFile->getNumChannels() == 1 )
+    if( _sample->getNumChannels() == 1 )
     {
         _dsCR( _iDirectSoundBuffer8->QueryInterface( 
             IID_IDirectSound3DBuffer, 
@@ -84,23 +149,41 @@ StaticSound::StaticSound(const char* resourceName, IDirectSound8* iDirectSound8)
         // setup buffer mode
         _dsCR( _iDirectSound3DBuffer8->SetMode( DS3DMODE_NORMAL, DS3D_IMMEDIATE ) );
     }
+}
 
-    // delete OGG file
-    delete oggFile;
+void StaticSound::recycleVoice(void)
+{
+    // sample reference is passed to idle voice
+    Voice voice;
+    voice.sample                = _sample;
+    voice.iDirectSoundBuffer    = _iDirectSoundBuffer;
+    voice.iDirectSoundBuffer8   = _iDirectSoundBuffer8;
+    voice.iDirectSound3DBuffer8 = _iDirectSound3DBuffer8;
+    _idleVoices.push_front( voice );
 
-    // reset management
-    _isPlaying = false;
-    _isLooping = false;
-    _iDirectSoundFXWavesReverb8 = NULL;
-    _fxWavesReverbIsActual = false;
+    // release least recently used voice
+    if( _idleVoices.size() > VOICE_POOL_SIZE )
+    {
+        voice = _idleVoices.back();
+        _idleVoices.pop_back();
+        if( voice.iDirectSound3DBuffer8 ) voice.iDirectSound3DBuffer8->Release();
+        voice.iDirectSoundBuffer8->Release();
+        voice.iDirectSoundBuffer->Release();
+        voice.sample->release();
+    }
 }
 
-StaticSound::~StaticSound()
+void StaticSound::releaseVoices(void)
 {
-    if( isPlaying() ) stop();
-    if( _iDirectSound3DBuffer8 ) _iDirectSound3DBuffer8->Release();
-    _iDirectSoundBuffer8->Release();    
-    _iDirectSoundBuffer->Release();
+    for( VoiceI voiceI = _idleVoices.begin(); voiceI != _idleVoices.end(); voiceI++ )
+    {
+        if( voiceI->iDirectSound3DBuffer8 ) voiceI->iDirectSound3DBuffer8->Release();
+        voiceI->iDirectSoundBuffer8->Release();
+        voiceI->iDirectSoundBuffer->Release();
+        voiceI->sample->release();
+    }
+    _idleVoices.clear();
+    Sample::evict( 0 );
 }
 
 /**
@@ -4,13 +4,32 @@
 
 #include "headers.h"
 #include "../shared/audio.h"
-#include "ogg.h"
+#include "sample.h"
 #include "spatial.h"
 
+#define VOICE_POOL_SIZE 32 // number of idle sound buffers kept for recycling
+
 class StaticSound : public SpatialSound
 {
+private:
+    /**
+     * sound buffer filled with sample data
+     */
+    struct Voice
+    {
+    public:
+        Sample*                sample;
+        IDirectSoundBuffer*    iDirectSoundBuffer;
+        IDirectSoundBuffer8*   iDirectSoundBuffer8;
+        IDirectSound3DBuffer8* iDirectSound3DBuffer8;
+    };
+    typedef std::list<Voice> Voices;
+    typedef Voices::iterator VoiceI;
+private:
+    static Voices _idleVoices; // released voices, recently released first
 private:
     std::string                 _resourceName;
+    Sample*                     _sample;
     WAVEFORMATEX                _bufferFormat;
     DSBUFFERDESC                _bufferDesc;
     IDirectSound8*              _iDirectSound8;
@@ -21,6 +40,10 @@ private:
     bool                        _fxWavesReverbIsActual;
     bool                        _isPlaying;
     bool                        _isLooping;
+private:
+    bool acquireVoice(void);
+    void createVoice(void);
+    void recycleVoice(void);
 protected:
     // SpatialSound
     virtual IDirectSound3DBuffer8* getIDirectSound3DBuffer8(void) { return _iDirectSound3DBuffer8; }
@@ -41,6 +64,9 @@ public:
     // frequency mixing capabilities (setup externally by Audio entity)
     static DWORD minSecondarySampleRate;
     static DWORD maxSecondarySampleRate;
+public:
+    // releases idle voices & unreferenced samples (must be called before sound device is released)
+    static void releaseVoices(void);
 };
 
 #endif
\ No newline at end of file
@@ -15,6 +15,9 @@ const Vector3f defaultVel( 0,0,0 );
 
 StreamSound::StreamSounds StreamSound::_streamSounds;
 
+StreamDecoder* StreamDecoder::_decoders[STREAM_DECODER_THREADS] = { NULL };
+unsigned int   StreamDecoder::_nextDecoder = 0;
+
 DWORD StreamSound::minSecondarySampleRate = 0;
 DWORD StreamSound::maxSecondarySampleRate = 0;
 
@@ -84,13 +87,27 @@ StreamSound::StreamSound(const char* resourceName, IDirectSound8* iDirectSound8,
     _isPlaying = false;
     _writeCursor = 0;
     _playProgress = 0;
+    _streamSize = _oggFile->getSize();
+
+    // setup decoded PCM ring (power of two, so ring offsets survive counter wrapping)
+    DWORD ringSize = 1;
+    while( ringSize < STREAM_RING_BUFFERS * _bufferDesc.dwBufferBytes ) ringSize <<= 1;
+    _ring.resize( ringSize );
+    _ringRead = _ringWrite = 0;
+    _decodeEnded = _decodeFailed = 0;
+    InitializeCriticalSection( &_decodeLock );
 
-    // register in management list
+    // register in management list & start background decoding
     _streamSounds.push_back( this );
+    _decoder = StreamDecoder::acquire();
+    _decoder->add( this );
 }
 
 StreamSound::~StreamSound()
 {
+    // stop background decoding
+    if( _decoder ) _decoder->remove( this );
+    DeleteCriticalSection( &_decodeLock );
     // stop sound
     if( isPlaying() ) stop();
     // release sound interfaces
@@ -125,8 +142,11 @@ bool StreamSound::isPlaying(void)
 
 void StreamSound::play(void)
 {
-    // reset ogg file
+    // reset ogg file & discard decoded data
+    EnterCriticalSection( &_decodeLock );
     _oggFile->reset();
+    _ringRead = _ringWrite = 0;
+    _decodeEnded = 0;
 
     // setup streaming
     _writeCursor = 0;
@@ -147,8 +167,10 @@ void StreamSound::play(void)
         0
     ) );
     assert( bufferSize2 == 0 );
-    uploadSound( reinterpret_cast<BYTE*>(bufferData1), bufferSize1 );
+    decodeSound( reinterpret_cast<BYTE*>(bufferData1), bufferSize1 );
     _dsCR( _iDirectSoundBuffer->Unlock( bufferData1, bufferSize1, bufferData2, bufferSize2 ) );
+    LeaveCriticalSection( &_decodeLock );
+    if( _decoder ) _decoder->wake();
 
     // play
     _dsCR( _iDirectSoundBuffer8->Play( 0, 0, DSBPLAY_LOOPING ) );
@@ -199,7 +221,7 @@ void StreamSound::setPitchShift(float value)
  * streaming routine
  */
 
-void StreamSound::uploadSound(BYTE* buffer, DWORD size)
+void StreamSound::decodeSound(BYTE* buffer, DWORD size)
 {    
     DWORD bytesRestToUpload = size;
     DWORD uploadOffset = 0;
@@ -211,7 +233,7 @@ void StreamSound::uploadSound(BYTE* buffer, DWORD size)
         uploadOffset += oggBytes;
         if( bytesRestToUpload > 0 )
         {
-            if( _isLooping )
+            if( _isLooping && _streamSize )
             {
                 _oggFile->reset();
             }
@@ -219,12 +241,76 @@ void StreamSound::uploadSound(BYTE* buffer, DWORD size)
             {
                 FillMemory( buffer + uploadOffset, bytesRestToUpload, 0 );
                 bytesRestToUpload = 0;
+                _decodeEnded = 1;
             }
         }
     }
     _playProgress += size;
 }
 
+void StreamSound::decodeAhead(void)
+{
+    // decoder thread is the only writer of ring, lock is taken per ogg block,
+    // so play() waits for one block at most
+    DWORD ringSize = _ring.size();
+    bool ringIsFull = false;
+    while( !ringIsFull && !_decodeEnded && !_decodeFailed )
+    {
+        EnterCriticalSection( &_decodeLock );
+        try
+        {
+            DWORD used = DWORD( _ringWrite - _ringRead );
+            ringIsFull = ( used >= ringSize );
+            if( !ringIsFull )
+            {
+                DWORD offset = DWORD( _ringWrite ) & ( ringSize - 1 );
+                DWORD bytes = _oggFile->readBlock( &_ring[offset], std::min<DWORD>( ringSize - used, ringSize - offset ) );
+                if( bytes )
+                {
+                    InterlockedExchangeAdd( &_ringWrite, bytes );
+                }
+                else if( _isLooping && _streamSize )
+                {
+                    _oggFile->reset();
+                }
+                else
+                {
+                    InterlockedExchange( &_decodeEnded, 1 );
+                }
+            }
+        }
+        catch( ccor::Exception& )
+        {
+            // reported by game thread
+            InterlockedExchange( &_decodeFailed, 1 );
+        }
+        LeaveCriticalSection( &_decodeLock );
+    }
+}
+
+void StreamSound::uploadSound(BYTE* buffer, DWORD size)
+{    
+    if( _decodeFailed )
+    {
+        throw ccor::Exception( "Error while reading ogg-file \"%s\"", _resourceName.c_str() );
+    }
+
+    // copy decoded data, game thread is the only reader of ring
+    DWORD ringSize = _ring.size();
+    DWORD offset = DWORD( _ringRead ) & ( ringSize - 1 );
+    DWORD bytes = std::min<DWORD>( DWORD( _ringWrite - _ringRead ), size );
+    DWORD bytes1 = std::min<DWORD>( bytes, ringSize - offset );
+    CopyMemory( buffer, &_ring[offset], bytes1 );
+    CopyMemory( buffer + bytes1, &_ring[0], bytes - bytes1 );
+    InterlockedExchangeAdd( &_ringRead, bytes );
+
+    // end of stream (or decoder is late), upload silence
+    if( bytes < size ) FillMemory( buffer + bytes, size - bytes, 0 );
+
+    _playProgress += size;
+    if( _decoder ) _decoder->wake();
+}
+
 void StreamSound::onUpdateStreamBuffer(void)
 {
     void* bufferData1;
@@ -324,7 +410,7 @@ void StreamSound::onUpdateStreamBuffer(void)
     if( _writeCursor == _bufferDesc.dwBufferBytes ) _writeCursor = 0;
 
     // terminate playing of non-looping stream 
-    if( !_isLooping && _playProgress >= _oggFile->getSize() + _bufferDesc.dwBufferBytes )
+    if( !_isLooping && _playProgress >= _streamSize + _bufferDesc.dwBufferBytes )
     {
         stop();
     }
@@ -338,4 +424,94 @@ void StreamSound::updateStreamBuffers(void)
     {
         ( *streamSoundI )->onUpdateStreamBuffer();
     }
-}
\ No newline at end of file
+}
+/**
+ * class StreamDecoder
+ */
+
+StreamDecoder::StreamDecoder()
+{
+    _terminate = 0;
+    _wakeEvent = CreateEvent( NULL, FALSE, FALSE, NULL ); assert( _wakeEvent );
+    InitializeCriticalSection( &_lock );
+    DWORD threadId;
+    _thread = CreateThread( NULL, 0, threadProc, this, 0, &threadId ); assert( _thread );
+    SetThreadPriority( _thread, THREAD_PRIORITY_ABOVE_NORMAL );
+}
+
+StreamDecoder::~StreamDecoder()
+{
+    InterlockedExchange( &_terminate, 1 );
+    SetEvent( _wakeEvent );
+    WaitForSingleObject( _thread, INFINITE );
+    CloseHandle( _thread );
+    CloseHandle( _wakeEvent );
+
+    // detach remaining streams
+    for( StreamSoundI streamSoundI = _streamSounds.begin();
+                      streamSoundI != _streamSounds.end();
+                      streamSoundI++ )
+    {
+        (*streamSoundI)->_decoder = NULL;
+    }
+    DeleteCriticalSection( &_lock );
+}
+
+DWORD WINAPI StreamDecoder::threadProc(LPVOID parameter)
+{
+    StreamDecoder* decoder = reinterpret_cast<StreamDecoder*>( parameter );
+    while( !decoder->_terminate )
+    {
+        // sleep until some stream is consumed
+        WaitForSingleObject( decoder->_wakeEvent, STREAM_DECODER_PERIOD );
+
+        EnterCriticalSection( &decoder->_lock );
+        for( StreamSoundI streamSoundI = decoder->_streamSounds.begin();
+                          streamSoundI != decoder->_streamSounds.end();
+                          streamSoundI++ )
+        {
+            (*streamSoundI)->decodeAhead();
+        }
+        LeaveCriticalSection( &decoder->_lock );
+    }
+    return 0;
+}
+
+void StreamDecoder::add(StreamSound* streamSound)
+{
+    EnterCriticalSection( &_lock );
+    _streamSounds.push_back( streamSound );
+    LeaveCriticalSection( &_lock );
+    wake();
+}
+
+void StreamDecoder::remove(StreamSound* streamSound)
+{
+    EnterCriticalSection( &_lock );
+    _streamSounds.remove( streamSound );
+    LeaveCriticalSection( &_lock );
+}
+
+void StreamDecoder::wake(void)
+{
+    SetEvent( _wakeEvent );
+}
+
+StreamDecoder* StreamDecoder::acquire(void)
+{
+    unsigned int decoderId = _nextDecoder++ % STREAM_DECODER_THREADS;
+    if( !_decoders[decoderId] ) _decoders[decoderId] = new StreamDecoder;
+    return _decoders[decoderId];
+}
+
+void StreamDecoder::shutdown(void)
+{
+    for( unsigned int i=0; i<STREAM_DECODER_THREADS; i++ )
+    {
+        if( _decoders[i] )
+        {
+            delete _decoders[i];
+            _decoders[i] = NULL;
+        }
+    }
+}
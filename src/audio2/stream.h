@@ -7,8 +7,48 @@
 #include "ogg.h"
 #include "spatial.h"
 
+#define STREAM_DECODER_THREADS 2  // number of background decoding threads
+#define STREAM_DECODER_PERIOD  10 // longest sleep of decoding thread, in milliseconds
+#define STREAM_RING_BUFFERS    2  // size of decoded PCM ring, in sound buffers
+
+class StreamSound;
+
+/**
+ * background thread, decodes its streams ahead of their play cursors
+ */
+
+class StreamDecoder
+{
+private:
+    typedef std::list<StreamSound*> StreamSounds;
+    typedef StreamSounds::iterator StreamSoundI;
+private:
+    static StreamDecoder* _decoders[STREAM_DECODER_THREADS];
+    static unsigned int   _nextDecoder;
+private:
+    HANDLE           _thread;
+    HANDLE           _wakeEvent;
+    CRITICAL_SECTION _lock;
+    StreamSounds     _streamSounds;
+    volatile LONG    _terminate;
+private:
+    StreamDecoder();
+    ~StreamDecoder();
+    static DWORD WINAPI threadProc(LPVOID parameter);
+public:
+    void add(StreamSound* streamSound);
+    void remove(StreamSound* streamSound);
+    void wake(void);
+public:
+    // returns decoder for new stream (round-robin)
+    static StreamDecoder* acquire(void);
+    // terminates decoding threads
+    static void shutdown(void);
+};
+
 class StreamSound :  public SpatialSound
 {
+    friend class StreamDecoder;
 private:
     typedef std::list<StreamSound*> StreamSounds;
     typedef StreamSounds::iterator StreamSoundI;
@@ -25,11 +65,23 @@ private:
     IDirectSoundBuffer*    _iDirectSoundBuffer;
     IDirectSoundBuffer8*   _iDirectSoundBuffer8;
     IDirectSound3DBuffer8* _iDirectSound3DBuffer8;    
-    bool                   _isLooping;
+    volatile bool          _isLooping;
     bool                   _isPlaying;
     DWORD                  _writeCursor;
     DWORD                  _playProgress;
+    DWORD                  _streamSize;
+private:
+    // decoded PCM ring, written by decoder thread & read by game thread
+    StreamDecoder*         _decoder;
+    CRITICAL_SECTION       _decodeLock;   // guards ogg file & ring reset, held per decoded block
+    std::vector<BYTE>      _ring;
+    volatile LONG          _ringRead;     // total bytes read from ring
+    volatile LONG          _ringWrite;    // total bytes written to ring
+    volatile LONG          _decodeEnded;  // non-looping stream is decoded entirely
+    volatile LONG          _decodeFailed; // ogg file reading error
 private:
+    void decodeSound(BYTE* buffer, DWORD size);
+    void decodeAhead(void);
     void uploadSound(BYTE* buffer, DWORD size);
     void onUpdateStreamBuffer(void);
 protected:
@@ -0,0 +1,270 @@
+#include <io.h>
+#include <fcntl.h>
+#include "headers.h"
+#include "../shared/ccor.h"
+#include "CoreImpl.h"
+#include "zlib/zlib.h"
+#include "Archive.h"
+
+namespace ccor {
+
+/**
+ * class PackedArchive
+ */
+
+static void normalizeEntryName(char * dst, const char * src) {
+    for(; *src; ++src, ++dst)
+        *dst = *src == '\\' ? '/' : ::tolower(*src);
+    *dst = '\0';
+}
+
+static bool fitsIn(unsigned int offset, unsigned int size, unsigned int limit) {
+    return offset <= limit && size <= limit - offset;
+}
+
+bool PackedArchive::validate() {
+    header = reinterpret_cast<const PackHeader *>(base);
+    if(baseSize < sizeof(PackHeader) || header->magic != PACK_MAGIC || header->version != PACK_VERSION)
+        return false;
+
+    if(header->numEntries > baseSize / sizeof(PackEntry) ||
+       !fitsIn(header->entriesOffset, header->numEntries * sizeof(PackEntry), header->namesOffset) ||
+       !fitsIn(header->namesOffset, header->namesSize, baseSize))
+        return false;
+
+    entries = reinterpret_cast<const PackEntry *>(base + header->entriesOffset);
+    names = base + header->namesOffset;
+
+    // every entry name must be terminated inside name table, every entry data inside the file
+    for(unsigned int i = 0; i < header->numEntries; ++i) {
+        const PackEntry & entry = entries[i];
+        if(entry.nameOffset >= header->namesSize ||
+           !::memchr(names + entry.nameOffset, '\0', header->namesSize - entry.nameOffset))
+            return false;
+        if(!fitsIn(entry.dataOffset, entry.packedSize, baseSize))
+            return false;
+        if(entry.method == pmStored && entry.size != entry.packedSize)
+            return false;
+    }
+
+    return true;
+}
+
+const PackEntry * PackedArchive::find(const char * entryName) {
+    char key[MAX_PATH];
+    if(::strlen(entryName) >= MAX_PATH)
+        return NULL;
+    normalizeEntryName(key, entryName);
+
+    int lo = 0;
+    int hi = int(header->numEntries) - 1;
+    while(lo <= hi) {
+        int mid = (lo + hi) >> 1;
+        int cmp = ::strcmp(key, names + entries[mid].nameOffset);
+        if(cmp == 0)
+            return entries + mid;
+        if(cmp < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+
+    return NULL;
+}
+
+const void * PackedArchive::getStoredData(const PackEntry * entry) {
+    if(entry->method != pmStored)
+        return NULL;
+    return base + entry->dataOffset;
+}
+
+unsigned int PackedArchive::extract(const PackEntry * entry, void * buffer, unsigned int bufferSize) {
+    if(bufferSize < entry->size)
+        throw Exception("resmgr: buffer is too small to extract \"%s\" from \"%s\"", getEntryName(entry), name.c_str());
+
+    switch(entry->method) {
+    case pmStored:
+        ::memcpy(buffer, base + entry->dataOffset, entry->size);
+        return entry->size;
+    case pmDeflate: {
+        uLongf size = entry->size;
+        if(uncompress((Bytef *) buffer, &size, (const Bytef *) base + entry->dataOffset, entry->packedSize) != Z_OK || size != entry->size)
+            throw Exception("resmgr: cannot inflate \"%s\" from \"%s\"", getEntryName(entry), name.c_str());
+        return size;
+    }
+    default:
+        throw Exception("resmgr: unknown pack method %d of \"%s\" in \"%s\"", entry->method, getEntryName(entry), name.c_str());
+    }
+}
+
+/**
+ * archive building
+ */
+
+struct PackSource {
+    std::string entryName;
+    std::string fileName;
+    bool operator < (const PackSource & source) const { return entryName < source.entryName; }
+};
+
+typedef std::vector<PackSource> PackSources;
+
+static void collectPackSources(PackSources & sources, const std::string & rootDir, const std::string & subDir) {
+    _finddata_t findData;
+    std::string mask = rootDir + "/" + subDir + "*";
+    long findHandle = ::_findfirst(mask.c_str(), &findData);
+    if(findHandle == -1)
+        return;
+
+    do {
+        if(!::strcmp(findData.name, ".") || !::strcmp(findData.name, ".."))
+            continue;
+
+        if(findData.attrib & _A_SUBDIR)
+            collectPackSources(sources, rootDir, subDir + findData.name + "/");
+        else {
+            char entryName[MAX_PATH];
+            normalizeEntryName(entryName, (subDir + findData.name).c_str());
+            PackSource source;
+            source.entryName = entryName;
+            source.fileName = rootDir + "/" + subDir + findData.name;
+            sources.push_back(source);
+        }
+    }
+    while(::_findnext(findHandle, &findData) != -1);
+
+    ::_findclose(findHandle);
+}
+
+static void writePackData(FILE * file, const void * data, unsigned int size, const char * archiveName) {
+    if(size && !::fwrite(data, size, 1, file))
+        throw Exception("resmgr: error occured while writing archive \"%s\"", archiveName);
+}
+
+void PackedArchive::build(const char * archiveName, const char * rootDir, bool compress) {
+    PackSources sources;
+    collectPackSources(sources, rootDir, "");
+    std::sort(sources.begin(), sources.end());
+
+    FILE * file = ::fopen(archiveName, "wb");
+    if(!file)
+        throw Exception("resmgr: cannot create archive \"%s\"", archiveName);
+
+    try {
+        PackHeader header;
+        ::memset(&header, 0, sizeof(PackHeader));
+        writePackData(file, &header, sizeof(PackHeader), archiveName);
+
+        std::vector<PackEntry> entries(sources.size());
+        std::string names;
+        MemFileBuffer data;
+        MemFileBuffer packed;
+        unsigned int offset = sizeof(PackHeader);
+
+        for(unsigned int i = 0; i < sources.size(); ++i) {
+            FILE * source = ::fopen(sources[i].fileName.c_str(), "rb");
+            if(!source)
+                throw Exception("resmgr: cannot open file \"%s\"", sources[i].fileName.c_str());
+            unsigned int size = ::_filelength(_fileno(source));
+            data.resize(size ? size : 1);
+            bool readOk = !size || ::fread(&data[0], size, 1, source) == 1;
+            ::fclose(source);
+            if(!readOk)
+                throw Exception("resmgr: cannot read file \"%s\"", sources[i].fileName.c_str());
+
+            PackEntry & entry = entries[i];
+            entry.nameOffset = names.size();
+            entry.dataOffset = offset;
+            entry.size = size;
+            entry.crc = crc32(0, (const Bytef *) &data[0], size);
+            entry.method = pmStored;
+            entry.packedSize = size;
+
+            names.append(sources[i].entryName);
+            names.push_back('\0');
+
+            if(compress && size) {
+                // zlib 1.1.4 has no compressBound(), use the documented worst case
+                uLongf packedSize = size + size / 1000 + 12;
+                packed.resize(packedSize);
+                // keep entries stored unless deflate saves at least an eighth
+                if(compress2((Bytef *) &packed[0], &packedSize, (const Bytef *) &data[0], size, Z_BEST_COMPRESSION) == Z_OK &&
+                   packedSize < size - size / 8) {
+                    entry.method = pmDeflate;
+                    entry.packedSize = packedSize;
+                }
+            }
+
+            writePackData(file, entry.method == pmStored ? &data[0] : &packed[0], entry.packedSize, archiveName);
+            offset += entry.packedSize;
+        }
+
+        header.magic = PACK_MAGIC;
+        header.version = PACK_VERSION;
+        header.numEntries = entries.size();
+        header.entriesOffset = offset;
+        header.namesOffset = offset + entries.size() * sizeof(PackEntry);
+        header.namesSize = names.size();
+
+        if(entries.size())
+            writePackData(file, &entries[0], entries.size() * sizeof(PackEntry), archiveName);
+        writePackData(file, names.data(), names.size(), archiveName);
+
+        ::rewind(file);
+        writePackData(file, &header, sizeof(PackHeader), archiveName);
+    }
+    catch(...) {
+        ::fclose(file);
+        ::remove(archiveName);
+        throw;
+    }
+
+    ::fclose(file);
+}
+
+/**
+ * class ArchiveReader
+ */
+
+ArchiveReader::ArchiveReader(PackedArchive * archive, const PackEntry * entry, bool textMode, const char * name) : Resource(name) {
+    this->archive = archive;
+    this->entry = entry;
+    this->textMode = textMode;
+}
+
+const void * ArchiveReader::getData() {
+    const void * data = archive->getStoredData(entry);
+    if(data)
+        return data;
+
+    if(unpacked.empty() && entry->size) {
+        unpacked.resize(entry->size);
+        archive->extract(entry, &unpacked[0], entry->size);
+    }
+    return unpacked.empty() ? NULL : &unpacked[0];
+}
+
+unsigned int ArchiveReader::readData(void * buffer, unsigned int bufferSize) {
+    if(!unpacked.empty() && bufferSize >= entry->size) {
+        ::memcpy(buffer, &unpacked[0], entry->size);
+        return entry->size;
+    }
+    return archive->extract(entry, buffer, bufferSize);
+}
+
+FILE * ArchiveReader::getFile() {
+    // legacy stdio consumers get a temporary copy of the entry
+    if(!file) {
+        openTempFile(false);
+
+        if(entry->size && !::fwrite(getData(), entry->size, 1, file))
+            throw Exception("resmgr: error occured while writing from archive to temporary file");
+
+        ::rewind(file);
+        if(textMode)
+            ::setmode(_fileno(file), _O_TEXT);
+    }
+    return file;
+}
+
+}
@@ -0,0 +1,141 @@
+#ifndef H8C1F2E7A_4B0D_4E35_9A61_2D7E5B3C9F10
+#define H8C1F2E7A_4B0D_4E35_9A61_2D7E5B3C9F10
+
+#include "Resource.h"
+
+namespace ccor {
+
+/**
+ * Packed archive (.pak) layout:
+ *
+ *   PackHeader
+ *   entry data, each entry stored as is or as zlib stream (compress2/uncompress)
+ *   PackEntry[numEntries], sorted by name (lowercase, '/'-separated)
+ *   name table, zero-terminated names referenced by PackEntry::nameOffset
+ *
+ * All offsets are absolute and little-endian. Because the entry table is sorted
+ * it is searched directly inside the mapped view, no index is built at load time.
+ */
+
+#define PACK_MAGIC   0x4B505842 // "BXPK"
+#define PACK_VERSION 1
+
+#define PACK_FILE_SUFFIX ".pak"
+
+enum PackMethod {
+    pmStored  = 0,
+    pmDeflate = 1
+};
+
+struct PackHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int numEntries;
+    unsigned int entriesOffset;
+    unsigned int namesOffset;
+    unsigned int namesSize;
+};
+
+struct PackEntry {
+    unsigned int nameOffset;
+    unsigned int dataOffset;
+    unsigned int packedSize;
+    unsigned int size;
+    unsigned int method;
+    unsigned int crc;
+};
+
+/**
+ * Read-only view of a packed archive, mapped into the address space once
+ */
+class PackedArchive {
+private:
+
+    std::string        name;
+    void             * fileHandle;
+    void             * mappingHandle;
+    const char       * base;
+    unsigned int       baseSize;
+    const PackHeader * header;
+    const PackEntry  * entries;
+    const char       * names;
+
+    bool map(const char * archiveName);
+
+    void unmap();
+
+    /**
+     * Check that header, entry table, names and entry data lie within mapped view
+     */
+    bool validate();
+
+public:
+
+    PackedArchive(const char * archiveName);
+
+    ~PackedArchive();
+
+    const char * getName() { return name.c_str(); }
+
+    /**
+     * Find entry by its path relative to archive root
+     * @return Entry or NULL if archive has no such entry
+     */
+    const PackEntry * find(const char * entryName);
+
+    const char * getEntryName(const PackEntry * entry) { return names + entry->nameOffset; }
+
+    /**
+     * Zero-copy access to stored entry
+     * @return Pointer into mapped view or NULL if entry is compressed
+     */
+    const void * getStoredData(const PackEntry * entry);
+
+    /**
+     * Unpack entry into caller's memory. For stored entries this is a plain copy,
+     * compressed entries are inflated directly into the buffer.
+     * @return Number of bytes written
+     */
+    unsigned int extract(const PackEntry * entry, void * buffer, unsigned int bufferSize);
+
+    /**
+     * Build archive from all files located under specified directory
+     * @param archiveName Name of archive file to create
+     * @param rootDir Directory to pack, entry names are relative to it
+     * @param compress Deflate entries that benefit from compression
+     */
+    static void build(const char * archiveName, const char * rootDir, bool compress);
+};
+
+/**
+ * Resource served from packed archive
+ */
+class ArchiveReader : public Resource {
+
+friend class ResourceMgr;
+
+private:
+
+    PackedArchive   * archive;
+    const PackEntry * entry;
+    bool              textMode;
+    MemFileBuffer     unpacked;
+
+    ArchiveReader(PackedArchive * archive, const PackEntry * entry, bool textMode, const char * name);
+
+    ~ArchiveReader() { }
+
+public:
+
+    virtual FILE * __stdcall getFile();
+
+    virtual const void * __stdcall getData();
+
+    virtual unsigned int __stdcall getSize() { return entry->size; }
+
+    virtual unsigned int __stdcall readData(void * buffer, unsigned int bufferSize);
+};
+
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "headers.h"
+#include <windows.h>
+#include "../shared/ccor.h"
+#include "CoreImpl.h"
+#include "Archive.h"
+
+namespace ccor {
+
+PackedArchive::PackedArchive(const char * archiveName) : name(archiveName) {
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = NULL;
+    base = NULL;
+    baseSize = 0;
+
+    if(!map(archiveName)) {
+        unmap();
+        throw Exception("resmgr: cannot map archive \"%s\"", archiveName);
+    }
+
+    if(!validate()) {
+        unmap();
+        throw Exception("resmgr: invalid archive \"%s\"", archiveName);
+    }
+}
+
+PackedArchive::~PackedArchive() {
+    unmap();
+}
+
+bool PackedArchive::map(const char * archiveName) {
+    fileHandle = ::CreateFileA(archiveName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    baseSize = ::GetFileSize(fileHandle, NULL);
+    if(baseSize == INVALID_FILE_SIZE || !baseSize)
+        return false;
+
+    if(!(mappingHandle = ::CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL)))
+        return false;
+
+    base = static_cast<const char *>(::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    return base != NULL;
+}
+
+void PackedArchive::unmap() {
+    if(base)
+        ::UnmapViewOfFile(base);
+    if(mappingHandle)
+        ::CloseHandle(mappingHandle);
+    if(fileHandle != INVALID_HANDLE_VALUE)
+        ::CloseHandle(fileHandle);
+    base = NULL;
+    mappingHandle = NULL;
+    fileHandle = INVALID_HANDLE_VALUE;
+}
+
+}
@@ -164,7 +164,8 @@ void ComponentMgr::refreshMapComp() {
     // If yes, add '$debug' suffix to each component path
     bool inDebugMode = false;
     IParamPack * ppack = SingleCore::getInstance()->getCoreParamPack();
-    paramid_t pid = ppack->find("com.debug");
+    static ParamKey debugKey("com.debug");
+    paramid_t pid = debugKey.resolve(ppack);
     if (pid>=0) {
         ppack->get(pid,inDebugMode);
     }
@@ -4,11 +4,13 @@
 #include "CoreImpl.h"
 
 #include "Core.h"
+#include "Archive.h"
 
 using namespace ccor;
 
 
 entid_t gMainEntId = -1;
+bool gPackOnly = false;
 
 
 
@@ -44,6 +46,24 @@ static const void parseCommandLine(LPSTR cmdLine) {
         }
 }
 
+/**
+ * "--pack=<dir>" packs all files under <dir> into "<dir>.pak", which resource manager
+ * serves instead of missing loose files, and exits; "--packstored" disables deflate
+ */
+static bool packResources() {
+
+        IParamPack * ppack = SingleCore::getInstance()->getCoreParamPack();
+
+        const char * packDir = ppack->getv("startup.pack", (const char *) NULL);
+        if (!packDir)
+                return false;
+
+        std::string archiveName = std::string(packDir) + PACK_FILE_SUFFIX;
+        PackedArchive::build(archiveName.c_str(), packDir, !ppack->getv("startup.packstored", 0));
+        SingleCore::getInstance()->logMessage("core: packed \"%s\" into \"%s\"", packDir, archiveName.c_str());
+        return true;
+}
+
 //int PASCAL WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, int cmdShow)
 
 int CoreInitEngine(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, int cmdShow)
@@ -60,6 +80,11 @@ int CoreInitEngine(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
                 ppack->set("startup.arguments.prevInstance", (int) prevInstance);
                 ppack->set("startup.arguments.cmdShow", (int) cmdShow);
 
+                // Packing mode doesn't start the game
+                gPackOnly = packResources();
+                if (gPackOnly)
+                        return rcode;
+
                 // Create main entity
                 gMainEntId = c->createEntity("Main",-1,NULL);
         }
@@ -159,7 +184,7 @@ int CoreRunEngine(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, int
         int rcode = 0;
 
         rcode = CoreInitEngine(instance, prevInstance, cmdLine, cmdShow);
-        if (rcode == 0) {
+        if (rcode == 0 && !gPackOnly) {
                 rcode = CoreMainLoop();
         }
         rcode = CoreShutdownEngine(rcode);
@@ -46,7 +46,7 @@ CoreImpl * SingleCore::instance = 0;
 CoreImpl::CoreImpl() {
     flog = NULL;
     coreParamPack = NULL;
-    paramPackFactory = new ParamPackFactory();
+    paramPackFactory = new ParamPackFactory(&resMgr);
     EntityBase::icore = this;
     htmlLog = false;
     xdata = NULL;
@@ -68,7 +68,8 @@ void CoreImpl::init() {
     else logMessage("ccor : warning : can't open id database!");
     resMgr.loadPathMap("cfg/resmgr.config");
     // reset random seed
-    paramid_t pidRandomize = coreParamPack->find("randomize");
+    static ParamKey randomizeKey("randomize");
+    paramid_t pidRandomize = randomizeKey.resolve(coreParamPack);
     if (pidRandomize >= 0) {
         if (strcmp(coreParamPack->getv(pidRandomize,""), "timer")==0) 
             randToolkit.resetSeed();
@@ -121,6 +122,13 @@ void CoreImpl::act() {
 
 
 void CoreImpl::logMessageV(const char * fmt, va_list vl) {
+    // concurrent acts don't write log, their messages are logged by main thread when acts are done
+    if (flog && em.isActingConcurrently()) {
+        char buf[8192];
+        ::vsprintf(buf,fmt,vl);
+        em.deferMessage(buf);
+        return;
+    }
     if (flog) {
         if (htmlLog) {
             char buf[8192];
@@ -157,7 +165,8 @@ void CoreImpl::logMessageV(const char * fmt, va_list vl) {
 
 void CoreImpl::startLog() {
     // Determine log type
-    paramid_t idLogType=coreParamPack->find("log.type");
+    static ParamKey logTypeKey("log.type");
+    paramid_t idLogType=logTypeKey.resolve(coreParamPack);
     if (idLogType>=0) {
         const char * logType=coreParamPack->gets(idLogType);
         if (stricmp(logType,"html")==0) htmlLog=true;
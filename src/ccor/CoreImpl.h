@@ -57,6 +57,8 @@ public:
     void init();
     void release();
 
+    ResourceMgr & getResourceMgr() { return resMgr; }
+
     virtual IParamPack * __stdcall getCoreParamPack() {
         return coreParamPack;
     }
@@ -104,6 +106,8 @@ public:
 
     virtual void __stdcall setActivity(entid_t id, float activityRate) { em.setActivity(id, activityRate); }
 
+    virtual void __stdcall setConcurrentType(const char * type, bool concurrent) { em.setConcurrentType(type, concurrent); }
+
     virtual void __stdcall createTrigger(trigid_t id, int flags, Object * value) { tm.createTrigger(id,flags,value); }
 
     virtual void __stdcall destroyTrigger(trigid_t id) { tm.destroyTrigger(id); }
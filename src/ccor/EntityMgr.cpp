@@ -16,12 +16,31 @@ namespace ccor {
 
 static const int ACTIVITY_RATE_NORMAL       = 1000;
 static const int ACTIVITY_RATE_MAX          = 2 * ACTIVITY_RATE_NORMAL;
-static const int ACTIVITY_MAX_DELAY_CLOCK   = 5 * CLOCKS_PER_SEC;
+static const float ACTIVITY_MAX_DELAY      = 5.0f;
+
+
+EntityMgr::EntityMgr() {
+    acting = false;
+    actTick = 0;
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceFrequency(&frequency);
+    tickPeriod = 1.0 / double(frequency.QuadPart);
+    actSemaphore = NULL;
+    actDone = NULL;
+    nextActBatch = 0;
+    pendingActs = 0;
+    actFailed = 0;
+    stopWorkers = false;
+    actingConcurrently = 0;
+    deferredLock = 0;
+    handlingTriggers = false;
+}
 
 
 entid_t EntityMgr::createEntity(const char * type, entid_t idParent, Object * param) {
 
     if (NULL==type) throw Exception("core: Invalid entity type [NULL]");
+    if (actingConcurrently) throw Exception("core: Entity '%s' is created by concurrent act", type);
     if (-1!=idParent) checkId(idParent);
     // Get component
     ComponentMgr * comgr = SingleComponentMgr::getInstance();
@@ -100,6 +119,7 @@ entid_t EntityMgr::createEntity(const char * type, entid_t idParent, Object * pa
 
 void EntityMgr::destroyEntity(entid_t id) {
     if (id==-1) return;
+    if (actingConcurrently) throw Exception("core: Entity id=%d is destroyed by concurrent act", id);
     // checkId(id);
     // Notify subscribers that entity is to be destroyed
     TrigEntityLife::Param trigParam;
@@ -125,6 +145,13 @@ void EntityMgr::destroyEntity(entid_t id) {
             break;
         }
     }
+    unscheduleEntity(id);
+    if (!ec.trigevt.empty()) {
+        ec.trigevt.clear();
+        std::vector<entid_t>::iterator it = std::find(triggered.begin(), triggered.end(), id);
+        if (handlingTriggers) *it = -1;
+        else triggered.erase(it);
+    }
     // physically destroy entity
     ec.entity->entityDestroy();
     // remove id from parent entity
@@ -283,7 +310,7 @@ typeid_t EntityMgr::createChunkType(IComponent * c, const char* typeName) {
 
     chunkType[id].comp = c;
     chunkType[id].name = validTypeName;
-    chunkType[id].actMilli = 0;
+    chunkType[id].concurrent = concurrentTypes.find(typeName)!=concurrentTypes.end();
     return id;
 
 }
@@ -304,17 +331,190 @@ entid_t EntityMgr::createChunkEntity(EntityBase * entity, typeid_t typeId) {
 
     chunkEntity[id].entity = entity;
     chunkEntity[id].typeId = typeId;
-    chunkEntity[id].lastMilli = ::clock();
-    chunkEntity[id].actMilli = 0;
     chunkEntity[id].actRate  = ACTIVITY_RATE_NORMAL;
-    chunkEntity[id].actAccumulate = 0;
+    chunkEntity[id].actBatch = -1;
     chunkEntity[id].children.push_back(-1);
+    LARGE_INTEGER counter;
+    ::QueryPerformanceCounter(&counter);
+    scheduleEntity(id, counter.QuadPart);
     return id;
 }
 
 
+int EntityMgr::getActBatch(typeid_t typeId, int actRate) {
+    int key = typeId * (ACTIVITY_RATE_MAX + 1) + actRate;
+    MapActBatch::const_iterator it = mapActBatch.find(key);
+    if (it!=mapActBatch.end()) return it->second;
+
+    EntityActBatch * batch = new EntityActBatch();
+    batch->typeId = typeId;
+    batch->actRate = actRate;
+    batch->actAccumulate = 0;
+    batch->holes = false;
+    int batchId = actBatches.size();
+    actBatches.push_back(batch);
+    mapActBatch[key] = batchId;
+
+    // Batches are acted in order of types, more active batch of type goes first
+    unsigned int pos = 0;
+    for (; pos < actOrder.size(); ++pos) {
+        const EntityActBatch * b = actBatches[actOrder[pos]];
+        if (b->typeId > typeId || b->typeId==typeId && b->actRate < actRate) break;
+    }
+    actOrder.insert(actOrder.begin()+pos, batchId);
+    return batchId;
+}
+
+
+void EntityMgr::scheduleEntity(entid_t id, __int64 lastTick) {
+    EntityChunk& ec = chunkEntity[id];
+    ec.actBatch = getActBatch(ec.typeId, ec.actRate);
+    EntityActBatch * batch = actBatches[ec.actBatch];
+    ec.actSlot = batch->entities.size();
+    batch->entities.push_back(ec.entity);
+    batch->ids.push_back(id);
+    batch->lastTick.push_back(lastTick);
+}
+
+
+void EntityMgr::unscheduleEntity(entid_t id) {
+    EntityChunk& ec = chunkEntity[id];
+    if (ec.actBatch < 0) return;
+    EntityActBatch * batch = actBatches[ec.actBatch];
+    int slot = ec.actSlot;
+    if (acting) {
+        // Batch may be iterated right now, it's compacted after act
+        batch->entities[slot] = NULL;
+        if (!batch->holes) {
+            batch->holes = true;
+            holeBatches.push_back(ec.actBatch);
+        }
+    }
+    else {
+        int last = batch->entities.size() - 1;
+        if (slot!=last) {
+            batch->entities[slot] = batch->entities[last];
+            batch->ids[slot] = batch->ids[last];
+            batch->lastTick[slot] = batch->lastTick[last];
+            chunkEntity[batch->ids[slot]].actSlot = slot;
+        }
+        batch->entities.pop_back();
+        batch->ids.pop_back();
+        batch->lastTick.pop_back();
+    }
+    ec.actBatch = -1;
+}
+
+
+void EntityMgr::compactActBatches() {
+    for (unsigned int i=0; i < holeBatches.size(); ++i) {
+        EntityActBatch * batch = actBatches[holeBatches[i]];
+        unsigned int count = 0;
+        for (unsigned int j=0; j < batch->entities.size(); ++j) {
+            if (NULL==batch->entities[j]) continue;
+            batch->entities[count] = batch->entities[j];
+            batch->ids[count] = batch->ids[j];
+            batch->lastTick[count] = batch->lastTick[j];
+            chunkEntity[batch->ids[count]].actSlot = count;
+            ++count;
+        }
+        batch->entities.resize(count);
+        batch->ids.resize(count);
+        batch->lastTick.resize(count);
+        batch->holes = false;
+    }
+    holeBatches.clear();
+}
+
+
+void EntityMgr::actBatch(int batchId) {
+    EntityActBatch * batch = actBatches[batchId];
+    // Entities created by entityAct() are appended and acted in this tick too
+    for (unsigned int i=0; i < batch->entities.size(); ++i) {
+        EntityBase * e = batch->entities[i];
+        if (NULL==e) continue;
+        float dt = float((actTick - batch->lastTick[i]) * tickPeriod);
+        if (dt>ACTIVITY_MAX_DELAY) dt=ACTIVITY_MAX_DELAY;
+        if (dt<0) dt=0;
+        batch->lastTick[i] = actTick;
+        if (!e->entityEverActed()) {
+            getCore()->logMessage("core: acting '%s'[%d]",
+                chunkType[batch->typeId].name, e->getid());
+        }
+        e->entityAct(dt);
+        if (batch->entities[i]==e) const_cast<unsigned&>(e->entityNumActs)++;
+    }
+}
+
+
+void EntityMgr::actConcurrentBatches() {
+    long i;
+    while ((i = ::InterlockedIncrement(&nextActBatch) - 1) < long(concurrentBatches.size())) {
+        try {
+            actBatch(concurrentBatches[i]);
+        }
+        catch(const Exception& e) {
+            if (!::InterlockedExchange(&actFailed, 1)) actException = e;
+        }
+        catch(...) {
+            if (!::InterlockedExchange(&actFailed, 1)) actException = Exception("core: Unknown exception in concurrent entityAct()");
+        }
+        if (!::InterlockedDecrement(&pendingActs)) ::SetEvent(actDone);
+    }
+}
+
+
+unsigned long __stdcall EntityMgr::actWorker(void * data) {
+    EntityMgr * em = static_cast<EntityMgr *>(data);
+    while (true) {
+        ::WaitForSingleObject(em->actSemaphore, INFINITE);
+        if (em->stopWorkers) break;
+        em->actConcurrentBatches();
+        if (!::InterlockedDecrement(&em->pendingActs)) ::SetEvent(em->actDone);
+    }
+    return 0;
+}
+
+
+void EntityMgr::startActWorkers() {
+    SYSTEM_INFO systemInfo;
+    ::GetSystemInfo(&systemInfo);
+    actSemaphore = ::CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+    actDone = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (NULL==actSemaphore || NULL==actDone) throw Exception("core: Unable to create act workers");
+    // Main thread acts too, so one worker less than processors
+    for (unsigned int i=1; i < systemInfo.dwNumberOfProcessors; ++i) {
+        HANDLE thread = ::CreateThread(NULL, 0, actWorker, this, 0, NULL);
+        if (NULL==thread) break;
+        actWorkers.push_back(thread);
+    }
+}
+
+
+void EntityMgr::stopActWorkers() {
+    if (NULL==actSemaphore) return;
+    stopWorkers = true;
+    if (!actWorkers.empty()) {
+        ::ReleaseSemaphore(actSemaphore, actWorkers.size(), NULL);
+        ::WaitForMultipleObjects(actWorkers.size(), &actWorkers[0], TRUE, INFINITE);
+    }
+    for (unsigned int i=0; i < actWorkers.size(); ++i) {
+        ::CloseHandle(actWorkers[i]);
+    }
+    actWorkers.clear();
+    ::CloseHandle(actSemaphore);
+    ::CloseHandle(actDone);
+    actSemaphore = NULL;
+    actDone = NULL;
+}
+
+
 EntityMgr::~EntityMgr() {
     destroyAll();
+    stopActWorkers();
+    for (unsigned int i=0; i < actBatches.size(); ++i) {
+        delete actBatches[i];
+    }
 }
 
 
@@ -340,53 +540,75 @@ void EntityMgr::destroyAll() {
 
 void EntityMgr::actEntities() {
 
-    // Process trigger handlers for all entities
-    for (unsigned i=0; i < chunkEntity.size(); ++i) {
-        if (NULL!=chunkEntity[i].entity) {
-            for (unsigned int j=0; i<chunkEntity.size() && j<chunkEntity[i].trigevt.size(); ++j) {
-                EntityTriggerEvent evt=chunkEntity[i].trigevt[j];
-                chunkEntity[i].entity->entityHandleEvent(-1,evt.id,evt.param);
+    // Process trigger handlers for entities having pending events, handlers may
+    // destroy entities, so list is compacted when iteration is over
+    handlingTriggers = true;
+    try {
+        for (unsigned i=0; i < triggered.size(); ++i) {
+            entid_t id = triggered[i];
+            if (-1==id) continue;
+            for (unsigned int j=0; j<chunkEntity[id].trigevt.size() && NULL!=chunkEntity[id].entity; ++j) {
+                EntityTriggerEvent evt=chunkEntity[id].trigevt[j];
+                chunkEntity[id].entity->entityHandleEvent(-1,evt.id,evt.param);
             }
         }
     }
-    // Act all entities
-    // Also count time statistics for entity and for it's type
-    // Also take into account entity's activity rate
-    clock_t curMilli = -1;
-    for (unsigned i=0; i < chunkEntity.size(); ++i) {
-        EntityChunk& ec = chunkEntity[i];
-        if (NULL!=ec.entity) {
-            assert(ec.actRate >= 0);
-            assert(ec.actRate <= ACTIVITY_RATE_MAX);
-            if ((ec.actAccumulate += ec.actRate) >= ACTIVITY_RATE_MAX) {
-                ec.actAccumulate -= ACTIVITY_RATE_MAX;
-                if (curMilli<0) curMilli = ::clock();
-                clock_t dc = curMilli - ec.lastMilli;
-                if (dc>ACTIVITY_MAX_DELAY_CLOCK) dc=ACTIVITY_MAX_DELAY_CLOCK;
-                float dt = dc * (1.0f/CLOCKS_PER_SEC);
-                /*
-                if( dt < dtConst )
-                {
-                    Sleep( DWORD( ( dtConst - dt ) * 1000.0f ) );
-                    dt = dtConst;
-                }
-                */
-                ec.lastMilli = curMilli;
-                if (!ec.entity->entityEverActed()) {
-                    getCore()->logMessage("core: acting '%s'[%d]",
-                        chunkType[ec.typeId].name, ec.entity->getid());
-                }
-                ec.entity->entityAct(dt);
-                const_cast<unsigned&>(chunkEntity[i].entity->entityNumActs)++;
-                clock_t curMilli2 = ::clock();
-                clock_t actTime = curMilli2 - curMilli;
-                chunkEntity[i].actMilli += actTime;
-                chunkType[chunkEntity[i].typeId].actMilli += actTime;
-                curMilli = curMilli2;
-                // update system timer
-                TimeMgr::instance->getSystemTime()->advance(actTime * (1.0f/CLOCKS_PER_SEC));
-            }
+    catch(...) {
+        handlingTriggers = false;
+        triggered.erase(std::remove(triggered.begin(), triggered.end(), entid_t(-1)), triggered.end());
+        throw;
+    }
+    handlingTriggers = false;
+    triggered.erase(std::remove(triggered.begin(), triggered.end(), entid_t(-1)), triggered.end());
+    // Clock is read once per tick, due entity gets time passed since its previous act
+    LARGE_INTEGER counter;
+    ::QueryPerformanceCounter(&counter);
+    actTick = counter.QuadPart;
+    bool acted = false;
+    // Act due batches in order, batches of concurrent types are collected and
+    // acted together by workers when the rest is done
+    actQueue = actOrder;
+    concurrentBatches.clear();
+    acting = true;
+    try {
+        for (unsigned int i=0; i < actQueue.size(); ++i) {
+            EntityActBatch * batch = actBatches[actQueue[i]];
+            assert(batch->actRate >= 0);
+            assert(batch->actRate <= ACTIVITY_RATE_MAX);
+            if (batch->entities.empty()) continue;
+            if ((batch->actAccumulate += batch->actRate) < ACTIVITY_RATE_MAX) continue;
+            batch->actAccumulate -= ACTIVITY_RATE_MAX;
+            acted = true;
+            if (chunkType[batch->typeId].concurrent) concurrentBatches.push_back(actQueue[i]);
+            else actBatch(actQueue[i]);
         }
+        if (!concurrentBatches.empty()) {
+            if (NULL==actDone) startActWorkers();
+            long numWorkers = std::min(long(actWorkers.size()), long(concurrentBatches.size()) - 1);
+            // Each batch and each woken worker checks out, so no worker outlives the tick
+            nextActBatch = 0;
+            actFailed = 0;
+            pendingActs = concurrentBatches.size() + numWorkers;
+            actingConcurrently = 1;
+            if (numWorkers) ::ReleaseSemaphore(actSemaphore, numWorkers, NULL);
+            actConcurrentBatches();
+            ::WaitForSingleObject(actDone, INFINITE);
+            actingConcurrently = 0;
+            flushDeferredMessages();
+            if (actFailed) throw actException;
+        }
+    }
+    catch(...) {
+        acting = false;
+        compactActBatches();
+        throw;
+    }
+    acting = false;
+    compactActBatches();
+    // update system timer by time spent acting, as it was when acts were timed one by one
+    if (acted) {
+        ::QueryPerformanceCounter(&counter);
+        TimeMgr::instance->getSystemTime()->advance(float((counter.QuadPart - actTick) * tickPeriod));
     }
     /*
     // Manage vtbl transforms
@@ -402,9 +624,42 @@ void EntityMgr::actEntities() {
 
 void EntityMgr::setActivity(entid_t id, float activityRate) {
     checkId(id);
+    if (actingConcurrently) throw Exception("core: Activity of entity id=%d is changed by concurrent act", id);
     if (activityRate < 0) activityRate = 0;
     if (activityRate > 1) activityRate = 1;
-    chunkEntity[id].actRate = (int)(2 * activityRate * ACTIVITY_RATE_NORMAL);
+    int actRate = (int)(2 * activityRate * ACTIVITY_RATE_NORMAL);
+    EntityChunk& ec = chunkEntity[id];
+    if (ec.actRate==actRate) return;
+    // Entity moves to batch of new rate and keeps its act time
+    __int64 lastTick = actBatches[ec.actBatch]->lastTick[ec.actSlot];
+    unscheduleEntity(id);
+    ec.actRate = actRate;
+    scheduleEntity(id, lastTick);
+}
+
+
+void EntityMgr::setConcurrentType(const char * type, bool concurrent) {
+    if (NULL==type) throw Exception("core: Invalid entity type [NULL]");
+    if (concurrent) concurrentTypes.insert(type);
+    else concurrentTypes.erase(type);
+    MapTypeId::const_iterator it = mapTypeId.find(type);
+    if (it!=mapTypeId.end()) chunkType[it->second].concurrent = concurrent;
+}
+
+
+void EntityMgr::deferMessage(const char * message) {
+    while (::InterlockedExchange(&deferredLock, 1)) ::Sleep(0);
+    deferredMessages.push_back(message);
+    ::InterlockedExchange(&deferredLock, 0);
+}
+
+
+void EntityMgr::flushDeferredMessages() {
+    std::vector<std::string> messages;
+    messages.swap(deferredMessages);
+    for (unsigned int i=0; i < messages.size(); ++i) {
+        getCore()->logMessage("%s", messages[i].c_str());
+    }
 }
 
 
@@ -416,6 +671,7 @@ void EntityMgr::handleTrigger(entid_t id, trigid_t trigId, Object * param, bool
     }
     else {
         EntityChunk& ec=chunkEntity[id];
+        if (ec.trigevt.empty()) triggered.push_back(id);
         ec.trigevt.push_back(EntityTriggerEvent());
         ec.trigevt.back().id = trigId;
         ec.trigevt.back().param = param;
@@ -23,20 +23,33 @@ struct EntityTypeChunk {
     IComponent * comp;
     const char * name;
     std::vector<entid_t> instances;
-    clock_t actMilli;
+    bool concurrent;
 };
 
 struct EntityChunk {
     EntityBase * entity;
     std::vector<entid_t> children;
     typeid_t typeId;
-    clock_t lastMilli;
-    clock_t actMilli;
     int actRate;
-    int actAccumulate;
+    int actBatch;
+    int actSlot;
     std::vector<EntityTriggerEvent> trigevt;
 };
 
+/**
+ * Entities of one type sharing activation rate, they are acted together
+ * in one batch, so rate accumulator is kept per batch
+ */
+struct EntityActBatch {
+    typeid_t typeId;
+    int actRate;
+    int actAccumulate;
+    bool holes;
+    std::vector<EntityBase *> entities;
+    std::vector<entid_t> ids;
+    std::vector<__int64> lastTick;
+};
+
 
 /**
  * Manages entities creation, destroying, sending events
@@ -44,7 +57,7 @@ struct EntityChunk {
 class EntityMgr {
 public:    
 
-    EntityMgr() { }
+    EntityMgr();
 
     ~EntityMgr();
 
@@ -74,6 +87,15 @@ public:
 
     void setActivity(entid_t id, float activityRate);
 
+    void setConcurrentType(const char * type, bool concurrent);
+
+    bool isActingConcurrently() const { return actingConcurrently!=0; }
+
+    /**
+     * Keep message of concurrent act until workers are done, log file is written by main thread only
+     */
+    void deferMessage(const char * message);
+
     void actEntities();
 
     void handleTrigger(entid_t id, trigid_t trigId, Object * param, bool immediate);
@@ -100,10 +122,49 @@ private:
     VtableDisplace vtableDisplace;
     find_entity_t entityResult;
     find_str_t strResult;
+    std::vector<entid_t> triggered;
+    std::set<std::string> concurrentTypes;
+    bool handlingTriggers;      // triggered is iterated, destroyed entities leave -1 there
+
+    // Activation scheduler
+    typedef std::map<int, int> MapActBatch;
+    MapActBatch mapActBatch;
+    std::vector<EntityActBatch *> actBatches;
+    std::vector<int> actOrder;
+    std::vector<int> actQueue;
+    std::vector<int> holeBatches;
+    bool acting;
+    __int64 actTick;
+    double tickPeriod;
+
+    // Workers acting concurrent types
+    std::vector<int> concurrentBatches;
+    std::vector<void *> actWorkers;
+    void * actSemaphore;
+    void * actDone;
+    volatile long nextActBatch;
+    volatile long pendingActs;
+    volatile long actFailed;
+    bool stopWorkers;
+    Exception actException;
+    volatile long actingConcurrently;
+    volatile long deferredLock;                 // spin lock of deferredMessages
+    std::vector<std::string> deferredMessages;  // logged by concurrent acts
 
     typeid_t createChunkType(IComponent * c, const char* typeName);
     entid_t createChunkEntity(EntityBase * entity, typeid_t typeId);
 
+    int getActBatch(typeid_t typeId, int actRate);
+    void scheduleEntity(entid_t id, __int64 lastTick);
+    void unscheduleEntity(entid_t id);
+    void compactActBatches();
+    void actBatch(int batchId);
+    void actConcurrentBatches();
+    void startActWorkers();
+    void stopActWorkers();
+    void flushDeferredMessages();
+    static unsigned long __stdcall actWorker(void * data);
+
 };
 
 }
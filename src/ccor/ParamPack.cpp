@@ -9,10 +9,13 @@
 
 namespace ccor {
 
+volatile long ParamPack::nextRevision = 0;
+
 ParamPack::ParamPack() {
     resName = "";
     changed = false;
     tmpbuf[0] = '\0';
+    resetIndex();
     //add("$.tmp$");
     params.push_back(new ObjParam("$.tmp$"));
 }
@@ -29,14 +32,101 @@ void ParamPack::clear() {
     layout.clear();
     listeners.clear();
 
-    ids.clear();
+    resetIndex();
 
     for(ParamVector::iterator pvit = params.begin(); pvit != params.end(); ++pvit)
         delete *pvit;
     params.clear();
+
+    releasePacked();
+}
+
+void ParamPack::releasePacked() {
+    for(PackedParamsVector::iterator it = packed.begin(); it != packed.end(); ++it)
+        delete *it;
+    packed.clear();
+}
+
+void ParamPack::resetIndex() {
+    hashTable.assign(64, ParamSlot());
+    for(ParamHashTable::iterator it = hashTable.begin(); it != hashTable.end(); ++it)
+        it->id = -1;
+    hashCount = 0;
+    sortedIds.clear();
+    sortedIdsValid = false;
+    // revisions are unique process-wide, so key cached for destroyed pack never matches
+    // another pack allocated at the same address
+    revision = ::InterlockedIncrement(&nextRevision);
+}
+
+void ParamPack::indexParam(paramid_t id) {
+
+    // keep load factor below 1/2, table size is power of two
+    if(2 * (hashCount + 1) > int(hashTable.size())) {
+        ParamHashTable oldTable;
+        oldTable.swap(hashTable);
+        ParamSlot emptySlot;
+        emptySlot.hash = 0;
+        emptySlot.id = -1;
+        hashTable.assign(oldTable.size() * 2, emptySlot);
+        hashCount = 0;
+        for(ParamHashTable::iterator it = oldTable.begin(); it != oldTable.end(); ++it)
+            if(it->id != -1) indexParam(it->id);
+    }
+
+    unsigned int mask = hashTable.size() - 1;
+    unsigned int slot = params[id]->hash & mask;
+    while(hashTable[slot].id != -1) slot = (slot + 1) & mask;
+    hashTable[slot].hash = params[id]->hash;
+    hashTable[slot].id = id;
+    ++hashCount;
+    sortedIdsValid = false;
+}
+
+paramid_t ParamPack::findHashed(const char * name, unsigned int hash) {
+    unsigned int mask = hashTable.size() - 1;
+    for(unsigned int slot = hash & mask; hashTable[slot].id != -1; slot = (slot + 1) & mask) {
+        if(hashTable[slot].hash == hash && params[hashTable[slot].id]->name == name)
+            return hashTable[slot].id;
+    }
+    return -1;
+}
+
+struct ParamNameLess {
+    ParamVector * params;
+    ParamNameLess(ParamVector * params) { this->params = params; }
+    bool operator()(paramid_t a, paramid_t b) const { 
+        return ::strcmp((*params)[a]->name.c_str(), (*params)[b]->name.c_str()) < 0; 
+    }
+};
+
+struct ParamPrefixLess {
+    ParamVector * params;
+    ParamPrefixLess(ParamVector * params) { this->params = params; }
+    bool operator()(paramid_t a, const char * prefix) const { 
+        return ::strcmp((*params)[a]->name.c_str(), prefix) < 0; 
+    }
+};
+
+void ParamPack::updateSortedIds() {
+    if(sortedIdsValid) return;
+
+    sortedIds.clear();
+    for(ParamHashTable::iterator it = hashTable.begin(); it != hashTable.end(); ++it)
+        if(it->id != -1) sortedIds.push_back(it->id);
+    std::sort(sortedIds.begin(), sortedIds.end(), ParamNameLess(&params));
+    sortedIdsValid = true;
+}
+
+ParamIndex::iterator ParamPack::findPrefix(const char * prefix) {
+    updateSortedIds();
+    return std::lower_bound(sortedIds.begin(), sortedIds.end(), prefix, ParamPrefixLess(&params));
 }
 
 void ParamPack::ChangeParam(paramid_t id) {
+    // old value is swapped to temporary slot below, listeners should see it decoded
+    DecodeParam(id);
+
     ListenerVector::iterator it;
     for(it = listeners.begin(); it != listeners.end(); ++it)
         if(!(*it)->onParamPreChange(this, id, 0))
@@ -66,11 +156,11 @@ paramid_t ParamPack::add(const char * qualifiedName) {
         ::strncpy(nameEx, qualifiedName, nameLength - 1);
         int i = 0;
         do ::sprintf(nameEx + nameLength - 1, "%04d", ++i);
-        while(ids.find(nameEx) != ids.end());
+        while(findHashed(nameEx, hashParamName(nameEx)) != -1);
         if(i >= 10000) throw Exception("ccor : too many parameters \"%s\"", qualifiedName);
         params.push_back(new ObjParam(nameEx));
         id = params.size() - 1;
-        ids[params.back()->name.c_str()] = id;
+        indexParam(id);
     }
     else {
 
@@ -81,37 +171,70 @@ paramid_t ParamPack::add(const char * qualifiedName) {
             char name[BUF_SIZE] = "";
             ::strncpy(name, qualifiedName, namelen);
 
+            // zero index names base parameter, as normalizeParamName() looks it up
             int i = ::atoi(leftBracket + 1);
-            int imax = getMaxIndex(name);
-            while(++imax <= i) {
+            if(!i) {
+                params.push_back(new ObjParam(name));
+                id = params.size() - 1;
+                indexParam(id);
+                return id;
+            }
+
+            // indexed parameters are contiguous, so missing ones are found probing down
+            // from requested index, each probe is paid by parameter added below
+            int imin = i;
+            while(imin > 1) {
+                ::sprintf(name + namelen, "[%04d]", imin - 1);
+                if(findHashed(name, hashParamName(name)) != -1) break;
+                --imin;
+            }
+            for(int imax = imin; imax <= i; ++imax) {
 
                 ::sprintf(name + namelen, "[%04d]", imax);
                 params.push_back(new ObjParam(name));
                 id = params.size() - 1;
-                ids[params.back()->name.c_str()] = id;
+                indexParam(id);
             }
         }
         else {
 
             params.push_back(new ObjParam(qualifiedName));
             id = params.size() - 1;
-            ids[params.back()->name.c_str()] = id;
+            indexParam(id);
         }
     }
 
     return id;
 }
 
+paramid_t ParamPack::addHashed(const char * name, unsigned int hash) {
+    paramid_t id = findHashed(name, hash);
+    if(id != -1) return id;
+
+    // indexed and numbered names need add() to keep indices contiguous
+    int nameLength = ::strlen(name);
+    if(!nameLength || ::strchr(name, '[') || name[nameLength - 1] == '@')
+        return add(name);
+
+    params.push_back(new ObjParam(name, hash));
+    id = params.size() - 1;
+    indexParam(id);
+    return id;
+}
+
 int ParamPack::getMaxIndex(paramid_t id) {
 
     CheckID(id);
 
-    std::string param = params[id]->name.c_str();
-    ParamMap::iterator it = ids.upper_bound((param + "[\xFF").c_str());
-    paramid_t upperId = (--it)->second;
-    if(params[upperId]->name.length() > param.length())
-        if(params[upperId]->name[param.length()] == '[')
-            return ::atoi(params[upperId]->name.c_str() + param.length() + 1);
+    // last of "name[....]" parameters precedes "name\\"
+    std::string param = params[id]->name + "\\";
+    ParamIndex::iterator it = findPrefix(param.c_str());
+    if(it == sortedIds.begin()) return 0;
+    const std::string & upperName = params[*(--it)]->name;
+    param.resize(param.length() - 1);
+    if(upperName.length() > param.length() && !upperName.compare(0, param.length(), param))
+        if(upperName[param.length()] == '[')
+            return ::atoi(upperName.c_str() + param.length() + 1);
 
     return 0;
 }
@@ -234,6 +357,7 @@ void ParamPack::set(paramid_t id, const Vector4f & vec) {
 
 void ParamPack::get(paramid_t id, int & value) {
     CheckID(id);
+    DecodeParam(id);
 
     switch(params[id]->type) {
         case PT_INT :
@@ -269,6 +393,7 @@ void ParamPack::get(paramid_t id, int & value) {
 
 void ParamPack::get(paramid_t id, float & value) {
     CheckID(id);
+    DecodeParam(id);
 
     switch(params[id]->type) {
         case PT_INT :
@@ -304,6 +429,7 @@ void ParamPack::get(paramid_t id, float & value) {
 
 void ParamPack::get(paramid_t id, bool & value) {
     CheckID(id);
+    DecodeParam(id);
 
     switch(params[id]->type) {
         case PT_INT :
@@ -354,6 +480,7 @@ void ParamPack::get(paramid_t id, bool & value) {
 
 void ParamPack::get(paramid_t id, Object *& value) {
     CheckID(id);
+    DecodeParam(id);
 
     switch(params[id]->type) {
         case PT_OBJECT :
@@ -379,6 +506,7 @@ void ParamPack::get(paramid_t id, Object *& value) {
 
 const char * ParamPack::gets(paramid_t id) {
     CheckID(id);
+    DecodeParam(id);
 
     switch(params[id]->type) {
         case PT_INT :
@@ -429,6 +557,7 @@ const char * ParamPack::gets(paramid_t id) {
 
 void ParamPack::get(paramid_t id, Vector2f & vec) {
     CheckID(id);
+    DecodeParam(id);
     
     Vector2f tmpvec;
 
@@ -472,6 +601,7 @@ void ParamPack::get(paramid_t id, Vector2f & vec) {
 
 void ParamPack::get(paramid_t id, Vector3f & vec) {
     CheckID(id);
+    DecodeParam(id);
 
     Vector3f tmpvec;
 
@@ -516,6 +646,7 @@ void ParamPack::get(paramid_t id, Vector3f & vec) {
 
 void ParamPack::get(paramid_t id, Vector4f & vec) {
     CheckID(id);
+    DecodeParam(id);
 
     Vector4f tmpvec;
 
@@ -600,6 +731,7 @@ Vector4f __stdcall ParamPack::getv(paramid_t id, const Vector4f& dv) {
 
 void ParamPack::optimizeValue(paramid_t id) {
     CheckID(id);
+    DecodeParam(id);
 
     ObjParam * param = params[id];
 
@@ -639,35 +771,25 @@ paramid_t ParamPack::find(const char * qualifiedName) {
 
     tmpbuf[0] = '\0';
 
-    char findname[BUF_SIZE];
-    ::strcpy(findname, qualifiedName);
-
-    ParamMap::iterator it;
     paramid_t id = -1;
-    char * templend = ::strchr(findname, '*');
+    const char * templend = ::strchr(qualifiedName, '*');
     if(templend) {
-        *templend = '\0';
-        if((it = ids.lower_bound(findname)) != ids.end())
-            if(!::strncmp(it->first, findname, ::strlen(findname)))
-                id = it->second;
+        std::string prefix(qualifiedName, templend - qualifiedName);
+        ParamIndex::iterator it = findPrefix(prefix.c_str());
+        if(it != sortedIds.end())
+            if(!params[*it]->name.compare(0, prefix.length(), prefix))
+                id = *it;
+    }
+    else if(::strchr(qualifiedName, '[')) {
+        char findname[BUF_SIZE];
+        if(normalizeParamName(findname, qualifiedName, BUF_SIZE))
+            id = findHashed(findname, hashParamName(findname));
     }
     else {
-
-        char * leftBracket = ::strrchr(findname, '[');
-        if(leftBracket) {
-
-            int i = ::atoi(leftBracket + 1);
-            if(i)
-                ::sprintf(leftBracket + 1, "%04d]", i);
-            else
-                *leftBracket = '\0';
-        }
-
-        if((it = ids.find(findname)) != ids.end())
-            id = it->second;
+        id = findHashed(qualifiedName, hashParamName(qualifiedName));
     }
 
-    if(id == -1) ::strcpy(tmpbuf, qualifiedName);
+    if(id == -1) ::strncpy(tmpbuf, qualifiedName, BUF_SIZE - 1), tmpbuf[BUF_SIZE - 1] = '\0';
 
     return id;
 }
@@ -675,27 +797,18 @@ paramid_t ParamPack::find(const char * qualifiedName) {
 int ParamPack::findParams(const char * qualifiedName) {
     findBuf.clear();
 
-    char findname[BUF_SIZE];
-    ::strcpy(findname, qualifiedName);
-    ParamMap::iterator it;
-    char * templend = ::strchr(findname, '*');
+    const char * templend = ::strchr(qualifiedName, '*');
     if(templend) {
-        *templend = '\0';
-        it = ids.lower_bound(findname);
-
-        *templend = '\xFF';
-        *(templend + 1) = '\0';
-        ParamMap::iterator upperit = ids.upper_bound(findname);
-
-        while(it != upperit) {
-            findBuf.push_back(it->second);
-            ++it;
+        std::string prefix(qualifiedName, templend - qualifiedName);
+        for(ParamIndex::iterator it = findPrefix(prefix.c_str()); it != sortedIds.end(); ++it) {
+            if(params[*it]->name.compare(0, prefix.length(), prefix)) break;
+            findBuf.push_back(*it);
         }
     }
     else {
-        it = ids.find(qualifiedName);
-        if(it != ids.end())
-            findBuf.push_back(it->second);
+        paramid_t id = findHashed(qualifiedName, hashParamName(qualifiedName));
+        if(id != -1)
+            findBuf.push_back(id);
     }
 
     paramResult = findBuf;
@@ -930,8 +1043,52 @@ int UTF8Converter::fromASCIIToUTF8(const char * ascii_s, char * s, int slen) {
 
 inline ObjParam::ObjParam(const char * name) {
     this->name = name;
+    this->hash = hashParamName(name);
+    type = PT_INT;
+    this->value.iValue = 0;
+    packedOp = NULL;
+    packedParams = NULL;
+}
+
+inline ObjParam::ObjParam(const char * name, unsigned int hash) {
+    this->name = name;
+    this->hash = hash;
     type = PT_INT;
     this->value.iValue = 0;
+    packedOp = NULL;
+    packedParams = NULL;
+}
+
+void ObjParam::decode() {
+    const PackedOp * op = packedOp;
+    packedOp = NULL;
+
+    release();
+    type = ParamType(op->type);
+    switch(type) {
+        case PT_STRING :
+            value.sValue = ::strdup(packedParams->strings + op->value);
+            break;
+
+        case PT_VECTOR2 :
+        case PT_VECTOR3 :
+        case PT_VECTOR4 :
+            const float * vec;
+            vec = packedParams->floats + op->value;
+            value.vecValue = new Vector4f(vec[0], vec[1], type != PT_VECTOR2 ? vec[2] : 0.0f, type == PT_VECTOR4 ? vec[3] : 0.0f);
+            break;
+
+        case PT_FLOAT :
+            value.fValue = *reinterpret_cast<const float *>(&op->value);
+            break;
+
+        case PT_BOOL :
+            value.bValue = op->value != 0;
+            break;
+
+        default:
+            value.iValue = int(op->value);
+    }
 }
 
 void ObjParam::release() {
@@ -1415,6 +1572,23 @@ void ParamPackFactory::getFullParamName( char * name,
     }
 }
 
+void ParamPackFactory::addComment(ParamPack * pack, const char * s) {
+    pack->layout.addString(s);
+    if(compiler) compiler->addComment(s);
+}
+
+paramid_t ParamPackFactory::addParam(ParamPack * pack, const char * name, const char * value, bool layout) {
+    paramid_t id = pack->add(name);
+    pack->set(id, value);
+    if(layout) pack->layout.addParam(id);
+
+    if(compiler) {
+        pack->DecodeParam(id);
+        compiler->addParam(name, pack->params[id], layout);
+    }
+    return id;
+}
+
 void ParamPackFactory::nextLine(ParamPack * pack) {
     preadbuf->length = 0;
     preadbuf->buffer[0] = '\0';
@@ -1485,7 +1659,7 @@ int ParamPackFactory::nextString(ParamPack * pack, char * buf, paramid_t * id) {
         ::strcat(buf, preadbuf->buffer + tmpbufpos);
         //preadbuf->passComments = 0;
         for(StringVector::iterator it = preadbuf->passComments.begin(); it != preadbuf->passComments.end(); ++it)
-            pack->layout.addString(it->c_str());
+            addComment(pack, it->c_str());
         preadbuf->passComments.clear();
         //
 
@@ -1589,6 +1763,11 @@ void ParamPackFactory::loadFromFile( ParamPack * pack,
     res = icore->getResource(fname, "rt", type);
     if(!res) throw Exception("ccor: cannot load %s", fname);
 
+    if(compiler) {
+        std::string path = getResourcePath(fname, type);
+        compiler->addSource(path.c_str(), icore->getResourceTime(path.c_str()));
+    }
+
     if(loaded.size() == 1) pack->resName = fname;
 
     const char * signature = utfconv.getUTF8Signature();
@@ -1650,15 +1829,10 @@ void ParamPackFactory::loadFromFile( ParamPack * pack,
                 //::strcpy(fullName + includePrefix.length(), name);
                 //
 
-                id = pack->add(fullName);
-                //pack->set(id, value);
-                //
-                pack->set(id, values[0].c_str());
-                //
-                pack->layout.addParam(id);
+                id = addParam(pack, fullName, values[0].c_str(), true);
 
                 for(StringVector::iterator it = readbuf.passComments.begin(); it != readbuf.passComments.end(); ++it)
-                    pack->layout.addString(it->c_str());
+                    addComment(pack, it->c_str());
                 readbuf.passComments.clear();
                 //
                 char value[BUF_SIZE] = "";
@@ -1668,7 +1842,7 @@ void ParamPackFactory::loadFromFile( ParamPack * pack,
                     ::sprintf(name + namelen, "[%04d]", i);
                     ::strcpy(value, values[i].c_str());
                     //translateEscapeSequences(value);
-                    pack->set(pack->add(name), value);
+                    addParam(pack, name, value, false);
                 }
                 //
             }
@@ -1682,6 +1856,266 @@ void ParamPackFactory::loadFromFile( ParamPack * pack,
     loaded.erase(insertResult.first);
 }
 
+bool PackedParams::validate() {
+    const char * base = static_cast<const char *>(res->getData());
+    unsigned int size = res->getSize();
+    if(!base || size < sizeof(PackedParamsHeader))
+        return false;
+
+    header = reinterpret_cast<const PackedParamsHeader *>(base);
+    if(header->magic != PACKED_PARAMS_MAGIC || header->version != PACKED_PARAMS_VERSION)
+        return false;
+
+    unsigned int opsOffset = sizeof(PackedParamsHeader) + header->numSources * sizeof(PackedSource);
+    unsigned int floatsOffset = opsOffset + header->numOps * sizeof(PackedOp);
+    unsigned int stringsOffset = floatsOffset + header->numFloats * sizeof(float);
+    if(stringsOffset + header->stringsSize != size || !header->stringsSize || base[size - 1])
+        return false;
+
+    sources = reinterpret_cast<const PackedSource *>(base + sizeof(PackedParamsHeader));
+    ops = reinterpret_cast<const PackedOp *>(base + opsOffset);
+    floats = reinterpret_cast<const float *>(base + floatsOffset);
+    strings = base + stringsOffset;
+
+    // offsets are checked once here, so decoding of values needs no checks
+    unsigned int i;
+    for(i = 0; i < header->numSources; ++i)
+        if(sources[i].name >= header->stringsSize)
+            return false;
+
+    for(i = 0; i < header->numOps; ++i) {
+        const PackedOp & op = ops[i];
+        if(op.name >= header->stringsSize)
+            return false;
+
+        switch(op.type) {
+            case PACKED_OP_COMMENT :
+            case PT_INT :
+            case PT_FLOAT :
+            case PT_BOOL :
+                break;
+
+            case PT_STRING :
+                if(op.value >= header->stringsSize)
+                    return false;
+                break;
+
+            case PT_VECTOR2 :
+            case PT_VECTOR3 :
+            case PT_VECTOR4 :
+                if(op.value + (op.type - PT_VECTOR2 + 2) > header->numFloats)
+                    return false;
+                break;
+
+            default:
+                return false;
+        }
+    }
+
+    return true;
+}
+
+unsigned int ParamPackCompiler::addString(const char * s) {
+    StringOffsetMap::iterator it = stringOffsets.find(s);
+    if(it != stringOffsets.end())
+        return it->second;
+
+    unsigned int offset = strings.size();
+    strings.insert(strings.end(), s, s + ::strlen(s) + 1);
+    stringOffsets.insert(StringOffsetMap::value_type(s, offset));
+    return offset;
+}
+
+void ParamPackCompiler::addSource(const char * name, time_t lastModified) {
+    PackedSource source;
+    source.name = addString(name);
+    source.lastModified = (unsigned int) lastModified;
+    sources.push_back(source);
+}
+
+void ParamPackCompiler::addComment(const char * s) {
+    PackedOp op;
+    op.name = addString(s);
+    op.hash = 0;
+    op.type = PACKED_OP_COMMENT;
+    op.flags = 0;
+    op.value = 0;
+    ops.push_back(op);
+}
+
+void ParamPackCompiler::addParam(const char * name, const ObjParam * param, bool layout) {
+    PackedOp op;
+    op.name = addString(name);
+    op.hash = hashParamName(name);
+    op.type = (unsigned short) param->type;
+    op.flags = layout ? PACKED_OP_LAYOUT : 0;
+
+    switch(param->type) {
+        case PT_STRING :
+            op.value = addString(param->value.sValue);
+            break;
+
+        case PT_VECTOR2 :
+        case PT_VECTOR3 :
+        case PT_VECTOR4 :
+            const float * vec;
+            vec = param->value.vecValue->getPtr();
+            op.value = floats.size();
+            floats.insert(floats.end(), vec, vec + (param->type - PT_VECTOR2 + 2));
+            break;
+
+        case PT_FLOAT :
+            op.value = *reinterpret_cast<const unsigned int *>(&param->value.fValue);
+            break;
+
+        case PT_BOOL :
+            op.value = param->value.bValue ? 1 : 0;
+            break;
+
+        case PT_INT :
+            op.value = (unsigned int) param->value.iValue;
+            break;
+
+        default:
+            throw Exception("ccor : cannot compile parameter \"%s\"", name);
+    }
+
+    ops.push_back(op);
+}
+
+bool ParamPackCompiler::write(IResource * res) {
+    PackedParamsHeader header;
+    header.magic = PACKED_PARAMS_MAGIC;
+    header.version = PACKED_PARAMS_VERSION;
+    header.numSources = sources.size();
+    header.numOps = ops.size();
+    header.numFloats = floats.size();
+    header.stringsSize = strings.size();
+
+    FILE * file = res->getFile();
+    if(!::fwrite(&header, sizeof(header), 1, file))
+        return false;
+    if(!sources.empty() && !::fwrite(&sources[0], sizeof(PackedSource) * sources.size(), 1, file))
+        return false;
+    if(!ops.empty() && !::fwrite(&ops[0], sizeof(PackedOp) * ops.size(), 1, file))
+        return false;
+    if(!floats.empty() && !::fwrite(&floats[0], sizeof(float) * floats.size(), 1, file))
+        return false;
+    if(!strings.empty() && !::fwrite(&strings[0], strings.size(), 1, file))
+        return false;
+
+    return true;
+}
+
+std::string ParamPackFactory::getResourcePath(const char * name, const char * type) {
+    char fullPath[MAX_PATH];
+    return resMgr->getFullPath(fullPath, name, type);
+}
+
+bool ParamPackFactory::loadPacked(ParamPack * pack, const char * name, const char * path) {
+    ICore* icore = SingleCore::getInstance();
+
+    std::string packedName = path;
+    packedName += PACKED_PARAMS_SUFFIX;
+    if(!icore->getResourceTime(packedName.c_str()))
+        return false;
+
+    IResource * packedRes = icore->getResource(packedName.c_str(), "rb");
+    if(!packedRes)
+        return false;
+
+    PackedParams * packedParams = new PackedParams(packedRes);
+    if(!packedParams->validate()) {
+        icore->logMessage("ccor : invalid compiled config \"%s\"", packedName.c_str());
+        delete packedParams;
+        return false;
+    }
+
+    // compiled form is stale once config or any of its includes is modified
+    const PackedParamsHeader * header = packedParams->header;
+    unsigned int i;
+    for(i = 0; i < header->numSources; ++i) {
+        const PackedSource & source = packedParams->sources[i];
+        if((unsigned int) icore->getResourceTime(packedParams->strings + source.name) != source.lastModified) {
+            delete packedParams;
+            return false;
+        }
+    }
+
+    pack->resName = name;
+    pack->packed.push_back(packedParams);
+
+    // names and hashes are taken as is, values are decoded on first access
+    for(i = 0; i < header->numOps; ++i) {
+        const PackedOp * op = packedParams->ops + i;
+        if(op->type == PACKED_OP_COMMENT) {
+            pack->layout.addString(packedParams->strings + op->name);
+            continue;
+        }
+
+        paramid_t id = pack->addHashed(packedParams->strings + op->name, op->hash);
+        ObjParam * param = pack->params[id];
+        param->release();
+        param->type = PT_INT;
+        param->value.iValue = 0;
+        param->packedOp = op;
+        param->packedParams = packedParams;
+
+        if(op->flags & PACKED_OP_LAYOUT)
+            pack->layout.addParam(id);
+    }
+
+    return true;
+}
+
+void ParamPackFactory::writePacked(ParamPackCompiler * packCompiler, const char * path) {
+    std::string packedName = path;
+    packedName += PACKED_PARAMS_SUFFIX;
+
+    ICore* icore = SingleCore::getInstance();
+    IResource * packedRes = icore->getResource(packedName.c_str(), "wb");
+    if(!packedRes)
+        return;
+
+    bool written = packCompiler->write(packedRes);
+    packedRes->release();
+
+    // broken compiled form would be rejected by validate(), but don't leave it around
+    if(!written) {
+        icore->logMessage("ccor : cannot write compiled config \"%s\"", packedName.c_str());
+        ::remove(packedName.c_str());
+    }
+}
+
+void ParamPackFactory::loadPack(ParamPack * pack, const char * name, const char * type) {
+
+    // compiled form is kept next to config, as it is found by path map
+    std::string path = getResourcePath(name, type);
+
+    // listeners expect notification about each parsed value
+    if(pack->listeners.empty() && loadPacked(pack, name, path.c_str()))
+        return;
+
+    // only loose configs are compiled, time of mem files and packed ones isn't reliable
+    ICore* icore = SingleCore::getInstance();
+    bool compile = icore->getResourceTime(path.c_str()) && ::strncmp(name, "mem:", 4);
+
+    ParamPackCompiler packCompiler;
+    StringSet loaded;
+    compiler = compile ? &packCompiler : NULL;
+    try {
+        loadFromFile(pack, name, loaded, type);
+    }
+    catch(...) {
+        compiler = NULL;
+        throw;
+    }
+    compiler = NULL;
+
+    if(compile)
+        writePacked(&packCompiler, path.c_str());
+}
+
 IParamPack * ParamPackFactory::load(const char * name, const char * type) {
 
     if(!name) throw Exception("ccor : bad resource name");
@@ -1689,7 +2123,7 @@ IParamPack * ParamPackFactory::load(const char * name, const char * type) {
     checkLocalization();
 
     ParamPack * ppack = (ParamPack *) createInstance();
-    loadFromFile(ppack, name, StringSet(), type);
+    loadPack(ppack, name, type);
 
     ICore* icore = SingleCore::getInstance();
     ((ParamPack *) ppack)->lastModified = icore->getResourceTime(name);
@@ -1708,18 +2142,19 @@ void ParamPackFactory::load(IParamPack * ppack, const char * name, bool append,
 
     if(!append) {
 
-        pack->ids.clear();
+        pack->resetIndex();
 
         assert(!pack->params.empty());
         for(ParamVector::iterator pvit = pack->params.begin() + 1; pvit != pack->params.end(); ++pvit)
             delete *pvit;
         //pack->params.clear();
         pack->params.erase(pack->params.begin() + 1, pack->params.end());
+        pack->releasePacked();
 
         pack->layout.clear();
     }
 
-    loadFromFile(pack, name, StringSet(), type);
+    loadPack(pack, name, type);
 
     ICore* icore = SingleCore::getInstance();
     ((ParamPack *) ppack)->lastModified = icore->getResourceTime(name);
@@ -1782,7 +2217,8 @@ void ParamPackFactory::update(IParamPack * ppack) {
 
 //      res = icore->getResource(paramPack->resName.c_str(), "rt");
 
-        loadFromFile(paramPack, paramPack->resName.c_str(), StringSet());
+        std::string resName = paramPack->resName;
+        loadPack(paramPack, resName.c_str(), NULL);
 
 //      res->release();
 //      res = NULL;
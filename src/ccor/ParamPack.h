@@ -40,52 +40,101 @@ union ParamValue {
 
 };
 
-class StringPtrWrapper {
-public:
-
-    const char * s;
+/**
+ * Compiled form of config, written next to source config as "<name>.ppc".
+ * Layout: header, sources, ops, float values, interned strings,
+ * all sections are 4 bytes aligned and referenced by offsets.
+ */
 
-    StringPtrWrapper() { }
- 
-    StringPtrWrapper(const char * s) { this->s = s; }
+#define PACKED_PARAMS_SUFFIX  ".ppc"
+#define PACKED_PARAMS_MAGIC   0x31435050 // "PPC1"
+#define PACKED_PARAMS_VERSION 1
 
-    StringPtrWrapper(const std::string & s) { this->s = s.c_str(); }
+#define PACKED_OP_COMMENT     0xFFFF     // type of layout comment op
+#define PACKED_OP_LAYOUT      0x0001     // param op is present in layout
 
-    StringPtrWrapper& operator=(const StringPtrWrapper& b) {
-        s = b.s;
-        return * this;
-    }
+struct PackedParamsHeader {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int numSources;
+    unsigned int numOps;
+    unsigned int numFloats;
+    unsigned int stringsSize;
+};
 
-    bool operator==(const StringPtrWrapper& b) const { return !::stricmp(s, b.s); }
+// source config or included file, compiled form is stale when any of them is modified
+struct PackedSource {
+    unsigned int name;
+    unsigned int lastModified;
+};
 
-    operator const char * () const { return s; }
+// assignment of typed value (or layout comment) in order of source
+struct PackedOp {
+    unsigned int name;          // offset in string table
+    unsigned int hash;          // hashParamName(name)
+    unsigned short type;        // ParamType or PACKED_OP_COMMENT
+    unsigned short flags;
+    unsigned int value;         // int, float, bool, offset of string or index of first float
 };
 
-struct StringPtrWrapperComparator {
-    bool operator()(const StringPtrWrapper & a, const StringPtrWrapper & b) const { return ::strcmp(a.s, b.s) < 0; }
+class PackedParams {
+public:
+
+    IResource * res;
+    const PackedParamsHeader * header;
+    const PackedSource * sources;
+    const PackedOp * ops;
+    const float * floats;
+    const char * strings;
+
+    PackedParams(IResource * res) : res(res), header(NULL), sources(NULL), ops(NULL), floats(NULL), strings(NULL) { }
+
+    ~PackedParams() { res->release(); }
+
+    bool validate();
 };
 
+typedef std::vector<PackedParams*> PackedParamsVector;
+
 class ObjParam {
 
 friend class ParamPack;
+friend class ParamPackFactory;
+friend class ParamPackCompiler;
+friend struct ParamNameLess;
+friend struct ParamPrefixLess;
 
 private:
 
     std::string name;
+    unsigned int hash;
     ParamType type;
     ParamValue value;
+    const PackedOp * packedOp;          // value isn't decoded yet
+    const PackedParams * packedParams;
 
 public:
 
     ObjParam(const char * name);
 
+    ObjParam(const char * name, unsigned int hash);
+
+    void decode();
+
     void release();
 
     ~ObjParam() { release(); }
 };
 
 typedef std::vector<ObjParam*> ParamVector;
-typedef std::map<StringPtrWrapper,paramid_t,StringPtrWrapperComparator> ParamMap;
+
+struct ParamSlot {
+    unsigned int hash;
+    paramid_t id;
+};
+
+typedef std::vector<ParamSlot> ParamHashTable;
+typedef std::vector<paramid_t> ParamIndex;
 typedef std::vector<ParamPackListener *> ListenerVector;
 typedef std::map<wchar_t, char> UTF8Map;
 typedef std::map<char, wchar_t> ASCIIMap;
@@ -162,13 +211,42 @@ public:
     void clear();
 };
 
+class ParamPackCompiler {
+private:
+
+    typedef std::map<std::string, unsigned int> StringOffsetMap;
+
+    std::vector<PackedSource> sources;
+    std::vector<PackedOp> ops;
+    std::vector<float> floats;
+    std::vector<char> strings;
+    StringOffsetMap stringOffsets;
+
+    unsigned int addString(const char * s);
+
+public:
+
+    void addSource(const char * name, time_t lastModified);
+
+    void addComment(const char * s);
+
+    void addParam(const char * name, const ObjParam * param, bool layout);
+
+    bool write(IResource * res);
+};
+
 class ParamPack : public IParamPack {
 
 friend class ParamPackFactory;
 
 private:
 
-    ParamMap ids;
+    ParamHashTable hashTable;   // open addressing index of names, -1 marks empty slot
+    int hashCount;
+    ParamIndex sortedIds;       // ids ordered by name, prefix index for templates
+    bool sortedIdsValid;
+    unsigned int revision;
+    static volatile long nextRevision; // last revision given to any pack
     ParamVector params;
     char tmpbuf[BUF_SIZE];
     ListenerVector listeners;
@@ -178,11 +256,28 @@ private:
     bool changed;
     std::vector<paramid_t> findBuf;
     find_param_t paramResult;
+    PackedParamsVector packed;  // compiled configs referenced by undecoded values
 
     void CheckID(paramid_t id);
 
     void ChangeParam(paramid_t id);
 
+    void DecodeParam(paramid_t id) { if(params[id]->packedOp) params[id]->decode(); }
+
+    void releasePacked();
+
+    paramid_t addHashed(const char * name, unsigned int hash);
+
+    void resetIndex();
+
+    void indexParam(paramid_t id);
+
+    paramid_t findHashed(const char * name, unsigned int hash);
+
+    void updateSortedIds();
+
+    ParamIndex::iterator findPrefix(const char * prefix);
+
 public:
 
     ParamPack();
@@ -193,6 +288,7 @@ public:
     
     ParamType getType(paramid_t id) {
         CheckID(id);
+        DecodeParam(id);
         return params[id]->type;
     }
 
@@ -271,6 +367,10 @@ public:
 
     paramid_t __stdcall find(const char * qualifiedName);
 
+    paramid_t __stdcall find(const ParamKey & key) { return findHashed(key.getName(), key.getHash()); }
+
+    unsigned int __stdcall getRevision() { return revision; }
+
     int __stdcall findParams(const char * qualifiedName);
 
     void __stdcall copyParamResult(paramid_t * array);
@@ -297,6 +397,8 @@ public:
     void __stdcall setReadonly(bool readOnly) { }
 };
 
+class ResourceMgr;
+
 class ParamPackFactory : public IParamPackFactory {
 
 friend class ParamPack;
@@ -312,6 +414,8 @@ private:
     UTF8Converter utfconv;
     READBUF * preadbuf;
     IResource * res;
+    ParamPackCompiler * compiler;   // records loaded config while it's being parsed
+    ResourceMgr * resMgr;           // resolves paths of configs & their compiled forms
 
     int getParamName(char * name, const char * src);
 
@@ -351,6 +455,10 @@ private:
                                   const std::string & substSrc,
                                   const std::string & substDst );
 
+    void addComment(ParamPack * pack, const char * s);
+
+    paramid_t addParam(ParamPack * pack, const char * name, const char * value, bool layout);
+
     void nextLine(ParamPack * pack);
 
     int nextString(ParamPack * pack, char * buf, paramid_t * id);
@@ -363,6 +471,14 @@ private:
                        const std::string & substSrc = "",
                        const std::string & substDst = "" );
 
+    std::string getResourcePath(const char * name, const char * type);
+
+    bool loadPacked(ParamPack * pack, const char * name, const char * path);
+
+    void writePacked(ParamPackCompiler * packCompiler, const char * path);
+
+    void loadPack(ParamPack * pack, const char * name, const char * type);
+
     void saveParam(ParamPack * pack, paramid_t id);
 
     void saveToFile(ParamPack * pack, bool saveUTF8Signature = false);
@@ -371,6 +487,8 @@ private:
 
 public:
 
+    ParamPackFactory(ResourceMgr * resMgr) : preadbuf(NULL), res(NULL), compiler(NULL), resMgr(resMgr) { }
+
     virtual IParamPack * __stdcall createInstance() { return new ParamPack(); }
 
     virtual IParamPack * __stdcall load(const char * name, const char * type);
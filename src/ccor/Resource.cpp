@@ -6,9 +6,12 @@
 #include "CoreImpl.h"
 #include "zlib/unzip.h"
 #include "Resource.h"
+#include "Archive.h"
 
 #define BUF_SIZE 4096
 
+#define READ_BUF_SIZE 65536
+
 #define MEM_FILE_PREFIX "mem:"
 
 #define ZIP_FILE_SUFFIX ".zip"
@@ -20,6 +23,19 @@ Resource::~Resource() {
         ::fclose(file);
 }
 
+unsigned int Resource::getSize() {
+    FILE * f = getFile();
+    return f ? ::_filelength(_fileno(f)) : 0;
+}
+
+unsigned int Resource::readData(void * buffer, unsigned int bufferSize) {
+    FILE * f = getFile();
+    if(!f)
+        return 0;
+    ::rewind(f);
+    return ::fread(buffer, 1, bufferSize, f);
+}
+
 void Resource::openTempFile(bool textMode) {
     char fname[MAX_PATH];
     ::tmpnam(fname);
@@ -29,8 +45,13 @@ void Resource::openTempFile(bool textMode) {
         throw Exception("resmgr: cannot open temporary file");
 }
 
-FileReader::FileReader(const char * fname, bool textMode) : Resource(fname) {
-    if(!(file = ::fopen(fname, textMode ? "rt" : "rb"))) {
+FileReader::FileReader(const char * fname, bool textMode) : Resource(fname), mappingHandle(NULL), view(NULL) {
+    if(file = ::fopen(fname, textMode ? "rt" : "rb")) {
+        // binary readers (assets, textures) issue fread per structure, setvbuf must precede any I/O
+        if(!textMode)
+            ::setvbuf(file, NULL, _IOFBF, READ_BUF_SIZE);
+    }
+    else {
         openTempFile(false);
 
         char zipName[MAX_PATH];
@@ -86,16 +107,26 @@ bool FileReader::openZipFile(const char * zipName, const char * zipedFileName) {
     return false;
 }
 
-MemFileReader::MemFileReader(MemFile * memFile, bool textMode, const char * name) : Resource(name) {
+FILE * MemFileReader::getFile() {
+    // temporary copy is made only for stdio consumers, getData() is zero-copy
+    if(!file) {
+        openTempFile(false);
 
-    openTempFile(false);
+        if(!memFile->buf.empty() && !::fwrite(&*memFile->buf.begin(), memFile->buf.size(), 1, file))
+            throw Exception("resmgr: error occured while writing from mem file to temporary file");
 
-    if(!::fwrite(&*memFile->buf.begin(), memFile->buf.size(), 1, file))
-        throw Exception("resmgr: error occured while writing from mem file to temporary file");
+        ::rewind(file);
+        if(textMode)
+            ::setmode(_fileno(file), _O_TEXT);
+    }
+    return file;
+}
 
-    ::rewind(file);
-    if(textMode)
-        ::setmode(_fileno(file), _O_TEXT);
+unsigned int MemFileReader::readData(void * buffer, unsigned int bufferSize) {
+    unsigned int size = std::min(bufferSize, (unsigned int)(memFile->buf.size()));
+    if(size)
+        ::memcpy(buffer, &memFile->buf[0], size);
+    return size;
 }
 
 bool FileWriter::openFile(const char * fname, bool textMode) {
@@ -144,6 +175,9 @@ MemFileWriter::~MemFileWriter() {
 ResourceMgr::~ResourceMgr() {
     for(MemFileMap::iterator it = memFileMap.begin(); it != memFileMap.end(); ++it)
         delete it->second;
+    for(PackedArchiveMap::iterator it = archiveMap.begin(); it != archiveMap.end(); ++it)
+        delete it->second;
+    freeArchiveLock();
 }
 
 void ResourceMgr::loadPathMap(const char * fileName) {
@@ -200,6 +234,59 @@ char * ResourceMgr::getFullPath(char * fullPath, const char * fname, const char
     return fullPath;
 }
 
+PackedArchive * ResourceMgr::getArchive(const char * archiveName) {
+    lockArchives();
+    PackedArchiveMap::iterator it = archiveMap.find(archiveName);
+    if(it != archiveMap.end()) {
+        PackedArchive * archive = it->second;
+        unlockArchives();
+        return archive;
+    }
+
+    // missing archives are remembered too, so each one is probed only once;
+    // archive is opened under the lock, so concurrent readers never map it twice
+    PackedArchive * archive = NULL;
+    std::string error;
+    if(!::_access(archiveName, 0)) {
+        try {
+            archive = new PackedArchive(archiveName);
+        }
+        catch(Exception exception) {
+            error = exception.getMsg();
+        }
+    }
+    archiveMap[archiveName] = archive;
+    unlockArchives();
+
+    if(!error.empty())
+        SingleCore::getInstance()->logMessage(error.c_str());
+    return archive;
+}
+
+IResource * ResourceMgr::getArchiveReader(const char * resName, bool textMode) {
+    // "a/b/c.dds" is looked up as "c.dds" in "a/b.pak", then as "b/c.dds" in "a.pak"
+    char archiveName[MAX_PATH];
+    const char * separator = resName + ::strlen(resName);
+    while(separator > resName) {
+        if(*--separator != '/')
+            continue;
+
+        int archiveNameLen = separator - resName;
+        if(archiveNameLen + sizeof(PACK_FILE_SUFFIX) > MAX_PATH)
+            continue;
+        ::strncpy(archiveName, resName, archiveNameLen);
+        ::strcpy(archiveName + archiveNameLen, PACK_FILE_SUFFIX);
+
+        PackedArchive * archive = getArchive(archiveName);
+        if(archive) {
+            const PackEntry * entry = archive->find(separator + 1);
+            if(entry)
+                return new ArchiveReader(archive, entry, textMode, resName);
+        }
+    }
+    return NULL;
+}
+
 IResource * ResourceMgr::getResourceReader(const char * resName, bool textMode) {
     if(!::strncmp(resName, MEM_FILE_PREFIX, ::strlen(MEM_FILE_PREFIX))) {
         MemFileMap::iterator it = memFileMap.find(resName);
@@ -208,6 +295,13 @@ IResource * ResourceMgr::getResourceReader(const char * resName, bool textMode)
         return new MemFileReader(it->second, textMode, resName);
     }
 
+    // loose files override packed ones
+    if(::_access(resName, 0)) {
+        IResource * resource = getArchiveReader(resName, textMode);
+        if(resource)
+            return resource;
+    }
+
     return new FileReader(resName, textMode);
 }
 
@@ -26,6 +26,12 @@ public:
     virtual const char * __stdcall getName() { return name.c_str(); }
 
     virtual void __stdcall release() { delete this; }
+
+    virtual const void * __stdcall getData() { return NULL; }
+
+    virtual unsigned int __stdcall getSize();
+
+    virtual unsigned int __stdcall readData(void * buffer, unsigned int bufferSize);
 };
 
 typedef std::vector<char> MemFileBuffer;
@@ -44,11 +50,18 @@ friend class ResourceMgr;
 
 private:
 
+    void * mappingHandle;
+    const void * view;
+
     FileReader(const char * fname, bool textMode);
 
 	bool openZipFile(const char * zipName, const char * fileName);
 
-    ~FileReader() { }
+    ~FileReader();
+
+public:
+
+    virtual const void * __stdcall getData();
 };
 
 class FileWriter : public Resource {
@@ -73,9 +86,25 @@ friend class ResourceMgr;
 
 private:
 
-	MemFileReader(MemFile * memFile, bool textMode, const char * name);
+    MemFile * memFile;
+    bool textMode;
+
+	MemFileReader(MemFile * memFile, bool textMode, const char * name) : Resource(name) {
+        this->memFile = memFile;
+        this->textMode = textMode;
+    }
 
     ~MemFileReader() { }
+
+public:
+
+    virtual FILE * __stdcall getFile();
+
+    virtual const void * __stdcall getData() { return memFile->buf.empty() ? NULL : &memFile->buf[0]; }
+
+    virtual unsigned int __stdcall getSize() { return memFile->buf.size(); }
+
+    virtual unsigned int __stdcall readData(void * buffer, unsigned int bufferSize);
 };
 
 class MemFileWriter : public Resource {
@@ -100,11 +129,26 @@ private:
 typedef std::map<std::string, MemFile *> MemFileMap;
 typedef std::map<std::string, std::string> PathMap;
 
+class PackedArchive;
+typedef std::map<std::string, PackedArchive *> PackedArchiveMap;
+
 class ResourceMgr {
 private:
 
     MemFileMap memFileMap;
     PathMap pathMap;
+    PackedArchiveMap archiveMap;
+    void * archiveLock; // CRITICAL_SECTION, archives are requested from loader & job threads
+
+    void lockArchives();
+
+    void unlockArchives();
+
+    void freeArchiveLock();
+
+    PackedArchive * getArchive(const char * archiveName);
+
+    IResource * getArchiveReader(const char * resName, bool textMode);
 
     IResource * getResourceReader(const char * resName, bool textMode);
 
@@ -112,7 +156,7 @@ private:
 
 public:
 
-    ResourceMgr() { }
+    ResourceMgr();
 
     ~ResourceMgr();
 
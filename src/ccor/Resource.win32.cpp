@@ -0,0 +1,57 @@
+#include <io.h>
+#include "headers.h"
+#include <windows.h>
+#include "../shared/ccor.h"
+#include "CoreImpl.h"
+#include "Resource.h"
+
+namespace ccor {
+
+const void * FileReader::getData() {
+    if(view || !file)
+        return view;
+
+    // zip entries are served from temporary file, flush it before mapping
+    ::fflush(file);
+    if(!getSize())
+        return NULL;
+
+    HANDLE fileHandle = reinterpret_cast<HANDLE>(::_get_osfhandle(_fileno(file)));
+    if(fileHandle == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    if(!(mappingHandle = ::CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL)))
+        return NULL;
+
+    view = ::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    return view;
+}
+
+ResourceMgr::ResourceMgr() {
+    CRITICAL_SECTION * lock = new CRITICAL_SECTION;
+    ::InitializeCriticalSection(lock);
+    archiveLock = lock;
+}
+
+void ResourceMgr::lockArchives() {
+    ::EnterCriticalSection(static_cast<CRITICAL_SECTION *>(archiveLock));
+}
+
+void ResourceMgr::unlockArchives() {
+    ::LeaveCriticalSection(static_cast<CRITICAL_SECTION *>(archiveLock));
+}
+
+void ResourceMgr::freeArchiveLock() {
+    CRITICAL_SECTION * lock = static_cast<CRITICAL_SECTION *>(archiveLock);
+    ::DeleteCriticalSection(lock);
+    delete lock;
+}
+
+FileReader::~FileReader() {
+    if(view)
+        ::UnmapViewOfFile(view);
+    if(mappingHandle)
+        ::CloseHandle(mappingHandle);
+}
+
+}
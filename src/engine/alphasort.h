@@ -13,102 +13,113 @@
 #include "frame.h"
 #include "geometry.h"
 #include "engine.h"
+#include "radixsort.h"
 
 struct AlphaGeometry
 {
 public:
-    unsigned char key;          // sorting key
-    Frame*        frame;        // transformation frame
-    Geometry*     geometry;     // target geometry
-    BSPSector*    sector;       // where is the target geometry? - in the sector of BSP tree!
-    D3DXMATRIX**  boneMatrices; // bone matrices for skinned geometries
-    unsigned int  subsetId;     // identifier specifies the alpha geometry mesh subset
+    unsigned short key;          // sorting key
+    Frame*         frame;        // transformation frame
+    Geometry*      geometry;     // target geometry
+    BSPSector*     sector;       // where is the target geometry? - in the sector of BSP tree!
+    D3DXMATRIX**   boneMatrices; // bone matrices for skinned geometries
+    unsigned int   subsetId;     // identifier specifies the alpha geometry mesh subset
 public:
     AlphaGeometry()
     {
         key = 0, frame = NULL, geometry = NULL, subsetId = 0, sector = NULL, boneMatrices = NULL;
     }
-    AlphaGeometry(bool n, unsigned char k, Frame* f, Geometry* g, BSPSector* bsps, D3DXMATRIX** bms, unsigned int s)
+    AlphaGeometry(bool n, unsigned short k, Frame* f, Geometry* g, BSPSector* bsps, D3DXMATRIX** bms, unsigned int s)
     {
         key = k, frame = f, geometry = g, sector = bsps, boneMatrices = bms, subsetId = s;
     }
 };
 
+/**
+ * alpha queue, sorted by radixSort16, items are never dropped,
+ * storage grows on demand and is reused between frames
+ *
+ * define ENGINE_ALPHASORT_DUMP to record keys of rendered queues for
+ * offline benchmark (see alphasortbench.cpp)
+ */
+
 class AlphaSorting
 {
 private:
-    unsigned char _nestSize[256];    // corresponding nest size
-    AlphaGeometry _nest[256][256];   // 256 nests for objects
-    unsigned int  _numItems;         // number of items to sort
-    AlphaGeometry _items[65535];     // items to sort
+    typedef std::vector<AlphaGeometry> AlphaGeometryV;
+    typedef std::vector<unsigned int> IndexV;
+private:
+    AlphaGeometryV _items;           // items to sort
+    IndexV         _order;           // sorted item indices
+    IndexV         _temp;            // indices after first pass
 public:
-    AlphaSorting() : _numItems(0) {}
+    AlphaSorting() {}
 public:
     inline unsigned int size(void)
     {
-        return _numItems;
+        return _items.size();
     }
     inline void clear(void)
     {
-        _numItems = 0;
+        // keeps capacity
+        _items.clear();
     }
     inline void add(AlphaGeometry* alphaGeometry)
     {
-        assert( _numItems <= 65535 );
-        memcpy( _items + _numItems, alphaGeometry, sizeof( AlphaGeometry ) );
-        _numItems++;
+        _items.push_back( *alphaGeometry );
     }
 public:
-    void render(void)
+    void sort(void)
     {
-        // reset nest counters
-        memset( _nestSize, 0, sizeof( _nestSize ) );
-
-        unsigned int   i,j;
-        unsigned char  key;
-        unsigned char* nestSize;        
-
-        // sort
-        for( i=0; i<_numItems; i++ )
+        unsigned int numItems = _items.size();
+        _order.resize( numItems );
+        _temp.resize( numItems );
+        if( !numItems ) return;
+        radixSort16( &_items[0], numItems, &_order[0], &_temp[0] );
+    }
+#ifdef ENGINE_ALPHASORT_DUMP
+public:
+    /**
+     * appends queue to "alphasort.dmp": number of items, then their keys
+     */
+    void dump(void)
+    {
+        static FILE* file = fopen( "alphasort.dmp", "wb" );
+        if( !file ) return;
+        unsigned int numItems = _items.size();
+        fwrite( &numItems, sizeof(unsigned int), 1, file );
+        for( unsigned int i=0; i<numItems; i++ )
         {
-            key = _items[i].key;
-            nestSize = _nestSize + key;
-
-            // search for nearest thin nest
-            // a priori, central nests (lower nestId) are more vacant
-            while( *nestSize == 255 && key > 0 ) key--, nestSize = _nestSize + key;
-            // leave alpha unsorted & unrendered if there are no space to sort it
-            if( *nestSize == 255 ) continue;
-
-            // add alpha to corresponding nest
-            memcpy( _nest[key] + *nestSize, _items + i, sizeof(AlphaGeometry) );
-            (*nestSize)++;
+            fwrite( &_items[i].key, sizeof(unsigned short), 1, file );
         }
-
-        AlphaGeometry* nest;
+    }
+#endif
+public:
+    void render(void)
+    {
+        #ifdef ENGINE_ALPHASORT_DUMP
+            dump();
+        #endif
+        sort();
 
         // render
-        for( i=0; i<256; i++ )
-        {            
-            nestSize = _nestSize + i;
-            Engine::statistics.alphaObjectsRendered += *nestSize;
-            for( j=0; j<*nestSize; j++ )
+        AlphaGeometry* item;
+        for( unsigned int i=0; i<_order.size(); i++ )
+        {
+            item = &_items[_order[i]];
+            // setup world transformation
+            if( item->frame )
+            {
+                _dxCR( iDirect3DDevice->SetTransform( D3DTS_WORLD, &item->frame->LTM ) );
+            }
+            else
             {
-                nest = _nest[i] + j;
-                // setup world transformation
-                if( nest->frame )
-                {
-                    _dxCR( iDirect3DDevice->SetTransform( D3DTS_WORLD, &nest->frame->LTM ) );
-                }
-                else
-                {
-                    _dxCR( iDirect3DDevice->SetTransform( D3DTS_WORLD, &identity ) );
-                }
-        
-                // render subset
-                if( nest->boneMatrices ) Mesh::pBoneMatrices = nest->boneMatrices;
-                nest->geometry->renderAlphaGeometry( nest->subsetId );
+                _dxCR( iDirect3DDevice->SetTransform( D3DTS_WORLD, &identity ) );
             }
+    
+            // render subset
+            if( item->boneMatrices ) Mesh::pBoneMatrices = item->boneMatrices;
+            item->geometry->renderAlphaGeometry( item->subsetId );
         }
     }
 };
@@ -0,0 +1,209 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description offline benchmark of alpha sorting: replays alpha queues,
+ * recorded by engine built with ENGINE_ALPHASORT_DUMP, through legacy nest
+ * sorter & radix sorter
+ *
+ *  alphasortbench <alphasort.dmp> [runs] - replays queues, reports timings
+ *  alphasortbench -w <alphasort.dmp>     - writes synthesized queues
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "radixsort.h"
+
+#define BENCH_DEFAULT_RUNS 100
+
+/**
+ * item of the same layout as AlphaGeometry
+ */
+
+struct BenchItem
+{
+public:
+    unsigned short key;
+    void*          frame;
+    void*          geometry;
+    void*          sector;
+    void*          boneMatrices;
+    unsigned int   subsetId;
+};
+
+typedef std::vector<BenchItem> BenchItemV;
+typedef std::vector<BenchItemV> QueueV;
+
+/**
+ * nest sorter, which was used by AlphaSorting before radix sort: 8-bit key
+ * picks one of 256 nests of 255 items, items are dropped when nests are full
+ */
+
+class NestSorter
+{
+private:
+    unsigned char _nestSize[256];
+    BenchItem     _nest[256][256];
+public:
+    /**
+     * @return number of dropped items
+     */
+    unsigned int sort(const BenchItem* items, unsigned int numItems)
+    {
+        memset( _nestSize, 0, sizeof( _nestSize ) );
+
+        unsigned int   numDropped = 0;
+        unsigned char  key;
+        unsigned char* nestSize;
+        for( unsigned int i=0; i<numItems; i++ )
+        {
+            // legacy key is distance with 256 times coarser step
+            key = items[i].key >> 8;
+            nestSize = _nestSize + key;
+            while( *nestSize == 255 && key > 0 ) key--, nestSize = _nestSize + key;
+            if( *nestSize == 255 ) 
+            {
+                numDropped++;
+                continue;
+            }
+            memcpy( _nest[key] + *nestSize, items + i, sizeof(BenchItem) );
+            (*nestSize)++;
+        }
+        return numDropped;
+    }
+};
+
+static bool readQueues(const char* fileName, QueueV& queues)
+{
+    FILE* file = fopen( fileName, "rb" );
+    if( !file ) return false;
+
+    unsigned int numItems;
+    while( fread( &numItems, sizeof(unsigned int), 1, file ) == 1 )
+    {
+        queues.push_back( BenchItemV( numItems ) );
+        BenchItemV& queue = queues.back();
+        for( unsigned int i=0; i<numItems; i++ )
+        {
+            if( fread( &queue[i].key, sizeof(unsigned short), 1, file ) != 1 )
+            {
+                fclose( file );
+                return false;
+            }
+            queue[i].subsetId = i;
+        }
+    }
+    fclose( file );
+    return true;
+}
+
+static bool writeQueues(const char* fileName)
+{
+    FILE* file = fopen( fileName, "wb" );
+    if( !file ) return false;
+
+    // 600 frames of growing crowd, clustered near camera like spectators & particles
+    srand( 1 );
+    for( unsigned int frame=0; frame<600; frame++ )
+    {
+        unsigned int numItems = 64 + frame * 8;
+        fwrite( &numItems, sizeof(unsigned int), 1, file );
+        for( unsigned int i=0; i<numItems; i++ )
+        {
+            float distance = float( rand() ) / RAND_MAX;
+            unsigned short key = (unsigned short)( distance * distance * 32.0f * 256.0f );
+            fwrite( &key, sizeof(unsigned short), 1, file );
+        }
+    }
+    fclose( file );
+    return true;
+}
+
+static bool isSorted(const BenchItemV& queue, const std::vector<unsigned int>& order)
+{
+    for( unsigned int i=1; i<order.size(); i++ )
+    {
+        const BenchItem& prev = queue[order[i-1]];
+        const BenchItem& next = queue[order[i]];
+        if( prev.key > next.key ) return false;
+        if( prev.key == next.key && prev.subsetId > next.subsetId ) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if( argc == 3 && !strcmp( argv[1], "-w" ) )
+    {
+        if( writeQueues( argv[2] ) ) return 0;
+        printf( "alphasortbench: can't write \"%s\"\n", argv[2] );
+        return 1;
+    }
+    if( argc < 2 )
+    {
+        printf( "usage: alphasortbench <alphasort.dmp> [runs] | -w <alphasort.dmp>\n" );
+        return 1;
+    }
+
+    QueueV queues;
+    if( !readQueues( argv[1], queues ) || queues.empty() )
+    {
+        printf( "alphasortbench: can't read \"%s\"\n", argv[1] );
+        return 1;
+    }
+    unsigned int numRuns = argc > 2 ? atoi( argv[2] ) : BENCH_DEFAULT_RUNS;
+    if( !numRuns ) numRuns = 1;
+
+    unsigned int i, run, numQueues = queues.size(), numItems = 0, maxItems = 0;
+    for( i=0; i<numQueues; i++ )
+    {
+        numItems += queues[i].size();
+        if( queues[i].size() > maxItems ) maxItems = queues[i].size();
+    }
+
+    // legacy sorter
+    NestSorter* nestSorter = new NestSorter;
+    unsigned int numDropped = 0;
+    clock_t time = clock();
+    for( run=0; run<numRuns; run++ )
+    {
+        for( i=0; i<numQueues; i++ )
+        {
+            if( queues[i].empty() ) continue;
+            numDropped += nestSorter->sort( &queues[i][0], queues[i].size() );
+        }
+    }
+    double nestTime = double( clock() - time ) / CLOCKS_PER_SEC;
+    delete nestSorter;
+
+    // radix sorter, with storage reused between queues as AlphaSorting does
+    std::vector<unsigned int> order( maxItems ), temp( maxItems );
+    time = clock();
+    for( run=0; run<numRuns; run++ )
+    {
+        for( i=0; i<numQueues; i++ )
+        {
+            if( queues[i].empty() ) continue;
+            radixSort16( &queues[i][0], queues[i].size(), &order[0], &temp[0] );
+        }
+    }
+    double radixTime = double( clock() - time ) / CLOCKS_PER_SEC;
+
+    // radix order is checked once per queue
+    bool isValid = true;
+    for( i=0; i<numQueues && isValid; i++ )
+    {
+        if( queues[i].empty() ) continue;
+        order.resize( queues[i].size() );
+        radixSort16( &queues[i][0], queues[i].size(), &order[0], &temp[0] );
+        isValid = isSorted( queues[i], order );
+    }
+
+    printf( "alphasortbench: %u queues, %u items, largest queue %u, %u runs\n", numQueues, numItems, maxItems, numRuns );
+    printf( "  nest sorter:  %.3f us per queue, %u items dropped per run\n", 1e6 * nestTime / ( numRuns * numQueues ), numDropped / numRuns );
+    printf( "  radix sorter: %.3f us per queue, %s\n", 1e6 * radixTime / ( numRuns * numQueues ), isValid ? "stable order" : "ORDER MISMATCH" );
+    return isValid ? 0 : 1;
+}
@@ -1,7 +1,132 @@
-
 #include "headers.h"
 #include "animation.h"
 #include "fastquat.h"
+#include "raypacket.h"
+
+#define ANIMATION_VECTOR_TOLERANCE   1e-4f // relative tolerance of constant & linear elision of scale and translation
+#define ANIMATION_ROTATION_TOLERANCE 1e-4f // tolerance of constant & linear elision of rotation components
+#define ANIMATION_INTERVAL_TOLERANCE 1e-4f // relative tolerance of evenly spaced key times
+#define ANIMATION_POSE_CACHE_BITS    6     // size of shared pose cache is 2^ANIMATION_POSE_CACHE_BITS
+
+/**
+ * quaternion quantization
+ */
+
+static inline float getComponent(const Quaternion& q, unsigned int i)
+{
+    return i == 0 ? q.x : ( i == 1 ? q.y : ( i == 2 ? q.z : q.w ) );
+}
+
+static inline void packQuaternion(PackedQuaternion* out, const Quaternion* q)
+{
+    // find the largest component
+    unsigned int largest = 0;
+    unsigned int i;
+    for( i=1; i<4; i++ )
+    {
+        if( fabs( getComponent( *q, i ) ) > fabs( getComponent( *q, largest ) ) ) largest = i;
+    }
+
+    // the rest components are in range [-1/sqrt(2), 1/sqrt(2)], 
+    // the largest one is restored as positive, so sign is passed to the rest
+    float sign = getComponent( *q, largest ) < 0 ? -1.0f : 1.0f;
+    float value;
+    unsigned int j = 0;
+    for( i=0; i<4; i++ )
+    {
+        if( i == largest ) continue;
+        value = ( sign * getComponent( *q, i ) * 1.414213562f + 1.0f ) * 0.5f;
+        value = value < 0.0f ? 0.0f : ( value > 1.0f ? 1.0f : value );
+        out->value[j++] = (unsigned short)( value * 32767.0f + 0.5f );
+    }
+    out->value[0] |= ( largest & 1 ) << 15;
+    out->value[1] |= ( largest >> 1 ) << 15;
+}
+
+static inline void unpackQuaternion(Quaternion* out, const PackedQuaternion* q)
+{
+    unsigned int largest = ( q->value[0] >> 15 ) | ( ( q->value[1] >> 15 ) << 1 );
+    float        c[4];
+    float        sqSum = 0.0f;
+    unsigned int i, j = 0;
+    for( i=0; i<4; i++ )
+    {
+        if( i == largest ) continue;
+        c[i] = ( ( q->value[j++] & 0x7FFF ) * ( 2.0f / 32767.0f ) - 1.0f ) * 0.707106781f;
+        sqSum += c[i] * c[i];
+    }
+    c[largest] = sqSum < 1.0f ? sqrtf( 1.0f - sqSum ) : 0.0f;
+    out->x = c[0], out->y = c[1], out->z = c[2], out->w = c[3];
+}
+
+static inline void nlerpQuaternion(Quaternion* out, const Quaternion* a, const Quaternion* b, float t)
+{
+    float sign = ( a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w ) < 0 ? -1.0f : 1.0f;
+    out->x = a->x + ( sign * b->x - a->x ) * t;
+    out->y = a->y + ( sign * b->y - a->y ) * t;
+    out->z = a->z + ( sign * b->z - a->z ) * t;
+    out->w = a->w + ( sign * b->w - a->w ) * t;
+    float invLength = 1.0f / sqrtf( out->x * out->x + out->y * out->y + out->z * out->z + out->w * out->w );
+    out->x *= invLength, out->y *= invLength, out->z *= invLength, out->w *= invLength;
+}
+
+static inline bool isEqualRotation(const Quaternion* a, const Quaternion* b)
+{
+    float sign = ( a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w ) < 0 ? -1.0f : 1.0f;
+    return fabs( a->x - sign * b->x ) <= ANIMATION_ROTATION_TOLERANCE &&
+           fabs( a->y - sign * b->y ) <= ANIMATION_ROTATION_TOLERANCE &&
+           fabs( a->z - sign * b->z ) <= ANIMATION_ROTATION_TOLERANCE &&
+           fabs( a->w - sign * b->w ) <= ANIMATION_ROTATION_TOLERANCE;
+}
+
+/**
+ * 4-wide normalized linear interpolation of quaternions, 
+ * b is flipped to hemisphere of a
+ */
+
+static inline void nlerpQuaternion4(float4& x, float4& y, float4& z, float4& w, float4 bx, float4 by, float4 bz, float4 bw, float4 t)
+{
+    float4 dot  = f4add( f4add( f4mul( x, bx ), f4mul( y, by ) ), f4add( f4mul( z, bz ), f4mul( w, bw ) ) );
+    float4 sign = f4sub( f4set( 1.0f ), f4and( f4lt( dot, f4set( 0.0f ) ), f4set( 2.0f ) ) );
+    x = f4add( x, f4mul( f4sub( f4mul( bx, sign ), x ), t ) );
+    y = f4add( y, f4mul( f4sub( f4mul( by, sign ), y ), t ) );
+    z = f4add( z, f4mul( f4sub( f4mul( bz, sign ), z ), t ) );
+    w = f4add( w, f4mul( f4sub( f4mul( bw, sign ), w ), t ) );
+    float4 sqLength  = f4add( f4add( f4mul( x, x ), f4mul( y, y ) ), f4add( f4mul( z, z ), f4mul( w, w ) ) );
+    float4 invLength = f4div( f4set( 1.0f ), f4sqrt( sqLength ) );
+    x = f4mul( x, invLength );
+    y = f4mul( y, invLength );
+    z = f4mul( z, invLength );
+    w = f4mul( w, invLength );
+}
+
+/**
+ * 4-wide spherical linear interpolation of quaternions (polynomial approximation 
+ * by Andy Thomason, see fastquat.h), b is flipped to hemisphere of a
+ */
+
+static inline void slerpQuaternion4(float4& x, float4& y, float4& z, float4& w, float4 bx, float4 by, float4 bz, float4 bw, float4 t)
+{
+    float4 dot  = f4add( f4add( f4mul( x, bx ), f4mul( y, by ) ), f4add( f4mul( z, bz ), f4mul( w, bw ) ) );
+    float4 sign = f4sub( f4set( 1.0f ), f4and( f4lt( dot, f4set( 0.0f ) ), f4set( 2.0f ) ) );
+    dot = f4mul( dot, sign );
+    bx = f4mul( bx, sign ), by = f4mul( by, sign ), bz = f4mul( bz, sign ), bw = f4mul( bw, sign );
+
+    float4 recipOnePlusDot = f4div( f4set( 1.0f ), f4add( f4set( 1.0f ), dot ) );
+    float4 c1 = f4add( f4set( 1.570994357f ), f4mul( f4add( f4set( 0.5642929859f ), f4mul( f4add( f4set( -0.1783657717f ), f4mul( f4set( 0.4319949352e-1f ), dot ) ), dot ) ), dot ) );
+    float4 c3 = f4add( f4set( -0.6461396382f ), f4mul( f4add( f4set( 0.5945657936f ), f4mul( f4add( f4set( 0.8610323953e-1f ), f4mul( f4set( -0.3465122928e-1f ), dot ) ), dot ) ), dot ) );
+    float4 c5 = f4add( f4set( 0.7949823521e-1f ), f4mul( f4add( f4set( -0.1730436931f ), f4mul( f4add( f4set( 0.1079279599f ), f4mul( f4set( -0.1439397801e-1f ), dot ) ), dot ) ), dot ) );
+    float4 c7 = f4add( f4set( -0.4354102836e-2f ), f4mul( f4add( f4set( 0.1418962736e-1f ), f4mul( f4add( f4set( -0.1567189691e-1f ), f4mul( f4set( 0.5848706227e-2f ), dot ) ), dot ) ), dot ) );
+    float4 T  = f4sub( f4set( 1.0f ), t );
+    float4 T2 = f4mul( T, T );
+    float4 t2 = f4mul( t, t );
+    float4 alpha = f4mul( f4mul( f4add( c1, f4mul( f4add( c3, f4mul( f4add( c5, f4mul( c7, T2 ) ), T2 ) ), T2 ) ), T ), recipOnePlusDot );
+    float4 beta  = f4mul( f4mul( f4add( c1, f4mul( f4add( c3, f4mul( f4add( c5, f4mul( c7, t2 ) ), t2 ) ), t2 ) ), t ), recipOnePlusDot );
+    x = f4add( f4mul( alpha, x ), f4mul( beta, bx ) );
+    y = f4add( f4mul( alpha, y ), f4mul( beta, by ) );
+    z = f4add( f4mul( alpha, z ), f4mul( beta, bz ) );
+    w = f4add( f4mul( alpha, w ), f4mul( beta, bw ) );
+}
 
 /**
  * SRT animation support
@@ -11,28 +136,71 @@ Animation::Animation(const char* name, unsigned int numKeys)
 {
     assert( numKeys > 0 );
 
-    _name    = name;
-    _numKeys = numKeys;    
-    _keys    = new SRT[numKeys];
-    _period  = 0.0f;
+    _name      = name;
+    _numKeys   = numKeys;    
+    _keys      = new SRT[numKeys];
+    _times     = NULL;
+    _startTime = 0.0f;
+    _interval  = 0.0f;
+    _period    = 0.0f;
     memset( _keys, 0, sizeof(SRT)*numKeys );
+    memset( &_scale, 0, sizeof(VectorChannel) );
+    memset( &_rotation, 0, sizeof(RotationChannel) );
+    memset( &_translation, 0, sizeof(VectorChannel) );
 }
 
 Animation* Animation::clone(void)
 {
     Animation* result = new Animation( _name.c_str(), _numKeys );
-    result->_period = _period;
-    memcpy( result->_keys, _keys, sizeof(SRT)*_numKeys );
+    result->_period    = _period;
+    result->_startTime = _startTime;
+    result->_interval  = _interval;
+    if( !isCompressed() )
+    {
+        memcpy( result->_keys, _keys, sizeof(SRT)*_numKeys );
+        return result;
+    }
+
+    delete[] result->_keys;
+    result->_keys = NULL;
+    if( _times )
+    {
+        result->_times = new float[_numKeys];
+        memcpy( result->_times, _times, sizeof(float)*_numKeys );
+    }
+    result->_scale = _scale;
+    result->_rotation = _rotation;
+    result->_translation = _translation;
+    if( _scale.keys )
+    {
+        result->_scale.keys = new unsigned short[_numKeys*3];
+        memcpy( result->_scale.keys, _scale.keys, sizeof(unsigned short)*_numKeys*3 );
+    }
+    if( _rotation.keys )
+    {
+        result->_rotation.keys = new PackedQuaternion[_numKeys];
+        memcpy( result->_rotation.keys, _rotation.keys, sizeof(PackedQuaternion)*_numKeys );
+    }
+    if( _translation.keys )
+    {
+        result->_translation.keys = new unsigned short[_numKeys*3];
+        memcpy( result->_translation.keys, _translation.keys, sizeof(unsigned short)*_numKeys*3 );
+    }
     return result;
 }
 
 Animation::~Animation(void)
 {
-    delete[] _keys;
+    if( _keys ) delete[] _keys;
+    if( _times ) delete[] _times;
+    if( _scale.keys ) delete[] _scale.keys;
+    if( _rotation.keys ) delete[] _rotation.keys;
+    if( _translation.keys ) delete[] _translation.keys;
 }
 
 void Animation::setKey(unsigned int kId, const SRT* srt)
 {
+    assert( !isCompressed() );
     assert( kId>=0 && kId<_numKeys );
     assert( srt->time >= 0 );    
     _keys[kId] = *srt;
@@ -41,6 +209,7 @@ void Animation::setKey(unsigned int kId, const SRT* srt)
 
 bool Animation::validateKeys(void)
 {
+    assert( !isCompressed() );
     for( unsigned int i=0; i<_numKeys; i++ )
     {
         if( i && _keys[i].time <= _keys[i-1].time ) return false;
@@ -48,14 +217,180 @@ bool Animation::validateKeys(void)
     return true;
 }
 
-unsigned int Animation::getSRT(float time, SRT* srt, unsigned int cacheId)
+float Animation::getKeyTime(unsigned int kId)
+{
+    if( _keys ) return _keys[kId].time;
+    if( _times ) return _times[kId];
+    return _startTime + _interval * kId;
+}
+
+float Animation::getKeyPhase(unsigned int kId)
+{
+    if( _numKeys == 1 ) return 0.0f;
+    return ( getKeyTime( kId ) - getKeyTime( 0 ) ) / ( getKeyTime( _numKeys-1 ) - getKeyTime( 0 ) );
+}
+
+void Animation::compressChannel(VectorChannel* channel, unsigned int offset, float tolerance)
 {
-    if( _numKeys == 1 ) 
+    unsigned int i,j;
+    const float* first = reinterpret_cast<const float*>( reinterpret_cast<const char*>( _keys ) + offset );
+    const float* last  = reinterpret_cast<const float*>( reinterpret_cast<const char*>( _keys + _numKeys - 1 ) + offset );
+    const float* value;
+
+    // channel bounds
+    Vector inf( first[0], first[1], first[2] );
+    Vector sup = inf;
+    for( i=1; i<_numKeys; i++ )
     {
-        *srt = _keys[0];
-        return 0;
+        value = reinterpret_cast<const float*>( reinterpret_cast<const char*>( _keys + i ) + offset );
+        inf.x = std::min( inf.x, value[0] ), sup.x = std::max( sup.x, value[0] );
+        inf.y = std::min( inf.y, value[1] ), sup.y = std::max( sup.y, value[1] );
+        inf.z = std::min( inf.z, value[2] ), sup.z = std::max( sup.z, value[2] );
+    }
+    float magnitude = std::max( std::max( std::max( fabs( inf.x ), fabs( sup.x ) ), std::max( fabs( inf.y ), fabs( sup.y ) ) ), std::max( fabs( inf.z ), fabs( sup.z ) ) );
+    tolerance *= 1.0f + magnitude;
+
+    // constant channel
+    channel->keys = NULL;
+    channel->base = Vector( first[0], first[1], first[2] );
+    if( sup.x - inf.x <= tolerance && sup.y - inf.y <= tolerance && sup.z - inf.z <= tolerance )
+    {
+        channel->type   = ctConstant;
+        channel->extent = Vector( 0,0,0 );
+        return;
     }
 
+    // linear channel
+    bool  isLinear = true;
+    float phase;
+    channel->extent = Vector( last[0] - first[0], last[1] - first[1], last[2] - first[2] );
+    for( i=1; i<_numKeys-1 && isLinear; i++ )
+    {
+        value = reinterpret_cast<const float*>( reinterpret_cast<const char*>( _keys + i ) + offset );
+        phase = getKeyPhase( i );
+        isLinear = fabs( channel->base.x + channel->extent.x * phase - value[0] ) <= tolerance &&
+                   fabs( channel->base.y + channel->extent.y * phase - value[1] ) <= tolerance &&
+                   fabs( channel->base.z + channel->extent.z * phase - value[2] ) <= tolerance;
+    }
+    if( isLinear )
+    {
+        channel->type = ctLinear;
+        return;
+    }
+
+    // keyed channel, quantized by 16 bits in channel bounds
+    channel->type   = ctKeyed;
+    channel->base   = inf;
+    channel->extent = ( sup - inf ) / 65535.0f;
+    channel->keys   = new unsigned short[_numKeys*3];
+    float invStep[3] = {
+        channel->extent.x > 0 ? 1.0f / channel->extent.x : 0.0f,
+        channel->extent.y > 0 ? 1.0f / channel->extent.y : 0.0f,
+        channel->extent.z > 0 ? 1.0f / channel->extent.z : 0.0f
+    };
+    const float* base = &channel->base.x;
+    for( i=0; i<_numKeys; i++ )
+    {
+        value = reinterpret_cast<const float*>( reinterpret_cast<const char*>( _keys + i ) + offset );
+        for( j=0; j<3; j++ )
+        {
+            channel->keys[i*3+j] = (unsigned short)( std::min( ( value[j] - base[j] ) * invStep[j] + 0.5f, 65535.0f ) );
+        }
+    }
+}
+
+void Animation::compressChannel(RotationChannel* channel)
+{
+    unsigned int i;
+
+    channel->keys  = NULL;
+    channel->first = _keys[0].rotation;
+    channel->last  = _keys[_numKeys-1].rotation;
+    D3DXQuaternionNormalize( &channel->first, &channel->first );
+    D3DXQuaternionNormalize( &channel->last, &channel->last );
+
+    // constant channel
+    bool isConstant = true;
+    for( i=1; i<_numKeys && isConstant; i++ )
+    {
+        isConstant = isEqualRotation( &channel->first, &_keys[i].rotation );
+    }
+    if( isConstant )
+    {
+        channel->type = ctConstant;
+        return;
+    }
+
+    // linear channel
+    bool isLinear = true;
+    Quaternion rotation;
+    for( i=1; i<_numKeys-1 && isLinear; i++ )
+    {
+        nlerpQuaternion( &rotation, &channel->first, &channel->last, getKeyPhase( i ) );
+        isLinear = isEqualRotation( &rotation, &_keys[i].rotation );
+    }
+    if( isLinear )
+    {
+        channel->type = ctLinear;
+        return;
+    }
+
+    // keyed channel
+    channel->type = ctKeyed;
+    channel->keys = new PackedQuaternion[_numKeys];
+    for( i=0; i<_numKeys; i++ )
+    {
+        D3DXQuaternionNormalize( &rotation, &_keys[i].rotation );
+        packQuaternion( channel->keys + i, &rotation );
+    }
+}
+
+void Animation::compress(void)
+{
+    if( isCompressed() ) return;
+
+    unsigned int i;
+
+    // evenly spaced keys are described by start time & interval
+    _startTime = _keys[0].time;
+    _interval  = _numKeys > 1 ? ( _keys[_numKeys-1].time - _keys[0].time ) / ( _numKeys - 1 ) : 0.0f;
+    bool isEven = true;
+    for( i=1; i<_numKeys && isEven; i++ )
+    {
+        isEven = fabs( _keys[i].time - ( _startTime + _interval * i ) ) <= _interval * ANIMATION_INTERVAL_TOLERANCE;
+    }
+    if( !isEven )
+    {
+        _times = new float[_numKeys];
+        for( i=0; i<_numKeys; i++ ) _times[i] = _keys[i].time;
+    }
+
+    compressChannel( &_scale, offsetof( SRT, scale ), ANIMATION_VECTOR_TOLERANCE );
+    compressChannel( &_rotation );
+    compressChannel( &_translation, offsetof( SRT, translation ), ANIMATION_VECTOR_TOLERANCE );
+
+    delete[] _keys;
+    _keys = NULL;
+}
+
+bool Animation::hasSameKeys(Animation* animation)
+{
+    if( _numKeys != animation->_numKeys ) return false;
+    if( _period != animation->_period ) return false;
+    for( unsigned int i=0; i<_numKeys; i++ )
+    {
+        if( getKeyTime( i ) != animation->getKeyTime( i ) ) return false;
+    }
+    return true;
+}
+
+unsigned int Animation::findKey(float time, float* interpolator, unsigned int cacheId)
+{
+    assert( isCompressed() );
+
+    *interpolator = 0.0f;
+    if( _numKeys == 1 ) return 0;
+
     // trim time value to animation period
     if( time > _period )
     {
@@ -63,29 +398,36 @@ unsigned int Animation::getSRT(float time, SRT* srt, unsigned int cacheId)
     }
 
     // check boundary condition
-    if( time == _keys[0].time ) 
+    if( time <= getKeyTime( 0 ) ) 
     {
-        *srt = _keys[0];
         return 0;
     }
-    else if( time == _keys[_numKeys-1].time )
+    else if( time >= getKeyTime( _numKeys-1 ) )
     {
-        *srt = _keys[_numKeys-1];
+        *interpolator = 1.0f;
         return _numKeys-2;
     }
 
     // search for animation key
     unsigned int kId;
 
+    if( !_times )
+    {
+        // evenly spaced keys are addressed directly
+        kId = std::min<unsigned int>( unsigned int( ( time - _startTime ) / _interval ), _numKeys-2 );
+        *interpolator = ( time - getKeyTime( kId ) ) / _interval;
+        *interpolator = *interpolator < 0.0f ? 0.0f : ( *interpolator > 1.0f ? 1.0f : *interpolator );
+        return kId;
+    }
+
     // sequential access using cache
-    if( ( cacheId != 0xFFFFFFFF ) && ( _keys[cacheId].time <= time && _keys[cacheId+1].time > time ) )
+    if( ( cacheId < _numKeys-1 ) && ( _times[cacheId] <= time && _times[cacheId+1] > time ) )
     {
         kId = cacheId;
     }
-    else if( ( cacheId != 0xFFFFFFFF ) && ( cacheId < _numKeys-2 ) && ( _keys[cacheId+1].time <= time && _keys[cacheId+2].time > time ) )
+    else if( ( cacheId < _numKeys-2 ) && ( _times[cacheId+1] <= time && _times[cacheId+2] > time ) )
     {
-        cacheId++;
-        kId = cacheId;
+        kId = cacheId + 1;
     }
     else
     {
@@ -95,26 +437,83 @@ unsigned int Animation::getSRT(float time, SRT* srt, unsigned int cacheId)
         do
         {
             kId = startId + (endId - startId)/2;
-            if( ( _keys[kId].time <= time && _keys[kId+1].time > time ) ) break;
-            if( _keys[kId].time > time ) endId = kId;
-            else if( _keys[kId].time < time ) startId = kId;
+            if( ( _times[kId] <= time && _times[kId+1] > time ) ) break;
+            if( _times[kId] > time ) endId = kId;
+            else if( _times[kId] < time ) startId = kId;
         }
         while( true );
-        cacheId = kId;
     }
 
-    // linear interpolation    
-    float interpolator = ( time - _keys[kId].time ) / ( _keys[kId+1].time - _keys[kId].time );
-    D3DXVec3Lerp( &srt->scale, &_keys[kId].scale, &_keys[kId+1].scale, interpolator );
-    D3DXVec3Lerp( &srt->translation, &_keys[kId].translation, &_keys[kId+1].translation, interpolator );
-    D3DXQuaternionSlerp( &srt->rotation, &_keys[kId].rotation, &_keys[kId+1].rotation, interpolator );    
+    *interpolator = ( time - _times[kId] ) / ( _times[kId+1] - _times[kId] );
+    return kId;
+}
 
-    // no interpolation (+5% performance)
-    /*
-    *srt = _keys[kId];
-    */
+void Animation::decodeChannel(VectorChannel* channel, unsigned int kId, float (*lanes)[4], unsigned int stream, unsigned int lane)
+{
+    switch( channel->type )
+    {
+    case ctConstant:
+        lanes[stream][lane]   = channel->base.x;
+        lanes[stream+1][lane] = channel->base.y;
+        lanes[stream+2][lane] = channel->base.z;
+        break;
+    case ctLinear:
+    {
+        float phase = getKeyPhase( kId );
+        lanes[stream][lane]   = channel->base.x + channel->extent.x * phase;
+        lanes[stream+1][lane] = channel->base.y + channel->extent.y * phase;
+        lanes[stream+2][lane] = channel->base.z + channel->extent.z * phase;
+        break;
+    }
+    case ctKeyed:
+    {
+        const unsigned short* key = channel->keys + kId * 3;
+        lanes[stream][lane]   = channel->base.x + channel->extent.x * key[0];
+        lanes[stream+1][lane] = channel->base.y + channel->extent.y * key[1];
+        lanes[stream+2][lane] = channel->base.z + channel->extent.z * key[2];
+        break;
+    }
+    default:
+        assert( !"shouldn't be here!" );
+    }
+}
 
-    return cacheId;
+void Animation::decodeChannel(RotationChannel* channel, unsigned int kId, float (*lanes)[4], unsigned int lane)
+{
+    Quaternion rotation;
+    switch( channel->type )
+    {
+    case ctConstant:
+        rotation = channel->first;
+        break;
+    case ctLinear:
+        nlerpQuaternion( &rotation, &channel->first, &channel->last, getKeyPhase( kId ) );
+        break;
+    case ctKeyed:
+        unpackQuaternion( &rotation, channel->keys + kId );
+        break;
+    default:
+        assert( !"shouldn't be here!" );
+        rotation = Quaternion( 0,0,0,1 );
+    }
+    lanes[psRotationX][lane] = rotation.x;
+    lanes[psRotationY][lane] = rotation.y;
+    lanes[psRotationZ][lane] = rotation.z;
+    lanes[psRotationW][lane] = rotation.w;
+}
+
+void Animation::getKeys(unsigned int kId, float (*a)[4], float (*b)[4], unsigned int lane)
+{
+    assert( isCompressed() );
+    assert( kId>=0 && kId<_numKeys );
+
+    unsigned int nextId = std::min<unsigned int>( kId + 1, _numKeys - 1 );
+    decodeChannel( &_scale, kId, a, psScaleX, lane );
+    decodeChannel( &_scale, nextId, b, psScaleX, lane );
+    decodeChannel( &_rotation, kId, a, lane );
+    decodeChannel( &_rotation, nextId, b, lane );
+    decodeChannel( &_translation, kId, a, psTranslationX, lane );
+    decodeChannel( &_translation, nextId, b, psTranslationX, lane );
 }
 
 /**
@@ -126,11 +525,24 @@ AnimationSet::AnimationSet(unsigned int numAnimations)
     _numReferences = 1;
     _numAnimations = numAnimations;
     _animations = new Animation*[_numAnimations];
+    _sharedKeys = false;
+    _sharedPoses = NULL;
+    _sharedStreams = NULL;
     memset( _animations, 0, sizeof(Animation*)*_numAnimations );
 }
 
 AnimationSet::~AnimationSet()
 {
+    if( _sharedPoses )
+    {
+        for( unsigned int i=0; i<( 1 << ANIMATION_POSE_CACHE_BITS ); i++ )
+        {
+            delete[] _sharedPoses[i].matrices;
+            delete[] _sharedPoses[i].outputs;
+        }
+        delete[] _sharedPoses;
+        delete[] _sharedStreams;
+    }
     for( unsigned int i=0; i<_numAnimations; i++ )
     {
         delete _animations[i];
@@ -144,6 +556,186 @@ void AnimationSet::release(void)
     if( _numReferences == 1 ) delete this;
 }
 
+void AnimationSet::setAnimation(unsigned int animId, Animation* animation)
+{
+    assert( animId>=0 && animId<_numAnimations );
+    _animations[animId] = animation;
+    if( animation ) animation->compress();
+
+    // detect shared keys
+    _sharedKeys = ( _animations[0] != NULL );
+    for( unsigned int i=1; i<_numAnimations && _sharedKeys; i++ )
+    {
+        _sharedKeys = _animations[i] && _animations[i]->hasSameKeys( _animations[0] );
+    }
+}
+
+void AnimationSet::evaluatePose(float time, unsigned int& cacheId, float* pose)
+{
+    unsigned int stride = getPoseStride();
+    unsigned int i, j, animId;
+    float        a[psNumStreams][4];
+    float        b[psNumStreams][4];
+    float        interpolator[4];
+    unsigned int kId = 0;
+
+    // keys shared by all animations are searched once
+    if( _sharedKeys )
+    {
+        cacheId = kId = _animations[0]->findKey( time, interpolator, cacheId );
+        for( j=1; j<4; j++ ) interpolator[j] = interpolator[0];
+    }
+
+    float4 t, x, y, z, w;
+    for( i=0; i<stride; i+=4 )
+    {
+        // gather keys of 4 animations
+        for( j=0; j<4; j++ )
+        {
+            animId = i + j;
+            if( animId < _numAnimations )
+            {
+                if( !_sharedKeys ) 
+                {
+                    cacheId = kId = _animations[animId]->findKey( time, interpolator + j, cacheId );
+                }
+                _animations[animId]->getKeys( kId, a, b, j );
+            }
+            else
+            {
+                // identity in padding lanes
+                a[psScaleX][j] = a[psScaleY][j] = a[psScaleZ][j] = 1.0f;
+                a[psRotationX][j] = a[psRotationY][j] = a[psRotationZ][j] = 0.0f;
+                a[psRotationW][j] = 1.0f;
+                a[psTranslationX][j] = a[psTranslationY][j] = a[psTranslationZ][j] = 0.0f;
+                for( unsigned int k=0; k<psNumStreams; k++ ) b[k][j] = a[k][j];
+                interpolator[j] = 0.0f;
+            }
+        }
+
+        // interpolate scale & translation
+        t = f4load( interpolator );
+        for( j=psScaleX; j<=psScaleZ; j++ )
+        {
+            x = f4load( a[j] );
+            f4store( pose + j * stride + i, f4add( x, f4mul( f4sub( f4load( b[j] ), x ), t ) ) );
+        }
+        for( j=psTranslationX; j<=psTranslationZ; j++ )
+        {
+            x = f4load( a[j] );
+            f4store( pose + j * stride + i, f4add( x, f4mul( f4sub( f4load( b[j] ), x ), t ) ) );
+        }
+
+        // interpolate rotation
+        x = f4load( a[psRotationX] );
+        y = f4load( a[psRotationY] );
+        z = f4load( a[psRotationZ] );
+        w = f4load( a[psRotationW] );
+        nlerpQuaternion4( 
+            x, y, z, w, 
+            f4load( b[psRotationX] ), f4load( b[psRotationY] ), f4load( b[psRotationZ] ), f4load( b[psRotationW] ), 
+            t
+        );
+        f4store( pose + psRotationX * stride + i, x );
+        f4store( pose + psRotationY * stride + i, y );
+        f4store( pose + psRotationZ * stride + i, z );
+        f4store( pose + psRotationW * stride + i, w );
+    }
+}
+
+void AnimationSet::composePose(const float* pose, unsigned int stride, unsigned int numBones, Matrix** output, const float* weightSum)
+{
+    float4 one  = f4set( 1.0f );
+    float4 two  = f4set( 2.0f );
+    float4 zero = f4set( 0.0f );
+    float4 row[4][4];
+    unsigned int i, j, boneId;
+
+    for( i=0; i<numBones; i+=4 )
+    {
+        float4 x = f4load( pose + psRotationX * stride + i );
+        float4 y = f4load( pose + psRotationY * stride + i );
+        float4 z = f4load( pose + psRotationZ * stride + i );
+        float4 w = f4load( pose + psRotationW * stride + i );
+        float4 sx = f4load( pose + psScaleX * stride + i );
+        float4 sy = f4load( pose + psScaleY * stride + i );
+        float4 sz = f4load( pose + psScaleZ * stride + i );
+
+        float4 xx = f4mul( two, f4mul( x, x ) ), yy = f4mul( two, f4mul( y, y ) ), zz = f4mul( two, f4mul( z, z ) );
+        float4 xy = f4mul( two, f4mul( x, y ) ), xz = f4mul( two, f4mul( x, z ) ), yz = f4mul( two, f4mul( y, z ) );
+        float4 wx = f4mul( two, f4mul( w, x ) ), wy = f4mul( two, f4mul( w, y ) ), wz = f4mul( two, f4mul( w, z ) );
+
+        // scale * rotation * translation, rows in SoA order
+        row[0][0] = f4mul( sx, f4sub( one, f4add( yy, zz ) ) );
+        row[0][1] = f4mul( sx, f4add( xy, wz ) );
+        row[0][2] = f4mul( sx, f4sub( xz, wy ) );
+        row[0][3] = zero;
+        row[1][0] = f4mul( sy, f4sub( xy, wz ) );
+        row[1][1] = f4mul( sy, f4sub( one, f4add( xx, zz ) ) );
+        row[1][2] = f4mul( sy, f4add( yz, wx ) );
+        row[1][3] = zero;
+        row[2][0] = f4mul( sz, f4add( xz, wy ) );
+        row[2][1] = f4mul( sz, f4sub( yz, wx ) );
+        row[2][2] = f4mul( sz, f4sub( one, f4add( xx, yy ) ) );
+        row[2][3] = zero;
+        row[3][0] = f4load( pose + psTranslationX * stride + i );
+        row[3][1] = f4load( pose + psTranslationY * stride + i );
+        row[3][2] = f4load( pose + psTranslationZ * stride + i );
+        row[3][3] = one;
+
+        // transpose to AoS, row[r][j] is row r of matrix of bone i+j
+        for( j=0; j<4; j++ ) f4transpose( row[j][0], row[j][1], row[j][2], row[j][3] );
+
+        for( j=0; j<4; j++ )
+        {
+            boneId = i + j;
+            if( boneId >= numBones ) break;
+            if( !output[boneId] ) continue;
+            if( weightSum && weightSum[boneId] == 0 ) continue;
+            f4store( &output[boneId]->_11, row[0][j] );
+            f4store( &output[boneId]->_21, row[1][j] );
+            f4store( &output[boneId]->_31, row[2][j] );
+            f4store( &output[boneId]->_41, row[3][j] );
+        }
+    }
+}
+
+const Matrix* AnimationSet::getSharedPose(float time, unsigned int& cacheId)
+{
+    unsigned int i;
+
+    if( !_sharedPoses )
+    {
+        _sharedPoses = new SharedPose[1 << ANIMATION_POSE_CACHE_BITS];
+        for( i=0; i<( 1 << ANIMATION_POSE_CACHE_BITS ); i++ )
+        {
+            _sharedPoses[i].isValid  = false;
+            _sharedPoses[i].time     = 0.0f;
+            _sharedPoses[i].matrices = NULL;
+            _sharedPoses[i].outputs  = NULL;
+        }
+        _sharedStreams = new float[psNumStreams * getPoseStride()];
+    }
+
+    // slot is addressed by hash of time
+    unsigned int bits = *reinterpret_cast<unsigned int*>( &time );
+    SharedPose* sharedPose = _sharedPoses + ( ( bits * 2654435761u ) >> ( 32 - ANIMATION_POSE_CACHE_BITS ) );
+    if( sharedPose->isValid && sharedPose->time == time ) return sharedPose->matrices;
+
+    // evaluate pose
+    if( !sharedPose->matrices )
+    {
+        sharedPose->matrices = new Matrix[_numAnimations];
+        sharedPose->outputs  = new Matrix*[_numAnimations];
+        for( i=0; i<_numAnimations; i++ ) sharedPose->outputs[i] = sharedPose->matrices + i;
+    }
+    evaluatePose( time, cacheId, _sharedStreams );
+    composePose( _sharedStreams, getPoseStride(), _numAnimations, sharedPose->outputs, NULL );
+    sharedPose->isValid = true;
+    sharedPose->time    = time;
+    return sharedPose->matrices;
+}
+
 /**
  * animation track
  */
@@ -217,10 +809,7 @@ AnimationController::AnimationController(Frame* hierarchy, AnimationSet* animati
     for( unsigned int i=0; i<_animationSet->getNumAnimations(); i++ )
     {
         Frame* targetFrame = hierarchyRoot->findFrame( _animationSet->getAnimationByIndex( i )->getName() );
-        if( targetFrame )
-        {
-            _animationOutput[ i ] = &targetFrame->TransformationMatrix;
-        }
+        _animationOutput[ i ] = targetFrame ? &targetFrame->TransformationMatrix : NULL;
     }
 
     memset( _track, 0, sizeof(Track) * engine::maxAnimationTracks );
@@ -238,7 +827,16 @@ AnimationController::AnimationController(Frame* hierarchy, AnimationSet* animati
     _blendSrc = new SRT[_animationSet->getNumAnimations()];
     _blendDst = new SRT[_animationSet->getNumAnimations()];
 
+    // track poses are allocated when tracks are mixed first time
+    unsigned int stride = _animationSet->getPoseStride();
+    memset( _trackPose, 0, sizeof(float*) * engine::maxAnimationTracks );
+    _mixerPose      = new float[psNumStreams * stride];
+    _mixerWeight    = new float[engine::maxAnimationTracks * stride];
+    _mixerWeightSum = new float[stride];
+
     _activeTrack.reserve( engine::maxAnimationTracks );
+
+    _poseGranularity = 0.0f;
 }
 
 AnimationController::~AnimationController()
@@ -249,6 +847,14 @@ AnimationController::~AnimationController()
         _weightSetMap.erase( _weightSetMap.begin() );
     }
 
+    for( unsigned int i=0; i<engine::maxAnimationTracks; i++ )
+    {
+        if( _trackPose[i] ) delete[] _trackPose[i];
+    }
+    delete[] _mixerWeightSum;
+    delete[] _mixerWeight;
+    delete[] _mixerPose;
+
     _animationSet->release();
     delete[] _blendDst;
     delete[] _blendSrc;
@@ -369,30 +975,6 @@ void AnimationController::copyTrack(unsigned int srcTrackId, unsigned int dstTra
     _track[dstTrackId] = _track[srcTrackId];
 }
 
-inline void slerpQuaternions(SRT* dst, SRT* src, engine::WeightSet* weightSet, std::vector<unsigned int>& activeTrack)
-{   
-    SRT temp;
-    float weight1 = weightSet->weight[activeTrack[0]];
-    float weight2;
-    float weightSum;
-    unsigned int j;
-    DWORD* testZero = reinterpret_cast<DWORD*>( &weight2 );
-    dst->rotation = src[activeTrack[0]].rotation;
-    for( unsigned int i=1; i<activeTrack.size(); i++ )
-    {
-        j = activeTrack[i];
-        weight2 = weightSet->weight[j];
-        if( (*testZero) )
-        {
-            weightSum = weight1 + weight2;        
-            weight2 /= ( weightSum>0 ) ? ( weight1 + weight2 ) : 1.0f;        
-            D3DXQuaternionSlerp( &temp.rotation, &dst->rotation, &src[j].rotation, weight2 );
-            dst->rotation = temp.rotation;
-            weight1 += weightSet->weight[j];
-        }        
-    }
-}
-
 void AnimationController::advance(float dt)
 {
     if( _activeTrack.size() == 0 ) 
@@ -412,112 +994,160 @@ void AnimationController::advance(float dt)
 
 void AnimationController::advanceSingleTrack(float dt)
 {
-    unsigned int i;
-    Matrix s,r,rs,t;
-
     unsigned int activeTrack = _activeTrack[0];
 
     // advance time for active track
     _track[activeTrack].time += dt * _track[activeTrack].speed;
     _track[activeTrack].updateAbsoluteTime();    
 
-    // mix animation tracks
-    for( i=0; i<_animationSet->getNumAnimations(); i++ )
+    // reuse pose shared by controllers of the same animation set
+    if( _poseGranularity > 0 )
     {
-        // calculate SRT values for active track
-        _track[activeTrack].cacheId = _animationSet->getAnimationByIndex( i )->getSRT( 
-            _track[activeTrack].absoluteTime, 
-            &_mixerDst,
-            _track[activeTrack].cacheId
-        );
-
-        // calculate final transformation matrix from mixer destination SRT
-        D3DXMatrixRotationQuaternion( &r, &_mixerDst.rotation );
-        D3DXMatrixScaling( &s, _mixerDst.scale.x, _mixerDst.scale.y, _mixerDst.scale.z );
-        D3DXMatrixTranslation( &t, _mixerDst.translation.x, _mixerDst.translation.y, _mixerDst.translation.z );
-        dxMultiply( &rs, &s, &r );
-        dxMultiply( _animationOutput[i], &rs, &t );
+        engine::AnimSequence* sequence = _track[activeTrack].animation;
+        float time = floor( _track[activeTrack].absoluteTime / _poseGranularity + 0.5f ) * _poseGranularity;
+        time = time < sequence->startTime ? sequence->startTime : ( time > sequence->endTime ? sequence->endTime : time );
+        const Matrix* pose = _animationSet->getSharedPose( time, _track[activeTrack].cacheId );
+        for( unsigned int i=0; i<_animationSet->getNumAnimations(); i++ )
+        {
+            if( _animationOutput[i] ) *_animationOutput[i] = pose[i];
+        }
+        return;
     }
+
+    // decode pose of active track & calculate final transformation matrices
+    _animationSet->evaluatePose( 
+        _track[activeTrack].absoluteTime, 
+        _track[activeTrack].cacheId, 
+        _mixerPose 
+    );
+    AnimationSet::composePose( 
+        _mixerPose, 
+        _animationSet->getPoseStride(), 
+        _animationSet->getNumAnimations(), 
+        _animationOutput, 
+        NULL 
+    );
 }
 
 void AnimationController::advanceMultipleTracks(float dt)
 {    
     unsigned int i,j,k;
-    Matrix s,r,rs,t;
 
     unsigned int numActiveTracks = _activeTrack.size();
+    unsigned int numAnimations   = _animationSet->getNumAnimations();
+    unsigned int stride          = _animationSet->getPoseStride();
 
-    // advance time for active tracks
+    // advance time & decode poses for active tracks
     for( j=0; j<numActiveTracks; j++ )
     {
-        _track[_activeTrack[j]].time += dt * _track[_activeTrack[j]].speed;
-        _track[_activeTrack[j]].updateAbsoluteTime();
+        k = _activeTrack[j];
+        _track[k].time += dt * _track[k].speed;
+        _track[k].updateAbsoluteTime();
+        if( !_trackPose[k] ) _trackPose[k] = new float[psNumStreams * stride];
+        _animationSet->evaluatePose( _track[k].absoluteTime, _track[k].cacheId, _trackPose[k] );
     }
 
-    engine::WeightSet weightSet;
-
-    // mix animation tracks
-    for( i=0; i<_animationSet->getNumAnimations(); i++ )
+    // calculate weights taking into account a weight set
+    bool useWeightSet = ( _activeWeightSetI._Mynode() != 0 );
+    float weight;
+    for( i=0; i<stride; i++ )
     {
-        // calculate SRT values for active tracks
-        for( j=0; j<numActiveTracks; j++ ) 
-        {
-            k = _activeTrack[j]; 
-            _track[k].cacheId = _animationSet->getAnimationByIndex( i )->getSRT( 
-                _track[k].absoluteTime, 
-                _mixerSrc+k,
-                _track[k].cacheId
-            );
-        }
-
-        // reset destination SRT
-        memset( &_mixerDst, 0, sizeof(SRT) );
-
-        // calculate weights taking into account a weight set
-        float weightSum = 0.0f;
+        _mixerWeightSum[i] = 0.0f;
         for( j=0; j<numActiveTracks; j++ )
         {
             k = _activeTrack[j];
-            weightSet.weight[k] = _track[k].weight;
-            weightSum += weightSet.weight[k];
-        }
-        if( _activeWeightSetI._Mynode() != 0 )
-        {
-            weightSum = 0.0f;
-            for( j=0; j<numActiveTracks; j++ )
+            weight = 0.0f;
+            if( i < numAnimations ) 
             {
-                k = _activeTrack[j];
-                weightSet.weight[k] *= _activeWeightSetI->second[i].weight[k];
-                weightSum += weightSet.weight[k];
+                weight = _track[k].weight;
+                if( useWeightSet ) weight *= _activeWeightSetI->second[i].weight[k];
             }
+            _mixerWeight[j * stride + i] = weight;
+            _mixerWeightSum[i] += weight;
         }
 
-        if( weightSum == 0 ) continue;
-
         // rescale weights to achieve a weight sum of 1.0f
+        if( _mixerWeightSum[i] == 0 ) continue;
         for( j=0; j<numActiveTracks; j++ )
         {
-            k = _activeTrack[j];
-            weightSet.weight[k] *= 1.0f / weightSum; 
+            _mixerWeight[j * stride + i] *= 1.0f / _mixerWeightSum[i];
         }
+    }
+
+    mixPoses();
+
+    // calculate final transformation matrices, animations with zero weight sum are left untouched
+    AnimationSet::composePose( _mixerPose, stride, numAnimations, _animationOutput, _mixerWeightSum );
+}
+
+void AnimationController::mixPoses(void)
+{
+    static const unsigned int vectorStreams[6] = { psScaleX, psScaleY, psScaleZ, psTranslationX, psTranslationY, psTranslationZ };
 
+    unsigned int numActiveTracks = _activeTrack.size();
+    unsigned int stride          = _animationSet->getPoseStride();
+    unsigned int i, j, s, stream;
+    const float* src;
+    float4       weight, accumWeight, t;
+    float4       dst, x, y, z, w, bx, by, bz, bw, contributes;
+    float4       tiny = f4set( 1e-20f );
+    float4       zero = f4set( 0.0f );
+    float4       one  = f4set( 1.0f );
+
+    for( i=0; i<stride; i+=4 )
+    {
         // mix scale and translational components
-        for( j=0; j<numActiveTracks; j++ )
+        for( s=0; s<6; s++ )
         {
-            k = _activeTrack[j];
-            _mixerDst.scale += _mixerSrc[k].scale * weightSet.weight[k];
-            _mixerDst.translation += _mixerSrc[k].translation * weightSet.weight[k];
+            stream = vectorStreams[s];
+            dst = f4set( 0.0f );
+            for( j=0; j<numActiveTracks; j++ )
+            {
+                src    = _trackPose[_activeTrack[j]];
+                weight = f4load( _mixerWeight + j * stride + i );
+                dst    = f4add( dst, f4mul( f4load( src + stream * stride + i ), weight ) );
+            }
+            f4store( _mixerPose + stream * stride + i, dst );
         }
-        
-        // mix rotational components
-        slerpQuaternions( &_mixerDst, _mixerSrc, &weightSet, _activeTrack );
-
-        // calculate final transformation matrix from mixer destination SRT
-        D3DXMatrixRotationQuaternion( &r, &_mixerDst.rotation );
-        D3DXMatrixScaling( &s, _mixerDst.scale.x, _mixerDst.scale.y, _mixerDst.scale.z );
-        D3DXMatrixTranslation( &t, _mixerDst.translation.x, _mixerDst.translation.y, _mixerDst.translation.z );
-        dxMultiply( &rs, &s, &r );
-        dxMultiply( _animationOutput[i], &rs, &t );
+
+        // mix rotational components, each track is blended with accumulated weight of previous tracks
+        src = _trackPose[_activeTrack[0]];
+        x = f4load( src + psRotationX * stride + i );
+        y = f4load( src + psRotationY * stride + i );
+        z = f4load( src + psRotationZ * stride + i );
+        w = f4load( src + psRotationW * stride + i );
+        accumWeight = f4load( _mixerWeight + i );
+        for( j=1; j<numActiveTracks; j++ )
+        {
+            // tracks of zero weight are skipped, as by D3DX mixer
+            weight = f4load( _mixerWeight + j * stride + i );
+            contributes = f4and( f4gt( weight, zero ), one );
+            if( !f4mask( f4gt( contributes, zero ) ) ) continue;
+            src    = _trackPose[_activeTrack[j]];
+            accumWeight = f4add( accumWeight, weight );
+            t = f4div( weight, f4max( accumWeight, tiny ) );
+            bx = x, by = y, bz = z, bw = w;
+            slerpQuaternion4(
+                bx, by, bz, bw,
+                f4load( src + psRotationX * stride + i ),
+                f4load( src + psRotationY * stride + i ),
+                f4load( src + psRotationZ * stride + i ),
+                f4load( src + psRotationW * stride + i ),
+                t
+            );
+            x = f4add( x, f4mul( contributes, f4sub( bx, x ) ) );
+            y = f4add( y, f4mul( contributes, f4sub( by, y ) ) );
+            z = f4add( z, f4mul( contributes, f4sub( bz, z ) ) );
+            w = f4add( w, f4mul( contributes, f4sub( bw, w ) ) );
+        }
+
+        // polynomial slerp is approximate, so mixed rotation is renormalized
+        t = f4div( one, f4max( f4sqrt( f4add( f4add( f4mul( x, x ), f4mul( y, y ) ), f4add( f4mul( z, z ), f4mul( w, w ) ) ) ), tiny ) );
+        x = f4mul( x, t ), y = f4mul( y, t ), z = f4mul( z, t ), w = f4mul( w, t );
+        f4store( _mixerPose + psRotationX * stride + i, x );
+        f4store( _mixerPose + psRotationY * stride + i, y );
+        f4store( _mixerPose + psRotationZ * stride + i, z );
+        f4store( _mixerPose + psRotationW * stride + i, w );
     }
 }
 
@@ -532,6 +1162,7 @@ void AnimationController::captureBlendSrc(void)
 
     for( unsigned int i=0; i<_animationSet->getNumAnimations(); i++ )
     {
+        if( !_animationOutput[i] ) continue;
         srt = _blendSrc + i;
         srt->scale.x = D3DXVec3Length( &dxRight( _animationOutput[i] ) );
         srt->scale.y = D3DXVec3Length( &dxUp( _animationOutput[i] ) );
@@ -566,6 +1197,7 @@ void AnimationController::captureBlendDst(void)
 
     for( unsigned int i=0; i<_animationSet->getNumAnimations(); i++ )
     {
+        if( !_animationOutput[i] ) continue;
         srt = _blendDst + i;
         srt->scale.x = D3DXVec3Length( &dxRight( _animationOutput[i] ) );
         srt->scale.y = D3DXVec3Length( &dxUp( _animationOutput[i] ) );
@@ -604,6 +1236,7 @@ void AnimationController::blend(float interpolator)
 
     for( unsigned int i=0; i<_animationSet->getNumAnimations(); i++ )
     {
+        if( !_animationOutput[i] ) continue;
         D3DXVec3Lerp( &srt.scale, &_blendSrc[i].scale, &_blendDst[i].scale, interpolator );        
         D3DXVec3Lerp( &srt.translation, &_blendSrc[i].translation, &_blendDst[i].translation, interpolator );
         D3DXQuaternionSlerp( &srt.rotation, &_blendSrc[i].rotation, &_blendDst[i].rotation, interpolator );
@@ -675,4 +1308,14 @@ void AnimationController::forAllAnimationWeightSets(const char* weightSetName, e
             data
         );
     }
-}
\ No newline at end of file
+}
+
+/**
+ * pose sharing
+ */
+
+void AnimationController::setPoseGranularity(float granularity)
+{
+    assert( granularity >= 0 );
+    _poseGranularity = granularity;
+}
@@ -26,21 +26,78 @@ public:
     Vector     translation;
 };
 
+/**
+ * rotation quantized by "smallest three" method: the largest component is dropped,
+ * the rest three are stored by 15 bits, index of dropped component is stored 
+ * in the high bits of first two values
+ */
+
+struct PackedQuaternion
+{
+public:
+    unsigned short value[3];
+};
+
+/**
+ * streams of decoded pose, each stream holds one component for all bones
+ */
+
+enum PoseStream
+{
+    psScaleX, psScaleY, psScaleZ,
+    psRotationX, psRotationY, psRotationZ, psRotationW,
+    psTranslationX, psTranslationY, psTranslationZ,
+    psNumStreams
+};
+
 class Animation
 {
 private:
-    std::string  _name;
-    unsigned int _numKeys;
-    SRT*         _keys;
-    float        _period;
+    enum ChannelType
+    {
+        ctConstant, // single value for all keys
+        ctLinear,   // value is linear function of time
+        ctKeyed     // quantized value per key
+    };
+    struct VectorChannel
+    {
+    public:
+        ChannelType     type;
+        Vector          base;   // constant value, first value or dequantization base
+        Vector          extent; // difference of last & first values or dequantization step
+        unsigned short* keys;   // quantized values, 3 per key
+    };
+    struct RotationChannel
+    {
+    public:
+        ChannelType       type;
+        Quaternion        first; // constant value or first value
+        Quaternion        last;  // last value
+        PackedQuaternion* keys;  // quantized values
+    };
+private:
+    std::string     _name;
+    unsigned int    _numKeys;
+    SRT*            _keys;        // raw keys, released when animation is compressed
+    float*          _times;       // key times, NULL for evenly spaced keys
+    float           _startTime;   // time of first key
+    float           _interval;    // interval of evenly spaced keys
+    float           _period;
+    VectorChannel   _scale;
+    RotationChannel _rotation;
+    VectorChannel   _translation;
+private:
+    float getKeyTime(unsigned int kId);
+    float getKeyPhase(unsigned int kId);
+    void compressChannel(VectorChannel* channel, unsigned int offset, float tolerance);
+    void compressChannel(RotationChannel* channel);
+    void decodeChannel(VectorChannel* channel, unsigned int kId, float (*lanes)[4], unsigned int stream, unsigned int lane);
+    void decodeChannel(RotationChannel* channel, unsigned int kId, float (*lanes)[4], unsigned int lane);
 public:
     inline const char* getName(void) { return _name.c_str(); }
     inline float getPeriod(void) { return _period; }
-    inline SRT* getKey(unsigned int kId) 
-    {
-        assert( kId>=0 && kId<_numKeys );
-        return _keys+kId;
-    }
+    inline unsigned int getNumKeys(void) { return _numKeys; }
+    inline bool isCompressed(void) { return _keys == NULL; }
 public:
     Animation(const char* name, unsigned int numKeys);
     virtual ~Animation(void);
@@ -48,7 +105,23 @@ public:
     Animation* clone(void);
     void setKey(unsigned int kId, const SRT* srt);    
     bool validateKeys(void);
-    unsigned int getSRT(float time, SRT* srt, unsigned int cacheId=0xFFFFFFFF);
+    /**
+     * quantizes keys and elides constant & linear channels, raw keys are released
+     */
+    void compress(void);
+    /**
+     * @return true if both animations have the same key times
+     */
+    bool hasSameKeys(Animation* animation);
+    /**
+     * searches for key pair around specified time
+     * @return index of first key of pair, it may be passed as cache for sequential search
+     */
+    unsigned int findKey(float time, float* interpolator, unsigned int cacheId=0xFFFFFFFF);
+    /**
+     * decodes keys kId & kId+1 into specified lane of SoA arrays (psNumStreams x 4 floats)
+     */
+    void getKeys(unsigned int kId, float (*a)[4], float (*b)[4], unsigned int lane);
 };
 
 /**
@@ -59,16 +132,46 @@ class AnimationSet
 {
 private:
     friend class AnimationController;
+private:
+    struct SharedPose
+    {
+    public:
+        bool     isValid;
+        float    time;     // quantized time of pose
+        Matrix*  matrices; // composed pose
+        Matrix** outputs;  // pointers to composed pose
+    };
 private:
     unsigned int _numReferences;
     unsigned int _numAnimations;
     Animation**  _animations;
+    bool         _sharedKeys;    // all animations have the same keys, so keys are searched once per pose
+    SharedPose*  _sharedPoses;   // direct-mapped cache of poses shared by controllers
+    float*       _sharedStreams; // decoded pose of shared pose cache miss
 private:
     virtual ~AnimationSet();
 public:
     AnimationSet(unsigned int numAnimations);    
     void release(void);
 public:
+    /**
+     * decodes pose of all animations at specified time into psNumStreams streams of getPoseStride() floats
+     */
+    void evaluatePose(float time, unsigned int& cacheId, float* pose);
+    /**
+     * builds transformation matrices from decoded pose, NULL outputs and outputs 
+     * with zero weight sum (if weight sums are specified) aren't changed
+     */
+    static void composePose(const float* pose, unsigned int stride, unsigned int numBones, Matrix** output, const float* weightSum);
+    /**
+     * @return composed pose at specified (quantized) time, pose is evaluated on cache miss only
+     */
+    const Matrix* getSharedPose(float time, unsigned int& cacheId);
+public:
+    inline unsigned int getPoseStride(void)
+    {
+        return ( _numAnimations + 3 ) & ~3;
+    }
     inline unsigned int getNumAnimations(void)
     {
         return _numAnimations;
@@ -96,11 +199,7 @@ public:
         assert( !"getAnimationIndexByName() : animation not found!" );
         return 0xFFFFFFFF;
     }
-    inline void setAnimation(unsigned int animId, Animation* animation)
-    {
-        assert( animId>=0 && animId<_numAnimations );
-        _animations[animId] = animation;
-    }
+    void setAnimation(unsigned int animId, Animation* animation);
 };
 
 /**
@@ -139,13 +238,17 @@ private:
     std::vector<unsigned int> _activeTrack;    
     WeightSetMap              _weightSetMap;
     WeightSetI                _activeWeightSetI;
-    SRT                       _mixerSrc[engine::maxAnimationTracks];
-    SRT                       _mixerDst;
+    float*                    _trackPose[engine::maxAnimationTracks]; // decoded poses of tracks
+    float*                    _mixerPose;      // decoded pose of mixer output
+    float*                    _mixerWeight;    // normalized weights of active tracks, per bone
+    float*                    _mixerWeightSum; // weight sums, per bone
     SRT*                      _blendSrc;
     SRT*                      _blendDst;
+    float                     _poseGranularity; // time granularity of shared poses
 private:
     void advanceSingleTrack(float dt);
     void advanceMultipleTracks(float dt);
+    void mixPoses(void);
 public:
     // class implementation
     AnimationController(Frame* hierarchy, AnimationSet* animationSet, Frame* hierarchyRoot);
@@ -177,6 +280,8 @@ public:
     virtual engine::WeightSet* __stdcall getWeightSet(const char* weightSetName);
     virtual engine::WeightSet* __stdcall getAnimationWeightSet(const char* weightSetName, const char* animationName);
     virtual void __stdcall forAllAnimationWeightSets(const char* weightSetName, engine::WeightSetCallBack callBack, void* data);
+    // IAnimationController : pose sharing
+    virtual void __stdcall setPoseGranularity(float granularity);
 public:
     // module local : inlines
     inline AnimationSet* getAnimationSet(void) { return _animationSet; }
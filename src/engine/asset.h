@@ -13,6 +13,7 @@
 #include "headers.h"
 #include "engine.h"
 #include "bsp.h"
+#include "jobs.h"
 #include "../common/istring.h"
 #include "../shared/import.h"
 
@@ -124,7 +125,8 @@ public:
 #define BA_LIGHT     0x74696C0D
 #define BA_BSP       0x7073620D 
 #define BA_SECTOR    0x6365730D
-#define BA_OCTREE    0x74636F0D
+#define BA_OCTREE    0x74636F0D /* legacy, superseded by BA_BVH */
+#define BA_BVH       0x6876620D
 #define BA_EFFECT    0x7866650D 
 #define BA_BINARY    0x6E69620D
 #define BA_EXTENSION 0x7478650D
@@ -145,6 +147,24 @@ public:
     void write(IResource* resource);
 };
 
+// binary asset loading state, shared with asynchronous loader
+struct BinaryAssetLoad
+{
+public:
+    JobGroup      jobs;       // texture decoding jobs
+    volatile LONG bytesRead;  // asset stream position
+    LONG          bytesTotal; // asset stream size
+public:
+    BinaryAssetLoad() : bytesRead(0), bytesTotal(0) {}
+public:
+    // stream reading & texture decoding are equally weighted
+    inline float getProgress(void)
+    {
+        float streamProgress = bytesTotal ? float( bytesRead ) / float( bytesTotal ) : 0.0f;
+        return 0.5f * streamProgress + 0.5f * jobs.getProgress();
+    }
+};
+
 class BinaryAsset : public Asset
 {
 private:
@@ -171,13 +191,16 @@ private:
 private:
     std::string  _resourcePath;
     AssetObjectM _assetObjects;
+    StringL      _newTextures;  // textures registered by this asset while reading
 private:
     void collectTextures(std::list<Texture*>* textures);
+    void readChunks(IResource* resource, BinaryAssetLoad* load);
     void readLightmaps(unsigned int numLightmaps, IResource* resource);
+    void onChunkRead(IResource* resource, BinaryAssetLoad* load);
 public:
     // class implementation
     BinaryAsset(const char* resourceName);
-    BinaryAsset(IResource* resource);
+    BinaryAsset(IResource* resource, BinaryAssetLoad* load = NULL);
     virtual ~BinaryAsset(void);
 public:
     // IAsset
@@ -6,6 +6,7 @@
 #include "camera.h"
 #include "collision.h"
 #include "wire.h"
+#include "raypacket.h"
 
 //#define RENDER_BATCH_BSP
 
@@ -13,6 +14,8 @@
 #define MIN_INSTANCE_BRIGHTNESS 0.75f
 #define MAX_INSTANCE_BRIGHTNESS 1.00f
 
+#define BATCH_BIN_WIDTH 8 // instances processed by one iteration of LOD binning
+
 /**
  * kurieitoru 
  */
@@ -70,13 +73,32 @@ Batch::Batch(unsigned int batchSize, engine::BatchScheme* batchScheme) : _batchS
         _lods[i].lodGeometry->_numReferences++;
 
         // allocate space for LOD instances
-        _lods[i].lodMatrices = new Matrix[_batchSize];
-        _lods[i].lodColors   = new Quartector[_batchSize];
+        _lods[i].lodIndices = new unsigned int[_batchSize];
 
         // calculate squared distance
         _lods[i].lodSqDistance = _batchScheme.lodDistance[i] * _batchScheme.lodDistance[i];
     }
 
+    // bounding radius of all LODs around the instance origin
+    _lodRadius = 0.0f;
+    for( unsigned int i=0; i<_batchScheme.numLods; i++ )
+    {
+        Sphere* sphere = _lods[i].lodGeometry->getBoundingSphere();
+        _lodRadius = std::max( _lodRadius, D3DXVec3Length( &sphere->center ) + sphere->radius );
+    }
+
+    // position streams are padded to the width of binning kernel
+    unsigned int streamSize = ( _batchSize + BATCH_BIN_WIDTH - 1 ) / BATCH_BIN_WIDTH * BATCH_BIN_WIDTH;
+    _posX   = reinterpret_cast<float*>( _aligned_malloc( sizeof(float) * streamSize, 16 ) );
+    _posY   = reinterpret_cast<float*>( _aligned_malloc( sizeof(float) * streamSize, 16 ) );
+    _posZ   = reinterpret_cast<float*>( _aligned_malloc( sizeof(float) * streamSize, 16 ) );
+    _radius = reinterpret_cast<float*>( _aligned_malloc( sizeof(float) * streamSize, 16 ) );
+    for( unsigned int i=0; i<streamSize; i++ )
+    {
+        _posX[i] = _posY[i] = _posZ[i] = 0.0f;
+        _radius[i] = _lodRadius;
+    }
+
     // create & reset instance data 
     _matrices = new Matrix[_batchSize];
     _colors   = new Quartector[_batchSize];
@@ -129,12 +151,16 @@ Batch::~Batch()
     for( unsigned int i=0; i<_batchScheme.numLods; i++ )
     {
         _lods[i].lodGeometry->release();
-        delete[] _lods[i].lodMatrices;
-        delete[] _lods[i].lodColors;
+        delete[] _lods[i].lodIndices;
     }
 
     // release instance data
     delete[] _matrices;
+    delete[] _colors;
+    _aligned_free( _posX );
+    _aligned_free( _posY );
+    _aligned_free( _posZ );
+    _aligned_free( _radius );
 
     // release shared effect
     _numGlobalReferences--;
@@ -188,24 +214,50 @@ void Batch::setMatrix(unsigned int batchId, const Matrix4f& matrix)
 {
     assert( batchId < _batchSize );
     _matrices[batchId] = wrap( matrix );
+
+    // update position streams, radius is scaled by the largest axis of transformation
+    Matrix& m = _matrices[batchId];
+    _posX[batchId] = m._41;
+    _posY[batchId] = m._42;
+    _posZ[batchId] = m._43;
+    float scale = std::max( 
+        m._11 * m._11 + m._12 * m._12 + m._13 * m._13,
+        std::max( m._21 * m._21 + m._22 * m._22 + m._23 * m._23, m._31 * m._31 + m._32 * m._32 + m._33 * m._33 )
+    );
+    _radius[batchId] = _lodRadius * sqrtf( scale );
 }
 
 void Batch::createBatchTree(unsigned int leafSize, const char* resourceName)
 {
     if( _rootSector ) delete _rootSector;
+    _rootSector = NULL;
+
+    Sector::CacheHeader header;
+    Sector::getCacheHeader( header, leafSize, _lods[0].lodGeometry, _matrices, _batchSize );
 
     IResource* resource = getCore()->getResource( resourceName, "rb" );
     if( resource )
     {
-        _rootSector = new Sector( resource );
+        _rootSector = Sector::readTree( resource, header );
         resource->release();
     }
-    else
+
+    // rebuild absent or stale cache
+    if( !_rootSector )
     {
         _rootSector = Sector::createTree( leafSize, _lods[0].lodGeometry, _matrices, _batchSize );
         resource = getCore()->getResource( resourceName, "wb" ); assert( resource );
-        _rootSector->write( resource );
-        resource->release();
+        if( resource )
+        {
+            bool isWritten = Sector::writeTree( _rootSector, resource, header );
+            resource->release();
+            if( !isWritten )
+            {
+                // partially written cache is not kept
+                getCore()->logMessage( "engine: failed to write batch spatial cache \"%s\"", resourceName );
+                remove( resourceName );
+            }
+        }
     }
     assert( static_cast<Sector*>(_rootSector)->getNumInstancesInHierarchy() == _batchSize );
 }
@@ -229,13 +281,8 @@ void Batch::forAllInstancesInAABB(Vector3f aabbInf, Vector3f aabbSup, engine::IB
 
 void Batch::updateLODs(void)
 {
-    unsigned int i,j;
-    Vector pos;
-    Vector distance;
-    float distanceLengthSq;
-
     // clear LODs
-    for( i=0; i<_batchScheme.numLods; i++ ) _lods[i].lodSize = 0;
+    for( unsigned int i=0; i<_batchScheme.numLods; i++ ) _lods[i].lodSize = 0;
 
     // if BSP acceleration is enabled
     if( _rootSector )
@@ -244,26 +291,9 @@ void Batch::updateLODs(void)
         updateLODs( static_cast<Sector*>(_rootSector) );
     }
     // pass all instances
-    else for( i=0; i<_batchSize; i++ )
+    else
     {
-        // calculate instance position
-        pos.x = _matrices[i]._41,
-        pos.y = _matrices[i]._42,
-        pos.z = _matrices[i]._43;
-        // calculate squared distance from camera to instace position
-        D3DXVec3Subtract( &distance, &pos, &Camera::eyePos );
-        distanceLengthSq = D3DXVec3LengthSq( &distance );
-        // pass all LODs
-        for( j=0; j<_batchScheme.numLods; j++ )
-        {            
-            if( _lods[j].lodSqDistance > distanceLengthSq )
-            {
-                _lods[j].lodMatrices[_lods[j].lodSize] = _matrices[i];
-                _lods[j].lodColors[_lods[j].lodSize] = _colors[i];
-                _lods[j].lodSize++;
-                break;
-            }
-        }
+        binInstances( 0, _batchSize, NULL );
     }
 }
 
@@ -274,11 +304,8 @@ void Batch::updateLODs(Sector* sector)
         // leaf?
         if( sector->left == NULL && sector->right == NULL )
         {
-            Vector pos;
-            Vector distance;
-            float distanceLengthSq;
-
             // calculate nearest (rough) distance to this sector
+            Vector distance;
             D3DXVec3Subtract( &distance, &sector->boundingSphere.center, &Camera::eyePos );
             float nearestDistance = D3DXVec3Length( &distance ) - sector->boundingSphere.radius;
 
@@ -286,29 +313,7 @@ void Batch::updateLODs(Sector* sector)
             if( nearestDistance < _batchScheme.lodDistance[_batchScheme.numLods-1] )
             {
                 // collect instaces
-                unsigned int index, instanceId, lodId;
-                for( index = 0; index < sector->numIndices; index++ )
-                {
-                    instanceId = sector->indices[index];
-                    // calculate instance position
-                    pos.x = _matrices[instanceId]._41,
-                    pos.y = _matrices[instanceId]._42,
-                    pos.z = _matrices[instanceId]._43;
-                    // calculate squared distance from camera to instace position
-                    D3DXVec3Subtract( &distance, &pos, &Camera::eyePos );
-                    distanceLengthSq = D3DXVec3LengthSq( &distance );
-                    // pass all LODs
-                    for( lodId=0; lodId<_batchScheme.numLods; lodId++ )
-                    {            
-                        if( _lods[lodId].lodSqDistance > distanceLengthSq )
-                        {
-                            _lods[lodId].lodMatrices[_lods[lodId].lodSize] = _matrices[instanceId];
-                            _lods[lodId].lodColors[_lods[lodId].lodSize] = _colors[instanceId];
-                            _lods[lodId].lodSize++;
-                            break;
-                        }
-                    }
-                }
+                binInstances( 0, sector->numIndices, sector->indices );
             }
         }
         else
@@ -319,6 +324,103 @@ void Batch::updateLODs(Sector* sector)
     }
 }
 
+/**
+ * culls and bins BATCH_BIN_WIDTH instances per iteration: instance is visible 
+ * if its bounding sphere isn't behind any frustum plane, visible instance goes 
+ * to the first LOD whose squared distance exceeds the squared distance to camera,
+ * instances are taken in range [first,first+count) or through the indices
+ */
+
+void Batch::binInstances(unsigned int first, unsigned int count, const unsigned int* indices)
+{
+    unsigned int i, lane, lodId, planeId;
+
+    // kernel constants
+    float4 zero = f4set( 0.0f );
+    float4 eyeX = f4set( Camera::eyePos.x );
+    float4 eyeY = f4set( Camera::eyePos.y );
+    float4 eyeZ = f4set( Camera::eyePos.z );
+    float4 planeA[6], planeB[6], planeC[6], planeD[6];
+    for( planeId=0; planeId<6; planeId++ )
+    {
+        planeA[planeId] = f4set( Camera::frustrum[planeId].a );
+        planeB[planeId] = f4set( Camera::frustrum[planeId].b );
+        planeC[planeId] = f4set( Camera::frustrum[planeId].c );
+        // frustum plane distance is a*x + b*y + c*z - d (see distTo)
+        planeD[planeId] = f4set( -Camera::frustrum[planeId].d );
+    }
+    float4 lodSqDistance[engine::maxBatchLods];
+    for( lodId=0; lodId<_batchScheme.numLods; lodId++ )
+    {
+        lodSqDistance[lodId] = f4set( _lods[lodId].lodSqDistance );
+    }
+
+    // gathered lanes
+    float        x[BATCH_BIN_WIDTH], y[BATCH_BIN_WIDTH], z[BATCH_BIN_WIDTH], r[BATCH_BIN_WIDTH];
+    unsigned int id[BATCH_BIN_WIDTH];
+
+    for( i=0; i<count; i+=BATCH_BIN_WIDTH )
+    {
+        unsigned int numLanes = std::min<unsigned int>( count - i, BATCH_BIN_WIDTH );
+        const float *laneX, *laneY, *laneZ, *laneR;
+        if( indices )
+        {
+            for( lane=0; lane<BATCH_BIN_WIDTH; lane++ )
+            {
+                id[lane] = indices[i + ( lane < numLanes ? lane : 0 )];
+                x[lane] = _posX[id[lane]], y[lane] = _posY[id[lane]], z[lane] = _posZ[id[lane]], r[lane] = _radius[id[lane]];
+            }
+            laneX = x, laneY = y, laneZ = z, laneR = r;
+        }
+        else
+        {
+            // streams are padded, so tail lanes read valid memory and are masked out below
+            for( lane=0; lane<BATCH_BIN_WIDTH; lane++ ) id[lane] = first + i + lane;
+            laneX = _posX + first + i, laneY = _posY + first + i, laneZ = _posZ + first + i, laneR = _radius + first + i;
+        }
+
+        // two halves of 4 lanes
+        int    visible = ( 1 << numLanes ) - 1;
+        float4 sqDistance[2];
+        for( unsigned int half=0; half<2; half++ )
+        {
+            float4 px = f4load( laneX + half * 4 );
+            float4 py = f4load( laneY + half * 4 );
+            float4 pz = f4load( laneZ + half * 4 );
+            float4 pr = f4load( laneR + half * 4 );
+            float4 dx = f4sub( px, eyeX );
+            float4 dy = f4sub( py, eyeY );
+            float4 dz = f4sub( pz, eyeZ );
+            sqDistance[half] = f4add( f4add( f4mul( dx, dx ), f4mul( dy, dy ) ), f4mul( dz, dz ) );
+            int culled = 0;
+            for( planeId=0; planeId<6; planeId++ )
+            {
+                float4 planeDistance = f4add( 
+                    f4add( f4mul( planeA[planeId], px ), f4mul( planeB[planeId], py ) ),
+                    f4add( f4mul( planeC[planeId], pz ), planeD[planeId] )
+                );
+                culled |= f4mask( f4lt( f4add( planeDistance, pr ), zero ) );
+            }
+            visible &= ~( culled << ( half * 4 ) );
+        }
+
+        // bin visible lanes, first LOD wins
+        for( lodId=0; visible && lodId<_batchScheme.numLods; lodId++ )
+        {
+            int inLod = visible & ( 
+                f4mask( f4lt( sqDistance[0], lodSqDistance[lodId] ) ) |
+                ( f4mask( f4lt( sqDistance[1], lodSqDistance[lodId] ) ) << 4 )
+            );
+            visible &= ~inLod;
+            Lod* lod = _lods + lodId;
+            for( lane=0; inLod; lane++, inLod >>= 1 )
+            {
+                if( inLod & 1 ) lod->lodIndices[lod->lodSize++] = id[lane];
+            }
+        }
+    }
+}
+
 /**
  * ShaderBatch
  */
@@ -587,13 +689,19 @@ void ShaderBatch::renderLODs(void)
             int numRenderInstances = 0;
             int numRemainingInstances = _lods[lodId].lodSize;
             int batchSize = _lods[lodId].lodSize;
+            Matrix worldInstance[BATCH_SIZE_VS_2_0];
             while( numRemainingInstances > 0 )
             {
                 // determine how many instances are in this batch (up to g_nNumBatchInstance)
                 numRenderInstances = min( numRemainingInstances, BATCH_SIZE_VS_2_0 );
 
-                // set the instancing array
-                _dxCR( _effect->SetMatrixArray( "worldInstance", _lods[lodId].lodMatrices + batchSize - numRemainingInstances, numRenderInstances ) );
+                // gather and set the instancing array
+                const unsigned int* lodIndices = _lods[lodId].lodIndices + batchSize - numRemainingInstances;
+                for( int iInst=0; iInst<numRenderInstances; iInst++ )
+                {
+                    worldInstance[iInst] = _matrices[lodIndices[iInst]];
+                }
+                _dxCR( _effect->SetMatrixArray( "worldInstance", worldInstance, numRenderInstances ) );
             
                 // The effect interface queues up the changes and performs them 
                 // with the CommitChanges call. You do not need to call CommitChanges if 
@@ -948,11 +1056,11 @@ void HardwareBatch::renderLODs(void)
 
                 // lock and fill instance buffer    
                 _dxCR( _vbInstance->Lock( 0, NULL,  (void**)(&instance), 0 ) );
+                const unsigned int* lodIndices = _lods[lodId].lodIndices + batchSize - numRemainingInstances;
                 for( iInst=0; iInst<numRenderInstances; iInst++ )
                 {
-                    memcpy( &instance[iInst].matrix, _lods[lodId].lodMatrices + batchSize - numRemainingInstances + iInst, sizeof(Matrix) );
-                    memcpy( &instance[iInst].color, _lods[lodId].lodColors + batchSize - numRemainingInstances + iInst, sizeof(Quartector) );
-                    //memcpy( instanceData, _lods[lodId].lodMatrices + batchSize - numRemainingInstances, sizeof(Matrix)*numRenderInstances );
+                    memcpy( &instance[iInst].matrix, _matrices + lodIndices[iInst], sizeof(Matrix) );
+                    memcpy( &instance[iInst].color, _colors + lodIndices[iInst], sizeof(Quartector) );
                 }
                 _dxCR( _vbInstance->Unlock() );
                        
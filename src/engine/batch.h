@@ -28,18 +28,26 @@ protected:
         Geometry*     lodGeometry;   // the geometry of LOD
         unsigned int  lodSize;       // current number of instances in this LOD
         float         lodSqDistance; // squared distance of LOD
-        Matrix*       lodMatrices;   // instance matricex
-        Quartector*   lodColors;     // instance colors
+        unsigned int* lodIndices;    // indices of instances in this LOD
     public:
-        Lod() : lodGeometry(NULL), lodSize(0), lodSqDistance(0), lodMatrices(NULL) {}
+        Lod() : lodGeometry(NULL), lodSize(0), lodSqDistance(0), lodIndices(NULL) {}
     };
 protected:
     // batch sector
     struct Sector
     {
     public:
-        typedef std::set<unsigned int> DynamicIndices;
-        typedef DynamicIndices::iterator DynamicIndex;
+        // cache file header, cache is rebuilt if any field mismatches
+        struct CacheHeader
+        {
+            unsigned int magic;
+            unsigned int version;
+            unsigned int leafSize;
+            unsigned int numInstances;
+            unsigned int contentHash;  // hash of instance matrices and LOD0 bounds
+        };
+        // temporary data of tree builder
+        struct Builder;
     public:
         AABB          boundingBox;    // sector bounds
         Sphere        boundingSphere; // alternative bounds
@@ -48,16 +56,19 @@ protected:
         unsigned int  numIndices;     // number of instances in sector
         unsigned int* indices;        // indices of instances
     public:
-        Sector(IResource* resource);
-        Sector(unsigned int leafSize, Geometry* geometryLod0, Matrix* instances, AABB* aabb, DynamicIndices& parentIndices, float treeProgress=0.0f, float sectorProgress=1.0f);
+        Sector(IResource* resource, unsigned int depth);
+        Sector(Builder* builder, unsigned int first, unsigned int count, unsigned int depth);
         ~Sector();
     public:
         void render(float maxDistance);
-        void write(IResource* resource);
+        bool write(IResource* resource);
         unsigned int getNumInstancesInHierarchy(void);
         void forAllInstancesInAABB(Geometry* geometryLod0, Matrix* instances, AABB* aabb, engine::IBatchCallback callback, void* data);
     public:        
         static Sector* createTree(unsigned int leafSize, Geometry* geometryLod0, Matrix* instances, unsigned int numInstances);
+        static void getCacheHeader(CacheHeader& header, unsigned int leafSize, Geometry* geometryLod0, Matrix* instances, unsigned int numInstances);
+        static Sector* readTree(IResource* resource, const CacheHeader& expected);
+        static bool writeTree(Sector* root, IResource* resource, const CacheHeader& header);
     };
 protected:
     unsigned int         _batchSize;                  // number of instances
@@ -65,6 +76,11 @@ protected:
     Lod                  _lods[engine::maxBatchLods]; // lods
     Matrix*              _matrices;                   // instance transformations
     Quartector*          _colors;                     // instance colors
+    float*               _posX;                       // instance positions (SoA streams)
+    float*               _posY;
+    float*               _posZ;
+    float*               _radius;                     // instance bounding radius, scaled
+    float                _lodRadius;                  // bounding radius of all LODs around instance origin
     Sector*              _rootSector;                 // speedup structure
 protected:
     static ID3DXEffect*    _effect;
@@ -77,6 +93,7 @@ protected:
     // LOD builders
     void updateLODs(void);
     void updateLODs(Sector* sector);
+    void binInstances(unsigned int first, unsigned int count, const unsigned int* indices);
 public:
     // class implementation
     Batch(unsigned int batchSize, engine::BatchScheme* batchScheme);
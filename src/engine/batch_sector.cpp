@@ -8,11 +8,48 @@
 #include "wire.h"
 #include "gui.h"
 
+#define BATCH_TREE_MAGIC     0x45455254 // "TREE"
+#define BATCH_TREE_VERSION   2
+#define BATCH_TREE_BINS      16         // number of SAH bins per split
+#define BATCH_TREE_MAX_DEPTH 48         // limits depth of tree and size of traversal stack
+
+/**
+ * temporary data of tree builder
+ */
+
+struct Batch::Sector::Builder
+{
+public:
+    unsigned int              leafSize;
+    unsigned int              numInstances;
+    unsigned int              numProcessed; // instances already placed in leaves
+    std::vector<AABB>         instanceAABB; // world-space bounds of instances
+    std::vector<Vector>       centroid;     // centers of instance bounds
+    std::vector<unsigned int> indices;      // instance indices, partitioned in place
+};
+
+static inline void mergeAABB(AABB& box, const AABB& other)
+{
+    box.addPoint( other.inf );
+    box.addPoint( other.sup );
+}
+
+static inline float getHalfArea(const AABB& box)
+{
+    Vector size = box.sup - box.inf;
+    return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+static inline float getComponent(const Vector& v, unsigned int axis)
+{
+    return axis == 0 ? v.x : ( axis == 1 ? v.y : v.z );
+}
+
 /**
  * bachu no sekutoru
  */
 
-Batch::Sector::Sector(IResource* resource)
+Batch::Sector::Sector(IResource* resource, unsigned int depth)
 {
     assert( resource );
 
@@ -22,136 +59,190 @@ Batch::Sector::Sector(IResource* resource)
         throw Exception( "Batch spatial cache is corrupted!" );
     }
 
-    if( numIndices ) 
-    {
-        indices = new unsigned int[numIndices];
-        opsize = fread( indices, 1, sizeof(unsigned int)*numIndices, resource->getFile() );
-        if( opsize != sizeof(unsigned int)*numIndices )
-        {
-            throw Exception( "Batch spatial cache is corrupted!" );
-        }
-    }
-    else 
-    {
-        indices = NULL;
-    }
+    // stored pointers only mark presence of subsets, nothing is owned until it is read,
+    // so sector, which fails to read, frees its partial hierarchy by itself
+    bool hasLeft  = ( left != NULL );
+    bool hasRight = ( right != NULL );
+    left = right = NULL;
+    indices = NULL;
 
-    if( unsigned int(left) )
+    // check for integrity, traversal stack fits trees of limited depth only
+    if( ( numIndices ? ( hasLeft || hasRight ) : !( hasLeft || hasRight ) ) ||
+        ( ( hasLeft || hasRight ) && depth >= BATCH_TREE_MAX_DEPTH ) )
     {
-        left = new Sector( resource );
+        throw Exception( "Batch spatial cache is corrupted!" );
     }
-    if( unsigned int(right) )
-    {
-        right = new Sector( resource );
-    }    
 
-    // check for integrity
-    if( numIndices ) 
+    try
     {
-        assert( left == NULL && right == NULL );
+        if( numIndices ) 
+        {
+            indices = new unsigned int[numIndices];
+            opsize = fread( indices, 1, sizeof(unsigned int)*numIndices, resource->getFile() );
+            if( opsize != sizeof(unsigned int)*numIndices )
+            {
+                throw Exception( "Batch spatial cache is corrupted!" );
+            }
+        }
+        if( hasLeft )
+        {
+            left = new Sector( resource, depth + 1 );
+        }
+        if( hasRight )
+        {
+            right = new Sector( resource, depth + 1 );
+        }
     }
-    else
+    catch( ... )
     {
-        assert( left != NULL || right != NULL );
+        if( indices ) delete[] indices;
+        if( left ) delete left;
+        throw;
     }
 }
 
-Batch::Sector::Sector(unsigned int leafSize, Geometry* geometryLod0, Matrix* instances, AABB* aabb, DynamicIndices& parentIndices, float treeProgress, float sectorProgress)
+Batch::Sector::Sector(Builder* builder, unsigned int first, unsigned int count, unsigned int depth)
 {
-    boundingBox = *aabb;
+    assert( count );
+
     left = right = NULL;
+    numIndices = 0;
+    indices = NULL;
 
-    // local indices
-    DynamicIndices dynamicIndices;
+    unsigned int* range = &builder->indices[first];
+    unsigned int  i;
 
-    // show progress
-    if( Engine::instance->progressCallback )
+    // bounds of instances and bounds of their centroids
+    boundingBox = builder->instanceAABB[range[0]];
+    AABB centroidBox( builder->centroid[range[0]] );
+    for( i=1; i<count; i++ )
     {
-        Engine::instance->progressCallback(
-            Gui::iLanguage->getUnicodeString(7),
-            treeProgress,
-            Engine::instance->progressCallbackUserData
-        );
+        mergeAABB( boundingBox, builder->instanceAABB[range[i]] );
+        centroidBox.addPoint( builder->centroid[range[i]] );
     }
 
     // calculate bounding sphere
     Vector corner[8];
-    unsigned int i;
-    for( i=0; i<8; i++ ) corner[i] = boundingBox.getCorner( i );    
+    for( i=0; i<8; i++ ) corner[i] = boundingBox.getCorner( i );
     boundingSphere.calculate( 8, corner );
 
-    // build list of indices inside AABB of this 
-    unsigned int instanceId;
-    AABB instanceAABB;
-    DynamicIndex index;
-    for( index = parentIndices.begin(); 
-                      index != parentIndices.end(); 
-                      index++ )
+    // build subsets
+    if( count > builder->leafSize && depth < BATCH_TREE_MAX_DEPTH )
     {
-        instanceId = (*index);
-        instanceAABB.calculate( geometryLod0->getBoundingBox(), instances+instanceId );
-        if( ::intersectionAABBAABB( &boundingBox, &instanceAABB ) )
+        // split axis is the longest axis of centroid bounds
+        Vector       extent = centroidBox.sup - centroidBox.inf;
+        unsigned int axis   = 0;
+        if( extent.y > getComponent( extent, axis ) ) axis = 1;
+        if( extent.z > getComponent( extent, axis ) ) axis = 2;
+        float axisInf    = getComponent( centroidBox.inf, axis );
+        float axisExtent = getComponent( extent, axis );
+
+        unsigned int numLeft = count / 2;
+        if( axisExtent > 0 )
         {
-            dynamicIndices.insert( instanceId );
-        }
-    }
+            // bin centroids
+            unsigned int binCount[BATCH_TREE_BINS];
+            AABB         binAABB[BATCH_TREE_BINS];
+            unsigned int binId;
+            float        binScale = BATCH_TREE_BINS / axisExtent;
+            for( i=0; i<BATCH_TREE_BINS; i++ ) binCount[i] = 0;
+            for( i=0; i<count; i++ )
+            {
+                binId = std::min<unsigned int>( 
+                    unsigned int( ( getComponent( builder->centroid[range[i]], axis ) - axisInf ) * binScale ), 
+                    BATCH_TREE_BINS - 1 
+                );
+                if( binCount[binId] ) 
+                {
+                    mergeAABB( binAABB[binId], builder->instanceAABB[range[i]] );
+                }
+                else
+                {
+                    binAABB[binId] = builder->instanceAABB[range[i]];
+                }
+                binCount[binId]++;
+            }
 
-    // remove this indices from parent indices
-    DynamicIndex parentIndex;
-    for( index = dynamicIndices.begin(); index != dynamicIndices.end(); index++ )
-    {
-        parentIndex = parentIndices.find( (*index) );
-        assert( parentIndex != parentIndices.end() );
-        parentIndices.erase( parentIndex );
-    }
+            // sweep from the right, accumulating costs of right sides
+            float        rightCost[BATCH_TREE_BINS];
+            AABB         accumAABB;
+            unsigned int accumCount = 0;
+            for( i=BATCH_TREE_BINS-1; i>0; i-- )
+            {
+                if( binCount[i] )
+                {
+                    if( accumCount ) mergeAABB( accumAABB, binAABB[i] ); else accumAABB = binAABB[i];
+                    accumCount += binCount[i];
+                }
+                rightCost[i-1] = accumCount ? getHalfArea( accumAABB ) * accumCount : 0.0f;
+            }
 
-    // build subsets
-    if( dynamicIndices.size() > leafSize )
-    {
-        AABB leftAABB;
-        AABB rightAABB;
-        boundingBox.divide( leftAABB, rightAABB, AABB::maxPlane );
-        left = new Sector( leafSize, geometryLod0, instances, &leftAABB, dynamicIndices, treeProgress, sectorProgress * 0.5f );
-        if( static_cast<Sector*>(left)->getNumInstancesInHierarchy() == 0 )
-        {
-            delete left;
-            left = NULL;
-        }
-        right = new Sector( leafSize, geometryLod0, instances, &rightAABB, dynamicIndices, treeProgress + sectorProgress * 0.5f, sectorProgress * 0.5f );
-        if( static_cast<Sector*>(right)->getNumInstancesInHierarchy() == 0 )
-        {
-            delete right;
-            right = NULL;
-        }        
-    }
+            // sweep from the left, choosing the cheapest split
+            unsigned int bestBin  = 0;
+            float        bestCost = FLT_MAX;
+            float        cost;
+            accumCount = 0;
+            for( i=0; i<BATCH_TREE_BINS-1; i++ )
+            {
+                if( binCount[i] )
+                {
+                    if( accumCount ) mergeAABB( accumAABB, binAABB[i] ); else accumAABB = binAABB[i];
+                    accumCount += binCount[i];
+                }
+                if( accumCount == 0 || accumCount == count ) continue;
+                cost = getHalfArea( accumAABB ) * accumCount + rightCost[i];
+                if( cost < bestCost )
+                {
+                    bestCost = cost;
+                    bestBin  = i;
+                }
+            }
+            assert( bestCost < FLT_MAX );
 
-    if( !left && !right )
-    {        
-        // build static indices
-        numIndices = dynamicIndices.size();
-        indices = new unsigned int[numIndices];        
-        for( index = dynamicIndices.begin(), i = 0; 
-             index != dynamicIndices.end(); 
-             index++, i++ )
-        {
-            indices[i] = *index;
+            // partition indices: instances of bins [0..bestBin] go to the left
+            unsigned int head = 0;
+            unsigned int tail = count;
+            while( head < tail )
+            {
+                binId = std::min<unsigned int>( 
+                    unsigned int( ( getComponent( builder->centroid[range[head]], axis ) - axisInf ) * binScale ), 
+                    BATCH_TREE_BINS - 1 
+                );
+                if( binId <= bestBin )
+                {
+                    head++;
+                }
+                else
+                {
+                    tail--;
+                    std::swap( range[head], range[tail] );
+                }
+            }
+            numLeft = head;
         }
-        dynamicIndices.clear();
+        // else all centroids are coincident, so halve the range
+
+        assert( numLeft > 0 && numLeft < count );
+        left  = new Sector( builder, first, numLeft, depth + 1 );
+        right = new Sector( builder, first + numLeft, count - numLeft, depth + 1 );
     }
     else
     {
-        numIndices = 0;
-        indices = NULL;
-    }
+        // build static indices
+        numIndices = count;
+        indices = new unsigned int[numIndices];
+        memcpy( indices, range, sizeof(unsigned int) * numIndices );
 
-    // show progress
-    if( Engine::instance->progressCallback )
-    {
-        Engine::instance->progressCallback(
-            Gui::iLanguage->getUnicodeString(7),
-            treeProgress + sectorProgress,
-            Engine::instance->progressCallbackUserData
-        );
+        // show progress
+        builder->numProcessed += count;
+        if( Engine::instance->progressCallback )
+        {
+            Engine::instance->progressCallback(
+                Gui::iLanguage->getUnicodeString(7),
+                float( builder->numProcessed ) / float( builder->numInstances ),
+                Engine::instance->progressCallbackUserData
+            );
+        }
     }
 }
 
@@ -188,21 +279,22 @@ void Batch::Sector::render(float maxDistance)
     }
 }
 
-void Batch::Sector::write(IResource* resource)
+bool Batch::Sector::write(IResource* resource)
 {
-    fwrite( this, 1, sizeof(Sector), resource->getFile() );
+    if( fwrite( this, sizeof(Sector), 1, resource->getFile() ) != 1 ) return false;
     if( numIndices )
     {
-        fwrite( indices, 1, sizeof(unsigned int)*numIndices, resource->getFile() );
+        if( fwrite( indices, sizeof(unsigned int)*numIndices, 1, resource->getFile() ) != 1 ) return false;
     }
     if( left )
     {
-        left->write( resource );
+        if( !left->write( resource ) ) return false;
     }
     if( right )
     {
-        right->write( resource );
+        if( !right->write( resource ) ) return false;
     }
+    return true;
 }
 
 unsigned int Batch::Sector::getNumInstancesInHierarchy(void)
@@ -220,33 +312,106 @@ unsigned int Batch::Sector::getNumInstancesInHierarchy(void)
 
 Batch::Sector* Batch::Sector::createTree(unsigned int leafSize, Geometry* geometryLod0, Matrix* instances, unsigned int numInstances)
 {
-    DynamicIndices batchIndices;
-    for( unsigned int i=0; i<numInstances; i++ ) batchIndices.insert( i );
+    assert( numInstances );
 
-    AABB batchAABB;
-    AABB instanceAABB;
-    batchAABB.calculate( geometryLod0->getBoundingBox(), instances );
-    for( unsigned int i=1; i<numInstances; i++ )
+    Builder builder;
+    builder.leafSize     = leafSize ? leafSize : 1;
+    builder.numInstances = numInstances;
+    builder.numProcessed = 0;
+    builder.instanceAABB.resize( numInstances );
+    builder.centroid.resize( numInstances );
+    builder.indices.resize( numInstances );
+    for( unsigned int i=0; i<numInstances; i++ )
     {
-        instanceAABB.calculate( geometryLod0->getBoundingBox(), instances+i );
-        batchAABB.addAABB( &instanceAABB );
+        builder.instanceAABB[i].calculate( geometryLod0->getBoundingBox(), instances+i );
+        builder.centroid[i] = ( builder.instanceAABB[i].inf + builder.instanceAABB[i].sup ) * 0.5f;
+        builder.indices[i] = i;
     }
 
-    return new Sector( leafSize, geometryLod0, instances, &batchAABB, batchIndices );
+    return new Sector( &builder, 0, numInstances, 0 );
+}
+
+void Batch::Sector::getCacheHeader(CacheHeader& header, unsigned int leafSize, Geometry* geometryLod0, Matrix* instances, unsigned int numInstances)
+{
+    memset( &header, 0, sizeof(CacheHeader) );
+    header.magic        = BATCH_TREE_MAGIC;
+    header.version      = BATCH_TREE_VERSION;
+    header.leafSize     = leafSize;
+    header.numInstances = numInstances;
+
+    // FNV-1a over instance matrices and bounds of LOD0
+    unsigned int hash = 2166136261u;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>( instances );
+    unsigned int numBytes = sizeof(Matrix) * numInstances;
+    unsigned int i;
+    for( i=0; i<numBytes; i++ ) hash = ( hash ^ bytes[i] ) * 16777619u;
+    bytes = reinterpret_cast<const unsigned char*>( geometryLod0->getBoundingBox() );
+    for( i=0; i<sizeof(AABB); i++ ) hash = ( hash ^ bytes[i] ) * 16777619u;
+    header.contentHash = hash;
+}
+
+Batch::Sector* Batch::Sector::readTree(IResource* resource, const CacheHeader& expected)
+{
+    CacheHeader header;
+    if( fread( &header, sizeof(CacheHeader), 1, resource->getFile() ) != 1 ||
+        memcmp( &header, &expected, sizeof(CacheHeader) ) != 0 )
+    {
+        // cache is stale or belongs to obsolete format
+        return NULL;
+    }
+
+    // cache, which is truncated by crash or full disk or is too deep, is rebuilt
+    Sector* root = NULL;
+    try
+    {
+        root = new Sector( resource, 0 );
+    }
+    catch( ... )
+    {
+        return NULL;
+    }
+    if( root->getNumInstancesInHierarchy() != expected.numInstances )
+    {
+        delete root;
+        return NULL;
+    }
+    return root;
+}
+
+bool Batch::Sector::writeTree(Sector* root, IResource* resource, const CacheHeader& header)
+{
+    // header is put in place when the whole tree is written, so partially written cache never matches
+    CacheHeader placeholder;
+    memset( &placeholder, 0, sizeof(CacheHeader) );
+    FILE* file = resource->getFile();
+    if( fwrite( &placeholder, sizeof(CacheHeader), 1, file ) != 1 ) return false;
+    if( !root->write( resource ) ) return false;
+    if( fflush( file ) != 0 || fseek( file, 0, SEEK_SET ) != 0 ) return false;
+    if( fwrite( &header, sizeof(CacheHeader), 1, file ) != 1 ) return false;
+    return fflush( file ) == 0;
 }
 
 void Batch::Sector::forAllInstancesInAABB(Geometry* geometryLod0, Matrix* instances, AABB* aabb, engine::IBatchCallback callback, void* data)
 {
-    if( ::intersectionAABBAABB( &boundingBox, aabb ) )
+    // depth-first traversal with explicit stack, left subsets are visited first
+    Sector*      stack[BATCH_TREE_MAX_DEPTH+1];
+    unsigned int stackSize = 0;
+    Sector*      sector;
+    AABB         instanceAABB;
+    Matrix4f     instanceMatrix;
+    unsigned int index;
+
+    stack[stackSize++] = this;
+    while( stackSize )
     {
-        if( !left && !right )
+        sector = stack[--stackSize];
+        if( !::intersectionAABBAABB( &sector->boundingBox, aabb ) ) continue;
+
+        if( !sector->left && !sector->right )
         {
-            AABB instanceAABB;
-            Matrix4f instanceMatrix;
-            unsigned int index;
-            for( unsigned int i=0; i<numIndices; i++ )
+            for( unsigned int i=0; i<sector->numIndices; i++ )
             {
-                index = indices[i];
+                index = sector->indices[i];
                 instanceAABB.calculate( geometryLod0->getBoundingBox(), instances + index );
                 if( ::intersectionAABBAABB( &instanceAABB, aabb ) )
                 {
@@ -257,8 +422,9 @@ void Batch::Sector::forAllInstancesInAABB(Geometry* geometryLod0, Matrix* instan
         }
         else
         {
-            if( left ) static_cast<Sector*>(left)->forAllInstancesInAABB( geometryLod0, instances, aabb, callback, data );
-            if( right ) static_cast<Sector*>(right)->forAllInstancesInAABB( geometryLod0, instances, aabb, callback, data );
+            assert( stackSize + 2 <= BATCH_TREE_MAX_DEPTH + 1 );
+            if( sector->right ) stack[stackSize++] = sector->right;
+            if( sector->left ) stack[stackSize++] = sector->left;
         }
     }
-}
\ No newline at end of file
+}
@@ -59,16 +59,65 @@ BinaryAsset::BinaryAsset(const char* resourceName)
     _resourcePath = resourceName;
 }
 
-BinaryAsset::BinaryAsset(IResource* resource)
+BinaryAsset::BinaryAsset(IResource* resource, BinaryAssetLoad* load)
 {
+    BinaryAssetLoad localLoad;
+    if( !load ) load = &localLoad;
+
     // prepare progress callback
-    fseek( resource->getFile(), 0, SEEK_END );    
-    unsigned int fileSize = ftell( resource->getFile() );
-    fseek( resource->getFile(), 0, SEEK_SET );
-    unsigned int filePos;
+    load->bytesTotal = resource->getSize();
 
     _resourcePath = resource->getName();
 
+    try
+    {
+        readChunks( resource, load );
+        // textures are decoded by job pool while the rest of asset is read,
+        // DirectX objects are created here, so device needs no multithreading support
+        load->jobs.wait();
+        for( StringI stringI = _newTextures.begin(); stringI != _newTextures.end(); stringI++ )
+        {
+            TextureI textureI = Texture::textures.find( *stringI );
+            if( textureI != Texture::textures.end() ) textureI->second->upload();
+        }
+    }
+    catch( ... )
+    {
+        // jobs refer to textures of this asset, so they should finish first
+        load->jobs.cancel();
+        try { load->jobs.wait(); } catch( ... ) {}
+        // release clumps & bsps, then textures which are referenced by nothing but dictionary
+        clear();
+        for( StringI stringI = _newTextures.begin(); stringI != _newTextures.end(); stringI++ )
+        {
+            TextureI textureI = Texture::textures.find( *stringI );
+            if( textureI != Texture::textures.end() && textureI->second->getNumReferences() == 1 )
+            {
+                textureI->second->release();
+            }
+        }
+        throw;
+    }
+}
+
+void BinaryAsset::onChunkRead(IResource* resource, BinaryAssetLoad* load)
+{
+    InterlockedExchange( &load->bytesRead, ftell( resource->getFile() ) );
+
+    if( load->jobs.isCancelled() ) throw Exception( "Loading of \"%s\" is cancelled", _resourcePath.c_str() );
+
+    if( Engine::instance->progressCallback )
+    {
+        Engine::instance->progressCallback(
+            wstrformat( Gui::iLanguage->getUnicodeString(4), asciizToUnicode(_resourcePath.c_str()).c_str() ).c_str(),
+            load->getProgress(),
+            Engine::instance->progressCallbackUserData
+        );
+    }
+}
+
+void BinaryAsset::readChunks(IResource* resource, BinaryAssetLoad* load)
+{
     ChunkHeader assetHeader( resource );
     if( assetHeader.type != BA_ASSET ) throw Exception( "Incompatible binary asset format" );
     if( assetHeader.size != sizeof(Chunk) ) throw Exception( "Incompatible binary asset version" );
@@ -83,16 +132,14 @@ BinaryAsset::BinaryAsset(IResource* resource)
     int i;
     for( i=0; i<chunk.numTextures; i++ )
     {
-        _assetObjects.insert( Texture::read( resource, _assetObjects ) );
-        if( Engine::instance->progressCallback )
-        {            
-            filePos = ftell( resource->getFile() );
-            Engine::instance->progressCallback(
-                wstrformat( Gui::iLanguage->getUnicodeString(4), asciizToUnicode(_resourcePath.c_str()).c_str() ).c_str(),
-                float( filePos ) / float( fileSize ),
-                Engine::instance->progressCallbackUserData
-            );
+        unsigned int numTextures = Texture::textures.size();
+        AssetObjectT assetObjectT = Texture::read( resource, _assetObjects, &load->jobs );
+        if( Texture::textures.size() > numTextures )
+        {
+            _newTextures.push_back( reinterpret_cast<Texture*>( assetObjectT.second )->getName() );
         }
+        _assetObjects.insert( assetObjectT );
+        onChunkRead( resource, load );
     }
 
     // read bsps
@@ -101,15 +148,7 @@ BinaryAsset::BinaryAsset(IResource* resource)
         AssetObjectT assetObjectT = BSP::read( resource, _assetObjects );
         _bsps.push_back( reinterpret_cast<BSP*>( assetObjectT.second ) );
         _assetObjects.insert( assetObjectT );
-        if( Engine::instance->progressCallback )
-        {            
-            filePos = ftell( resource->getFile() );
-            Engine::instance->progressCallback(
-                wstrformat( Gui::iLanguage->getUnicodeString(4), asciizToUnicode(_resourcePath.c_str()).c_str() ).c_str(),
-                float( filePos ) / float( fileSize ),
-                Engine::instance->progressCallbackUserData
-            );
-        }
+        onChunkRead( resource, load );
     }  
 
     // read clumps
@@ -118,15 +157,7 @@ BinaryAsset::BinaryAsset(IResource* resource)
         AssetObjectT assetObjectT = Clump::read( resource, _assetObjects );
         _clumps.push_back( reinterpret_cast<Clump*>( assetObjectT.second ) );
         _assetObjects.insert( assetObjectT );
-        if( Engine::instance->progressCallback )
-        {            
-            filePos = ftell( resource->getFile() );
-            Engine::instance->progressCallback(
-                wstrformat( Gui::iLanguage->getUnicodeString(4), asciizToUnicode(_resourcePath.c_str()).c_str() ).c_str(),
-                float( filePos ) / float( fileSize ),
-                Engine::instance->progressCallbackUserData
-            );
-        }
+        onChunkRead( resource, load );
     }
 
     // read extensions
@@ -153,6 +184,7 @@ BinaryAsset::BinaryAsset(IResource* resource)
             default:
                 assert( !"Unknown asset extension!" );
             }
+            onChunkRead( resource, load );
         }
     }
     while( extensionResult == 1 );
@@ -1113,7 +1113,7 @@ void BSP::addAlphaGeometry(Atomic* atomic, unsigned int subsetId)
     {
         _sortedAlpha.add( &AlphaGeometry( 
             _nearest,
-            unsigned char( _distance ),
+            (unsigned short)( _distance * 256.0f ),
             atomic->frame(), 
             atomic->geometry(),
             firstSector,
@@ -1147,7 +1147,7 @@ void BSP::addAlphaGeometry(BSPSector* sector, unsigned int subsetId)
     {
         _sortedAlpha.add( &AlphaGeometry( 
             false,
-            unsigned char( _distance ),
+            (unsigned short)( _distance * 256.0f ),
             NULL, 
             sector->geometry(),
             sector,
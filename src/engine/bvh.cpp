@@ -0,0 +1,564 @@
+#include "headers.h"
+#include <float.h>
+#include "bvh.h"
+#include "geometry.h"
+#include "asset.h"
+
+/**
+ * builder
+ */
+
+struct BVHBuildTriangle
+{
+public:
+    AABB   box;
+    Vector centroid;
+    int    triangleId;
+};
+
+struct BVHBuildBin
+{
+public:
+    AABB box;
+    int  numTriangles;
+    bool isEmpty;
+};
+
+static inline float getHalfArea(const AABB& box)
+{
+    Vector d = box.sup - box.inf;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static inline void mergeBox(AABB& box, bool& isEmpty, const AABB& other)
+{
+    if( isEmpty )
+    {
+        box = other, isEmpty = false;
+    }
+    else
+    {
+        box.addPoint( other.inf );
+        box.addPoint( other.sup );
+    }
+}
+
+static inline float getComponent(const Vector& v, int axis)
+{
+    return axis == 0 ? v.x : ( axis == 1 ? v.y : v.z );
+}
+
+class BVHBuilder
+{
+public:
+    std::vector<BVHBuildTriangle> triangles;
+    std::vector<BVHNode>          nodes;
+    std::vector<BVHBlock>         blocks;
+    const Vector*                 vertices;
+    const Triangle*               sourceTriangles;
+private:
+    struct CentroidLess
+    {
+        int axis;
+        CentroidLess(int a) : axis(a) {}
+        bool operator () (const BVHBuildTriangle& t1, const BVHBuildTriangle& t2) const
+        {
+            return getComponent( t1.centroid, axis ) < getComponent( t2.centroid, axis );
+        }
+    };
+    struct CentroidBinLess
+    {
+        int   axis;
+        int   split;
+        float inf;
+        float scale;
+        CentroidBinLess(int a, int s, float i, float sc) : axis(a), split(s), inf(i), scale(sc) {}
+        bool operator () (const BVHBuildTriangle& t) const
+        {
+            int bin = int( ( getComponent( t.centroid, axis ) - inf ) * scale );
+            if( bin >= BVH_NUM_BINS ) bin = BVH_NUM_BINS - 1;
+            return bin < split;
+        }
+    };
+private:
+    void makeLeaf(BVHNode& node, unsigned int first, unsigned int last)
+    {
+        node.offset = blocks.size();
+        node.numTriangles = (unsigned short)( last - first );
+        node.axis = 0;
+
+        BVHBlock block;
+        memset( &block, 0, sizeof(BVHBlock) );
+        for( unsigned int slot=0; slot<BVH_LEAF_SIZE; slot++ )
+        {
+            if( first + slot >= last )
+            {
+                block.triangleId[slot] = -1;
+                continue;
+            }
+            int triangleId = triangles[first+slot].triangleId;
+            const Triangle* triangle = sourceTriangles + triangleId;
+            const Vector& v0 = vertices[triangle->vertexId[0]];
+            Vector e1 = vertices[triangle->vertexId[1]] - v0;
+            Vector e2 = vertices[triangle->vertexId[2]] - v0;
+            block.v0[0][slot] = v0.x, block.v0[1][slot] = v0.y, block.v0[2][slot] = v0.z;
+            block.e1[0][slot] = e1.x, block.e1[1][slot] = e1.y, block.e1[2][slot] = e1.z;
+            block.e2[0][slot] = e2.x, block.e2[1][slot] = e2.y, block.e2[2][slot] = e2.z;
+            block.triangleId[slot] = triangleId;
+        }
+        blocks.push_back( block );
+    }
+public:
+    void build(unsigned int first, unsigned int last, int depth)
+    {
+        unsigned int nodeId = nodes.size();
+        nodes.push_back( BVHNode() );
+
+        // bounds of triangles & their centroids
+        AABB box = triangles[first].box;
+        AABB centroidBox( triangles[first].centroid );
+        unsigned int i;
+        for( i=first+1; i<last; i++ )
+        {
+            box.addPoint( triangles[i].box.inf );
+            box.addPoint( triangles[i].box.sup );
+            centroidBox.addPoint( triangles[i].centroid );
+        }
+        nodes[nodeId].inf = box.inf;
+        nodes[nodeId].sup = box.sup;
+
+        if( last - first <= BVH_LEAF_SIZE )
+        {
+            makeLeaf( nodes[nodeId], first, last );
+            return;
+        }
+
+        // binned SAH: evaluate bin boundaries along all axes,
+        // deep branches fall back to median split, so traversal stack can't overflow
+        int   bestAxis  = -1;
+        int   bestSplit = 0;
+        float bestCost  = FLT_MAX;
+        if( depth < BVH_MAX_DEPTH / 2 ) for( int axis=0; axis<3; axis++ )
+        {
+            float inf = getComponent( centroidBox.inf, axis );
+            float extent = getComponent( centroidBox.sup, axis ) - inf;
+            if( extent <= 0.0f ) continue;
+            float scale = BVH_NUM_BINS / extent;
+
+            BVHBuildBin bins[BVH_NUM_BINS];
+            int b;
+            for( b=0; b<BVH_NUM_BINS; b++ ) bins[b].numTriangles = 0, bins[b].isEmpty = true;
+            for( i=first; i<last; i++ )
+            {
+                b = int( ( getComponent( triangles[i].centroid, axis ) - inf ) * scale );
+                if( b >= BVH_NUM_BINS ) b = BVH_NUM_BINS - 1;
+                bins[b].numTriangles++;
+                mergeBox( bins[b].box, bins[b].isEmpty, triangles[i].box );
+            }
+
+            // sweep from the right, then from the left
+            float rightArea[BVH_NUM_BINS];
+            int   rightCount[BVH_NUM_BINS];
+            AABB  accBox;
+            bool  accEmpty = true;
+            int   accCount = 0;
+            for( b=BVH_NUM_BINS-1; b>0; b-- )
+            {
+                if( !bins[b].isEmpty ) mergeBox( accBox, accEmpty, bins[b].box );
+                accCount += bins[b].numTriangles;
+                rightCount[b] = accCount;
+                rightArea[b] = accEmpty ? 0.0f : getHalfArea( accBox );
+            }
+            accEmpty = true;
+            accCount = 0;
+            for( b=1; b<BVH_NUM_BINS; b++ )
+            {
+                if( !bins[b-1].isEmpty ) mergeBox( accBox, accEmpty, bins[b-1].box );
+                accCount += bins[b-1].numTriangles;
+                if( accCount == 0 || rightCount[b] == 0 ) continue;
+                float cost = accCount * getHalfArea( accBox ) + rightCount[b] * rightArea[b];
+                if( cost < bestCost )
+                {
+                    bestCost = cost, bestAxis = axis, bestSplit = b;
+                }
+            }
+        }
+
+        unsigned int middle;
+        if( bestAxis >= 0 )
+        {
+            float inf = getComponent( centroidBox.inf, bestAxis );
+            float scale = BVH_NUM_BINS / ( getComponent( centroidBox.sup, bestAxis ) - inf );
+            middle = std::partition(
+                triangles.begin() + first,
+                triangles.begin() + last,
+                CentroidBinLess( bestAxis, bestSplit, inf, scale )
+            ) - triangles.begin();
+        }
+        else
+        {
+            // coincident centroids or deep branch, split in halves along longest axis
+            Vector extent = centroidBox.sup - centroidBox.inf;
+            bestAxis = extent.x > extent.y ? ( extent.x > extent.z ? 0 : 2 ) : ( extent.y > extent.z ? 1 : 2 );
+            middle = first;
+        }
+        if( middle == first || middle == last )
+        {
+            middle = ( first + last ) / 2;
+            std::nth_element(
+                triangles.begin() + first,
+                triangles.begin() + middle,
+                triangles.begin() + last,
+                CentroidLess( bestAxis )
+            );
+        }
+
+        build( first, middle, depth + 1 );
+        nodes[nodeId].offset = nodes.size();
+        nodes[nodeId].numTriangles = 0;
+        nodes[nodeId].axis = (unsigned short)( bestAxis );
+        build( middle, last, depth + 1 );
+    }
+};
+
+/**
+ * class implementation
+ */
+
+BVH::BVH(int numNodes, int numBlocks)
+{
+    _numNodes  = numNodes;
+    _numBlocks = numBlocks;
+    _nodes     = reinterpret_cast<BVHNode*>( _aligned_malloc( sizeof(BVHNode) * numNodes, 32 ) );
+    _blocks    = reinterpret_cast<BVHBlock*>( _aligned_malloc( sizeof(BVHBlock) * ( numBlocks ? numBlocks : 1 ), 32 ) );
+}
+
+BVH::BVH(int numTriangles, const Triangle* triangles, const Vector* vertices)
+{
+    BVHBuilder builder;
+    builder.vertices = vertices;
+    builder.sourceTriangles = triangles;
+    builder.triangles.resize( numTriangles );
+    for( int i=0; i<numTriangles; i++ )
+    {
+        BVHBuildTriangle& buildTriangle = builder.triangles[i];
+        buildTriangle.box.inf = buildTriangle.box.sup = vertices[triangles[i].vertexId[0]];
+        buildTriangle.box.addPoint( vertices[triangles[i].vertexId[1]] );
+        buildTriangle.box.addPoint( vertices[triangles[i].vertexId[2]] );
+        buildTriangle.centroid = ( buildTriangle.box.inf + buildTriangle.box.sup ) * 0.5f;
+        buildTriangle.triangleId = i;
+    }
+
+    if( numTriangles )
+    {
+        builder.nodes.reserve( 2 * numTriangles / BVH_LEAF_SIZE + 1 );
+        builder.blocks.reserve( numTriangles / BVH_LEAF_SIZE + 1 );
+        builder.build( 0, numTriangles, 0 );
+    }
+    else
+    {
+        // empty hierarchy: bare root, queries check isEmpty() before traversal
+        BVHNode node;
+        memset( &node, 0, sizeof(BVHNode) );
+        builder.nodes.push_back( node );
+    }
+
+    _numNodes  = builder.nodes.size();
+    _numBlocks = builder.blocks.size();
+    _nodes     = reinterpret_cast<BVHNode*>( _aligned_malloc( sizeof(BVHNode) * _numNodes, 32 ) );
+    _blocks    = reinterpret_cast<BVHBlock*>( _aligned_malloc( sizeof(BVHBlock) * ( _numBlocks ? _numBlocks : 1 ), 32 ) );
+    memcpy( _nodes, &builder.nodes[0], sizeof(BVHNode) * _numNodes );
+    if( _numBlocks ) memcpy( _blocks, &builder.blocks[0], sizeof(BVHBlock) * _numBlocks );
+}
+
+BVH::~BVH()
+{
+    _aligned_free( _nodes );
+    _aligned_free( _blocks );
+}
+
+/**
+ * queries
+ */
+
+static inline bool intersectionRayNode(const BVHNode* node, const Vector& start, const Vector& invDir)
+{
+    // slab test, ray is parametrized in [0..1]
+    float t0 = ( node->inf.x - start.x ) * invDir.x;
+    float t1 = ( node->sup.x - start.x ) * invDir.x;
+    float tmin = t0 < t1 ? t0 : t1;
+    float tmax = t0 < t1 ? t1 : t0;
+    t0 = ( node->inf.y - start.y ) * invDir.y;
+    t1 = ( node->sup.y - start.y ) * invDir.y;
+    tmin = std::max( tmin, t0 < t1 ? t0 : t1 );
+    tmax = std::min( tmax, t0 < t1 ? t1 : t0 );
+    t0 = ( node->inf.z - start.z ) * invDir.z;
+    t1 = ( node->sup.z - start.z ) * invDir.z;
+    tmin = std::max( tmin, t0 < t1 ? t0 : t1 );
+    tmax = std::min( tmax, t0 < t1 ? t1 : t0 );
+    return tmax >= std::max( tmin, 0.0f ) && tmin <= 1.0f;
+}
+
+bool BVH::intersect(const Line* ray, BVHRayCallBack callBack, void* data)
+{
+    if( isEmpty() ) return true;
+
+    const Vector& o = ray->start;
+    const Vector& d = ray->end;
+    Vector invDir( safeInverse( d.x ), safeInverse( d.y ), safeInverse( d.z ) );
+    bool dirNegative[3] = { d.x < 0, d.y < 0, d.z < 0 };
+
+    unsigned int stack[BVH_MAX_DEPTH];
+    int stackSize = 0;
+    unsigned int nodeId = 0;
+    for(;;)
+    {
+        const BVHNode* node = _nodes + nodeId;
+        if( intersectionRayNode( node, o, invDir ) )
+        {
+            if( node->isLeaf() )
+            {
+                // test ray against all leaf triangles at once
+                const BVHBlock* block = _blocks + node->offset;
+                float4 distances;
+                int hitMask = intersectionRayTriangles( ray, block->v0[0], block->e1[0], block->e2[0], &distances );
+                for( unsigned int i=0; hitMask; i++, hitMask >>= 1 )
+                {
+                    if( !( hitMask & 1 ) || block->triangleId[i] < 0 ) continue;
+                    float t = f4lane( distances, i );
+                    if( !callBack( block->triangleId[i], t, o + d * t, data ) ) return false;
+                }
+            }
+            else
+            {
+                // visit near child first
+                unsigned int nearId = nodeId + 1;
+                unsigned int farId  = node->offset;
+                if( dirNegative[node->axis] ) std::swap( nearId, farId );
+                assert( stackSize < BVH_MAX_DEPTH );
+                stack[stackSize++] = farId;
+                nodeId = nearId;
+                continue;
+            }
+        }
+        if( stackSize == 0 ) break;
+        nodeId = stack[--stackSize];
+    }
+    return true;
+}
+
+bool BVH::intersect(RayPacket* packet, BVHPacketCallBack callBack, void* data)
+{
+    if( !packet->mask ) return false;
+    if( isEmpty() ) return true;
+
+    // children are ordered by direction of the first active ray
+    int leadRay = 0;
+    while( !( packet->mask & ( 1 << leadRay ) ) ) leadRay++;
+    Vector d = packet->getDirection( leadRay );
+    bool dirNegative[3] = { d.x < 0, d.y < 0, d.z < 0 };
+
+    unsigned int stack[BVH_MAX_DEPTH];
+    int stackSize = 0;
+    unsigned int nodeId = 0;
+    for(;;)
+    {
+        const BVHNode* node = _nodes + nodeId;
+        if( intersectionRayPacketAABB( packet, node->inf, node->sup ) )
+        {
+            if( node->isLeaf() )
+            {
+                const BVHBlock* block = _blocks + node->offset;
+                for( unsigned int i=0; i<node->numTriangles; i++ )
+                {
+                    float v0[3] = { block->v0[0][i], block->v0[1][i], block->v0[2][i] };
+                    float e1[3] = { block->e1[0][i], block->e1[1][i], block->e1[2][i] };
+                    float e2[3] = { block->e2[0][i], block->e2[1][i], block->e2[2][i] };
+                    float4 distances;
+                    int hitMask = intersectionRayPacketTriangle( packet, v0, e1, e2, &distances );
+                    for( int lane=0; hitMask; lane++, hitMask >>= 1 )
+                    {
+                        if( !( hitMask & 1 ) ) continue;
+                        float t = f4lane( distances, lane );
+                        Vector hitPoint = packet->getStart( lane ) + packet->getDirection( lane ) * t;
+                        if( !callBack( lane, block->triangleId[i], t, hitPoint, data ) )
+                        {
+                            // callback stops this ray only
+                            packet->mask &= ~( 1 << lane );
+                            if( !packet->mask ) return false;
+                        }
+                    }
+                }
+            }
+            else
+            {
+                unsigned int nearId = nodeId + 1;
+                unsigned int farId  = node->offset;
+                if( dirNegative[node->axis] ) std::swap( nearId, farId );
+                assert( stackSize < BVH_MAX_DEPTH );
+                stack[stackSize++] = farId;
+                nodeId = nearId;
+                continue;
+            }
+        }
+        if( stackSize == 0 ) break;
+        nodeId = stack[--stackSize];
+    }
+    return true;
+}
+
+static inline bool intersectionSphereNode(const BVHNode* node, const Sphere* sphere)
+{
+    float dmin = 0;
+    const Vector& c = sphere->center;
+    if( c.x < node->inf.x ) dmin += sqr( c.x - node->inf.x ); else if( c.x > node->sup.x ) dmin += sqr( c.x - node->sup.x );
+    if( c.y < node->inf.y ) dmin += sqr( c.y - node->inf.y ); else if( c.y > node->sup.y ) dmin += sqr( c.y - node->sup.y );
+    if( c.z < node->inf.z ) dmin += sqr( c.z - node->inf.z ); else if( c.z > node->sup.z ) dmin += sqr( c.z - node->sup.z );
+    return dmin <= sqr( sphere->radius );
+}
+
+bool BVH::forAllTriangles(const Sphere* sphere, BVHTriangleCallBack callBack, void* data)
+{
+    if( isEmpty() ) return true;
+
+    unsigned int stack[BVH_MAX_DEPTH];
+    int stackSize = 0;
+    unsigned int nodeId = 0;
+    for(;;)
+    {
+        const BVHNode* node = _nodes + nodeId;
+        if( intersectionSphereNode( node, sphere ) )
+        {
+            if( node->isLeaf() )
+            {
+                const BVHBlock* block = _blocks + node->offset;
+                for( unsigned int i=0; i<node->numTriangles; i++ )
+                {
+                    if( !callBack( block->triangleId[i], data ) ) return false;
+                }
+            }
+            else
+            {
+                assert( stackSize < BVH_MAX_DEPTH );
+                stack[stackSize++] = node->offset;
+                nodeId++;
+                continue;
+            }
+        }
+        if( stackSize == 0 ) break;
+        nodeId = stack[--stackSize];
+    }
+    return true;
+}
+
+/**
+ * serialization
+ */
+
+void BVH::write(IResource* resource)
+{
+    ChunkHeader bvhHeader( BA_BVH, sizeof( Chunk ) );
+    bvhHeader.write( resource );
+
+    Chunk chunk;
+    chunk.numNodes  = _numNodes;
+    chunk.numBlocks = _numBlocks;
+    fwrite( &chunk, sizeof( Chunk ), 1, resource->getFile() );
+
+    ChunkHeader nodesHeader( BA_BINARY, sizeof(BVHNode) * _numNodes );
+    nodesHeader.write( resource );
+    fwrite( _nodes, sizeof(BVHNode), _numNodes, resource->getFile() );
+
+    ChunkHeader blocksHeader( BA_BINARY, sizeof(BVHBlock) * _numBlocks );
+    blocksHeader.write( resource );
+    if( _numBlocks ) fwrite( _blocks, sizeof(BVHBlock), _numBlocks, resource->getFile() );
+}
+
+BVH* BVH::read(IResource* resource)
+{
+    ChunkHeader bvhHeader( resource );
+    if( bvhHeader.type != BA_BVH ) throw Exception( "Unexpected chunk type" );
+    if( bvhHeader.size != sizeof(Chunk) ) throw Exception( "Incompatible binary asset version" );
+
+    Chunk chunk;
+    fread( &chunk, sizeof(Chunk), 1, resource->getFile() );
+
+    if( chunk.numNodes < 1 || chunk.numBlocks < 0 ) throw Exception( "Invalid BVH chunk" );
+
+    BVH* bvh = new BVH( chunk.numNodes, chunk.numBlocks );
+    try
+    {
+        ChunkHeader nodesHeader( resource );
+        if( nodesHeader.type != BA_BINARY ) throw Exception( "Unexpected chunk type" );
+        if( nodesHeader.size != int( sizeof(BVHNode) * chunk.numNodes ) ) throw Exception( "Incompatible binary asset version" );
+        fread( bvh->_nodes, sizeof(BVHNode), chunk.numNodes, resource->getFile() );
+
+        ChunkHeader blocksHeader( resource );
+        if( blocksHeader.type != BA_BINARY ) throw Exception( "Unexpected chunk type" );
+        if( blocksHeader.size != int( sizeof(BVHBlock) * chunk.numBlocks ) ) throw Exception( "Incompatible binary asset version" );
+        if( chunk.numBlocks ) fread( bvh->_blocks, sizeof(BVHBlock), chunk.numBlocks, resource->getFile() );
+
+        // traversal trusts node contents, so child & block references are checked once here:
+        // children follow their parent (no cycles), traversal stack is never overflowed
+        std::vector<int> depth( chunk.numNodes, 0 );
+        for( int nodeId=0; nodeId<chunk.numNodes; nodeId++ )
+        {
+            const BVHNode& node = bvh->_nodes[nodeId];
+            if( node.isLeaf() )
+            {
+                if( node.numTriangles > BVH_LEAF_SIZE || node.offset >= (unsigned int)( chunk.numBlocks ) ) throw Exception( "Invalid BVH chunk" );
+                continue;
+            }
+            unsigned int leftId  = nodeId + 1;
+            unsigned int rightId = node.offset;
+            if( node.axis > 2 ||
+                leftId >= (unsigned int)( chunk.numNodes ) ||
+                rightId <= leftId || rightId >= (unsigned int)( chunk.numNodes ) ||
+                depth[nodeId] >= BVH_MAX_DEPTH )
+            {
+                throw Exception( "Invalid BVH chunk" );
+            }
+            depth[leftId]  = std::max( depth[leftId], depth[nodeId] + 1 );
+            depth[rightId] = std::max( depth[rightId], depth[nodeId] + 1 );
+        }
+    }
+    catch( ... )
+    {
+        delete bvh;
+        throw;
+    }
+
+    return bvh;
+}
+
+/**
+ * legacy octree chunk, assets exported before BVH carry one per octree sector
+ */
+
+struct OcTreeChunk
+{
+    auid id;
+    auid parentId;
+    auid geometryId;
+    AABB boundingBox;
+    int  numTriangles;
+};
+
+void BVH::skipOcTree(IResource* resource, int numOcTreeSectors)
+{
+    for( int i=0; i<numOcTreeSectors; i++ )
+    {
+        ChunkHeader ocTreeHeader( resource );
+        if( ocTreeHeader.type != BA_OCTREE ) throw Exception( "Unexpected chunk type" );
+        if( ocTreeHeader.size != sizeof(OcTreeChunk) ) throw Exception( "Incompatible binary asset version" );
+
+        OcTreeChunk chunk;
+        fread( &chunk, sizeof(OcTreeChunk), 1, resource->getFile() );
+        if( chunk.numTriangles )
+        {
+            ChunkHeader trianglesHeader( resource );
+            if( trianglesHeader.type != BA_BINARY ) throw Exception( "Unexpected chunk type" );
+            fseek( resource->getFile(), trianglesHeader.size, SEEK_CUR );
+        }
+    }
+}
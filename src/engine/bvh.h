@@ -0,0 +1,118 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description bounding volume hierarchy, used to space partitioning for collision detection
+ *
+ * @author bad3p
+ */
+
+#ifndef BVH_IMPLEMENTATION_INCLUDED
+#define BVH_IMPLEMENTATION_INCLUDED
+
+#include "headers.h"
+#include "fundamentals.h"
+#include "raypacket.h"
+
+struct Triangle;
+
+#define BVH_LEAF_SIZE  4  /* limit of triangles per leaf, leaf triangles fit one SoA block */
+#define BVH_NUM_BINS   16 /* number of bins used by SAH builder */
+#define BVH_MAX_DEPTH  64 /* traversal stack depth */
+
+/**
+ * BVH node (32 bytes), nodes are stored in depth-first order,
+ * so left child of inner node immediately follows its parent
+ */
+
+struct BVHNode
+{
+public:
+    Vector         inf;
+    unsigned int   offset;       // inner node : index of right child, leaf : index of triangle block
+    Vector         sup;
+    unsigned short numTriangles; // 0 for inner node
+    unsigned short axis;         // split axis of inner node
+public:
+    inline bool isLeaf(void) const { return numTriangles != 0; }
+};
+
+/**
+ * leaf triangles in SoA order: vertex & two edges per triangle,
+ * padding slots have zero edges and negative triangle id
+ */
+
+struct BVHBlock
+{
+public:
+    float v0[3][BVH_LEAF_SIZE];
+    float e1[3][BVH_LEAF_SIZE];
+    float e2[3][BVH_LEAF_SIZE];
+    int   triangleId[BVH_LEAF_SIZE];
+};
+
+/**
+ * query callbacks, returning false stops query (or packet lane)
+ */
+
+typedef bool (*BVHRayCallBack)(int triangleId, float distance, const Vector& hitPoint, void* data);
+typedef bool (*BVHTriangleCallBack)(int triangleId, void* data);
+typedef bool (*BVHPacketCallBack)(int lane, int triangleId, float distance, const Vector& hitPoint, void* data);
+
+/**
+ * flattened bounding volume hierarchy of geometry triangles
+ */
+
+class BVH
+{
+private:
+    struct Chunk
+    {
+        int numNodes;
+        int numBlocks;
+    };
+private:
+    int       _numNodes;
+    int       _numBlocks;
+    BVHNode*  _nodes;
+    BVHBlock* _blocks;
+private:
+    BVH(int numNodes, int numBlocks);
+public:
+    // builds SAH hierarchy over geometry triangles
+    BVH(int numTriangles, const Triangle* triangles, const Vector* vertices);
+    ~BVH();
+public:
+    inline int getNumNodes(void) { return _numNodes; }
+    inline int getNumBlocks(void) { return _numBlocks; }
+    inline BVHNode* getNodes(void) { return _nodes; }
+    inline BVHBlock* getBlocks(void) { return _blocks; }
+    inline AABB getBoundingBox(void) { return AABB( _nodes[0].inf, _nodes[0].sup ); }
+    // hierarchy of no triangles consists of bare root node, which is neither leaf nor inner node
+    inline bool isEmpty(void) { return _numBlocks == 0; }
+public:
+    /**
+     * reports all triangles hit by ray (start, direction), hits are accepted
+     * in range [0..1] of ray direction, leafs are visited front-to-back
+     * @return false if query was stopped by callback
+     */
+    bool intersect(const Line* ray, BVHRayCallBack callBack, void* data);
+    /**
+     * reports all triangles hit by active rays of packet, callback returning
+     * false deactivates its ray (clears bit of packet mask)
+     * @return false if all rays were stopped by callback
+     */
+    bool intersect(RayPacket* packet, BVHPacketCallBack callBack, void* data);
+    /**
+     * reports all triangles, which leafs are overlapped by sphere
+     * @return false if query was stopped by callback
+     */
+    bool forAllTriangles(const Sphere* sphere, BVHTriangleCallBack callBack, void* data);
+public:
+    void write(IResource* resource);
+    static BVH* read(IResource* resource);
+    // skips legacy octree chunks
+    static void skipOcTree(IResource* resource, int numOcTreeSectors);
+};
+
+#endif
@@ -51,7 +51,7 @@ private:
     bool                 _hasLODs;
 private:
     static engine::IFrame* collectFrameCB(engine::IFrame* frame, void* data);
-    void cloneFrameHierarchy(Frame* frame, Clump* clone);
+    void cloneFrameHierarchy(Frame* frame, Frame* clonedParent, Clump* clone);
     void cloneAttachedObjects(Clump* clone);
 public:
     // class implementation
@@ -4,6 +4,7 @@
 
 #include "headers.h"
 #include "fundamentals.h"
+#include "raypacket.h"
 
 /**
  * intersection between two AABBs
@@ -47,71 +48,72 @@ bool intersectPointFrustum(Vector* point, D3DXPLANE* frustrum);
 float getDistance(D3DXPLANE* plane, Vector* point);
 
 /**
- * ray-box intersection by DirectX SDK
+ * ray-box slab test, ray is parametrized in range [0..1] of direction
  */
 
 inline bool intersectionRayAABB(Line* ray, AABB* aabb)
 {
-    Vector rayEnd = ray->start + ray->end;
-    if( aabb->isInside( ray->start ) || aabb->isInside( rayEnd ) )
-    {
-        return true;
-    }    
-    if( ( aabb->sup.x < ray->start.x && aabb->sup.x < rayEnd.x ) ||
-        ( aabb->inf.x > ray->start.x && aabb->inf.x > rayEnd.x ) ||
-        ( aabb->sup.y < ray->start.y && aabb->sup.y < rayEnd.y ) ||
-        ( aabb->inf.y > ray->start.y && aabb->inf.y > rayEnd.y ) ||
-        ( aabb->sup.z < ray->start.z && aabb->sup.z < rayEnd.z ) ||
-        ( aabb->inf.z > ray->start.z && aabb->inf.z > rayEnd.z ) )
-    {
-        return false;
-    }
-    return 0 != D3DXBoxBoundProbe( 
-        &aabb->inf, &aabb->sup, 
-        &ray->start, &ray->end
-    );
+    float tmin = 0.0f, tmax = 1.0f;
+    float t0, t1, invDir;
+
+    invDir = safeInverse( ray->end.x );
+    t0 = ( aabb->inf.x - ray->start.x ) * invDir;
+    t1 = ( aabb->sup.x - ray->start.x ) * invDir;
+    if( t0 > t1 ) std::swap( t0, t1 );
+    tmin = std::max( tmin, t0 ), tmax = std::min( tmax, t1 );
+    if( tmin > tmax ) return false;
+
+    invDir = safeInverse( ray->end.y );
+    t0 = ( aabb->inf.y - ray->start.y ) * invDir;
+    t1 = ( aabb->sup.y - ray->start.y ) * invDir;
+    if( t0 > t1 ) std::swap( t0, t1 );
+    tmin = std::max( tmin, t0 ), tmax = std::min( tmax, t1 );
+    if( tmin > tmax ) return false;
+
+    invDir = safeInverse( ray->end.z );
+    t0 = ( aabb->inf.z - ray->start.z ) * invDir;
+    t1 = ( aabb->sup.z - ray->start.z ) * invDir;
+    if( t0 > t1 ) std::swap( t0, t1 );
+    tmin = std::max( tmin, t0 ), tmax = std::min( tmax, t1 );
+    return tmin <= tmax;
 }
 
 inline bool intersectionLineAABB(Line* line, AABB* aabb)
 {
-    return intersectionRayAABB( 
-        &Line( line->start, line->end - line->start ),
-        aabb
-    );
+    Line ray( line->start, line->end - line->start );
+    return intersectionRayAABB( &ray, aabb );
 }
 
 /**
- * ray-triangle intersection by DirectX SDK
+ * ray-triangle intersection by Moller & Trumbore, ray is parametrized in range [0..1] of direction
  */
 
 inline bool intersectionRayTriangle(Line* ray, Vector* v0, Vector* v1, Vector* v2, Vector* hitPoint, float* distance)
 {
-    float u,v;
-    if( 0 != D3DXIntersectTri( 
-            v0, v1, v2,
-            &ray->start, &ray->end,
-            &u, &v, distance
-      ) && *distance <= 1.0f )
-    {
-        *hitPoint = *v0 + ( *v1 - *v0 ) * u + ( *v2 - *v0 ) * v;
-        return true;
-    }
-    return false;
+    Vector e1 = *v1 - *v0;
+    Vector e2 = *v2 - *v0;
+    Vector p, q, s;
+    D3DXVec3Cross( &p, &ray->end, &e2 );
+    float det = D3DXVec3Dot( &e1, &p );
+    if( fabs( det ) < 1e-12f ) return false;
+    float invDet = 1.0f / det;
+    s = ray->start - *v0;
+    float u = D3DXVec3Dot( &s, &p ) * invDet;
+    if( u < 0.0f || u > 1.0f ) return false;
+    D3DXVec3Cross( &q, &s, &e1 );
+    float v = D3DXVec3Dot( &ray->end, &q ) * invDet;
+    if( v < 0.0f || u + v > 1.0f ) return false;
+    float t = D3DXVec3Dot( &e2, &q ) * invDet;
+    if( t < 0.0f || t > 1.0f ) return false;
+    *distance = t;
+    *hitPoint = *v0 + e1 * u + e2 * v;
+    return true;
 }
 
 inline bool intersectionLineTriangle(Line* line, Vector* v0, Vector* v1, Vector* v2, Vector* hitPoint, float* distance)
 {
-    float u,v;
-    if( 0 != D3DXIntersectTri(
-            v0, v1, v2,
-            &line->start, &( line->end - line->start ),
-            &u, &v, distance
-      ) && *distance <= 1.0f )
-    {
-        *hitPoint = *v0 + ( *v1 - *v0 ) * u + ( *v2 - *v0 ) * v;
-        return true;
-    }
-    return false;
+    Line ray( line->start, line->end - line->start );
+    return intersectionRayTriangle( &ray, v0, v1, v2, hitPoint, distance );
 }
 
 /**
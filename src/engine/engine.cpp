@@ -13,6 +13,7 @@
 #include "intersection.h"
 #include "sprite.h"
 #include "rain.h"
+#include "jobs.h"
 
 #include "fastquat.h"
 #include "../common/profiler.h"
@@ -49,6 +50,7 @@ Engine::Engine()
     _coreConfig = NULL;
     iDirect3D9 = NULL;
     iDirect3DDevice9 = NULL;
+    jobPool = NULL;
 
     // fill internal parameters
     presentParams.BackBufferWidth    = 0;
@@ -75,6 +77,9 @@ Engine::Engine()
 
 Engine::~Engine()
 {
+    // stop loader jobs before textures & DirectX objects are released
+    if( jobPool ) delete jobPool;
+
     // release alpha black texture
     alphaBlackTexture->release();
 
@@ -180,8 +185,10 @@ void Engine::entityInit(Object * p)
     // modify screen metrics for windowed mode
     if( windowed )
     {
-        screenWidth = _coreConfig->getv( "engine.viewport.width", 1024 );
-        screenHeight = _coreConfig->getv( "engine.viewport.height", 768 );
+        static ParamKey viewportWidth( "engine.viewport.width" );
+        static ParamKey viewportHeight( "engine.viewport.height" );
+        screenWidth = _coreConfig->getv( viewportWidth.resolve( _coreConfig ), 1024 );
+        screenHeight = _coreConfig->getv( viewportHeight.resolve( _coreConfig ), 768 );
     }
 
     // choose adapter mode corresponding to screen configuration
@@ -287,6 +294,9 @@ void Engine::entityInit(Object * p)
         &iDirect3DDevice9
     ) );
 
+    // create job pool
+    jobPool = new JobPool( JobPool::getDefaultNumWorkers() );
+
     // initialize engine components
     Frame::init();
     Effect::init();
@@ -463,6 +473,16 @@ engine::IFrame* Engine::findFrame(engine::IFrame* root, const char* frameName)
     return dynamic_cast<Frame*>( root )->findFrame( frameName );
 }
 
+engine::FrameHandle Engine::getFrameHandle(const char* frameName)
+{
+    return Frame::internName( frameName );
+}
+
+engine::IFrame* Engine::findFrame(engine::IFrame* root, engine::FrameHandle frameHandle)
+{
+    return dynamic_cast<Frame*>( root )->findFrame( frameHandle );
+}
+
 engine::IAtomic* Engine::getAtomic(engine::IClump* clump, engine::IFrame* frame)
 {
     return dynamic_cast<Clump*>( clump )->getAtomic( dynamic_cast<Frame*>( frame ) );
@@ -82,6 +82,8 @@ public:
  * IEngine implementation
  */
 
+class JobPool;
+
 class Engine : public EntityBase,
                virtual public engine::IEngine
 {
@@ -101,6 +103,7 @@ public:
     engine::ProgressCallBack progressCallback;
     void*                    progressCallbackUserData;    
     engine::ITexture*        alphaBlackTexture;    
+    JobPool*                 jobPool;
 private:
     // engine private fields    
     engine::ICamera*  _camera;    
@@ -163,6 +166,8 @@ public:
     );    
     virtual void __stdcall endEnvironmentMap(void);
     virtual engine::IFrame* __stdcall findFrame(engine::IFrame* root, const char* frameName);
+    virtual engine::FrameHandle __stdcall getFrameHandle(const char* frameName);
+    virtual engine::IFrame* __stdcall findFrame(engine::IFrame* root, engine::FrameHandle frameHandle);
     virtual engine::IAtomic* __stdcall getAtomic(engine::IClump* clump, engine::IFrame* frame);
     virtual engine::Mesh* __stdcall createMesh(unsigned int numVertices, unsigned int numTriangles, unsigned int numUVs);
     virtual void __stdcall releaseMesh(engine::Mesh* mesh);
@@ -3,6 +3,7 @@
 #include "frame.h"
 #include "atomic.h"
 #include "asset.h"
+#include "raypacket.h"
 
 /**
  * creation routine
@@ -17,19 +18,24 @@ engine::IFrame* Engine::createFrame(const char* frameName)
  * class implementation
  */
 
-unsigned int Frame::_numDirtyFrames = 0;
-Frame**      Frame::_dirtyFrames = NULL;
+unsigned int Frame::_numDirtyRoots = 0;
+Frame**      Frame::_dirtyRoots = NULL;
+
+Frame::NameAtoms Frame::_nameAtoms;
 
 Frame::Frame(const char* frameName)
 {
     if( !frameName ) frameName = "";
     Name = new char[ strlen(frameName) + 1 ];
     strcpy( Name, frameName );
+    _nameAtom = internName( frameName );
     D3DXMatrixIdentity( &TransformationMatrix );
     D3DXMatrixIdentity( &LTM );
     pParentFrame    = NULL;
     pAttachedObject = NULL;
     _dirty = false;
+    _isQueued = false;
+    _hierarchy = NULL;
     pFrameFirstChild = pFrameSibling = NULL;
     pMeshContainer = NULL;
 }
@@ -39,6 +45,8 @@ Frame::~Frame()
     if( isDirty() ) synchronizeSafe();
     setParent( NULL );   
     while( pFrameFirstChild ) delete static_cast<Frame*>( pFrameFirstChild );
+    if( _isQueued ) dequeue();
+    if( _hierarchy ) delete _hierarchy;
     delete[] Name;
 }
 
@@ -146,6 +154,11 @@ engine::IFrame* Frame::getParent(void)
 
 void Frame::setParent(engine::IFrame* frame)
 {
+    // flattened tree is changed, dirty frames are moved to another tree
+    Frame* root = getRoot();
+    if( root->_hierarchy ) root->_hierarchy->isValid = false;
+    bool isDirtySubtree = root->_isQueued && hasDirtySubtree();
+
     // destroy previous relationship
     if( pParentFrame )
     {
@@ -172,9 +185,15 @@ void Frame::setParent(engine::IFrame* frame)
     pParentFrame = dynamic_cast<Frame*>( frame );
     if( pParentFrame ) 
     {
+        // queued root becomes nested frame, its dirty frames are queued with new root
+        if( _isQueued ) dequeue();
         pFrameSibling = pParentFrame->pFrameFirstChild;
         pParentFrame->pFrameFirstChild = this;        
     }
+
+    root = getRoot();
+    if( root->_hierarchy ) root->_hierarchy->isValid = false;
+    if( isDirtySubtree ) root->enqueue();
 }
 
 void Frame::forAllChildren(engine::IFrameCallBack callBack, void* data)
@@ -197,95 +216,241 @@ Frame* Frame::getRoot(void)
     return pParentFrame->getRoot();
 }
 
-void Frame::dirty(void)
+static inline unsigned int hashNameAtom(unsigned int nameAtom)
 {
-    if( !_dirty )
+    return nameAtom * 2654435761u >> 4;
+}
+
+Frame* Frame::findFrame(unsigned int nameAtom)
+{
+    if( nameAtom == 0 ) return NULL;
+
+    // root frame has an index of its tree
+    if( pParentFrame == NULL )
     {
-        if( _numDirtyFrames == engine::maxDirtyFrames )
+        FrameHierarchy* hierarchy = getHierarchy();
+        unsigned int mask = hierarchy->index.size() - 1;
+        unsigned int slot = hashNameAtom( nameAtom ) & mask;
+        while( hierarchy->index[slot] )
         {
-            synchronizeSafe();
-        }
-        else
-        {
-            _dirty = true;
-            _dirtyFrames[_numDirtyFrames] = this;
-            _numDirtyFrames++;
+            Frame* frame = hierarchy->index[slot];
+            if( frame->_nameAtom == nameAtom ) return frame;
+            slot = ( slot + 1 ) & mask;
         }
+        return NULL;
     }
+
+    // nested frame is searched as D3DXFrameFind does (frame, its siblings, its children)
+    if( _nameAtom == nameAtom ) return this;
+    Frame* result = NULL;
+    if( pFrameSibling ) result = static_cast<Frame*>( pFrameSibling )->findFrame( nameAtom );
+    if( !result && pFrameFirstChild ) result = static_cast<Frame*>( pFrameFirstChild )->findFrame( nameAtom );
+    return result;
 }
 
-void Frame::synchronizeSafe(void)
+unsigned int Frame::internName(const char* frameName)
 {
-    if( _dirty ) for( unsigned int i=0; i<Frame::_numDirtyFrames; i++ )
+    NameAtomI nameAtomI = _nameAtoms.find( frameName );
+    if( nameAtomI != _nameAtoms.end() ) return nameAtomI->second;
+    unsigned int nameAtom = _nameAtoms.size() + 1;
+    _nameAtoms.insert( NameAtoms::value_type( frameName, nameAtom ) );
+    return nameAtom;
+}
+
+unsigned int Frame::findNameAtom(const char* frameName)
+{
+    // name that wasn't interned doesn't belong to any frame
+    NameAtomI nameAtomI = _nameAtoms.find( frameName );
+    return ( nameAtomI == _nameAtoms.end() ) ? 0 : nameAtomI->second;
+}
+
+void Frame::dirty(void)
+{
+    if( !_dirty )
     {
-        if( _dirtyFrames[i] == this )
+        _dirty = true;
+        // tree having dirty frames is queued already
+        Frame* root = this;
+        while( root->pParentFrame )
         {
-            _dirtyFrames[i] = NULL;
-            break;
+            root = root->pParentFrame;
+            if( root->_dirty ) return;
         }
+        root->enqueue();
     }
+}
 
-    _dirty = false;
+bool Frame::hasDirtySubtree(void)
+{
+    if( _dirty ) return true;
+    Frame* child = static_cast<Frame*>( pFrameFirstChild );
+    while( child )
+    {
+        if( child->hasDirtySubtree() ) return true;
+        child = static_cast<Frame*>( child->pFrameSibling );
+    }
+    return false;
+}
 
-    // check parent frame is dirty
-    if( pParentFrame && pParentFrame->isDirtyHierarchy() )
+void Frame::enqueue(void)
+{
+    assert( pParentFrame == NULL );
+    if( _isQueued ) return;
+    if( _numDirtyRoots == engine::maxDirtyFrames )
     {
-        getRoot()->synchronizeSafe();
-        return;
+        synchronizeHierarchy();
     }
+    else
+    {
+        _isQueued = true;
+        _dirtyRoots[_numDirtyRoots] = this;
+        _numDirtyRoots++;
+    }
+}
 
-    // synchronize this frame
-    if( !pParentFrame ) LTM = TransformationMatrix;
-    else dxMultiply( &LTM, &TransformationMatrix, &pParentFrame->LTM );
+void Frame::dequeue(void)
+{
+    assert( _isQueued );
+    for( unsigned int i=0; i<_numDirtyRoots; i++ )
+    {
+        if( _dirtyRoots[i] == this ) _dirtyRoots[i] = NULL;
+    }
+    _isQueued = false;
+}
 
-    // synchronize its children
-    Frame* child = static_cast<Frame*>( pFrameFirstChild );
-    while( child )
+FrameHierarchy* Frame::getHierarchy(void)
+{
+    assert( pParentFrame == NULL );
+    if( !_hierarchy ) 
     {
-        child->synchronizeSafe();
-        child = static_cast<Frame*>( child->pFrameSibling );
+        _hierarchy = new FrameHierarchy;
+        _hierarchy->isValid = false;
+    }
+    if( !_hierarchy->isValid )
+    {
+        // breadth-first order, so parent always precedes its children
+        _hierarchy->frames.clear();
+        _hierarchy->parents.clear();
+        _hierarchy->frames.push_back( this );
+        _hierarchy->parents.push_back( -1 );
+        unsigned int i;
+        for( i=0; i<_hierarchy->frames.size(); i++ )
+        {
+            Frame* child = static_cast<Frame*>( _hierarchy->frames[i]->pFrameFirstChild );
+            while( child )
+            {
+                _hierarchy->frames.push_back( child );
+                _hierarchy->parents.push_back( int( i ) );
+                child = static_cast<Frame*>( child->pFrameSibling );
+            }
+        }
+        _hierarchy->updated.resize( _hierarchy->frames.size() );
+
+        // index frames by name atoms, frames are visited in D3DXFrameFind order
+        // (frame, subtrees of its siblings, its children), so first frame wins
+        // for duplicated names as it does for D3DXFrameFind
+        unsigned int indexSize = 1;
+        while( indexSize < 2 * _hierarchy->frames.size() ) indexSize <<= 1;
+        _hierarchy->index.assign( indexSize, NULL );
+        std::vector<Frame*> stack;
+        stack.reserve( _hierarchy->frames.size() );
+        stack.push_back( this );
+        while( stack.size() )
+        {
+            Frame* frame = stack.back();
+            stack.pop_back();
+            unsigned int slot = hashNameAtom( frame->_nameAtom ) & ( indexSize - 1 );
+            while( _hierarchy->index[slot] && _hierarchy->index[slot]->_nameAtom != frame->_nameAtom )
+            {
+                slot = ( slot + 1 ) & ( indexSize - 1 );
+            }
+            if( !_hierarchy->index[slot] ) _hierarchy->index[slot] = frame;
+            // sibling is popped first, so its subtree precedes children of this frame
+            if( frame->pFrameFirstChild ) stack.push_back( static_cast<Frame*>( frame->pFrameFirstChild ) );
+            if( frame != this && frame->pFrameSibling ) stack.push_back( static_cast<Frame*>( frame->pFrameSibling ) );
+        }
+        _hierarchy->isValid = true;
+    }
+    return _hierarchy;
+}
+
+/**
+ * 4-wide LTM = matrix * parentLTM
+ */
+
+static inline void multiplyMatrix(Matrix* out, const Matrix* matrix, const Matrix* parentLTM)
+{
+    float4 row0 = f4load( parentLTM->m[0] );
+    float4 row1 = f4load( parentLTM->m[1] );
+    float4 row2 = f4load( parentLTM->m[2] );
+    float4 row3 = f4load( parentLTM->m[3] );
+    for( unsigned int i=0; i<4; i++ )
+    {
+        float4 result = f4mul( f4set( matrix->m[i][0] ), row0 );
+        result = f4add( result, f4mul( f4set( matrix->m[i][1] ), row1 ) );
+        result = f4add( result, f4mul( f4set( matrix->m[i][2] ), row2 ) );
+        result = f4add( result, f4mul( f4set( matrix->m[i][3] ), row3 ) );
+        f4store( out->m[i], result );
     }
-    // update attached atomic
-    if( pAttachedObject ) pAttachedObject->onUpdate();
 }
 
-void Frame::synchronizeFast(void)
+void Frame::synchronizeHierarchy(void)
 {
-    _dirty = false;
+    FrameHierarchy* hierarchy = getHierarchy();
+    unsigned int numFrames = hierarchy->frames.size();
+    Frame** frames = &hierarchy->frames[0];
+    int* parents = &hierarchy->parents[0];
+    unsigned char* updated = &hierarchy->updated[0];
+
+    // single pass recomputes all dirty subtrees
+    unsigned int i;
+    Frame* frame;
+    for( i=0; i<numFrames; i++ )
+    {
+        frame = frames[i];
+        updated[i] = frame->_dirty || ( parents[i] >= 0 && updated[parents[i]] );
+        if( !updated[i] ) continue;
+        frame->_dirty = false;
+        if( parents[i] < 0 ) frame->LTM = frame->TransformationMatrix;
+        else multiplyMatrix( &frame->LTM, &frame->TransformationMatrix, &frames[parents[i]]->LTM );
+    }
 
-    // synchronize this frame
-    if( !pParentFrame ) LTM = TransformationMatrix; 
-    else dxMultiply( &LTM, &TransformationMatrix, &pParentFrame->LTM );
-	
-    // synchronize its children
-    Frame* child = static_cast<Frame*>( pFrameFirstChild );
-    while( child )
+    // update attached objects when whole tree is synchronized
+    for( i=0; i<numFrames; i++ )
     {
-        child->synchronizeFast();
-        child = static_cast<Frame*>( child->pFrameSibling );
+        if( updated[i] && frames[i]->pAttachedObject ) frames[i]->pAttachedObject->onUpdate();
     }
-    // update attached object
-    if( pAttachedObject ) pAttachedObject->onUpdate();
+}
+
+void Frame::synchronizeSafe(void)
+{
+    // this frame is synchronized unconditionally, as well as dirty frames of its tree
+    _dirty = true;
+    getRoot()->synchronizeHierarchy();
 }
 
 void Frame::synchronizeAll(void)
 {
-    for( unsigned int i=0; i<_numDirtyFrames; i++ )
+    for( unsigned int i=0; i<_numDirtyRoots; i++ )
     {
-        if( _dirtyFrames[i] ) _dirtyFrames[i]->synchronizeFast();
+        if( _dirtyRoots[i] ) 
+        {
+            _dirtyRoots[i]->_isQueued = false;
+            _dirtyRoots[i]->synchronizeHierarchy();
+        }
     }
-    _numDirtyFrames = 0;
+    _numDirtyRoots = 0;
 }
 
 void Frame::init(void)
 {
-    _dirtyFrames = new Frame*[engine::maxDirtyFrames];
+    _dirtyRoots = new Frame*[engine::maxDirtyFrames];
 }
 
 void Frame::term(void)
 {
-    assert( _dirtyFrames != NULL );
-    delete[] _dirtyFrames;
+    assert( _dirtyRoots != NULL );
+    delete[] _dirtyRoots;
 }
 
 /**
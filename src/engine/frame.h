@@ -30,6 +30,19 @@ protected:
     virtual void onUpdate(void) = 0;
 };
 
+/**
+ * flattened frame tree, frames are stored in topological (parent-first) order
+ */
+
+struct FrameHierarchy
+{
+    bool                       isValid;
+    std::vector<Frame*>        frames;
+    std::vector<int>           parents;  // index of parent frame, -1 for root
+    std::vector<unsigned char> updated;  // frame is updated by current synchronization pass
+    std::vector<Frame*>        index;    // hash index of frames by name atom (open addressing)
+};
+
 /**
  * IFrame implementation
  */
@@ -50,12 +63,24 @@ public:
     Frame*     pParentFrame;
     Updatable* pAttachedObject;
 private:
+    unsigned int        _nameAtom;       // interned name
     bool                _dirty;
-    static unsigned int _numDirtyFrames;
-    static Frame**      _dirtyFrames;
+    bool                _isQueued;       // root frame is in dirty roots queue
+    FrameHierarchy*     _hierarchy;      // flattened tree, used by root frame
+    static unsigned int _numDirtyRoots;
+    static Frame**      _dirtyRoots;
+private:
+    typedef std::map<std::string,unsigned int> NameAtoms;
+    typedef NameAtoms::iterator NameAtomI;
+    static NameAtoms    _nameAtoms;
+private:
+    bool hasDirtySubtree(void);
+    void enqueue(void);
+    void dequeue(void);
+    FrameHierarchy* getHierarchy(void);
+    void synchronizeHierarchy(void);
 public:
     void synchronizeSafe(void);
-    void synchronizeFast(void);
 public:
     // class implementation
     Frame(const char* frameName);
@@ -92,14 +117,18 @@ public:
         return _dirty ? true : ( pParentFrame ? pParentFrame->isDirtyHierarchy() : false );
     }*/
     inline bool isDirty(void) { return _dirty; }
-    inline Frame* findFrame(const char* frameName) { return static_cast<Frame*>( D3DXFrameFind( this, frameName ) ); }
+    inline unsigned int getNameAtom(void) { return _nameAtom; }
+    inline Frame* findFrame(const char* frameName) { return findFrame( findNameAtom( frameName ) ); }
 public:
     // module locals
     Frame* getRoot(void);    
+    Frame* findFrame(unsigned int nameAtom);
     void dirty(void);
     void write(IResource* resource);
     static AssetObjectT read(IResource* resource, AssetObjectM& assetObjects);
 public:
+    static unsigned int internName(const char* frameName);
+    static unsigned int findNameAtom(const char* frameName);
     static void synchronizeAll(void);
     static void init(void);
     static void term(void);
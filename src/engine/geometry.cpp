@@ -5,6 +5,7 @@
 #include "asset.h"
 #include "effect.h"
 #include "wire.h"
+#include "shadows.h"
 
 /**
  * creation routine
@@ -64,8 +65,9 @@ Geometry::Geometry(
 
     _vertexDeclaration = dxGetVertexDeclaration( _numUVSets, _numPrelights );
     _mesh = NULL;
-    _ocTreeRoot = NULL;
+    _bvh = NULL;
     _effect = NULL;
+    _shadowAdjacency = NULL;
 }
 
 Geometry::Geometry(
@@ -94,8 +96,9 @@ Geometry::Geometry(
     _boundingSphere.radius = 0;        
     _shaders = NULL;    
     _effect = NULL;
-    _ocTreeRoot = NULL;
+    _bvh = NULL;
     _skinnedVertices = NULL;
+    _shadowAdjacency = NULL;
 
     // set given mesh as teh geometry mesh and capture mesh data in to 
     // hardware-independent structures
@@ -127,7 +130,9 @@ Geometry::~Geometry()
 
     if( _mesh ) delete _mesh;
 
-    if( _ocTreeRoot ) delete _ocTreeRoot;
+    if( _bvh ) delete _bvh;
+
+    if( _shadowAdjacency ) delete _shadowAdjacency;
 }
 
 /**
@@ -258,6 +263,13 @@ void Geometry::setMesh(engine::Mesh* mesh)
         _normals[mesh->triangles[i].vertexId[2]] = n;
     }
 
+    // silhouette computation structure is rebuilt on demand
+    if( _shadowAdjacency )
+    {
+        delete _shadowAdjacency;
+        _shadowAdjacency = NULL;
+    }
+
     instance();
 }
 #pragma warning(default:4018)
@@ -563,9 +575,9 @@ void Geometry::instance(void)
         _boundingBox.sup.z += 0.17f;
     }
 
-    if( _ocTreeRoot == NULL ) 
+    if( _bvh == NULL ) 
     {
-        _ocTreeRoot = new OcTreeSector( NULL, _boundingBox, this );
+        _bvh = new BVH( _numTriangles, _triangles, _vertices );
     }
 }
 
@@ -734,14 +746,7 @@ void Geometry::write(IResource* resource)
     chunk.numPrelights  = getNumPrelights();
     chunk.numTriangles  = getNumTriangles();
     chunk.sharedShaders = _sharedShaders;
-    if( _ocTreeRoot )
-    {
-        chunk.numOcTreeSectors = _ocTreeRoot->getOcTreeSize();
-    }
-    else
-    {
-        chunk.numOcTreeSectors = 0;
-    }
+    chunk.numOcTreeSectors = _bvh ? -1 : 0;
     chunk.hasEffect = ( _effect != NULL );
 
     fwrite( &chunk, sizeof( Chunk ), 1, resource->getFile() );
@@ -792,10 +797,10 @@ void Geometry::write(IResource* resource)
         fwrite( _shaders, shadersHeader.size, 1, resource->getFile() );
     }
 
-    // write octree
-    if( _ocTreeRoot )
+    // write bounding volume hierarchy
+    if( _bvh )
     {
-        _ocTreeRoot->write( resource );
+        _bvh->write( resource );
     }
 
     // write effect
@@ -883,16 +888,16 @@ AssetObjectT Geometry::read(IResource* resource, AssetObjectM& assetObjects)
 
     assetObjects.insert( AssetObjectT( chunk.id, geometry ) );
 
-    // read octree
-    if( chunk.numOcTreeSectors )
+    // read bounding volume hierarchy, assets with legacy octree get it rebuilt,
+    // geometries stored without octree were never queried & stay without BVH
+    if( chunk.numOcTreeSectors < 0 )
     {
-        for( int i=0; i<chunk.numOcTreeSectors; i++ )
-        {
-            AssetObjectT assetObjectT = OcTreeSector::read( resource, assetObjects );
-            if( i == 0 ) geometry->_ocTreeRoot = reinterpret_cast<OcTreeSector*>( assetObjectT.second );
-            assetObjects.insert( assetObjectT );
-        }
-        assert( geometry->_ocTreeRoot->checkConsistency() );
+        geometry->_bvh = BVH::read( resource );
+    }
+    else if( chunk.numOcTreeSectors > 0 )
+    {
+        BVH::skipOcTree( resource, chunk.numOcTreeSectors );
+        geometry->_bvh = new BVH( geometry->_numTriangles, geometry->_triangles, geometry->_vertices );
     }
 
     // read effect
@@ -927,6 +932,11 @@ void Geometry::captureMeshData(bool captureShaders)
     assert( _mesh->OriginalMeshData.Type == D3DXMESHTYPE_MESH );
 
     // release previous structures
+    if( _shadowAdjacency ) 
+    {
+        delete _shadowAdjacency;
+        _shadowAdjacency = NULL;
+    }
     if( _vertices ) delete[] _vertices;
     if( _normals ) delete[] _normals;
     if( _triangles ) delete[] _triangles;
@@ -1189,4 +1199,17 @@ void Geometry::addEdge(Table<EdgeHash,int>& edgeTable, std::vector<Edge>& edgeVe
         edgeTable.set( edgeKey, edgeVector.size() );
         edgeVector.push_back(newEdge);
     }
+}
+
+/**
+ * silhouette computation structure, built on demand
+ */
+
+ShadowAdjacency* Geometry::getShadowAdjacency(void)
+{
+    if( !_shadowAdjacency ) 
+    {
+        _shadowAdjacency = new ShadowAdjacency( _numTriangles, _triangles, _vertices );
+    }
+    return _shadowAdjacency;
 }
\ No newline at end of file
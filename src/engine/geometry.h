@@ -15,6 +15,7 @@
 #include "shader.h"
 #include "mesh.h"
 #include "hash.h"
+#include "bvh.h"
 
 /**
  * hash support
@@ -77,53 +78,7 @@ public:
     bool operator==(const EdgeHash& rhs);    
 };
 
-/**
- * octal tree, used to space partitioning for collision detection
- */
-
-class Geometry;
-class OcTreeSector;
-
-#define OCTREESECTOR_CAPACITY 16    /* limit of triangles per octree sector */
-#define OCTREESECTOR_SIZE     25.0f /* limit of octree sector bounding box edge size */
-
-typedef OcTreeSector* OcTreeSectorRayIntersectionCallBack(Line* ray, OcTreeSector* sector);
-
-class OcTreeSector
-{
-private:
-    friend class RayIntersection;
-    friend class SphereIntersection;
-private:
-    struct Chunk
-    {
-        auid id;
-        auid parentId;
-        auid geometryId;
-        AABB boundingBox;
-        int  numTriangles;
-    };
-private:
-    OcTreeSector*    _parent;
-    AABB             _boundingBox;
-    std::vector<int> _triangles;
-    OcTreeSector*    _subtree[8];
-    Geometry*        _geometry;    
-public:
-    OcTreeSector(Chunk* chunk, IResource* resource, AssetObjectM& assetObjects);
-    OcTreeSector(OcTreeSector* parent, AABB boundingBox, Geometry* geometry);
-    virtual ~OcTreeSector();
-public:
-    inline Geometry* getGeometry(void) { return _geometry; }
-    inline int getNumTriangles(void) { return _triangles.size(); }
-    inline int getTriangleId(int idx) { assert( idx>=0 && idx<int(_triangles.size()) ); return _triangles[idx]; }
-public:
-    int getOcTreeSize(void);
-    bool checkConsistency(void);
-    void write(IResource* resource);
-    static AssetObjectT read(IResource* resource, AssetObjectM& assetObjects);
-    OcTreeSector* forAllIntersections(Line* ray, OcTreeSectorRayIntersectionCallBack* callBack);
-};
+class ShadowAdjacency;
 
 /**
  * IGeometry implementation
@@ -141,7 +96,7 @@ private:
         int  numUVSets;
         int  numShaders;
         int  numPrelights;
-        int  numOcTreeSectors;
+        int  numOcTreeSectors; // legacy octree chunks, or -1 if BVH chunk follows
         bool sharedShaders;
         bool hasEffect;
         bool hasSkin;
@@ -169,12 +124,11 @@ private:
     Triangle*          _triangles;
     Shader**           _shaders;
     D3DVERTEXELEMENT9* _vertexDeclaration;
-    OcTreeSector*      _ocTreeRoot;
+    BVH*               _bvh;
     Mesh*              _mesh;
     void*              _effect;
     std::vector<Edge>  _edges; // computational structure
-private:
-    static OcTreeSector* onOcTreeSectorRayIntersection(Line* ray, OcTreeSector* sector);
+    ShadowAdjacency*   _shadowAdjacency; // silhouette computation structure
 private:
     void captureMeshData(bool captureShaders);
     void addEdge(Table<EdgeHash,int>& edgeTable, std::vector<Edge>& edgeVector, int v0, int v1, int face);
@@ -228,11 +182,12 @@ public:
     inline Triangle* getTriangles(void) { return _triangles; }
     inline AABB* getBoundingBox(void) { return &_boundingBox; }
     inline Sphere* getBoundingSphere(void) { return &_boundingSphere; }
-    inline OcTreeSector* getOcTreeRoot(void) { return _ocTreeRoot; }
+    inline BVH* getBVH(void) { return _bvh; }
     inline Shader* shader(int id) { assert( id>=0 && id<_numShaders ); return _shaders[id]; }
     inline Mesh* mesh(void) { return _mesh; }
     Vector* getSkinnedVertices(void);
     Edge* getEdges(void);
+    ShadowAdjacency* getShadowAdjacency(void);
 public:
     // module locals
     void setShaders(Shader** shaders);
@@ -8,6 +8,9 @@
 #include "wire.h"
 #include "gui.h"
 #include "../common/unicode.h"
+#include "collision.h"
+#include "raypacket.h"
+#include "radixsort.h"
 
 const DWORD maxParticlesPerPass = 8192;
 const DWORD particleFVF = D3DFVF_XYZ | D3DFVF_DIFFUSE | D3DFVF_TEX1;
@@ -104,6 +107,94 @@ void GrassCluster::push_back(GrassParticle* particle)
     }
 }
 
+void GrassCluster::updateStreams(void)
+{
+    // shuffle particles, so any number of first particles is an uniform subset
+    // of cluster (this is used for lowering of density of distant clusters)
+    unsigned int i, j, seed = numParticles;
+    GrassParticle temp;
+    for( i=numParticles; i>1; i-- )
+    {
+        seed = seed * 1664525 + 1013904223;
+        j = ( seed >> 8 ) % i;
+        temp = particles[i-1], particles[i-1] = particles[j], particles[j] = temp;
+    }
+
+    // position streams, padding lanes repeat the last particle
+    unsigned int numLanes = ( numParticles + 3 ) & ~3;
+    if( x ) delete[] x;
+    if( y ) delete[] y;
+    if( z ) delete[] z;
+    x = new float[numLanes];
+    y = new float[numLanes];
+    z = new float[numLanes];
+    for( i=0; i<numLanes; i++ )
+    {
+        j = i < numParticles ? i : numParticles - 1;
+        x[i] = particles[j].matrix._41,
+        y[i] = particles[j].matrix._42,
+        z[i] = particles[j].matrix._43;
+    }
+}
+
+/**
+ * GrassSector
+ */
+
+GrassSector::GrassSector(GrassClusters& sectorClusters, unsigned int depth)
+{
+    assert( sectorClusters.size() );
+
+    children[0] = children[1] = children[2] = children[3] = NULL;
+
+    // bound cluster spheres
+    GrassClusterI clusterI;
+    Vector extent;
+    for( clusterI = sectorClusters.begin(); clusterI != sectorClusters.end(); clusterI++ )
+    {
+        extent.x = extent.y = extent.z = (*clusterI)->boundingSphere.radius;
+        if( clusterI == sectorClusters.begin() )
+        {
+            boundingBox.inf = (*clusterI)->boundingSphere.center - extent;
+            boundingBox.sup = (*clusterI)->boundingSphere.center + extent;
+        }
+        else
+        {
+            boundingBox.addPoint( (*clusterI)->boundingSphere.center - extent );
+            boundingBox.addPoint( (*clusterI)->boundingSphere.center + extent );
+        }
+    }
+
+    // leaf sector?
+    if( sectorClusters.size() <= GRASS_SECTOR_LEAF_SIZE || depth == GRASS_SECTOR_MAX_DEPTH )
+    {
+        clusters = sectorClusters;
+        return;
+    }
+
+    // distribute clusters by quadrants (cluster goes to quadrant containing its center)
+    float midX = 0.5f * ( boundingBox.inf.x + boundingBox.sup.x );
+    float midZ = 0.5f * ( boundingBox.inf.z + boundingBox.sup.z );
+    GrassClusters quadrants[4];
+    for( clusterI = sectorClusters.begin(); clusterI != sectorClusters.end(); clusterI++ )
+    {
+        quadrants[( (*clusterI)->boundingSphere.center.x >= midX ? 1 : 0 ) |
+                  ( (*clusterI)->boundingSphere.center.z >= midZ ? 2 : 0 )].push_back( *clusterI );
+    }
+    for( unsigned int i=0; i<4; i++ )
+    {
+        if( quadrants[i].size() ) children[i] = new GrassSector( quadrants[i], depth + 1 );
+    }
+}
+
+GrassSector::~GrassSector()
+{
+    for( unsigned int i=0; i<4; i++ )
+    {
+        if( children[i] ) delete children[i];
+    }
+}
+
 /**
  * Grass rendering implementation
  */
@@ -225,6 +316,16 @@ Grass::Grass(const char* resourcePath, engine::IAtomic* templateAtomic, engine::
             fwrite( (*grassClusterI)->particles, sizeof(GrassParticle), buffer, resource->getFile() );
         }
     }
+
+    // build speedup structure
+    for( GrassClusterI grassClusterI = _clusters.begin();
+                       grassClusterI != _clusters.end();
+                       grassClusterI++ )
+    {
+        (*grassClusterI)->updateStreams();
+    }
+    _rootSector = _clusters.size() ? new GrassSector( _clusters, 0 ) : NULL;
+    _cullDot = 0.0f;
 }
 
 Grass::~Grass()
@@ -232,6 +333,7 @@ Grass::~Grass()
     _shader->release();
     _indexBuffer->Release();
     _vertexBuffer->Release();
+    if( _rootSector ) delete _rootSector;
     for( GrassClusterI grassClusterI = _clusters.begin();
                        grassClusterI != _clusters.end();
                        grassClusterI++ )
@@ -483,81 +585,147 @@ static const Vector billboardVertices[4] =
     Vector( 1.0f, -1.0f, 0.0f )
 };
 
-void Grass::render(void)
+/**
+ * particle culling & sorting
+ */
+
+void Grass::collectSector(GrassSector* sector)
 {
-    float  alpha, dot;
-    Vector p,z;
-    Vector vector;
-    Matrix m;
-    unsigned int i,j;
+    // sector is out of fade-out distance?
+    Vector nearest;
+    nearest.x = std::min<float>( std::max<float>( Camera::eyePos.x, sector->boundingBox.inf.x ), sector->boundingBox.sup.x );
+    nearest.y = std::min<float>( std::max<float>( Camera::eyePos.y, sector->boundingBox.inf.y ), sector->boundingBox.sup.y );
+    nearest.z = std::min<float>( std::max<float>( Camera::eyePos.z, sector->boundingBox.inf.z ), sector->boundingBox.sup.z );
+    Vector distance;
+    D3DXVec3Subtract( &distance, &nearest, &Camera::eyePos );
+    if( D3DXVec3LengthSq( &distance ) >= _fadeEnd * _fadeEnd ) return;
+
+    // sector is out of view?
+    if( !::intersectAABBFrustum( &sector->boundingBox, Camera::frustrum ) ) return;
+
+    // leaf?
+    if( sector->clusters.size() )
+    {
+        GrassCluster* cluster;
+        float nearestDistance, density;
+        unsigned int planeId;
+        for( GrassClusterI clusterI = sector->clusters.begin();
+                           clusterI != sector->clusters.end();
+                           clusterI++ )
+        {
+            cluster = *clusterI;
 
-    // culling value
-    float cullDot = cos( Camera::fov * D3DX_PI / 180.0f );
+            // cluster is in visible area?
+            D3DXVec3Subtract( &distance, &cluster->boundingSphere.center, &Camera::eyePos );
+            nearestDistance = D3DXVec3Length( &distance ) - cluster->boundingSphere.radius;
+            if( nearestDistance >= _fadeEnd ) continue;
+            for( planeId=0; planeId<6; planeId++ )
+            {
+                if( ::getDistance( Camera::frustrum + planeId, &cluster->boundingSphere.center ) + cluster->boundingSphere.radius < 0 ) break;
+            }
+            if( planeId < 6 ) continue;
+
+            // density of distant clusters is lowered down to GRASS_MIN_DENSITY at fade-out distance
+            density = ( nearestDistance - _fadeStart ) / ( _fadeEnd - _fadeStart );
+            density = 1.0f - ( 1.0f - GRASS_MIN_DENSITY ) * std::min<float>( std::max<float>( density, 0.0f ), 1.0f );
+            collectParticles( 
+                cluster, 
+                std::min<unsigned int>( unsigned int( ceilf( density * cluster->numParticles ) ), cluster->numParticles )
+            );
+        }
+    }
+    else
+    {
+        for( unsigned int i=0; i<4; i++ )
+        {
+            if( sector->children[i] ) collectSector( sector->children[i] );
+        }
+    }
+}
 
-    // fill items-to-sort
-    _numItems = 0;
+/**
+ * culls 4 particles per iteration: particle is visible if it is inside of culling 
+ * cone around eye direction and isn't faded out, first numParticles are processed
+ */
 
-    // pass clusters, build list of unsorted particles
-    GrassCluster* cluster;
-    for( GrassClusterI grassClusterI=_clusters.begin(); 
-                       grassClusterI!=_clusters.end(); 
-                       grassClusterI++ )
+void Grass::collectParticles(GrassCluster* cluster, unsigned int numParticles)
+{
+    // kernel constants
+    float4 eyeX = f4set( Camera::eyePos.x );
+    float4 eyeY = f4set( Camera::eyePos.y );
+    float4 eyeZ = f4set( Camera::eyePos.z );
+    float4 dirX = f4set( Camera::eyeDirection.x );
+    float4 dirY = f4set( Camera::eyeDirection.y );
+    float4 dirZ = f4set( Camera::eyeDirection.z );
+    float4 negCullDot = f4set( -_cullDot );
+    float4 fadeEnd = f4set( _fadeEnd );
+    float  invFadeRange = 1.0f / ( _fadeEnd - _fadeStart );
+    float  keyScale = 65535.0f / _fadeEnd;
+
+    float distance[4];
+    unsigned int i, lane;
+    GrassParticle* particle;
+    for( i=0; i<numParticles; i+=4 )
     {
-        cluster = *grassClusterI;
-        // cluster is in visible area?
-        D3DXVec3Subtract( &vector, &Camera::eyePos, &cluster->boundingSphere.center );
-        alpha = D3DXVec3Length( &vector );
-        if( alpha <= ( _fadeEnd + cluster->boundingSphere.radius ) )
+        float4 dx = f4sub( f4load( cluster->x + i ), eyeX );
+        float4 dy = f4sub( f4load( cluster->y + i ), eyeY );
+        float4 dz = f4sub( f4load( cluster->z + i ), eyeZ );
+        float4 laneDistance = f4sqrt( f4add( f4add( f4mul( dx, dx ), f4mul( dy, dy ) ), f4mul( dz, dz ) ) );
+        float4 eyeDot = f4add( f4add( f4mul( dx, dirX ), f4mul( dy, dirY ) ), f4mul( dz, dirZ ) );
+
+        // -dot( normalized( p - eye ), eyeDirection ) > cullDot, and alpha < 1
+        int visible = f4mask( f4and( 
+            f4lt( eyeDot, f4mul( negCullDot, laneDistance ) ),
+            f4lt( laneDistance, fadeEnd )
+        ) );
+        if( numParticles - i < 4 ) visible &= ( 1 << ( numParticles - i ) ) - 1;
+        if( !visible ) continue;
+
+        f4store( distance, laneDistance );
+        for( lane=0; visible; lane++, visible >>= 1 )
         {
-            // pass grass particles
-            for( i=0; i<cluster->numParticles; i++ )
+            if( visible & 1 )
             {
-                // particle alpha value
-                p.x = cluster->particles[i].matrix._41,
-                p.y = cluster->particles[i].matrix._42,
-                p.z = cluster->particles[i].matrix._43;
-                D3DXVec3Subtract( &vector, &p, &Camera::eyePos );
-                cluster->particles[i].distance = D3DXVec3Length( &vector );
-                alpha = cluster->particles[i].distance;
-                alpha = ( alpha - _fadeStart ) / ( _fadeEnd - _fadeStart );               
-                if( alpha < 0 ) alpha = 0;  
-                // particle culling
-                D3DXVec3Normalize( &z, &vector );
-                dot = D3DXVec3Dot( &z, &Camera::eyeDirection );
-                if( -dot > cullDot && alpha < 1.0f )
-                {
-                    cluster->particles[i].alpha = alpha;
-                    _items[_numItems] = &cluster->particles[i];
-                    _numItems++;
-                }
-                if( _numItems == 65535 ) break;
+                particle = cluster->particles + i + lane;
+                particle->distance = distance[lane];
+                particle->alpha = std::max<float>( ( distance[lane] - _fadeStart ) * invFadeRange, 0.0f );
+                _items.push_back( particle );
+                _keys.push_back( 65535 - std::min<unsigned int>( unsigned int( distance[lane] * keyScale ), 65535 ) );
             }
         }
-        if( _numItems == 65535 ) break;
     }
+}
 
-    if( _numItems == 0 ) return;
+/**
+ * radix sort on 16-bit key, far particles go first
+ */
 
-    // reset nest counters
-    memset( _nestSize, 0, sizeof( _nestSize ) );
+void Grass::sortParticles(void)
+{
+    unsigned int numItems = _items.size();
+    _order.resize( numItems );
+    _temp.resize( numItems );
+    if( !numItems ) return;
+    radixSort16( &_keys[0], numItems, &_order[0], &_temp[0] );
+}
+
+void Grass::render(void)
+{
+    Vector p;
+    Matrix m;
+    unsigned int i;
+
+    // culling value
+    _cullDot = cos( Camera::fov * D3DX_PI / 180.0f );
+
+    // collect visible particles (storage keeps capacity)
+    _items.clear();
+    _keys.clear();
+    if( _rootSector ) collectSector( _rootSector );
+    if( _items.empty() ) return;
 
     // sort particles
-    float step = _fadeEnd / 255.0f;
-    unsigned char key;
-    unsigned char* nestSize;
-    for( i=0; i<_numItems; i++ )
-    {
-        key = 255 - unsigned char( _items[i]->distance / step );
-        nestSize = _nestSize + key;
-        // search for nearest thin nest
-        // a priori, central nests (lower nestId) are more vacant
-        while( *nestSize == 255 && key > 0 ) key--, nestSize = _nestSize + key;
-        // leave particle unsorted & unrendered if there are no space to sort it
-        if( *nestSize == 255 ) continue;
-        // add particle to corresponding nest
-        _nest[key][*nestSize] = _items[i];
-        (*nestSize)++;
-    }
+    sortParticles();
 
     // lock buffers
     void* vertexData = NULL;
@@ -571,75 +739,73 @@ void Grass::render(void)
 
     // render particles
     unsigned int passParticles = 0;
-    for( i=0; i<256; i++ )
+    GrassParticle* particle;
+    for( i=0; i<_order.size(); i++ )
     {
-        nestSize = _nestSize + i;
-        for( j=0; j<*nestSize; j++ )
-        {          
-            // build billboard matrix
-            m = _nest[i][j]->matrix;
-            m._41 = m._42 = m._43 = 0.0f, m._44 = 1.0f;
-            p.x = _nest[i][j]->matrix._41,
-            p.y = _nest[i][j]->matrix._42,
-            p.z = _nest[i][j]->matrix._43;
-            // transform vertex coordinates by matrix
-            D3DXVec3TransformCoord( &vertex[0].pos, &billboardVertices[0], &m );
-            D3DXVec3TransformCoord( &vertex[1].pos, &billboardVertices[1], &m );
-            D3DXVec3TransformCoord( &vertex[2].pos, &billboardVertices[2], &m );
-            D3DXVec3TransformCoord( &vertex[3].pos, &billboardVertices[3], &m );
-            vertex[0].pos.x += p.x,
-            vertex[0].pos.y += p.y,
-            vertex[0].pos.z += p.z,
-            vertex[1].pos.x += p.x,
-            vertex[1].pos.y += p.y,
-            vertex[1].pos.z += p.z,
-            vertex[2].pos.x += p.x,
-            vertex[2].pos.y += p.y,
-            vertex[2].pos.z += p.z,
-            vertex[3].pos.x += p.x,
-            vertex[3].pos.y += p.y,
-            vertex[3].pos.z += p.z;
-            // setup uvs
-            vertex[0].uv = _nest[i][j]->uv[0];
-            vertex[1].uv = _nest[i][j]->uv[1];
-            vertex[2].uv = _nest[i][j]->uv[2];
-            vertex[3].uv = _nest[i][j]->uv[3];
-            // setup colors
-            vertex[0].color = 
-            vertex[1].color = 
-            vertex[2].color = 
-            vertex[3].color = D3DCOLOR_RGBA( 
-                _ambientR, 
-                _ambientG, 
-                _ambientB, 
-                unsigned int( 255.0f * ( 1.0f - _nest[i][j]->alpha ) ) 
-            );
-            // indices...
-            index[0] = passParticles * 4 + 0;
-            index[1] = passParticles * 4 + 1;
-            index[2] = passParticles * 4 + 2;
-            index[3] = passParticles * 4 + 0;
-            index[4] = passParticles * 4 + 2;
-            index[5] = passParticles * 4 + 3;
-            // next particle
-            vertex += 4, index += 6, passParticles++;
-            // buffers is full? - render
-            if( passParticles == maxParticlesPerPass )
-            {
-                // unlock buffers
-                _vertexBuffer->Unlock();
-                _indexBuffer->Unlock();
-                // render buffers
-                renderBuffers( passParticles );
-                // relock buffers
-                _dxCR( _vertexBuffer->Lock( 0, maxParticlesPerPass * 4 * sizeof( GrassParticleVertex ), &vertexData, D3DLOCK_DISCARD ) );
-                _dxCR( _indexBuffer->Lock( 0, maxParticlesPerPass * 6 * sizeof( WORD ), &indexData, D3DLOCK_DISCARD ) );
-                assert( vertexData );
-                assert( indexData );
-                vertex = (GrassParticleVertex*)( vertexData );
-                index = (WORD*)( indexData );
-                passParticles = 0;
-            }
+        particle = _items[_order[i]];
+        // build billboard matrix
+        m = particle->matrix;
+        m._41 = m._42 = m._43 = 0.0f, m._44 = 1.0f;
+        p.x = particle->matrix._41,
+        p.y = particle->matrix._42,
+        p.z = particle->matrix._43;
+        // transform vertex coordinates by matrix
+        D3DXVec3TransformCoord( &vertex[0].pos, &billboardVertices[0], &m );
+        D3DXVec3TransformCoord( &vertex[1].pos, &billboardVertices[1], &m );
+        D3DXVec3TransformCoord( &vertex[2].pos, &billboardVertices[2], &m );
+        D3DXVec3TransformCoord( &vertex[3].pos, &billboardVertices[3], &m );
+        vertex[0].pos.x += p.x,
+        vertex[0].pos.y += p.y,
+        vertex[0].pos.z += p.z,
+        vertex[1].pos.x += p.x,
+        vertex[1].pos.y += p.y,
+        vertex[1].pos.z += p.z,
+        vertex[2].pos.x += p.x,
+        vertex[2].pos.y += p.y,
+        vertex[2].pos.z += p.z,
+        vertex[3].pos.x += p.x,
+        vertex[3].pos.y += p.y,
+        vertex[3].pos.z += p.z;
+        // setup uvs
+        vertex[0].uv = particle->uv[0];
+        vertex[1].uv = particle->uv[1];
+        vertex[2].uv = particle->uv[2];
+        vertex[3].uv = particle->uv[3];
+        // setup colors
+        vertex[0].color = 
+        vertex[1].color = 
+        vertex[2].color = 
+        vertex[3].color = D3DCOLOR_RGBA( 
+            _ambientR, 
+            _ambientG, 
+            _ambientB, 
+            unsigned int( 255.0f * ( 1.0f - particle->alpha ) ) 
+        );
+        // indices...
+        index[0] = passParticles * 4 + 0;
+        index[1] = passParticles * 4 + 1;
+        index[2] = passParticles * 4 + 2;
+        index[3] = passParticles * 4 + 0;
+        index[4] = passParticles * 4 + 2;
+        index[5] = passParticles * 4 + 3;
+        // next particle
+        vertex += 4, index += 6, passParticles++;
+        // buffers is full? - render
+        if( passParticles == maxParticlesPerPass )
+        {
+            // unlock buffers
+            _vertexBuffer->Unlock();
+            _indexBuffer->Unlock();
+            // render buffers
+            renderBuffers( passParticles );
+            // relock buffers
+            _dxCR( _vertexBuffer->Lock( 0, maxParticlesPerPass * 4 * sizeof( GrassParticleVertex ), &vertexData, D3DLOCK_DISCARD ) );
+            _dxCR( _indexBuffer->Lock( 0, maxParticlesPerPass * 6 * sizeof( WORD ), &indexData, D3DLOCK_DISCARD ) );
+            assert( vertexData );
+            assert( indexData );
+            vertex = (GrassParticleVertex*)( vertexData );
+            index = (WORD*)( indexData );
+            passParticles = 0;
         }
     }
 
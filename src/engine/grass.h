@@ -37,11 +37,15 @@ public:
     Sphere         boundingSphere;
     unsigned int   numParticles;
     GrassParticle* particles;
+    float*         x;              // particle positions (SoA), padded to 4 lanes
+    float*         y;
+    float*         z;
 public:
     GrassCluster()
     {
         numParticles = 0;
         particles = NULL;
+        x = y = z = NULL;
         boundingSphere.center.x = boundingSphere.center.y =  boundingSphere.center.z = 0;
         boundingSphere.radius = 0;
     }
@@ -49,21 +53,45 @@ public:
     {
         numParticles = np;
         particles = new GrassParticle[numParticles];
+        x = y = z = NULL;
         boundingSphere.center.x = boundingSphere.center.y =  boundingSphere.center.z = 0;
         boundingSphere.radius = 0;
     }
     virtual ~GrassCluster()
     {
         if( particles ) delete[] particles;
+        if( x ) delete[] x;
+        if( y ) delete[] y;
+        if( z ) delete[] z;
     }
 public:
     void updateBoundingSphere(void);
+    void updateStreams(void);
     void push_back(GrassParticle* particle);
 };
 
 typedef std::vector<GrassCluster*> GrassClusters;
 typedef GrassClusters::iterator  GrassClusterI;
 
+/**
+ * quadtree of grass clusters (in XZ plane)
+ */
+
+#define GRASS_SECTOR_LEAF_SIZE 4     // max. number of clusters in leaf sector
+#define GRASS_SECTOR_MAX_DEPTH 8     // max. depth of quadtree
+#define GRASS_MIN_DENSITY      0.25f // part of cluster particles rendered at fade-out distance
+
+struct GrassSector
+{
+public:
+    AABB          boundingBox; // bounds cluster spheres
+    GrassSector*  children[4]; // quadrants, all are NULL for leaf sector
+    GrassClusters clusters;    // clusters of leaf sector
+public:
+    GrassSector(GrassClusters& sectorClusters, unsigned int depth);
+    ~GrassSector();
+};
+
 /**
  * grass rendering
  */
@@ -83,13 +111,18 @@ private:
     IDirect3DVertexBuffer9* _vertexBuffer; // vertex buffer
     IDirect3DIndexBuffer9*  _indexBuffer;  // index buffer
 private:
-    unsigned char   _nestSize[256];  // record contains corresponding nest size
-    GrassParticle*  _nest[256][256]; // 256 nests for particle vertices
-    unsigned int    _numItems;       // number of items to sort
-    GrassParticle*  _items[65535];   // items to sort
+    GrassSector*                _rootSector;   // speedup structure
+    float                       _cullDot;      // cosine of particle culling cone
+    std::vector<GrassParticle*> _items;        // visible particles
+    std::vector<unsigned short> _keys;         // sorting keys, far particles have lower keys
+    std::vector<unsigned int>   _order;        // sorted item indices
+    std::vector<unsigned int>   _temp;         // indices after first pass of sorting
 private:
     void generateSpecie(engine::GrassSpecie* specie, engine::IAtomic* templateAtomic, GrassParticles& solidStorage);
     void regroupCluster(GrassParticles& solidStorage, float clusterSize);
+    void collectSector(GrassSector* sector);
+    void collectParticles(GrassCluster* cluster, unsigned int numParticles);
+    void sortParticles(void);
     void renderBuffers(unsigned int numPassParticles);
 public:
     // class implementation
@@ -31,11 +31,14 @@ private:
     Geometry*                 _geometry;
     Vector*                   _vertices;
     Triangle*                 _triangles;
+    engine::RayBatchCallBack  _batchCallBack;
+    unsigned int              _packetOffset;
 private:
     BSPSector* collideBSPSector(BSPSector* sector);
-    OcTreeSector* collideBSPOcTreeSector(OcTreeSector* ocTreeSector);
-    OcTreeSector* collideAtomicOcTreeSector(OcTreeSector* ocTreeSector);
-    OcTreeSector* collideGeometryOcTreeSector(OcTreeSector* ocTreeSector);
+    bool collideBSPSector(BSPSector* sector, RayPacket* packet);
+    engine::CollisionTriangle* getCollisionTriangle(int triangleId, float distance, const Vector& hitPoint);
+    static bool onRayHit(int triangleId, float distance, const Vector& hitPoint, void* data);
+    static bool onPacketHit(int lane, int triangleId, float distance, const Vector& hitPoint, void* data);
 public:
     // class implementation
     RayIntersection(void);
@@ -46,6 +49,8 @@ public:
     virtual void __stdcall setRay(const Vector3f& start, const Vector3f& direction);
     virtual void __stdcall intersect(engine::IBSP* bsp, engine::CollisionCallBack callBack, void* data);
     virtual void __stdcall intersect(engine::IAtomic* atomic, engine::CollisionCallBack callBack, void* data);
+    virtual void __stdcall intersect(unsigned int numRays, const Vector3f* starts, const Vector3f* directions, engine::IBSP* bsp, engine::RayBatchCallBack callBack, void* data);
+    virtual void __stdcall intersect(unsigned int numRays, const Vector3f* starts, const Vector3f* directions, engine::IAtomic* atomic, engine::RayBatchCallBack callBack, void* data);
 public:
     void intersect(Geometry* geometry, engine::CollisionCallBack callBack, void* data);
 };
@@ -69,7 +74,7 @@ private:
     Vector*                   _vertices;
     Triangle*                 _triangles;
 private:
-    OcTreeSector* collideAtomicOcTreeSector(OcTreeSector* ocTreeSector);
+    static bool onAtomicTriangle(int triangleId, void* data);
 public:
     // class implementation
     SphereIntersection(void);
@@ -0,0 +1,251 @@
+#include "headers.h"
+#include "jobs.h"
+#include "engine.h"
+
+/**
+ * class JobGroup
+ */
+
+JobGroup::JobGroup()
+{
+    _numSubmitted = 0;
+    _numCompleted = 0;
+    _isCancelled  = 0;
+    // auto-reset event, signaled on every completion, so waiter never misses one
+    _doneEvent = CreateEvent( NULL, FALSE, FALSE, NULL );
+    InitializeCriticalSection( &_errorLock );
+}
+
+JobGroup::~JobGroup()
+{
+    assert( _numCompleted == _numSubmitted );
+    CloseHandle( _doneEvent );
+    DeleteCriticalSection( &_errorLock );
+}
+
+void JobGroup::onSubmit(void)
+{
+    InterlockedIncrement( &_numSubmitted );
+}
+
+void JobGroup::onComplete(void)
+{
+    InterlockedIncrement( &_numCompleted );
+    SetEvent( _doneEvent );
+}
+
+void JobGroup::onError(const char* message)
+{
+    EnterCriticalSection( &_errorLock );
+    if( _error.empty() ) _error = message;
+    LeaveCriticalSection( &_errorLock );
+}
+
+float JobGroup::getProgress(void)
+{
+    LONG numSubmitted = _numSubmitted;
+    if( numSubmitted == 0 ) return 1.0f;
+    return float( _numCompleted ) / float( numSubmitted );
+}
+
+void JobGroup::wait(void)
+{
+    while( _numCompleted < _numSubmitted )
+    {
+        WaitForSingleObject( _doneEvent, INFINITE );
+    }
+
+    EnterCriticalSection( &_errorLock );
+    std::string error = _error;
+    LeaveCriticalSection( &_errorLock );
+    if( !error.empty() ) throw Exception( "%s", error.c_str() );
+}
+
+/**
+ * class JobPool
+ */
+
+JobPool::JobPool(unsigned int numWorkers)
+{
+    assert( numWorkers > 0 );
+
+    _terminate  = 0;
+    _nextWorker = 0;
+    _tlsIndex   = TlsAlloc(); assert( _tlsIndex != TLS_OUT_OF_INDEXES );
+    _semaphore  = CreateSemaphore( NULL, 0, LONG_MAX, NULL );
+
+    _workers.resize( numWorkers );
+    unsigned int i;
+    for( i=0; i<numWorkers; i++ )
+    {
+        _workers[i] = new Worker;
+        _workers[i]->pool  = this;
+        _workers[i]->index = i;
+        InitializeCriticalSection( &_workers[i]->lock );
+    }
+    for( i=0; i<numWorkers; i++ )
+    {
+        DWORD threadId;
+        _workers[i]->thread = CreateThread( NULL, 0, workerProc, _workers[i], 0, &threadId );
+    }
+}
+
+JobPool::~JobPool()
+{
+    InterlockedExchange( &_terminate, 1 );
+    ReleaseSemaphore( _semaphore, _workers.size(), NULL );
+
+    unsigned int i;
+    for( i=0; i<_workers.size(); i++ )
+    {
+        WaitForSingleObject( _workers[i]->thread, INFINITE );
+        CloseHandle( _workers[i]->thread );
+    }
+    for( i=0; i<_workers.size(); i++ )
+    {
+        // jobs left behind are completed as skipped, so groups can be released
+        for( std::deque<Job*>::iterator jobI = _workers[i]->jobs.begin();
+                                        jobI != _workers[i]->jobs.end();
+                                        jobI++ )
+        {
+            JobGroup* group = (*jobI)->_group;
+            delete *jobI;
+            if( group ) group->onComplete();
+        }
+        DeleteCriticalSection( &_workers[i]->lock );
+        delete _workers[i];
+    }
+
+    CloseHandle( _semaphore );
+    TlsFree( _tlsIndex );
+}
+
+unsigned int JobPool::getDefaultNumWorkers(void)
+{
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo( &systemInfo );
+    return systemInfo.dwNumberOfProcessors > 1 ? systemInfo.dwNumberOfProcessors - 1 : 1;
+}
+
+void JobPool::submit(Job* job, JobGroup* group)
+{
+    job->_group = group;
+    if( group ) group->onSubmit();
+
+    // workers push to own deque, other threads distribute jobs round-robin
+    Worker* worker = reinterpret_cast<Worker*>( TlsGetValue( _tlsIndex ) );
+    if( !worker )
+    {
+        worker = _workers[(unsigned int)( InterlockedIncrement( &_nextWorker ) ) % _workers.size()];
+    }
+    EnterCriticalSection( &worker->lock );
+    worker->jobs.push_back( job );
+    LeaveCriticalSection( &worker->lock );
+
+    ReleaseSemaphore( _semaphore, 1, NULL );
+}
+
+Job* JobPool::popJob(unsigned int workerIndex)
+{
+    Job* job = NULL;
+
+    // own deque is served from the back (most recent, hot in cache)
+    Worker* worker = _workers[workerIndex];
+    EnterCriticalSection( &worker->lock );
+    if( worker->jobs.size() )
+    {
+        job = worker->jobs.back();
+        worker->jobs.pop_back();
+    }
+    LeaveCriticalSection( &worker->lock );
+    if( job ) return job;
+
+    // steal the oldest job from other workers
+    for( unsigned int i=1; i<_workers.size(); i++ )
+    {
+        Worker* victim = _workers[(workerIndex+i) % _workers.size()];
+        EnterCriticalSection( &victim->lock );
+        if( victim->jobs.size() )
+        {
+            job = victim->jobs.front();
+            victim->jobs.pop_front();
+        }
+        LeaveCriticalSection( &victim->lock );
+        if( job ) return job;
+    }
+
+    return NULL;
+}
+
+Job* JobPool::popGroupJob(JobGroup* group)
+{
+    for( unsigned int i=0; i<_workers.size(); i++ )
+    {
+        Worker* worker = _workers[i];
+        Job* job = NULL;
+        EnterCriticalSection( &worker->lock );
+        for( std::deque<Job*>::iterator jobI = worker->jobs.begin();
+                                        jobI != worker->jobs.end();
+                                        jobI++ )
+        {
+            if( (*jobI)->_group == group )
+            {
+                job = *jobI;
+                worker->jobs.erase( jobI );
+                break;
+            }
+        }
+        LeaveCriticalSection( &worker->lock );
+        if( job ) return job;
+    }
+    return NULL;
+}
+
+void JobPool::wait(JobGroup* group)
+{
+    // semaphore count of jobs taken here is left as is, workers wake up and find nothing
+    Job* job;
+    while( ( job = popGroupJob( group ) ) != NULL ) execute( job );
+
+    // remaining jobs of group are being executed by workers
+    group->wait();
+}
+
+void JobPool::execute(Job* job)
+{
+    JobGroup* group = job->_group;
+    if( !group || !group->isCancelled() )
+    {
+        try
+        {
+            job->run();
+        }
+        catch( Exception& exception )
+        {
+            if( group ) group->onError( exception.getMsg() );
+        }
+        catch( ... )
+        {
+            if( group ) group->onError( "unhandled exception in job" );
+        }
+    }
+    delete job;
+    if( group ) group->onComplete();
+}
+
+DWORD JobPool::workerProc(LPVOID lpParameter)
+{
+    Worker* worker = reinterpret_cast<Worker*>( lpParameter );
+    JobPool* pool = worker->pool;
+    TlsSetValue( pool->_tlsIndex, worker );
+
+    // every semaphore count stands for one submitted job
+    while( WaitForSingleObject( pool->_semaphore, INFINITE ) == WAIT_OBJECT_0 )
+    {
+        if( pool->_terminate ) break;
+        Job* job = pool->popJob( worker->index );
+        if( job ) execute( job );
+    }
+
+    return 0;
+}
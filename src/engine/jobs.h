@@ -0,0 +1,121 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description shared work-stealing job pool
+ *
+ * @author bad3p
+ */
+
+#ifndef JOBS_IMPLEMENTATION_INCLUDED
+#define JOBS_IMPLEMENTATION_INCLUDED
+
+#include "headers.h"
+#include <deque>
+
+class JobGroup;
+
+/**
+ * job is a piece of independent work, pool deletes it after execution
+ */
+
+class Job
+{
+private:
+    friend class JobPool;
+private:
+    JobGroup* _group;
+public:
+    Job() : _group(NULL) {}
+    virtual ~Job() {}
+public:
+    virtual void run(void) = 0;
+};
+
+/**
+ * job group tracks completion, progress, errors & cancellation of related jobs
+ */
+
+class JobGroup
+{
+private:
+    volatile LONG _numSubmitted;
+    volatile LONG _numCompleted;
+    volatile LONG _isCancelled;
+    HANDLE        _doneEvent;
+    CRITICAL_SECTION _errorLock;
+    std::string   _error;
+public:
+    JobGroup();
+    ~JobGroup();
+public:
+    void onSubmit(void);
+    void onComplete(void);
+    void onError(const char* message);
+public:
+    inline bool isCancelled(void) { return _isCancelled != 0; }
+    inline void cancel(void) { InterlockedExchange( &_isCancelled, 1 ); }
+    inline unsigned int getNumSubmitted(void) { return _numSubmitted; }
+    inline unsigned int getNumCompleted(void) { return _numCompleted; }
+    /**
+     * @return fraction of completed jobs, 1 for empty group
+     */
+    float getProgress(void);
+    /**
+     * blocks caller until all submitted jobs are completed (or skipped due to cancellation),
+     * rethrows first error occured in group jobs
+     */
+    void wait(void);
+};
+
+/**
+ * pool of worker threads, each worker owns a job deque and steals from
+ * other workers when own deque is empty
+ */
+
+class JobPool
+{
+private:
+    struct Worker
+    {
+    public:
+        JobPool*         pool;
+        unsigned int     index;
+        HANDLE           thread;
+        CRITICAL_SECTION lock;
+        std::deque<Job*> jobs;
+    };
+    typedef std::vector<Worker*> Workers;
+private:
+    Workers       _workers;
+    HANDLE        _semaphore;
+    volatile LONG _terminate;
+    volatile LONG _nextWorker;
+    DWORD         _tlsIndex;
+private:
+    static DWORD WINAPI workerProc(LPVOID lpParameter);
+    Job* popJob(unsigned int workerIndex);
+    Job* popGroupJob(JobGroup* group);
+    static void execute(Job* job);
+public:
+    JobPool(unsigned int numWorkers);
+    ~JobPool();
+public:
+    /**
+     * number of workers that fits the machine: one per processor except the calling one
+     */
+    static unsigned int getDefaultNumWorkers(void);
+public:
+    inline unsigned int getNumWorkers(void) { return _workers.size(); }
+    /**
+     * schedules job, jobs submitted from worker thread are put to its own deque
+     */
+    void submit(Job* job, JobGroup* group);
+    /**
+     * blocks caller until group is completed, queued jobs of group are executed
+     * by calling thread instead of waiting for workers busy with other jobs
+     */
+    void wait(JobGroup* group);
+};
+
+#endif
@@ -17,16 +17,32 @@ engine::ILoader* Engine::createLoader(engine::AssetType assetType, const char* r
 DWORD Loader::loadBinaryAsset(LPVOID lpParameter)
 {
     Loader* loader = reinterpret_cast<Loader*>( lpParameter );
-    BinaryAsset* ba = new BinaryAsset( loader->_resource );
-    loader->_asset = ba;
+    try
+    {
+        BinaryAsset* ba = new BinaryAsset( loader->_resource, &loader->_load );
+        loader->_asset = ba;
+    }
+    catch( Exception& exception )
+    {
+        getCore()->logMessage( "loader: %s", exception.getMsg() );
+    }
+    InterlockedExchange( &loader->_isFinished, 1 );
     return 0;
 }
 
 DWORD Loader::loadXAsset(LPVOID lpParameter)
 {
     Loader* loader = reinterpret_cast<Loader*>( lpParameter );
-    XAsset* xa = new XAsset( loader->_resourcePath.c_str() );
-    loader->_asset = xa;
+    try
+    {
+        XAsset* xa = new XAsset( loader->_resourcePath.c_str() );
+        loader->_asset = xa;
+    }
+    catch( Exception& exception )
+    {
+        getCore()->logMessage( "loader: %s", exception.getMsg() );
+    }
+    InterlockedExchange( &loader->_isFinished, 1 );
     return 0;
 }
 
@@ -37,6 +53,7 @@ DWORD Loader::loadXAsset(LPVOID lpParameter)
 Loader::Loader(engine::AssetType assetType, const char* resourcePath)
 {
     _asset = NULL;
+    _isFinished = 0;
     _resourcePath = resourcePath;
     _resource = NULL;
 
@@ -44,9 +61,6 @@ Loader::Loader(engine::AssetType assetType, const char* resourcePath)
     {
     case engine::atBinary:
         _resource = getCore()->getResource( resourcePath, "rb" ); assert( _resource );
-        fseek( _resource->getFile(), 0, SEEK_END );
-        _resourceSize = ftell( _resource->getFile() );
-        fseek( _resource->getFile(), 0, SEEK_SET );
         _threadHandle = CreateThread( NULL, 0, loadBinaryAsset, this, 0, &_threadId );
         break;
     case engine::atXFile:
@@ -59,6 +73,15 @@ Loader::Loader(engine::AssetType assetType, const char* resourcePath)
 
 Loader::~Loader()
 {
+    // loader thread refers to this object, so it should be stopped first
+    cancel();
+    // thread may be suspended several times by user, resume until suspend count is zero
+    DWORD suspendCount;
+    do suspendCount = ResumeThread( _threadHandle );
+    while( suspendCount != DWORD(-1) && suspendCount > 1 );
+    WaitForSingleObject( _threadHandle, INFINITE );
+    CloseHandle( _threadHandle );
+
     if( _resource ) _resource->release();
 }
 
@@ -73,15 +96,9 @@ void Loader::release(void)
 
 float Loader::getProgress(void)
 {
-    if( _resource )
-    {
-        if( _asset ) return 1;
-        return ( float( ftell( _resource->getFile() ) ) / _resourceSize );
-    }
-    else
-    {
-        return ( _asset == NULL ? 0.0f : 1.0f );
-    }
+    if( _isFinished ) return 1.0f;
+    if( _resource ) return _load.getProgress();
+    return 0.0f;
 }
 
 engine::IAsset* Loader::getAsset(void)
@@ -91,10 +108,16 @@ engine::IAsset* Loader::getAsset(void)
 
 void Loader::suspend(void)
 {
-    if( !_asset ) SuspendThread( _threadHandle );
+    if( !_isFinished ) SuspendThread( _threadHandle );
 }
 
 void Loader::resume(void)
 {
-    if( !_asset ) ResumeThread( _threadHandle );
+    if( !_isFinished ) ResumeThread( _threadHandle );
+}
+
+void Loader::cancel(void)
+{
+    // binary asset checks for cancellation after each chunk, pending texture jobs are skipped
+    _load.jobs.cancel();
 }
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include "headers.h"
 #include "../shared/ccor.h"
 #include "../shared/engine.h"
+#include "asset.h"
 
 class Loader : public engine::ILoader
 {
@@ -21,7 +22,8 @@ private:
     HANDLE          _threadHandle;
     std::string     _resourcePath;
     ccor::IResource*      _resource;
-    int             _resourceSize;
+    BinaryAssetLoad _load;
+    volatile LONG   _isFinished;
     engine::IAsset* _asset;
 private:
     static DWORD WINAPI loadBinaryAsset(LPVOID lpParameter);
@@ -36,6 +38,7 @@ public:
     virtual engine::IAsset* __stdcall getAsset(void);
     virtual void __stdcall suspend(void);
     virtual void __stdcall resume(void);
+    virtual void __stdcall cancel(void);
 };
 
 #endif
\ No newline at end of file
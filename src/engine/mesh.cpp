@@ -7,6 +7,7 @@
 #include "hlsl.h"
 #include "vertexdeclaration.h"
 #include "atomic.h"
+#include "skinning.h"
 
 D3DXMATRIX** Mesh::pBoneMatrices = NULL;
 
@@ -16,8 +17,6 @@ int             Mesh::_bonePaletteSize = NULL;
 int             Mesh::_lightPaletteSize = NULL;
 D3DXMATRIXA16*  Mesh::_pBoneMatrices = NULL;
 StaticLostable* Mesh::_effectLostable = NULL;
-DWORD           Mesh::_sizeOfSkinnedVertices = 0;
-PBYTE           Mesh::_skinnedVertices = NULL;
 
 /**
  * initialization & etc
@@ -138,7 +137,6 @@ void Mesh::term(void)
     if( _effectx ) _effectx->Release();
     if( _pBoneMatrices ) delete[] _pBoneMatrices;
     if( _effectLostable ) delete _effectLostable;
-    if( _skinnedVertices ) delete[] _skinnedVertices;
 }
 
 /**
@@ -160,6 +158,7 @@ Mesh::Mesh(DWORD numVertices,
     pSkinInfo              = NULL;
     pNextMeshContainer     = NULL;    
     pSoftwareBones         = NULL;
+    pSoftwareSkin          = NULL;
 
     // we event do not use the default container field
     // this is because of refactoring of Mesh class
@@ -207,6 +206,7 @@ Mesh::Mesh(LPCTSTR meshName,
     pBoneCombination   = NULL;
     UseSoftwareVP      = false;
     pSoftwareBones     = NULL;
+    pSoftwareSkin      = NULL;
 
     // we event do not use the default container field
     // this is because of refactoring of Mesh class
@@ -310,6 +310,7 @@ Mesh::~Mesh()
     if( pBoneOffsetMatrices ) delete[] pBoneOffsetMatrices;
     if( pBoneCombination ) pBoneCombination->Release();
     if( pSoftwareBones ) delete[] pSoftwareBones;
+    if( pSoftwareSkin ) delete pSoftwareSkin;
 
     if( OriginalMeshData.pMesh ) OriginalMeshData.pMesh->Release();
     if( SkinnedMeshData.pMesh ) SkinnedMeshData.pMesh->Release();
@@ -998,7 +999,7 @@ D3DXMATRIX** Mesh::assembleBoneMatrices(Frame* root)
     for( int i=0; i<numBones; i++ )
     {
         const char* boneName = pSkinInfo->GetBoneName( i );
-        Frame* frame = static_cast<Frame*>( D3DXFrameFind( root, boneName ) );
+        Frame* frame = root->findFrame( boneName );
         assert( frame );
         boneMatrices[i] = &frame->LTM;
     }
@@ -1022,44 +1023,15 @@ void Mesh::getSkinnedVertices(Vector* buffer)
         );
     }
 
-    IDirect3DVertexBuffer9* vertexBuffer;
-    _dxCR( OriginalMeshData.pMesh->GetVertexBuffer( &vertexBuffer ) );
-
-    D3DVERTEXBUFFER_DESC vertexBufferDesc;
-    _dxCR( vertexBuffer->GetDesc( &vertexBufferDesc ) );
-
-    if( _sizeOfSkinnedVertices < vertexBufferDesc.Size )
-    {
-        _sizeOfSkinnedVertices = vertexBufferDesc.Size;
-        if( _skinnedVertices ) delete[] _skinnedVertices;
-        _skinnedVertices = new BYTE[_sizeOfSkinnedVertices];
-    }
-
-    PBYTE unskinnedVertices = NULL;
-    _dxCR( OriginalMeshData.pMesh->LockVertexBuffer(
-        D3DLOCK_READONLY, 
-        (LPVOID*)&unskinnedVertices
-    ) );
-
-    _dxCR( pSkinInfo->UpdateSkinnedMesh(
-        pSoftwareBones, 
-        NULL, unskinnedVertices, _skinnedVertices
-    ) );
-
-    D3DVERTEXELEMENT9 declaration[MAX_FVF_DECL_SIZE];
-    _dxCR( OriginalMeshData.pMesh->GetDeclaration( declaration ) );
-    assert( declaration[0].Usage == D3DDECLUSAGE_POSITION );
-
-    unsigned int numVertices = OriginalMeshData.pMesh->GetNumVertices();
-    unsigned int stride = ::dxGetStride( declaration );
-    assert( vertexBufferDesc.Size % numVertices == 0 );
-
-    for( unsigned int i=0; i<numVertices; i++ )
+    if( !pSoftwareSkin )
     {
-        memcpy( buffer+i, _skinnedVertices + stride * i, sizeof(Vector) );
+        pSoftwareSkin = new SoftwareSkin( pSkinInfo, OriginalMeshData.pMesh );
+        #ifdef ENGINE_SKINNING_BENCHMARK
+            pSoftwareSkin->benchmark( Name, pSkinInfo, OriginalMeshData.pMesh, pSoftwareBones );
+        #endif
     }
 
-    _dxCR( OriginalMeshData.pMesh->UnlockVertexBuffer() );    
+    pSoftwareSkin->skin( pSoftwareBones, buffer );
 }
 
 /**
@@ -16,6 +16,8 @@
 #include "shader.h"
 #include "frame.h"
 
+class SoftwareSkin;
+
 /**
  * Mesh is a extension of D3DXMESHCONTAINER structure, provided with skinning
  * and other effects behaviour
@@ -30,8 +32,6 @@ private:
     static int             _lightPaletteSize; // (setup) number of light per render query
     static D3DXMATRIXA16*  _pBoneMatrices;
     static StaticLostable* _effectLostable;
-    static DWORD           _sizeOfSkinnedVertices; // current size of buffer for SW skinning
-    static PBYTE           _skinnedVertices;       // buffer for SW skinning
 public:
     // special skinning extension 
     D3DXMESHDATA OriginalMeshData;    // original mesh data
@@ -40,6 +40,7 @@ public:
     ID3DXBuffer* pBoneCombination;    // bone combination buffer
     D3DXMATRIX*  pBoneOffsetMatrices; // bone offset matrices
     MatrixA16*   pSoftwareBones;      // array of bones for software skinning
+    SoftwareSkin* pSoftwareSkin;      // position-only skinning kernel (built on demand)
     DWORD        NumPaletteEntries;   // number of index palette entries
     DWORD        NumAttributeGroups;  // number of attribute groups
     DWORD        SoftwareAttributeId; // denotes the split between SW and HW if necessary for non-indexed skinning
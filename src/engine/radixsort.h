@@ -0,0 +1,76 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description platform-independent radix sort on 16-bit keys,
+ * shared by alpha sorting, grass & offline benchmark of alpha sorting
+ *
+ * @author bad3p
+ */
+
+#ifndef RADIX_SORT_INCLUDED
+#define RADIX_SORT_INCLUDED
+
+#include <cstring>
+
+inline unsigned short radixKey16(const unsigned short* keys, unsigned int keyStride, unsigned int i)
+{
+    return *reinterpret_cast<const unsigned short*>( reinterpret_cast<const char*>( keys ) + i * keyStride );
+}
+
+/**
+ * two-pass LSD radix sort of item indices on 16-bit keys,
+ * stable, so items with equal key keep their order
+ *
+ * @param keys      key of first item
+ * @param numItems  number of items
+ * @param order     receives sorted item indices, numItems entries
+ * @param temp      indices after first pass, numItems entries
+ * @param keyStride distance between keys of neighbouring items, in bytes
+ */
+
+inline void radixSort16(const unsigned short* keys, unsigned int numItems, unsigned int* order, unsigned int* temp, unsigned int keyStride = sizeof(unsigned short))
+{
+    unsigned int loCount[256]; // histogram of low key byte
+    unsigned int hiCount[256]; // histogram of high key byte
+    unsigned int i;
+
+    // build both histograms at once
+    memset( loCount, 0, sizeof( loCount ) );
+    memset( hiCount, 0, sizeof( hiCount ) );
+    for( i=0; i<numItems; i++ )
+    {
+        loCount[radixKey16( keys, keyStride, i ) & 0xFF]++;
+        hiCount[radixKey16( keys, keyStride, i ) >> 8]++;
+    }
+
+    // histograms to offsets
+    unsigned int loOffset = 0, hiOffset = 0, count;
+    for( i=0; i<256; i++ )
+    {
+        count = loCount[i], loCount[i] = loOffset, loOffset += count;
+        count = hiCount[i], hiCount[i] = hiOffset, hiOffset += count;
+    }
+
+    // stable scatter by low byte, then by high byte
+    for( i=0; i<numItems; i++ )
+    {
+        temp[loCount[radixKey16( keys, keyStride, i ) & 0xFF]++] = i;
+    }
+    for( i=0; i<numItems; i++ )
+    {
+        order[hiCount[radixKey16( keys, keyStride, temp[i] ) >> 8]++] = temp[i];
+    }
+}
+
+/**
+ * radix sort of item indices on 16-bit item key (Item::key)
+ */
+
+template<class Item> void radixSort16(const Item* items, unsigned int numItems, unsigned int* order, unsigned int* temp)
+{
+    if( !numItems ) return;
+    radixSort16( &items->key, numItems, order, temp, sizeof(Item) );
+}
+
+#endif
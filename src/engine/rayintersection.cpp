@@ -54,12 +54,12 @@ BSPSector* RayIntersection::collideBSPSector(BSPSector* sector)
             if( sector->_geometry )
             {
                 _bspSector = sector;
-                // collide octree sectors
-                assert( sector->_geometry->getOcTreeRoot() );
+                // collide sector hierarchy
+                assert( sector->_geometry->getBVH() );
                 _geometry  = sector->_geometry;
                 _vertices  = _geometry->getVertices();
                 _triangles = _geometry->getTriangles();
-                if( !collideBSPOcTreeSector( sector->_geometry->getOcTreeRoot() ) ) return NULL;
+                if( !_geometry->getBVH()->intersect( &_ray, onRayHit, this ) ) return NULL;
                 _bspSector = NULL;
             }
         }
@@ -72,53 +72,68 @@ BSPSector* RayIntersection::collideBSPSector(BSPSector* sector)
     return sector;
 }
 
-OcTreeSector* RayIntersection::collideBSPOcTreeSector(OcTreeSector* ocTreeSector)
+engine::CollisionTriangle* RayIntersection::getCollisionTriangle(int triangleId, float distance, const Vector& hitPoint)
 {
-    if( ocTreeSector->_triangles.size() )
+    Triangle* triangle = _triangles + triangleId;
+    Vector*   vertices = _vertices;
+    Vector    v0v1, v0v2, n;
+    v0v1 = vertices[triangle->vertexId[1]] - vertices[triangle->vertexId[0]];
+    v0v2 = vertices[triangle->vertexId[2]] - vertices[triangle->vertexId[0]];
+    D3DXVec3Cross( &n, &v0v1, &v0v2 );
+    D3DXVec3Normalize( &n, &n );
+
+    engine::CollisionTriangle* collisionTriangle = &_collisionTriangle;
+    if( _atomic )
     {
-        // collide octree sector triangles
-        Triangle* triangle;
-        Vector    v0v1, v0v2, n;
-        Vector    hitPoint;
-        for( unsigned int i=0; i<ocTreeSector->_triangles.size(); i++ )
-        {
-            triangle = _triangles + ocTreeSector->_triangles[i];
-            if( ::intersectionRayTriangle(
-                      &_ray, 
-                      _vertices + triangle->vertexId[0],
-                      _vertices + triangle->vertexId[1],
-                      _vertices + triangle->vertexId[2],
-                      &hitPoint,
-                      &_collisionTriangle.distance
-              ))
-            {
-                _collisionTriangle.vertices[0] = wrap( _vertices[triangle->vertexId[0]] );
-                _collisionTriangle.vertices[1] = wrap( _vertices[triangle->vertexId[1]] );
-                _collisionTriangle.vertices[2] = wrap( _vertices[triangle->vertexId[2]] );
-                v0v1 = _vertices[triangle->vertexId[1]] - _vertices[triangle->vertexId[0]];
-                v0v2 = _vertices[triangle->vertexId[2]] - _vertices[triangle->vertexId[0]];
-                D3DXVec3Cross( &n, &v0v1, &v0v2 );
-                D3DXVec3Normalize( &n, &n );
-                _collisionTriangle.normal = wrap( n );
-                _collisionTriangle.collisionPoint = wrap( hitPoint );
-                _collisionTriangle.shader = _geometry->shader( triangle->shaderId );
-                _collisionTriangle.triangleId = ocTreeSector->_triangles[i];
-                if( !_callBack( &_collisionTriangle, _bspSector, NULL, _callBackData ) ) return NULL;
-                return ocTreeSector;
-            }
-        }
+        // hit is found in atomic space
+        Matrix* ltm = &_atomic->_frame->LTM;
+        Vector  temp;
+        D3DXVec3TransformCoord( &temp, vertices + triangle->vertexId[0], ltm );
+        collisionTriangle->vertices[0] = wrap( temp );
+        D3DXVec3TransformCoord( &temp, vertices + triangle->vertexId[1], ltm );
+        collisionTriangle->vertices[1] = wrap( temp );
+        D3DXVec3TransformCoord( &temp, vertices + triangle->vertexId[2], ltm );
+        collisionTriangle->vertices[2] = wrap( temp );
+        D3DXVec3TransformNormal( &temp, &n, ltm );
+        collisionTriangle->normal = wrap( temp );
+        D3DXVec3TransformCoord( &temp, &hitPoint, ltm );
+        collisionTriangle->collisionPoint = wrap( temp );
     }
-    else if( ocTreeSector->_subtree[0] )
+    else
     {
-        for( unsigned int i=0; i<8; i++ )
-        {
-            if( intersectionRayAABB( &_ray, &ocTreeSector->_subtree[i]->_boundingBox ) )
-            {
-                if( !collideBSPOcTreeSector( ocTreeSector->_subtree[i] ) ) return NULL;
-            }
-        }
+        collisionTriangle->vertices[0] = wrap( vertices[triangle->vertexId[0]] );
+        collisionTriangle->vertices[1] = wrap( vertices[triangle->vertexId[1]] );
+        collisionTriangle->vertices[2] = wrap( vertices[triangle->vertexId[2]] );
+        collisionTriangle->normal = wrap( n );
+        collisionTriangle->collisionPoint = wrap( hitPoint );
     }
-    return ocTreeSector;
+    collisionTriangle->distance = distance;
+    collisionTriangle->shader = _geometry->shader( triangle->shaderId );
+    collisionTriangle->triangleId = triangleId;
+    return collisionTriangle;
+}
+
+bool RayIntersection::onRayHit(int triangleId, float distance, const Vector& hitPoint, void* data)
+{
+    RayIntersection* __this = reinterpret_cast<RayIntersection*>( data );
+    return NULL != __this->_callBack( 
+        __this->getCollisionTriangle( triangleId, distance, hitPoint ),
+        __this->_bspSector, 
+        __this->_atomic, 
+        __this->_callBackData 
+    );
+}
+
+bool RayIntersection::onPacketHit(int lane, int triangleId, float distance, const Vector& hitPoint, void* data)
+{
+    RayIntersection* __this = reinterpret_cast<RayIntersection*>( data );
+    return NULL != __this->_batchCallBack( 
+        __this->_packetOffset + lane,
+        __this->getCollisionTriangle( triangleId, distance, hitPoint ),
+        __this->_bspSector, 
+        __this->_atomic, 
+        __this->_callBackData 
+    );
 }
 
 void RayIntersection::intersect(engine::IAtomic* atomic, engine::CollisionCallBack callBack, void* data)
@@ -129,7 +144,7 @@ void RayIntersection::intersect(engine::IAtomic* atomic, engine::CollisionCallBa
     _bspSector = NULL;
     _atomic = dynamic_cast<Atomic*>( atomic ); assert( _atomic );
    
-    assert( _atomic->_geometry->getOcTreeRoot() );
+    assert( _atomic->_geometry->getBVH() );
     _geometry  = _atomic->_geometry;
     _vertices  = _geometry->getVertices();
     _triangles = _geometry->getTriangles();
@@ -145,61 +160,7 @@ void RayIntersection::intersect(engine::IAtomic* atomic, engine::CollisionCallBa
     D3DXVec3TransformCoord( &_asRay.start, &_ray.start, &iLTM );
     D3DXVec3TransformNormal( &_asRay.end, &_ray.end, &iLTM );
 
-    collideAtomicOcTreeSector( _geometry->getOcTreeRoot() );
-}
-
-OcTreeSector* RayIntersection::collideAtomicOcTreeSector(OcTreeSector* ocTreeSector)
-{
-    if( ocTreeSector->_triangles.size() )
-    {
-        // collide octree sector triangles
-        Triangle* triangle;
-        Vector    v0v1, v0v2, n;
-        Vector    hitPoint;
-        Vector    temp;
-        for( unsigned int i=0; i<ocTreeSector->_triangles.size(); i++ )
-        {
-            triangle = _triangles + ocTreeSector->_triangles[i];
-            if( ::intersectionRayTriangle(
-                      &_asRay, 
-                      _vertices + triangle->vertexId[0],
-                      _vertices + triangle->vertexId[1],
-                      _vertices + triangle->vertexId[2],
-                      &hitPoint,
-                      &_collisionTriangle.distance
-              ))
-            {
-                D3DXVec3TransformCoord( &temp, _vertices + triangle->vertexId[0], &_atomic->_frame->LTM );
-                _collisionTriangle.vertices[0] = wrap( temp );
-                D3DXVec3TransformCoord( &temp, _vertices + triangle->vertexId[1], &_atomic->_frame->LTM );
-                _collisionTriangle.vertices[1] = wrap( temp );
-                D3DXVec3TransformCoord( &temp, _vertices + triangle->vertexId[2], &_atomic->_frame->LTM );
-                _collisionTriangle.vertices[2] = wrap( temp );
-                v0v1 = _vertices[triangle->vertexId[1]] - _vertices[triangle->vertexId[0]];
-                v0v2 = _vertices[triangle->vertexId[2]] - _vertices[triangle->vertexId[0]];
-                D3DXVec3Cross( &n, &v0v1, &v0v2 );
-                D3DXVec3Normalize( &n, &n );
-                D3DXVec3TransformNormal( &temp, &n, &_atomic->_frame->LTM );
-                _collisionTriangle.normal = wrap( temp );
-                D3DXVec3TransformCoord( &temp, &hitPoint, &_atomic->_frame->LTM );
-                _collisionTriangle.collisionPoint = wrap( temp );
-                _collisionTriangle.shader = _geometry->shader( triangle->shaderId );
-                _collisionTriangle.triangleId = ocTreeSector->_triangles[i];
-                if( !_callBack( &_collisionTriangle, NULL, _atomic, _callBackData ) ) return NULL;
-            }
-        }
-    }
-    else if( ocTreeSector->_subtree[0] )
-    {
-        for( unsigned int i=0; i<8; i++ )
-        {
-            if( intersectionRayAABB( &_asRay, &ocTreeSector->_subtree[i]->_boundingBox ) )
-            {
-                if( !collideAtomicOcTreeSector( ocTreeSector->_subtree[i] ) ) return NULL;
-            }
-        }
-    }
-    return ocTreeSector;
+    _geometry->getBVH()->intersect( &_asRay, onRayHit, this );
 }
 
 void RayIntersection::intersect(Geometry* geometry, engine::CollisionCallBack callBack, void* data)
@@ -215,58 +176,102 @@ void RayIntersection::intersect(Geometry* geometry, engine::CollisionCallBack ca
     _triangles = _geometry->getTriangles();
     _asRay = _ray;
 
-    collideGeometryOcTreeSector( _geometry->getOcTreeRoot() );
+    if( !_geometry->getBVH() ) return;
+
+    _geometry->getBVH()->intersect( &_asRay, onRayHit, this );
 }
 
-OcTreeSector* RayIntersection::collideGeometryOcTreeSector(OcTreeSector* ocTreeSector)
+/**
+ * batch queries
+ */
+
+bool RayIntersection::collideBSPSector(BSPSector* sector, RayPacket* packet)
 {
-    if( !ocTreeSector ) 
-    {
-        return NULL;
-    }
-    if( ocTreeSector->_triangles.size() )
+    AABB* box = sector->getBoundingBox();
+    if( intersectionRayPacketAABB( packet, box->inf, box->sup ) )
     {
-        // collide octree sector triangles
-        Triangle* triangle;
-        Vector    v0v1, v0v2, n;
-        Vector    hitPoint;
-        Vector    temp;
-        for( unsigned int i=0; i<ocTreeSector->_triangles.size(); i++ )
+        // is this a leaf sector?
+        if( !sector->_leftSubset )
         {
-            triangle = _triangles + ocTreeSector->_triangles[i];
-            if( ::intersectionRayTriangle(
-                      &_asRay, 
-                      _vertices + triangle->vertexId[0],
-                      _vertices + triangle->vertexId[1],
-                      _vertices + triangle->vertexId[2],
-                      &hitPoint,
-                      &_collisionTriangle.distance
-              ))
+            if( sector->_geometry )
             {
-                _collisionTriangle.vertices[0] = wrap( _vertices[triangle->vertexId[0]] );
-                _collisionTriangle.vertices[1] = wrap( _vertices[triangle->vertexId[1]] );
-                _collisionTriangle.vertices[2] = wrap( _vertices[triangle->vertexId[2]] );
-                v0v1 = _vertices[triangle->vertexId[1]] - _vertices[triangle->vertexId[0]];
-                v0v2 = _vertices[triangle->vertexId[2]] - _vertices[triangle->vertexId[0]];
-                D3DXVec3Cross( &n, &v0v1, &v0v2 );
-                D3DXVec3Normalize( &n, &n );
-                _collisionTriangle.normal = wrap( n );
-                _collisionTriangle.collisionPoint = wrap( hitPoint );
-                _collisionTriangle.shader = _geometry->shader( triangle->shaderId );
-                _collisionTriangle.triangleId = ocTreeSector->_triangles[i];
-                if( !_callBack( &_collisionTriangle, NULL, _atomic, _callBackData ) ) return NULL;
+                _bspSector = sector;
+                assert( sector->_geometry->getBVH() );
+                _geometry  = sector->_geometry;
+                _vertices  = _geometry->getVertices();
+                _triangles = _geometry->getTriangles();
+                if( !_geometry->getBVH()->intersect( packet, onPacketHit, this ) ) return false;
+                _bspSector = NULL;
             }
         }
+        else
+        {
+            if( !collideBSPSector( sector->_leftSubset, packet ) ) return false;
+            if( !collideBSPSector( sector->_rightSubset, packet ) ) return false;
+        }
     }
-    else if( ocTreeSector->_subtree[0] )
+    return true;
+}
+
+void RayIntersection::intersect(unsigned int numRays, const Vector3f* starts, const Vector3f* directions, engine::IBSP* bsp, engine::RayBatchCallBack callBack, void* data)
+{
+    _bsp = dynamic_cast<BSP*>( bsp ); assert( _bsp );
+    _batchCallBack = callBack;
+    _callBackData = data;
+    _bspSector = NULL;
+    _atomic = NULL;
+
+    RayPacket packet;
+    Line      rays[RAY_PACKET_SIZE];
+    for( _packetOffset=0; _packetOffset<numRays; _packetOffset+=RAY_PACKET_SIZE )
     {
-        for( unsigned int i=0; i<8; i++ )
+        unsigned int packetSize = std::min<unsigned int>( RAY_PACKET_SIZE, numRays - _packetOffset );
+        for( unsigned int i=0; i<packetSize; i++ )
         {
-            if( intersectionRayAABB( &_asRay, &ocTreeSector->_subtree[i]->_boundingBox ) )
-            {
-                if( !collideGeometryOcTreeSector( ocTreeSector->_subtree[i] ) ) return NULL;
-            }
+            rays[i].start = wrap( starts[_packetOffset+i] );
+            rays[i].end   = wrap( directions[_packetOffset+i] );
         }
+        setupRayPacket( &packet, rays, packetSize );
+        collideBSPSector( _bsp->getRoot(), &packet );
+        _bspSector = NULL;
     }
-    return ocTreeSector;
-}
\ No newline at end of file
+}
+
+void RayIntersection::intersect(unsigned int numRays, const Vector3f* starts, const Vector3f* directions, engine::IAtomic* atomic, engine::RayBatchCallBack callBack, void* data)
+{
+    _batchCallBack = callBack;
+    _callBackData = data;
+    _bsp = NULL;
+    _bspSector = NULL;
+    _atomic = dynamic_cast<Atomic*>( atomic ); assert( _atomic );
+
+    assert( _atomic->_geometry->getBVH() );
+    _geometry  = _atomic->_geometry;
+    _vertices  = _geometry->getVertices();
+    _triangles = _geometry->getTriangles();
+
+    if( _atomic->_frame->isDirtyHierarchy() )
+    {
+        _atomic->_frame->synchronizeSafe();
+    }
+
+    // rays are transformed to atomic space
+    Matrix iLTM;
+    D3DXMatrixInverse( &iLTM, NULL, &_atomic->_frame->LTM );
+
+    RayPacket packet;
+    Line      rays[RAY_PACKET_SIZE];
+    for( _packetOffset=0; _packetOffset<numRays; _packetOffset+=RAY_PACKET_SIZE )
+    {
+        unsigned int packetSize = std::min<unsigned int>( RAY_PACKET_SIZE, numRays - _packetOffset );
+        for( unsigned int i=0; i<packetSize; i++ )
+        {
+            Vector start = wrap( starts[_packetOffset+i] );
+            Vector direction = wrap( directions[_packetOffset+i] );
+            D3DXVec3TransformCoord( &rays[i].start, &start, &iLTM );
+            D3DXVec3TransformNormal( &rays[i].end, &direction, &iLTM );
+        }
+        setupRayPacket( &packet, rays, packetSize );
+        _geometry->getBVH()->intersect( &packet, onPacketHit, this );
+    }
+}
@@ -0,0 +1,26 @@
+#include "headers.h"
+#include "raypacket.h"
+
+void setupRayPacket(RayPacket* packet, const Line* rays, unsigned int numRays)
+{
+    assert( numRays > 0 && numRays <= RAY_PACKET_SIZE );
+
+    float ox[RAY_PACKET_SIZE], oy[RAY_PACKET_SIZE], oz[RAY_PACKET_SIZE];
+    float dx[RAY_PACKET_SIZE], dy[RAY_PACKET_SIZE], dz[RAY_PACKET_SIZE];
+    float idx[RAY_PACKET_SIZE], idy[RAY_PACKET_SIZE], idz[RAY_PACKET_SIZE];
+
+    for( unsigned int i=0; i<RAY_PACKET_SIZE; i++ )
+    {
+        const Line* ray = rays + ( i < numRays ? i : 0 );
+        ox[i] = ray->start.x, oy[i] = ray->start.y, oz[i] = ray->start.z;
+        dx[i] = ray->end.x, dy[i] = ray->end.y, dz[i] = ray->end.z;
+        idx[i] = safeInverse( dx[i] );
+        idy[i] = safeInverse( dy[i] );
+        idz[i] = safeInverse( dz[i] );
+    }
+
+    packet->ox  = f4load( ox ),  packet->oy  = f4load( oy ),  packet->oz  = f4load( oz );
+    packet->dx  = f4load( dx ),  packet->dy  = f4load( dy ),  packet->dz  = f4load( dz );
+    packet->idx = f4load( idx ), packet->idy = f4load( idy ), packet->idz = f4load( idz );
+    packet->mask = RAY_PACKET_MASK >> ( RAY_PACKET_SIZE - numRays );
+}
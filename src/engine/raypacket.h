@@ -0,0 +1,252 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description 4-wide ray packets & SIMD collision kernels
+ *
+ * @author bad3p
+ */
+
+#ifndef RAY_PACKET_INCLUDED
+#define RAY_PACKET_INCLUDED
+
+#include "headers.h"
+#include "fundamentals.h"
+
+/**
+ * SSE is used when compiler targets it (/arch:SSE or x64),
+ * otherwise kernels are compiled for scalar lanes
+ */
+
+#if !defined(ENGINE_NO_SIMD) && ( defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 ) || defined(__SSE__) )
+    #define ENGINE_SIMD_SSE
+    #include <xmmintrin.h>
+#endif
+
+#define RAY_PACKET_SIZE 4
+#define RAY_PACKET_MASK 0x0F
+
+/**
+ * 4-wide float lanes
+ */
+
+#ifdef ENGINE_SIMD_SSE
+
+typedef __m128 float4;
+
+inline float4 f4set(float value) { return _mm_set1_ps( value ); }
+inline float4 f4load(const float* p) { return _mm_loadu_ps( p ); }
+inline void f4store(float* p, float4 a) { _mm_storeu_ps( p, a ); }
+inline float4 f4add(float4 a, float4 b) { return _mm_add_ps( a, b ); }
+inline float4 f4sub(float4 a, float4 b) { return _mm_sub_ps( a, b ); }
+inline float4 f4mul(float4 a, float4 b) { return _mm_mul_ps( a, b ); }
+inline float4 f4div(float4 a, float4 b) { return _mm_div_ps( a, b ); }
+inline float4 f4min(float4 a, float4 b) { return _mm_min_ps( a, b ); }
+inline float4 f4max(float4 a, float4 b) { return _mm_max_ps( a, b ); }
+inline float4 f4and(float4 a, float4 b) { return _mm_and_ps( a, b ); }
+inline float4 f4lt(float4 a, float4 b) { return _mm_cmplt_ps( a, b ); }
+inline float4 f4le(float4 a, float4 b) { return _mm_cmple_ps( a, b ); }
+inline float4 f4gt(float4 a, float4 b) { return _mm_cmpgt_ps( a, b ); }
+inline int f4mask(float4 a) { return _mm_movemask_ps( a ); }
+inline float4 f4sqrt(float4 a) { return _mm_sqrt_ps( a ); }
+inline void f4transpose(float4& a, float4& b, float4& c, float4& d) { _MM_TRANSPOSE4_PS( a, b, c, d ); }
+
+#else
+
+struct float4
+{
+    union
+    {
+        float        f[4];
+        unsigned int i[4];
+    };
+};
+
+inline float4 f4set(float value) { float4 r; r.f[0] = r.f[1] = r.f[2] = r.f[3] = value; return r; }
+inline float4 f4load(const float* p) { float4 r; r.f[0] = p[0], r.f[1] = p[1], r.f[2] = p[2], r.f[3] = p[3]; return r; }
+inline void f4store(float* p, float4 a) { p[0] = a.f[0], p[1] = a.f[1], p[2] = a.f[2], p[3] = a.f[3]; }
+
+#define F4_LANEWISE(name,expr) \
+    inline float4 name(float4 a, float4 b) { float4 r; for( int k=0; k<4; k++ ) { expr; } return r; }
+
+F4_LANEWISE( f4add, r.f[k] = a.f[k] + b.f[k] )
+F4_LANEWISE( f4sub, r.f[k] = a.f[k] - b.f[k] )
+F4_LANEWISE( f4mul, r.f[k] = a.f[k] * b.f[k] )
+F4_LANEWISE( f4div, r.f[k] = a.f[k] / b.f[k] )
+F4_LANEWISE( f4min, r.f[k] = a.f[k] < b.f[k] ? a.f[k] : b.f[k] )
+F4_LANEWISE( f4max, r.f[k] = a.f[k] > b.f[k] ? a.f[k] : b.f[k] )
+F4_LANEWISE( f4and, r.i[k] = a.i[k] & b.i[k] )
+F4_LANEWISE( f4lt, r.i[k] = a.f[k] < b.f[k] ? 0xFFFFFFFF : 0 )
+F4_LANEWISE( f4le, r.i[k] = a.f[k] <= b.f[k] ? 0xFFFFFFFF : 0 )
+F4_LANEWISE( f4gt, r.i[k] = a.f[k] > b.f[k] ? 0xFFFFFFFF : 0 )
+
+#undef F4_LANEWISE
+
+inline int f4mask(float4 a)
+{
+    return ( a.i[0] >> 31 ) | ( ( a.i[1] >> 31 ) << 1 ) | ( ( a.i[2] >> 31 ) << 2 ) | ( ( a.i[3] >> 31 ) << 3 );
+}
+
+inline float4 f4sqrt(float4 a)
+{
+    float4 r;
+    for( int k=0; k<4; k++ ) r.f[k] = sqrtf( a.f[k] );
+    return r;
+}
+
+inline void f4transpose(float4& a, float4& b, float4& c, float4& d)
+{
+    float4 r[4] = { a, b, c, d };
+    for( int k=0; k<4; k++ ) a.f[k] = r[k].f[0], b.f[k] = r[k].f[1], c.f[k] = r[k].f[2], d.f[k] = r[k].f[3];
+}
+
+#endif
+
+inline float f4lane(float4 a, int lane)
+{
+    float temp[4];
+    f4store( temp, a );
+    return temp[lane];
+}
+
+/**
+ * packet of 4 rays (start, direction) in SoA order, rays are parametrized
+ * in range [0..1] of direction; inactive lanes are excluded by mask
+ */
+
+struct RayPacket
+{
+public:
+    float4 ox, oy, oz;    // ray starts
+    float4 dx, dy, dz;    // ray directions
+    float4 idx, idy, idz; // inverse directions, used by slab test
+    int    mask;          // bit per active ray
+public:
+    inline Vector getStart(int lane) { return Vector( f4lane( ox, lane ), f4lane( oy, lane ), f4lane( oz, lane ) ); }
+    inline Vector getDirection(int lane) { return Vector( f4lane( dx, lane ), f4lane( dy, lane ), f4lane( dz, lane ) ); }
+};
+
+/**
+ * inverse of direction component, avoids infinities on axis-parallel rays
+ */
+
+inline float safeInverse(float value)
+{
+    const float huge = 1e30f;
+    if( fabs( value ) < 1e-30f ) return value < 0 ? -huge : huge;
+    return 1.0f / value;
+}
+
+/**
+ * sets up packet from up to RAY_PACKET_SIZE rays, unused lanes repeat first ray and stay inactive
+ */
+
+void setupRayPacket(RayPacket* packet, const Line* rays, unsigned int numRays);
+
+/**
+ * slab test of ray packet and AABB
+ * @return mask of active rays entering the box
+ */
+
+inline int intersectionRayPacketAABB(const RayPacket* packet, const Vector& inf, const Vector& sup)
+{
+    float4 t0, t1, tmin, tmax;
+    t0   = f4mul( f4sub( f4set( inf.x ), packet->ox ), packet->idx );
+    t1   = f4mul( f4sub( f4set( sup.x ), packet->ox ), packet->idx );
+    tmin = f4max( f4min( t0, t1 ), f4set( 0.0f ) );
+    tmax = f4min( f4max( t0, t1 ), f4set( 1.0f ) );
+    t0   = f4mul( f4sub( f4set( inf.y ), packet->oy ), packet->idy );
+    t1   = f4mul( f4sub( f4set( sup.y ), packet->oy ), packet->idy );
+    tmin = f4max( f4min( t0, t1 ), tmin );
+    tmax = f4min( f4max( t0, t1 ), tmax );
+    t0   = f4mul( f4sub( f4set( inf.z ), packet->oz ), packet->idz );
+    t1   = f4mul( f4sub( f4set( sup.z ), packet->oz ), packet->idz );
+    tmin = f4max( f4min( t0, t1 ), tmin );
+    tmax = f4min( f4max( t0, t1 ), tmax );
+    return f4mask( f4le( tmin, tmax ) ) & packet->mask;
+}
+
+/**
+ * Moller-Trumbore test of ray packet and one triangle (vertex & two edges)
+ * @return mask of active rays hitting the triangle, distances are stored in lanes of (*distance)
+ */
+
+inline int intersectionRayPacketTriangle(const RayPacket* packet, const float* v0, const float* e1, const float* e2, float4* distance)
+{
+    float4 e1x = f4set( e1[0] ), e1y = f4set( e1[1] ), e1z = f4set( e1[2] );
+    float4 e2x = f4set( e2[0] ), e2y = f4set( e2[1] ), e2z = f4set( e2[2] );
+
+    // p = d x e2, det = e1 . p
+    float4 px  = f4sub( f4mul( packet->dy, e2z ), f4mul( packet->dz, e2y ) );
+    float4 py  = f4sub( f4mul( packet->dz, e2x ), f4mul( packet->dx, e2z ) );
+    float4 pz  = f4sub( f4mul( packet->dx, e2y ), f4mul( packet->dy, e2x ) );
+    float4 det = f4add( f4add( f4mul( e1x, px ), f4mul( e1y, py ) ), f4mul( e1z, pz ) );
+    float4 valid = f4gt( f4mul( det, det ), f4set( 1e-24f ) );
+    float4 invDet = f4div( f4set( 1.0f ), det );
+
+    // s = o - v0, u = s . p / det
+    float4 sx = f4sub( packet->ox, f4set( v0[0] ) );
+    float4 sy = f4sub( packet->oy, f4set( v0[1] ) );
+    float4 sz = f4sub( packet->oz, f4set( v0[2] ) );
+    float4 u  = f4mul( f4add( f4add( f4mul( sx, px ), f4mul( sy, py ) ), f4mul( sz, pz ) ), invDet );
+
+    // q = s x e1, v = d . q / det, t = e2 . q / det
+    float4 qx = f4sub( f4mul( sy, e1z ), f4mul( sz, e1y ) );
+    float4 qy = f4sub( f4mul( sz, e1x ), f4mul( sx, e1z ) );
+    float4 qz = f4sub( f4mul( sx, e1y ), f4mul( sy, e1x ) );
+    float4 v  = f4mul( f4add( f4add( f4mul( packet->dx, qx ), f4mul( packet->dy, qy ) ), f4mul( packet->dz, qz ) ), invDet );
+    float4 t  = f4mul( f4add( f4add( f4mul( e2x, qx ), f4mul( e2y, qy ) ), f4mul( e2z, qz ) ), invDet );
+
+    float4 zero = f4set( 0.0f ), one = f4set( 1.0f );
+    valid = f4and( valid, f4le( zero, u ) );
+    valid = f4and( valid, f4le( zero, v ) );
+    valid = f4and( valid, f4le( f4add( u, v ), one ) );
+    valid = f4and( valid, f4le( zero, t ) );
+    valid = f4and( valid, f4le( t, one ) );
+
+    *distance = t;
+    return f4mask( valid ) & packet->mask;
+}
+
+/**
+ * Moller-Trumbore test of one ray and 4 triangles in SoA order (v0[3][4], e1[3][4], e2[3][4])
+ * @return mask of triangles hit by ray, distances are stored in lanes of (*distance)
+ */
+
+inline int intersectionRayTriangles(const Line* ray, const float* v0, const float* e1, const float* e2, float4* distance)
+{
+    float4 ox = f4set( ray->start.x ), oy = f4set( ray->start.y ), oz = f4set( ray->start.z );
+    float4 dx = f4set( ray->end.x ), dy = f4set( ray->end.y ), dz = f4set( ray->end.z );
+    float4 e1x = f4load( e1 ), e1y = f4load( e1 + 4 ), e1z = f4load( e1 + 8 );
+    float4 e2x = f4load( e2 ), e2y = f4load( e2 + 4 ), e2z = f4load( e2 + 8 );
+
+    float4 px  = f4sub( f4mul( dy, e2z ), f4mul( dz, e2y ) );
+    float4 py  = f4sub( f4mul( dz, e2x ), f4mul( dx, e2z ) );
+    float4 pz  = f4sub( f4mul( dx, e2y ), f4mul( dy, e2x ) );
+    float4 det = f4add( f4add( f4mul( e1x, px ), f4mul( e1y, py ) ), f4mul( e1z, pz ) );
+    float4 valid = f4gt( f4mul( det, det ), f4set( 1e-24f ) );
+    float4 invDet = f4div( f4set( 1.0f ), det );
+
+    float4 sx = f4sub( ox, f4load( v0 ) );
+    float4 sy = f4sub( oy, f4load( v0 + 4 ) );
+    float4 sz = f4sub( oz, f4load( v0 + 8 ) );
+    float4 u  = f4mul( f4add( f4add( f4mul( sx, px ), f4mul( sy, py ) ), f4mul( sz, pz ) ), invDet );
+
+    float4 qx = f4sub( f4mul( sy, e1z ), f4mul( sz, e1y ) );
+    float4 qy = f4sub( f4mul( sz, e1x ), f4mul( sx, e1z ) );
+    float4 qz = f4sub( f4mul( sx, e1y ), f4mul( sy, e1x ) );
+    float4 v  = f4mul( f4add( f4add( f4mul( dx, qx ), f4mul( dy, qy ) ), f4mul( dz, qz ) ), invDet );
+    float4 t  = f4mul( f4add( f4add( f4mul( e2x, qx ), f4mul( e2y, qy ) ), f4mul( e2z, qz ) ), invDet );
+
+    float4 zero = f4set( 0.0f ), one = f4set( 1.0f );
+    valid = f4and( valid, f4le( zero, u ) );
+    valid = f4and( valid, f4le( zero, v ) );
+    valid = f4and( valid, f4le( f4add( u, v ), one ) );
+    valid = f4and( valid, f4le( zero, t ) );
+    valid = f4and( valid, f4le( t, one ) );
+
+    *distance = t;
+    return f4mask( valid );
+}
+
+#endif
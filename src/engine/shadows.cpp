@@ -4,12 +4,137 @@
 #include "collision.h"
 #include "intersection.h"
 #include "wire.h"
+#include "raypacket.h"
 
 ID3DXEffect*    ShadowVolume::_effect = NULL;
 StaticLostable* ShadowVolume::_effectLostable = NULL;
 
 static RayIntersection* _rayIntersection = NULL;
 
+/**
+ * shadow adjacency
+ */
+
+ShadowAdjacency::ShadowAdjacency(unsigned int numFaces, Triangle* faces, Vector* vertices)
+{
+    _numFaces = numFaces;
+    _numSilhouetteEdges = 0;
+    _isCached = false;
+
+    // edges are keyed by ordered pair of vertex indices, edge shared by more 
+    // than two faces is split in to several edges
+    std::map<DWORD,unsigned int> edgeMap;
+    std::map<DWORD,unsigned int>::iterator edgeI;
+    unsigned int i,j;
+    for( i=0; i<_numFaces; i++ )
+    {
+        for( j=0; j<3; j++ )
+        {
+            WORD v0 = faces[i].vertexId[j];
+            WORD v1 = faces[i].vertexId[(j+1)%3];
+            DWORD key = v0 < v1 ? ( v0 | ( v1 << 16 ) ) : ( v1 | ( v0 << 16 ) );
+            edgeI = edgeMap.find( key );
+            if( edgeI != edgeMap.end() && _edges[edgeI->second].faceId[1] == _numFaces )
+            {
+                _edges[edgeI->second].vertexId[1] = v0 | ( v1 << 16 );
+                _edges[edgeI->second].faceId[1] = i;
+            }
+            else
+            {
+                AdjacentEdge edge;
+                edge.vertexId[0] = edge.vertexId[1] = v0 | ( v1 << 16 );
+                edge.faceId[0] = i;
+                edge.faceId[1] = _numFaces;
+                edgeMap[key] = _edges.size();
+                _edges.push_back( edge );
+            }
+        }
+    }
+
+    unsigned int numPaddedFaces = ( _numFaces + 3 ) & ~3;
+    _nx.resize( numPaddedFaces, 0.0f );
+    _ny.resize( numPaddedFaces, 0.0f );
+    _nz.resize( numPaddedFaces, 0.0f );
+    _nd.resize( numPaddedFaces, 0.0f );
+    _frontFaces.resize( std::max<unsigned int>( numPaddedFaces, _numFaces + 1 ), 0 );
+    _silhouette.resize( std::max<unsigned int>( _edges.size(), 1 ) );
+
+    updatePlanes( faces, vertices );
+}
+
+void ShadowAdjacency::updatePlanes(Triangle* faces, Vector* vertices)
+{
+    Vector v0, v1, v2, e1, e2, normal, center;
+    for( unsigned int i=0; i<_numFaces; i++ )
+    {
+        v0 = vertices[faces[i].vertexId[0]];
+        v1 = vertices[faces[i].vertexId[1]];
+        v2 = vertices[faces[i].vertexId[2]];
+        e1 = v2 - v1;
+        e2 = v1 - v0;
+        D3DXVec3Cross( &normal, &e1, &e2 );
+        center = ( v0 + v1 + v2 ) / 3.0f;
+        _nx[i] = normal.x, _ny[i] = normal.y, _nz[i] = normal.z;
+        _nd[i] = D3DXVec3Dot( &normal, &center );
+    }
+}
+
+unsigned int ShadowAdjacency::computeSilhouette(Triangle* faces, Vector* skinnedVertices, const D3DXVECTOR4& light)
+{
+    if( skinnedVertices )
+    {
+        updatePlanes( faces, skinnedVertices );
+        _isCached = false;
+    }
+    else if( _isCached && _cachedLight == light )
+    {
+        return _numSilhouetteEdges;
+    }
+
+    // face is pointed on light if dot( normal, light - w * center ) >= 0
+    float4 lx = f4set( light.x );
+    float4 ly = f4set( light.y );
+    float4 lz = f4set( light.z );
+    float4 lw = f4set( light.w );
+    float4 zero = f4set( 0.0f );
+    BYTE* frontFaces = &_frontFaces[0];
+    unsigned int i, mask;
+    for( i=0; i<_numFaces; i+=4 )
+    {
+        float4 faceDot = f4sub(
+            f4add( f4add( f4mul( f4load( &_nx[i] ), lx ), f4mul( f4load( &_ny[i] ), ly ) ), f4mul( f4load( &_nz[i] ), lz ) ),
+            f4mul( f4load( &_nd[i] ), lw )
+        );
+        mask = ~f4mask( f4lt( faceDot, zero ) );
+        frontFaces[i+0] = mask & 1;
+        frontFaces[i+1] = ( mask >> 1 ) & 1;
+        frontFaces[i+2] = ( mask >> 2 ) & 1;
+        frontFaces[i+3] = ( mask >> 3 ) & 1;
+    }
+    frontFaces[_numFaces] = 0;
+
+    // edge is on silhouette if exactly one of its faces is pointed on light, 
+    // it is wound as in that face
+    unsigned int numEdges = _edges.size();
+    unsigned int numSilhouetteEdges = 0;
+    AdjacentEdge* edge = numEdges ? &_edges[0] : NULL;
+    DWORD* silhouette = &_silhouette[0];
+    DWORD front0, front1, select;
+    for( i=0; i<numEdges; i++, edge++ )
+    {
+        front0 = frontFaces[edge->faceId[0]];
+        front1 = frontFaces[edge->faceId[1]];
+        select = 0 - front0;
+        silhouette[numSilhouetteEdges] = ( edge->vertexId[0] & select ) | ( edge->vertexId[1] & ~select );
+        numSilhouetteEdges += front0 ^ front1;
+    }
+
+    _numSilhouetteEdges = numSilhouetteEdges;
+    _isCached = ( skinnedVertices == NULL );
+    _cachedLight = light;
+    return _numSilhouetteEdges;
+}
+
 /**
  * class implementation
  */
@@ -46,10 +171,6 @@ ShadowVolume::ShadowVolume(unsigned int maxExtrudedEdges)
         D3DPOOL_MANAGED, &_maskBuffer, NULL 
     ) );
 
-    _maxEdges = 0;
-    _edges = NULL;
-    _backFaces = 0;
-
     // try to create effect
     if( _effect == NULL )
     {
@@ -79,8 +200,6 @@ ShadowVolume::ShadowVolume(unsigned int maxExtrudedEdges)
 
 ShadowVolume::~ShadowVolume()
 {
-    if( _backFaces ) delete[] _backFaces;
-    if( _edges ) delete[] _edges;
     _indexBuffer->Release();
     _vertexBuffer->Release();
     _maskBuffer->Release();
@@ -322,7 +441,6 @@ void ShadowVolume::renderShadowVolume(Geometry* geometry, Matrix* ltm, float dep
     _dxCR( dxSetTextureStageState( 1, D3DTSS_ALPHAOP, D3DTOP_DISABLE ) );
     _dxCR( dxSetTextureStageState( 1, D3DTSS_COLOROP, D3DTOP_DISABLE ) );
 
-    unsigned int numEdges = 0;
     unsigned int numFaces = geometry->getNumFaces();
     bool skinned = ( geometry->mesh()->pSkinInfo != NULL );
     Triangle* faces = geometry->getTriangles();
@@ -348,56 +466,13 @@ void ShadowVolume::renderShadowVolume(Geometry* geometry, Matrix* ltm, float dep
     //dxRenderAABB( &aabb, isInsideShadowVolume?&red:&white, NULL );
     //return;
 
-    // allocate/reallocate an edge list
-    if( _maxEdges < numFaces*6 )
-    {
-        _maxEdges = numFaces*6;
-        delete[] _edges;
-        _edges = new WORD[_maxEdges];
-        delete[] _backFaces;
-        _backFaces = new BYTE[numFaces];
-    }
-
-    // cleanup flagging array
-    memset( _backFaces, 0, sizeof(BYTE)*numFaces );
-    
-    WORD wFace0, wFace1, wFace2;
-    Vector v0, v1, v2;
-    Vector vLight, vCross1, vCross2, vNormal;
-    float faceDot;
-    
-    // for each face
-    for( unsigned int i=0; i<numFaces; ++i )
-    {
-        // face indices
-        wFace0 = faces[i].vertexId[0];
-        wFace1 = faces[i].vertexId[1];
-        wFace2 = faces[i].vertexId[2];
-
-        // face vertices        
-        v0 = vertices[wFace0];
-        v1 = vertices[wFace1];
-        v2 = vertices[wFace2];
-       
-        vLight = lightDir ? osLightDir : (( osLightPos - v0 ) + ( osLightPos - v1 ) + ( osLightPos - v2 )) / 3.0f;
-        vCross1 = v2 - v1;
-        vCross2 = v1 - v0;
-        D3DXVec3Cross( &vNormal, &vCross1, &vCross2 );
-        faceDot = D3DXVec3Dot( &vNormal, &vLight );
-
-        // select only faces that are pointed on light
-        if( faceDot >= 0.0f )
-        {
-            addEdge( _edges, numEdges, wFace0, wFace1 );
-            addEdge( _edges, numEdges, wFace1, wFace2 );
-            addEdge( _edges, numEdges, wFace2, wFace0 );
-        }
-        // but also flag the backfaces
-        else if( faceDot <= 0.0f )
-        {
-            _backFaces[i] = 1;
-        }
-    }
+    // find silhouette edges
+    ShadowAdjacency* adjacency = geometry->getShadowAdjacency();
+    D3DXVECTOR4 osLight = lightDir ? D3DXVECTOR4( osLightDir.x, osLightDir.y, osLightDir.z, 0.0f ) :
+                                     D3DXVECTOR4( osLightPos.x, osLightPos.y, osLightPos.z, 1.0f );
+    unsigned int numEdges = adjacency->computeSilhouette( faces, skinned ? vertices : NULL, osLight );
+    DWORD* silhouette = adjacency->getSilhouette();
+    BYTE* frontFaces = adjacency->getFrontFaces();
     
     unsigned int numActiveEdges = 0;
     unsigned int fvId, fiId;
@@ -417,7 +492,7 @@ void ShadowVolume::renderShadowVolume(Geometry* geometry, Matrix* ltm, float dep
 
         // edge vertex 0 (extrusion weight = 0)
         vertex[fvId+0].extrusion.x = vertex[fvId+0].extrusion.y = 0.0f;
-        vertex[fvId+0].pos = vertices[_edges[2*i+0]];
+        vertex[fvId+0].pos = vertices[silhouette[i] & 0xFFFF];
 
         // edge vertex 0 (extrusion weight = 1)
         vertex[fvId+1].extrusion.x = vertex[fvId+1].extrusion.y = 1.0f;
@@ -425,7 +500,7 @@ void ShadowVolume::renderShadowVolume(Geometry* geometry, Matrix* ltm, float dep
 
         // edge vertex 1 (extrusion weight = 0)
         vertex[fvId+2].extrusion.x = vertex[fvId+2].extrusion.y = 0.0f;
-        vertex[fvId+2].pos = vertices[_edges[2*i+1]];
+        vertex[fvId+2].pos = vertices[silhouette[i] >> 16];
 
         // edge vertex 1 (extrusion weight = 1)
         vertex[fvId+3].extrusion.x = vertex[fvId+3].extrusion.y = 1.0f;
@@ -484,7 +559,7 @@ void ShadowVolume::renderShadowVolume(Geometry* geometry, Matrix* ltm, float dep
             fiId = numCappingFaces * 3;
 
             // fill capping vertices
-            if( !_backFaces[i] )
+            if( frontFaces[i] )
             {
                 // vertex shader specification:
                 //  - texture coordinate U is progressive component of vertex extrusion
@@ -12,6 +12,52 @@
 #include "geometry.h"
 #include "camera.h"
 
+/**
+ * shadow adjacency is index-based edge list of geometry with pair of faces adjacent
+ * to each edge (border edges refer to sentinel face, that is never front-facing),
+ * silhouette is found by SIMD orientation pass over face planes (SoA) followed by 
+ * branch-free gather of edges separating front and back faces; silhouette of static
+ * geometry is kept until object-space light changes
+ */
+
+class ShadowAdjacency
+{
+public:
+    struct AdjacentEdge
+    {
+    public:
+        DWORD        vertexId[2]; // edge vertices (v0 | v1<<16) as wound in each adjacent face
+        unsigned int faceId[2];   // adjacent faces, second face of border edge is numFaces
+    };
+private:
+    unsigned int              _numFaces;
+    std::vector<AdjacentEdge> _edges;
+    std::vector<float>        _nx;         // face normals, padded to 4 faces
+    std::vector<float>        _ny;
+    std::vector<float>        _nz;
+    std::vector<float>        _nd;         // dot product of face normal & face center
+    std::vector<BYTE>         _frontFaces; // 1 for faces pointed on light, numFaces+1 entries at least
+    std::vector<DWORD>        _silhouette; // silhouette edges (v0 | v1<<16)
+    unsigned int              _numSilhouetteEdges;
+    bool                      _isCached;
+    D3DXVECTOR4               _cachedLight;
+private:
+    void updatePlanes(Triangle* faces, Vector* vertices);
+public:
+    ShadowAdjacency(unsigned int numFaces, Triangle* faces, Vector* vertices);
+public:
+    inline unsigned int getNumEdges(void) { return _edges.size(); }
+    inline DWORD* getSilhouette(void) { return &_silhouette[0]; }
+    inline BYTE* getFrontFaces(void) { return &_frontFaces[0]; }
+public:
+    /**
+     * finds silhouette for object-space light (xyz is light direction with w=0, 
+     * or light position with w=1), returns number of silhouette edges;
+     * skinned geometry passes its current vertices to rebuild face planes
+     */
+    unsigned int computeSilhouette(Triangle* faces, Vector* skinnedVertices, const D3DXVECTOR4& light);
+};
+
 /**
  * shadow volume is used to render shadows for specified geometry
  */
@@ -46,9 +92,6 @@ private:
     IDirect3DVertexBuffer9* _vertexBuffer;     // vertex buffer for shadow volume
     IDirect3DIndexBuffer9*  _indexBuffer;      // index buffer for shadow volume
     IDirect3DVertexBuffer9* _maskBuffer;       // vertex buffer for shadow mask
-    unsigned int            _maxEdges;         // current size of reallocable buffer for edges
-    WORD*                   _edges;          // reallocable buffer for edges
-    BYTE*                   _backFaces;        // reallocable buffer for flagging backfaces
 public:
     ShadowVolume(unsigned int maxExtrudedEdges);
     virtual ~ShadowVolume();
@@ -86,27 +129,6 @@ private:
         _dxCR( _vertexBuffer->Unlock() );
         _dxCR( _indexBuffer->Unlock() );
     }
-    inline void addEdge(WORD* edges, unsigned int& numEdges, WORD v0, WORD v1)
-    {
-        // remove interior edges (which appear in the list twice)
-        for( unsigned int i=0; i<numEdges; ++i )
-        {
-            if( ( edges[2*i+0] == v0 && edges[2*i+1] == v1 ) ||
-                ( edges[2*i+0] == v1 && edges[2*i+1] == v0 ) )
-            {
-                if( numEdges > 1 )
-                {
-                    edges[2*i+0] = edges[2*(numEdges-1)+0];
-                    edges[2*i+1] = edges[2*(numEdges-1)+1];
-                }
-                --numEdges;
-                return;
-            }
-        }  
-        edges[2*numEdges+0] = v0;
-        edges[2*numEdges+1] = v1;
-        numEdges++;
-    }    
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,256 @@
+
+#include "headers.h"
+#include "skinning.h"
+#include "raypacket.h"
+#include "vertexdeclaration.h"
+#include "engine.h"
+#include "jobs.h"
+
+#ifdef ENGINE_SKINNING_BENCHMARK
+    #include "../common/profiler.h"
+#endif
+
+#define SKINNING_LANES 4
+
+/**
+ * class implementation
+ */
+
+SoftwareSkin::SoftwareSkin(ID3DXSkinInfo* skinInfo, ID3DXMesh* mesh)
+{
+    _numVertices = mesh->GetNumVertices();
+    _stride = ( _numVertices + SKINNING_LANES - 1 ) & ~( SKINNING_LANES - 1 );
+
+    // bind-pose positions
+    D3DVERTEXELEMENT9 declaration[MAX_FVF_DECL_SIZE];
+    _dxCR( mesh->GetDeclaration( declaration ) );
+    assert( declaration[0].Usage == D3DDECLUSAGE_POSITION );
+    unsigned int stride = ::dxGetStride( declaration );
+
+    // padding vertices have no influences & are never written to output
+    _x.assign( _stride, 0.0f );
+    _y.assign( _stride, 0.0f );
+    _z.assign( _stride, 0.0f );
+    BYTE* vertices = NULL;
+    _dxCR( mesh->LockVertexBuffer( D3DLOCK_READONLY, (LPVOID*)&vertices ) );
+    unsigned int i;
+    for( i=0; i<_numVertices; i++ )
+    {
+        Vector* position = reinterpret_cast<Vector*>( vertices + stride * i );
+        _x[i] = position->x, _y[i] = position->y, _z[i] = position->z;
+    }
+    _dxCR( mesh->UnlockVertexBuffer() );
+
+    // count influences per vertex
+    unsigned int numBones = skinInfo->GetNumBones();
+    unsigned int boneId;
+    std::vector<DWORD> influenceVertices;
+    std::vector<float> influenceWeights;
+    _vertexInfluences.assign( _stride, 0 );
+    _numInfluences = 0;
+    for( boneId=0; boneId<numBones; boneId++ )
+    {
+        unsigned int numBoneInfluences = skinInfo->GetNumBoneInfluences( boneId );
+        if( !numBoneInfluences ) continue;
+        influenceVertices.resize( numBoneInfluences );
+        influenceWeights.resize( numBoneInfluences );
+        _dxCR( skinInfo->GetBoneInfluence( boneId, &influenceVertices[0], &influenceWeights[0] ) );
+        for( i=0; i<numBoneInfluences; i++ )
+        {
+            assert( influenceVertices[i] < _numVertices );
+            _vertexInfluences[influenceVertices[i]]++;
+            _numInfluences = std::max<unsigned int>( _numInfluences, _vertexInfluences[influenceVertices[i]] );
+        }
+    }
+
+    // fill influence-major arrays
+    _bones.assign( _numInfluences * _stride, 0 );
+    _weights.assign( _numInfluences * _stride, 0.0f );
+    _vertexInfluences.assign( _stride, 0 );
+    for( boneId=0; boneId<numBones; boneId++ )
+    {
+        unsigned int numBoneInfluences = skinInfo->GetNumBoneInfluences( boneId );
+        if( !numBoneInfluences ) continue;
+        influenceVertices.resize( numBoneInfluences );
+        influenceWeights.resize( numBoneInfluences );
+        _dxCR( skinInfo->GetBoneInfluence( boneId, &influenceVertices[0], &influenceWeights[0] ) );
+        for( i=0; i<numBoneInfluences; i++ )
+        {
+            unsigned int vertexId = influenceVertices[i];
+            unsigned int slot = _vertexInfluences[vertexId] * _stride + vertexId;
+            _bones[slot] = boneId;
+            _weights[slot] = influenceWeights[i];
+            _vertexInfluences[vertexId]++;
+        }
+    }
+}
+
+void SoftwareSkin::skin(const Matrix* bones, Vector* output, unsigned int firstVertex, unsigned int numVertices)
+{
+    assert( firstVertex + numVertices <= _numVertices );
+    assert( firstVertex % SKINNING_LANES == 0 );
+
+    const float* x = &_x[0];
+    const float* y = &_y[0];
+    const float* z = &_z[0];
+    const unsigned char* vertexInfluences = &_vertexInfluences[0];
+    const unsigned short* vertexBones = _bones.size() ? &_bones[0] : NULL;
+    const float* vertexWeights = _weights.size() ? &_weights[0] : NULL;
+    float resultX[SKINNING_LANES];
+    float resultY[SKINNING_LANES];
+    float resultZ[SKINNING_LANES];
+
+    unsigned int lastVertex = firstVertex + numVertices;
+    for( unsigned int vertexId=firstVertex; vertexId<lastVertex; vertexId+=SKINNING_LANES )
+    {
+        // lanes are 4 consecutive vertices, padding lanes have zero weights
+        float4 px = f4load( x + vertexId );
+        float4 py = f4load( y + vertexId );
+        float4 pz = f4load( z + vertexId );
+        float4 sx = f4set( 0.0f );
+        float4 sy = f4set( 0.0f );
+        float4 sz = f4set( 0.0f );
+        unsigned int numInfluences = std::max( 
+            std::max( vertexInfluences[vertexId], vertexInfluences[vertexId+1] ),
+            std::max( vertexInfluences[vertexId+2], vertexInfluences[vertexId+3] )
+        );
+        unsigned int slot = vertexId;
+        for( unsigned int influenceId=0; influenceId<numInfluences; influenceId++ )
+        {
+            // rows of lane bones are transposed, so each register holds one matrix element of 4 bones
+            const Matrix* bone0 = bones + vertexBones[slot];
+            const Matrix* bone1 = bones + vertexBones[slot+1];
+            const Matrix* bone2 = bones + vertexBones[slot+2];
+            const Matrix* bone3 = bones + vertexBones[slot+3];
+            float4 weight = f4load( vertexWeights + slot );
+            float4 m00 = f4load( bone0->m[0] ), m01 = f4load( bone1->m[0] ), m02 = f4load( bone2->m[0] ), m03 = f4load( bone3->m[0] );
+            float4 m10 = f4load( bone0->m[1] ), m11 = f4load( bone1->m[1] ), m12 = f4load( bone2->m[1] ), m13 = f4load( bone3->m[1] );
+            float4 m20 = f4load( bone0->m[2] ), m21 = f4load( bone1->m[2] ), m22 = f4load( bone2->m[2] ), m23 = f4load( bone3->m[2] );
+            float4 m30 = f4load( bone0->m[3] ), m31 = f4load( bone1->m[3] ), m32 = f4load( bone2->m[3] ), m33 = f4load( bone3->m[3] );
+            f4transpose( m00, m01, m02, m03 );
+            f4transpose( m10, m11, m12, m13 );
+            f4transpose( m20, m21, m22, m23 );
+            f4transpose( m30, m31, m32, m33 );
+            float4 tx = f4add( f4add( f4mul( px, m00 ), f4mul( py, m10 ) ), f4add( f4mul( pz, m20 ), m30 ) );
+            float4 ty = f4add( f4add( f4mul( px, m01 ), f4mul( py, m11 ) ), f4add( f4mul( pz, m21 ), m31 ) );
+            float4 tz = f4add( f4add( f4mul( px, m02 ), f4mul( py, m12 ) ), f4add( f4mul( pz, m22 ), m32 ) );
+            sx = f4add( sx, f4mul( tx, weight ) );
+            sy = f4add( sy, f4mul( ty, weight ) );
+            sz = f4add( sz, f4mul( tz, weight ) );
+            slot += _stride;
+        }
+        f4store( resultX, sx );
+        f4store( resultY, sy );
+        f4store( resultZ, sz );
+        unsigned int numLanes = std::min<unsigned int>( SKINNING_LANES, lastVertex - vertexId );
+        for( unsigned int lane=0; lane<numLanes; lane++ )
+        {
+            output[vertexId+lane].x = resultX[lane];
+            output[vertexId+lane].y = resultY[lane];
+            output[vertexId+lane].z = resultZ[lane];
+        }
+    }
+}
+
+/**
+ * parallel skinning
+ */
+
+class SkinningJob : public Job
+{
+private:
+    SoftwareSkin* _skin;
+    const Matrix* _bones;
+    Vector*       _output;
+    unsigned int  _firstVertex;
+    unsigned int  _numVertices;
+public:
+    SkinningJob(SoftwareSkin* skin, const Matrix* bones, Vector* output, unsigned int firstVertex, unsigned int numVertices) :
+        _skin(skin), _bones(bones), _output(output), _firstVertex(firstVertex), _numVertices(numVertices)
+    {}
+public:
+    virtual void run(void)
+    {
+        _skin->skin( _bones, _output, _firstVertex, _numVertices );
+    }
+};
+
+void SoftwareSkin::skin(const Matrix* bones, Vector* output)
+{
+    JobPool* jobPool = Engine::instance->jobPool;
+    if( !jobPool || !jobPool->getNumWorkers() || _numVertices <= SKINNING_JOB_VERTICES )
+    {
+        skin( bones, output, 0, _numVertices );
+        return;
+    }
+
+    // first chunk is skinned by calling thread
+    JobGroup jobs;
+    for( unsigned int firstVertex=SKINNING_JOB_VERTICES; firstVertex<_numVertices; firstVertex+=SKINNING_JOB_VERTICES )
+    {
+        unsigned int numVertices = std::min<unsigned int>( SKINNING_JOB_VERTICES, _numVertices - firstVertex );
+        jobPool->submit( new SkinningJob( this, bones, output, firstVertex, numVertices ), &jobs );
+    }
+    skin( bones, output, 0, SKINNING_JOB_VERTICES );
+    // chunks, which are queued behind unrelated jobs (texture decoding, etc), are skinned by calling thread
+    jobPool->wait( &jobs );
+}
+
+/**
+ * benchmark
+ */
+
+#ifdef ENGINE_SKINNING_BENCHMARK
+
+void SoftwareSkin::benchmark(const char* meshName, ID3DXSkinInfo* skinInfo, ID3DXMesh* mesh, Matrix* bones)
+{
+    const unsigned int numRuns = 100;
+
+    // D3DX skinning of full vertex format
+    IDirect3DVertexBuffer9* vertexBuffer;
+    D3DVERTEXBUFFER_DESC vertexBufferDesc;
+    _dxCR( mesh->GetVertexBuffer( &vertexBuffer ) );
+    _dxCR( vertexBuffer->GetDesc( &vertexBufferDesc ) );
+    vertexBuffer->Release();
+    D3DVERTEXELEMENT9 declaration[MAX_FVF_DECL_SIZE];
+    _dxCR( mesh->GetDeclaration( declaration ) );
+    unsigned int stride = ::dxGetStride( declaration );
+    std::vector<BYTE> reference( vertexBufferDesc.Size );
+    BYTE* vertices = NULL;
+    _dxCR( mesh->LockVertexBuffer( D3DLOCK_READONLY, (LPVOID*)&vertices ) );
+    unsigned int i;
+    __int64 time = getPerformanceCounter();
+    for( i=0; i<numRuns; i++ )
+    {
+        _dxCR( skinInfo->UpdateSkinnedMesh( bones, NULL, vertices, &reference[0] ) );
+    }
+    float d3dxTime = convertCounterToSeconds( getPerformanceCounter() - time );
+    _dxCR( mesh->UnlockVertexBuffer() );
+
+    // kernel
+    std::vector<Vector> output( _numVertices );
+    time = getPerformanceCounter();
+    for( i=0; i<numRuns; i++ ) skin( bones, &output[0], 0, _numVertices );
+    float kernelTime = convertCounterToSeconds( getPerformanceCounter() - time );
+    time = getPerformanceCounter();
+    for( i=0; i<numRuns; i++ ) skin( bones, &output[0] );
+    float parallelTime = convertCounterToSeconds( getPerformanceCounter() - time );
+
+    float maxError = 0.0f;
+    for( i=0; i<_numVertices; i++ )
+    {
+        Vector* expected = reinterpret_cast<Vector*>( &reference[0] + stride * i );
+        maxError = std::max( maxError, fabsf( expected->x - output[i].x ) );
+        maxError = std::max( maxError, fabsf( expected->y - output[i].y ) );
+        maxError = std::max( maxError, fabsf( expected->z - output[i].z ) );
+    }
+
+    getCore()->logMessage(
+        "engine: skinning %s (%d vertices, %d influences) D3DX %.3f ms, kernel %.3f ms, parallel %.3f ms, max. error %f",
+        meshName, _numVertices, _numInfluences,
+        1000.0f * d3dxTime / numRuns, 1000.0f * kernelTime / numRuns, 1000.0f * parallelTime / numRuns,
+        maxError
+    );
+}
+
+#endif
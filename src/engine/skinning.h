@@ -0,0 +1,58 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description position-only software skinning
+ *
+ * @author bad3p
+ */
+
+#ifndef SOFTWARE_SKINNING_INCLUDED
+#define SOFTWARE_SKINNING_INCLUDED
+
+#include "headers.h"
+#include "fundamentals.h"
+
+/**
+ * skinning kernel processes positions only (shadow volumes & collision don't need
+ * the rest of vertex format); bind-pose positions, bone indices & weights are kept
+ * in SoA arrays padded to 4 vertices, kernel skins 4 vertices per iteration,
+ * large meshes are split between workers of job pool
+ *
+ * define ENGINE_SKINNING_BENCHMARK to compare kernel with D3DX skinning for
+ * each skinned mesh (jumper, canopy, etc) when its software skin is built
+ */
+
+#define SKINNING_JOB_VERTICES 2048 // vertices per job (multiple of 4), smaller meshes are skinned in calling thread
+
+class SoftwareSkin
+{
+private:
+    unsigned int                _numVertices;
+    unsigned int                _numInfluences;   // max. number of influences per vertex
+    unsigned int                _stride;          // number of vertices padded to 4
+    std::vector<float>          _x;               // bind-pose positions
+    std::vector<float>          _y;
+    std::vector<float>          _z;
+    std::vector<unsigned char>  _vertexInfluences; // number of influences per vertex
+    std::vector<unsigned short> _bones;            // influence-major: [influenceId * stride + vertexId]
+    std::vector<float>          _weights;          // same layout as bones
+public:
+    SoftwareSkin(ID3DXSkinInfo* skinInfo, ID3DXMesh* mesh);
+public:
+    inline unsigned int getNumVertices(void) { return _numVertices; }
+public:
+    /**
+     * skins range of vertices, range should start at multiple of 4
+     */
+    void skin(const Matrix* bones, Vector* output, unsigned int firstVertex, unsigned int numVertices);
+    /**
+     * skins all vertices, using job pool for large meshes
+     */
+    void skin(const Matrix* bones, Vector* output);
+#ifdef ENGINE_SKINNING_BENCHMARK
+    void benchmark(const char* meshName, ID3DXSkinInfo* skinInfo, ID3DXMesh* mesh, Matrix* bones);
+#endif
+};
+
+#endif
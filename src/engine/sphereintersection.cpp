@@ -43,7 +43,7 @@ void SphereIntersection::intersect(engine::IAtomic* atomic, engine::CollisionCal
     _callBack     = callBack;
     _callBackData = data;
 
-    assert( _atomic->_geometry->getOcTreeRoot() );
+    assert( _atomic->_geometry->getBVH() );
     _geometry  = _atomic->_geometry;
     _vertices  = _geometry->getVertices();
     _triangles = _geometry->getTriangles();
@@ -56,61 +56,48 @@ void SphereIntersection::intersect(engine::IAtomic* atomic, engine::CollisionCal
     D3DXVec3TransformCoord( &_asSphere.center, &_sphere.center, &iLTM );
     _asSphere.radius = _sphere.radius;
 
-    collideAtomicOcTreeSector( _geometry->getOcTreeRoot() );
+    _geometry->getBVH()->forAllTriangles( &_asSphere, onAtomicTriangle, this );
 }
 
-OcTreeSector* SphereIntersection::collideAtomicOcTreeSector(OcTreeSector* ocTreeSector)
+bool SphereIntersection::onAtomicTriangle(int triangleId, void* data)
 {
-    if( ocTreeSector->_triangles.size() )
-    {
-        // collide octree sector triangles
-        Triangle* triangle;
-        Vector    v0v1, v0v2, n;
-        Vector    hitPoint;
-        Vector    temp;
-        for( unsigned int i=0; i<ocTreeSector->_triangles.size(); i++ )
-        {
-            triangle = _triangles + ocTreeSector->_triangles[i];
-            if( intersectionSphereTriangle( 
-                   &_asSphere, 
-                   _vertices + triangle->vertexId[0],
-                   _vertices + triangle->vertexId[1],
-                   _vertices + triangle->vertexId[2],
-                   &hitPoint,
-                   &_collisionTriangle.distance
-              ) )
-            {
-                D3DXVec3TransformCoord( &temp, _vertices + triangle->vertexId[0], &_atomic->_frame->LTM );
-                _collisionTriangle.vertices[0] = wrap( temp );
-                D3DXVec3TransformCoord( &temp, _vertices + triangle->vertexId[1], &_atomic->_frame->LTM );
-                _collisionTriangle.vertices[1] = wrap( temp );
-                D3DXVec3TransformCoord( &temp, _vertices + triangle->vertexId[2], &_atomic->_frame->LTM );
-                _collisionTriangle.vertices[2] = wrap( temp );
-                v0v1 = _vertices[triangle->vertexId[1]] - _vertices[triangle->vertexId[0]];
-                v0v2 = _vertices[triangle->vertexId[2]] - _vertices[triangle->vertexId[0]];
-                D3DXVec3Cross( &n, &v0v1, &v0v2 );
-                D3DXVec3Normalize( &n, &n );
-                D3DXVec3TransformNormal( &temp, &n, &_atomic->_frame->LTM );
-                _collisionTriangle.normal = wrap( temp );
-                D3DXVec3TransformCoord( &temp, &hitPoint, &_atomic->_frame->LTM );
-                _collisionTriangle.collisionPoint = wrap( temp );
-                _collisionTriangle.shader = _geometry->shader( triangle->shaderId );
-                _collisionTriangle.triangleId = ocTreeSector->_triangles[i];
-                if( !_callBack( &_collisionTriangle, NULL, _atomic, _callBackData ) ) return NULL;
-            }
-        }
-    }
-    else if( ocTreeSector->_subtree[0] )
+    SphereIntersection* __this = reinterpret_cast<SphereIntersection*>( data );
+
+    Triangle* triangle = __this->_triangles + triangleId;
+    Vector*   vertices = __this->_vertices;
+    engine::CollisionTriangle* collisionTriangle = &__this->_collisionTriangle;
+    Vector    v0v1, v0v2, n;
+    Vector    hitPoint;
+    Vector    temp;
+    if( intersectionSphereTriangle( 
+           &__this->_asSphere, 
+           vertices + triangle->vertexId[0],
+           vertices + triangle->vertexId[1],
+           vertices + triangle->vertexId[2],
+           &hitPoint,
+           &collisionTriangle->distance
+      ) )
     {
-        for( unsigned int i=0; i<8; i++ )
-        {
-            if( intersectionSphereAABB( &_asSphere, &ocTreeSector->_subtree[i]->_boundingBox ) )
-            {
-                if( !collideAtomicOcTreeSector( ocTreeSector->_subtree[i] ) ) return NULL;
-            }
-        }
+        Matrix* ltm = &__this->_atomic->_frame->LTM;
+        D3DXVec3TransformCoord( &temp, vertices + triangle->vertexId[0], ltm );
+        collisionTriangle->vertices[0] = wrap( temp );
+        D3DXVec3TransformCoord( &temp, vertices + triangle->vertexId[1], ltm );
+        collisionTriangle->vertices[1] = wrap( temp );
+        D3DXVec3TransformCoord( &temp, vertices + triangle->vertexId[2], ltm );
+        collisionTriangle->vertices[2] = wrap( temp );
+        v0v1 = vertices[triangle->vertexId[1]] - vertices[triangle->vertexId[0]];
+        v0v2 = vertices[triangle->vertexId[2]] - vertices[triangle->vertexId[0]];
+        D3DXVec3Cross( &n, &v0v1, &v0v2 );
+        D3DXVec3Normalize( &n, &n );
+        D3DXVec3TransformNormal( &temp, &n, ltm );
+        collisionTriangle->normal = wrap( temp );
+        D3DXVec3TransformCoord( &temp, &hitPoint, ltm );
+        collisionTriangle->collisionPoint = wrap( temp );
+        collisionTriangle->shader = __this->_geometry->shader( triangle->shaderId );
+        collisionTriangle->triangleId = triangleId;
+        if( !__this->_callBack( collisionTriangle, NULL, __this->_atomic, __this->_callBackData ) ) return false;
     }
-    return ocTreeSector;
+    return true;
 }
 
 bool SphereIntersection::intersect(
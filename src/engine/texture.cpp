@@ -170,6 +170,7 @@ Texture::Texture()
     _lostableWidth         = 0;
     _lostableHeight        = 0;
     _lostableDepth         = 0;
+    _image                 = NULL;
 }    
 
 Texture::~Texture()
@@ -180,6 +181,9 @@ Texture::~Texture()
     assert( textureI != textures.end() );
     textures.erase( textureI );
 
+    // texture is released before its decoded contents were uploaded
+    if( _image ) delete _image;
+
     // release DirectX interface
     if( _iDirect3DTexture9 != NULL )
     {
@@ -273,62 +277,291 @@ Texture* Texture::createCubeRenderTarget(int size, int depth, const char* name)
     return result;
 }
 
-Texture* Texture::createTexture(const char* fileName, bool keepFullName)
+/**
+ * decoded texture contents
+ */
+
+TextureImage::TextureImage(IResource* resource)
 {
-    // read surface format
-    IResource* resource = getCore()->getResource( fileName, "rb" ); 
-    if (resource == 0) {
-        getCore()->logMessage("Error: can't find texture: %s", fileName);
+    this->resource = resource;
+    data           = NULL;
+    size           = 0;
+    isCubeMap      = false;
+    format         = D3DFMT_UNKNOWN;
+    width          = 0;
+    height         = 0;
+    numLevels      = 0;
+    blockSize      = 0;
+    bitsPerPixel   = 0;
+    pixels         = NULL;
+}
+
+TextureImage::~TextureImage()
+{
+    if( resource ) resource->release();
+}
+
+void TextureImage::parse(void)
+{
+    // resource contents: archive entries & loose files are memory-resident, 
+    // anything else is read in to buffer
+    const char* fileName = resource->getName();
+    size = resource->getSize();
+    data = reinterpret_cast<const BYTE*>( resource->getData() );
+    if( !data && size )
+    {
+        buffer.resize( size );
+        resource->readData( &buffer[0], size );
+        data = &buffer[0];
     }
-    assert( resource );
+    if( !data || size < sizeof(DWORD) + sizeof(DDSURFACEDESC2) )
+    {
+        throw Exception( "Error: can't read texture: %s", fileName );
+    }
+
+    // read surface format
     DWORD magicValue;
-    fread( &magicValue, sizeof(DWORD), 1, resource->getFile() );
+    memcpy( &magicValue, data, sizeof(DWORD) );
     DDSURFACEDESC2 surfaceDesc;
-    fread( &surfaceDesc, sizeof(DDSURFACEDESC2), 1, resource->getFile() );
-    resource->release();
+    memcpy( &surfaceDesc, data + sizeof(DWORD), sizeof(DDSURFACEDESC2) );
+
+    isCubeMap = ( surfaceDesc.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP ) != 0;
+
+    // partial cube maps & volumes are left to D3DX
+    if( magicValue != MAKEFOURCC( 'D','D','S',' ' ) ) return;
+    if( surfaceDesc.ddsCaps.dwCaps2 & DDSCAPS2_VOLUME ) return;
+    if( isCubeMap && ( surfaceDesc.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP_ALLFACES ) != DDSCAPS2_CUBEMAP_ALLFACES ) return;
+    if( isCubeMap && surfaceDesc.dwWidth != surfaceDesc.dwHeight ) return;
+
+    // recognize pixel format
+    const DDPIXELFORMAT& pf = surfaceDesc.ddpfPixelFormat;
+    D3DFORMAT surfaceFormat = D3DFMT_UNKNOWN;
+    if( pf.dwFlags & DDPF_FOURCC )
+    {
+        switch( pf.dwFourCC )
+        {
+        case MAKEFOURCC( 'D','X','T','1' ):
+            surfaceFormat = D3DFMT_DXT1, blockSize = 8;
+            break;
+        case MAKEFOURCC( 'D','X','T','2' ):
+        case MAKEFOURCC( 'D','X','T','3' ):
+        case MAKEFOURCC( 'D','X','T','4' ):
+        case MAKEFOURCC( 'D','X','T','5' ):
+            surfaceFormat = D3DFORMAT( pf.dwFourCC ), blockSize = 16;
+            break;
+        }
+    }
+    else if( pf.dwFlags & DDPF_RGB )
+    {
+        DWORD alphaMask = ( pf.dwFlags & DDPF_ALPHAPIXELS ) ? pf.dwRGBAlphaBitMask : 0;
+        bitsPerPixel = pf.dwRGBBitCount;
+        if( bitsPerPixel == 32 && pf.dwRBitMask == 0xff0000 && pf.dwGBitMask == 0xff00 && pf.dwBBitMask == 0xff )
+        {
+            surfaceFormat = alphaMask == 0xff000000 ? D3DFMT_A8R8G8B8 : D3DFMT_X8R8G8B8;
+        }
+        else if( bitsPerPixel == 24 && pf.dwRBitMask == 0xff0000 && pf.dwGBitMask == 0xff00 && pf.dwBBitMask == 0xff )
+        {
+            surfaceFormat = D3DFMT_R8G8B8;
+        }
+        else if( bitsPerPixel == 16 && pf.dwRBitMask == 0xf800 && pf.dwGBitMask == 0x7e0 && pf.dwBBitMask == 0x1f )
+        {
+            surfaceFormat = D3DFMT_R5G6B5;
+        }
+        else if( bitsPerPixel == 16 && pf.dwRBitMask == 0x7c00 && pf.dwGBitMask == 0x3e0 && pf.dwBBitMask == 0x1f )
+        {
+            surfaceFormat = alphaMask == 0x8000 ? D3DFMT_A1R5G5B5 : D3DFMT_X1R5G5B5;
+        }
+        else if( bitsPerPixel == 16 && pf.dwRBitMask == 0xf00 && pf.dwGBitMask == 0xf0 && pf.dwBBitMask == 0xf && alphaMask == 0xf000 )
+        {
+            surfaceFormat = D3DFMT_A4R4G4B4;
+        }
+    }
+    if( surfaceFormat == D3DFMT_UNKNOWN ) return;
+
+    width     = surfaceDesc.dwWidth;
+    height    = surfaceDesc.dwHeight;
+    numLevels = ( surfaceDesc.dwFlags & DDSD_MIPMAPCOUNT ) && surfaceDesc.dwMipMapCount ? surfaceDesc.dwMipMapCount : 1;
+    pixels    = data + sizeof(DWORD) + sizeof(DDSURFACEDESC2);
+
+    // all levels of all faces should be within file
+    unsigned int imageSize = 0;
+    for( unsigned int level=0; level<numLevels; level++ )
+    {
+        imageSize += getRowSize( level ) * getNumRows( level );
+    }
+    if( isCubeMap ) imageSize *= 6;
+    if( width == 0 || height == 0 || imageSize > size - ( pixels - data ) )
+    {
+        throw Exception( "Error: can't read texture: %s", fileName );
+    }
+
+    format = surfaceFormat;
+}
+
+unsigned int TextureImage::getRowSize(unsigned int level)
+{
+    unsigned int levelWidth = std::max( width >> level, 1u );
+    if( blockSize ) return std::max( ( levelWidth + 3 ) / 4, 1u ) * blockSize;
+    return levelWidth * bitsPerPixel / 8;
+}
+
+unsigned int TextureImage::getNumRows(unsigned int level)
+{
+    unsigned int levelHeight = std::max( height >> level, 1u );
+    if( blockSize ) return std::max( ( levelHeight + 3 ) / 4, 1u );
+    return levelHeight;
+}
+
+void Texture::decode(IResource* resource)
+{
+    TextureImage* image = new TextureImage( resource );
+    try
+    {
+        image->parse();
+    }
+    catch( ... )
+    {
+        delete image;
+        throw;
+    }
+    if( _image ) delete _image;
+    _image = image;
+}
+
+static bool isPow2(unsigned int value)
+{
+    return ( value & ( value - 1 ) ) == 0;
+}
+
+void Texture::uploadLevels(TextureImage* image)
+{
+    const BYTE* pixels = image->pixels;
+    unsigned int numFaces = image->isCubeMap ? 6 : 1;
+    for( unsigned int face=0; face<numFaces; face++ )
+    {
+        for( unsigned int level=0; level<image->numLevels; level++ )
+        {
+            D3DLOCKED_RECT lockedRect;
+            if( image->isCubeMap )
+            {
+                _dxCR( _iDirect3DCubeTexture9->LockRect( D3DCUBEMAP_FACES( face ), level, &lockedRect, NULL, 0 ) );
+            }
+            else
+            {
+                _dxCR( _iDirect3DTexture9->LockRect( level, &lockedRect, NULL, 0 ) );
+            }
+            unsigned int rowSize = image->getRowSize( level );
+            unsigned int numRows = image->getNumRows( level );
+            BYTE* dst = reinterpret_cast<BYTE*>( lockedRect.pBits );
+            for( unsigned int row=0; row<numRows; row++ )
+            {
+                memcpy( dst, pixels, rowSize );
+                dst += lockedRect.Pitch;
+                pixels += rowSize;
+            }
+            if( image->isCubeMap )
+            {
+                _dxCR( _iDirect3DCubeTexture9->UnlockRect( D3DCUBEMAP_FACES( face ), level ) );
+            }
+            else
+            {
+                _dxCR( _iDirect3DTexture9->UnlockRect( level ) );
+            }
+        }
+    }
+}
 
-    // analyse magic value
-    // ...
+void Texture::upload(void)
+{
+    if( !_image ) return;
+    TextureImage* image = _image;
+    _image = NULL;
+
+    try
+    {
+        // device-ready layout is copied in as is
+        bool pow2Required = ( dxDeviceCaps.TextureCaps & D3DPTEXTURECAPS_POW2 ) &&
+                            !( dxDeviceCaps.TextureCaps & D3DPTEXTURECAPS_NONPOW2CONDITIONAL );
+        bool isUploadable = image->format != D3DFMT_UNKNOWN &&
+                            !( pow2Required && !( isPow2( image->width ) && isPow2( image->height ) ) );
+        if( isUploadable )
+        {
+            HRESULT result;
+            if( image->isCubeMap )
+            {
+                result = iDirect3DDevice->CreateCubeTexture(
+                    image->width, image->numLevels, 0, image->format, D3DPOOL_MANAGED, &_iDirect3DCubeTexture9, NULL
+                );
+            }
+            else
+            {
+                result = iDirect3DDevice->CreateTexture(
+                    image->width, image->height, image->numLevels, 0, image->format, D3DPOOL_MANAGED, &_iDirect3DTexture9, NULL
+                );
+            }
+            // format isn't supported by device, D3DX converts it
+            isUploadable = SUCCEEDED( result );
+        }
+
+        if( isUploadable )
+        {
+            uploadLevels( image );
+        }
+        else if( image->isCubeMap )
+        {
+            _dxCR( D3DXCreateCubeTextureFromFileInMemory( 
+                iDirect3DDevice,
+                image->data,
+                image->size,
+                &_iDirect3DCubeTexture9
+            ) );
+        }
+        else
+        {
+            _dxCR( D3DXCreateTextureFromFileInMemoryEx(
+                iDirect3DDevice,
+                image->data,
+                image->size,
+                D3DX_DEFAULT,
+                D3DX_DEFAULT,
+                D3DX_FROM_FILE,
+                0,
+                D3DFMT_FROM_FILE,
+                D3DPOOL_MANAGED,
+                D3DX_DEFAULT,
+                D3DX_DEFAULT,
+                0,
+                NULL,
+                NULL,
+                &_iDirect3DTexture9
+            ) );
+        }
+    }
+    catch( ... )
+    {
+        delete image;
+        throw;
+    }
+    delete image;
+}
 
+Texture* Texture::createTexture(const char* fileName, bool keepFullName)
+{
     // create texture
     _chain( Texture* result = new Texture );
     
     result->_textureType = ttManaged;
-
-    // is it a cube map?
-    if( surfaceDesc.ddsCaps.dwCaps2 & DDSCAPS2_CUBEMAP )
+    IResource* resource = getCore()->getResource( fileName, "rb" );
+    try
     {
-        _dxCR( D3DXCreateCubeTextureFromFile( 
-            iDirect3DDevice,
-            fileName,
-            &result->_iDirect3DCubeTexture9
-        ) );
+        if( !resource ) throw Exception( "Error: can't find texture: %s", fileName );
+        result->decode( resource );
+        result->upload();
     }
-    else
+    catch( Exception& exception )
     {
-        _dxCR( D3DXCreateTextureFromFileEx(
-            iDirect3DDevice,
-            fileName,
-            D3DX_DEFAULT,
-            D3DX_DEFAULT,
-            D3DX_FROM_FILE,
-            0,
-            D3DFMT_FROM_FILE,
-            D3DPOOL_MANAGED,
-            D3DX_DEFAULT,
-            D3DX_DEFAULT,
-            0,
-            NULL,
-            NULL,
-            &result->_iDirect3DTexture9
-        ) );
-
-
-        /*_dxCR( D3DXCreateTextureFromFile( 
-            iDirect3DDevice,
-            fileName,
-            &result->_iDirect3DTexture9
-        ) );*/
+        getCore()->logMessage( exception.getMsg() );
+        assert( !"texture not found" );
     }
 
     if (keepFullName) {
@@ -662,7 +895,37 @@ void Texture::write(IResource* resource)
     save( path.c_str() );
 }
 
-AssetObjectT Texture::read(IResource* resource, AssetObjectM& assetObjects)
+/**
+ * texture decoding job: contents are decoded on job pool thread, while loader
+ * continues to read chunks, which refer to texture; DirectX objects are created
+ * by loader after all jobs of asset are completed
+ */
+
+class TextureDecodeJob : public Job
+{
+private:
+    Texture*    _texture;
+    IResource*  _resource; // opened by loader thread, resource manager isn't thread-safe
+    std::string _fileName;
+public:
+    TextureDecodeJob(Texture* texture, IResource* resource, const char* fileName) :
+        _texture(texture), _resource(resource), _fileName(fileName)
+    {}
+    virtual ~TextureDecodeJob()
+    {
+        if( _resource ) _resource->release();
+    }
+public:
+    virtual void run(void)
+    {
+        if( !_resource ) throw Exception( "Error: can't find texture: %s", _fileName.c_str() );
+        IResource* resource = _resource;
+        _resource = NULL;
+        _texture->decode( resource );
+    }
+};
+
+AssetObjectT Texture::read(IResource* resource, AssetObjectM& assetObjects, JobGroup* jobs)
 {
     ChunkHeader textureHeader( resource );
     if( textureHeader.type != BA_TEXTURE ) throw Exception( "Unexpected chunk header" );
@@ -684,7 +947,23 @@ AssetObjectT Texture::read(IResource* resource, AssetObjectM& assetObjects)
     path += chunk.name;
     path += ".dds";
 
-    Texture* texture = Texture::createTexture( path.c_str(), false );
+    Texture* texture = NULL;
+    if( jobs && Engine::instance->jobPool )
+    {
+        // texture is registered at once, its contents are ready to upload after jobs->wait()
+        _chain( texture = new Texture );
+        texture->_textureType = ttManaged;
+        texture->_name = getTextureNameFromFilePath( path.c_str() );
+        textures.insert( TextureT( texture->_name.c_str(), texture ) );
+        Engine::instance->jobPool->submit( 
+            new TextureDecodeJob( texture, getCore()->getResource( path.c_str(), "rb" ), path.c_str() ), 
+            jobs 
+        );
+    }
+    else
+    {
+        texture = Texture::createTexture( path.c_str(), false );
+    }
 
     texture->_addressTypeU  = chunk.addresTypeU;
     texture->_addressTypeV  = chunk.addresTypeV;
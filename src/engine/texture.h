@@ -12,6 +12,7 @@
 
 #include "headers.h"
 #include "engine.h"
+#include "jobs.h"
 
 /**
  * ITexture implementation
@@ -19,6 +20,36 @@
 
 class Texture;
 
+/**
+ * DDS contents prepared by job pool worker: surface levels are located
+ * within resource data, the thread that owns DirectX objects only creates
+ * texture & copies levels in
+ */
+
+struct TextureImage
+{
+public:
+    IResource*        resource;
+    std::vector<BYTE> buffer;       // resource contents, if resource isn't memory-resident
+    const BYTE*       data;
+    unsigned int      size;
+    bool              isCubeMap;
+    D3DFORMAT         format;       // D3DFMT_UNKNOWN, if file should be decoded by D3DX
+    unsigned int      width;
+    unsigned int      height;
+    unsigned int      numLevels;
+    unsigned int      blockSize;    // bytes per 4x4 block of DXT formats, 0 for others
+    unsigned int      bitsPerPixel;
+    const BYTE*       pixels;       // faces major, levels minor
+public:
+    TextureImage(IResource* resource);
+    ~TextureImage();
+public:
+    void parse(void);
+    unsigned int getRowSize(unsigned int level);
+    unsigned int getNumRows(unsigned int level);
+};
+
 typedef std::pair<std::string,Texture*> TextureT;
 typedef std::map<std::string,Texture*> TextureM;
 typedef TextureM::iterator TextureI;
@@ -71,8 +102,10 @@ private:
     int                    _lostableWidth;
     int                    _lostableHeight;
     int                    _lostableDepth;
+    TextureImage*          _image;   // decoded, but not yet uploaded in DirectX objects
 private:
     Texture();
+    void uploadLevels(TextureImage* image);
 public:
     // class implementation
     static Texture* createDynamicTexture(int width, int height, int depth, const char* name);
@@ -80,6 +113,10 @@ public:
     static Texture* createCubeRenderTarget(int size, int depth, const char* name);
     static Texture* createTexture(const char* fileName, bool keepFullName);
     virtual ~Texture();
+    // decodes resource contents & takes ownership of resource, safe to call from job pool thread
+    void decode(IResource* resource);
+    // creates DirectX objects from decoded contents, should be called by device owner thread
+    void upload(void);
     // Lostable
     virtual void onLostDevice(void);
     virtual void onResetDevice(void);
@@ -123,7 +160,7 @@ public:
     // module locals
     D3DFORMAT getFormat(void);
     void write(IResource* resource);
-    static AssetObjectT read(IResource* resource, AssetObjectM& assetObjects);
+    static AssetObjectT read(IResource* resource, AssetObjectM& assetObjects, JobGroup* jobs = NULL);
 public:
     // module locals : texture sampler
     inline void apply(int stageId)
@@ -39,70 +39,80 @@ static engine::IFrame* findRootCB(engine::IFrame* frame, void* data)
 
 engine::IAtomic* CanopySimulator::getCollisionGeometry(engine::IClump* clump)
 {
-    engine::IFrame* frame = Gameplay::iEngine->findFrame( clump->getFrame(), "CollisionGeometry_child0" ); assert( frame );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "CollisionGeometry_child0" );
+    engine::IFrame* frame = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ); assert( frame );
     engine::IAtomic* collisionGeometryA = Gameplay::iEngine->getAtomic( clump, frame ); assert( collisionGeometryA );    
     return collisionGeometryA;
 }
 
 engine::IFrame* CanopySimulator::getPhysicsJointFrontLeft(engine::IClump* clump)
 {
-    engine::IFrame* physicsJointFrontLeft = Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointFrontLeft" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointFrontLeft" );
+    engine::IFrame* physicsJointFrontLeft = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( physicsJointFrontLeft );    
     return physicsJointFrontLeft;
 }
 
 engine::IFrame* CanopySimulator::getPhysicsJointFrontRight(engine::IClump* clump)
 {
-    engine::IFrame* physicsJointFrontRight = Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointFrontRight" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointFrontRight" );
+    engine::IFrame* physicsJointFrontRight = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( physicsJointFrontRight );    
     return physicsJointFrontRight;
 }
 
 engine::IFrame* CanopySimulator::getPhysicsJointRearLeft(engine::IClump* clump)
 {
-    engine::IFrame* physicsJointRearLeft = Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointRearLeft" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointRearLeft" );
+    engine::IFrame* physicsJointRearLeft = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( physicsJointRearLeft );    
     return physicsJointRearLeft;
 }
 
 engine::IFrame* CanopySimulator::getPhysicsJointRearRight(engine::IClump* clump)
 {
-    engine::IFrame* physicsJointRearRight = Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointRearRight" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointRearRight" );
+    engine::IFrame* physicsJointRearRight = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( physicsJointRearRight );    
     return physicsJointRearRight;
 }
 
 engine::IFrame* CanopySimulator::getPilotCordJoint(engine::IClump* clump)
-{    
-    engine::IFrame* pilotCordJoint = Gameplay::iEngine->findFrame( clump->getFrame(), "PilotCordJoint" );
+{
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PilotCordJoint" );
+    engine::IFrame* pilotCordJoint = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( pilotCordJoint );    
     return pilotCordJoint;
 }
 
 engine::IFrame* CanopySimulator::getSliderJointFrontLeft(engine::IClump* clump)
 {
-    engine::IFrame* sliderJointFrontLeft = Gameplay::iEngine->findFrame( clump->getFrame(), "FL" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "FL" );
+    engine::IFrame* sliderJointFrontLeft = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( sliderJointFrontLeft );    
     return sliderJointFrontLeft;
 }
 
 engine::IFrame* CanopySimulator::getSliderJointFrontRight(engine::IClump* clump)
 {
-    engine::IFrame* sliderJointFrontRight = Gameplay::iEngine->findFrame( clump->getFrame(), "FR" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "FR" );
+    engine::IFrame* sliderJointFrontRight = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( sliderJointFrontRight );    
     return sliderJointFrontRight;
 }
 
 engine::IFrame* CanopySimulator::getSliderJointRearLeft(engine::IClump* clump)
 {
-    engine::IFrame* sliderJointRearLeft = Gameplay::iEngine->findFrame( clump->getFrame(), "RL" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "RL" );
+    engine::IFrame* sliderJointRearLeft = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( sliderJointRearLeft );    
     return sliderJointRearLeft;
 }
 
 engine::IFrame* CanopySimulator::getSliderJointRearRight(engine::IClump* clump)
 {
-    engine::IFrame* sliderJointRearRight = Gameplay::iEngine->findFrame( clump->getFrame(), "RR" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "RR" );
+    engine::IFrame* sliderJointRearRight = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( sliderJointRearRight );    
     return sliderJointRearRight;
 }
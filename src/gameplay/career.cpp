@@ -11,6 +11,34 @@
 #include "bitfield.h"
 #include "../shared/ccor.h"
 
+/**
+ * record serialization helpers
+ */
+
+static void writeRecordString(std::string& out, const char* value)
+{
+    unsigned int length = strlen( value );
+    out.append( reinterpret_cast<const char*>( &length ), sizeof(unsigned int) );
+    out.append( value, length );
+}
+
+static bool readRecordValue(const std::string& in, unsigned int& offset, unsigned int& value)
+{
+    if( offset + sizeof(unsigned int) > in.size() ) return false;
+    memcpy( &value, in.data() + offset, sizeof(unsigned int) );
+    offset += sizeof(unsigned int);
+    return true;
+}
+
+static bool readRecordString(const std::string& in, unsigned int& offset, std::string& value)
+{
+    unsigned int length;
+    if( !readRecordValue( in, offset, length ) || length > in.size() - offset ) return false;
+    value = in.substr( offset, length );
+    offset += length;
+    return true;
+}
+
 /**
  * class implementation
  */
@@ -166,6 +194,100 @@ Career::Career(TiXmlElement* node)
     initializeWalkthroughMeter();
 }
 
+Career::Career(const char* name, CareerRecords& records)
+{
+    _name = name;
+
+    _isHomeDefined = false;
+    _homeX = _homeY = 0;
+    _eventCallback = NULL;
+    _eventCallbackData = NULL;
+
+    for( unsigned int i=0; i<records.size(); i++ )
+    {
+        std::string& data = records[i].data;
+        bool isValid = true;
+        switch( records[i].type )
+        {
+        case crtHome:
+            {
+                int home[3];
+                isValid = ( data.size() == sizeof(home) );
+                if( isValid )
+                {
+                    memcpy( home, data.data(), sizeof(home) );
+                    _isHomeDefined = ( home[0] != 0 );
+                    _homeX = home[1];
+                    _homeY = home[2];
+                }
+            }
+            break;
+        case crtVirtues:
+            isValid = ( data.size() == sizeof(Virtues) );
+            if( isValid )
+            {
+                memcpy( &_virtues, data.data(), sizeof(Virtues) );
+                _virtues.equipment.suit.updateIdFromName();
+                _virtues.equipment.canopy.updateIdFromName();
+                _virtues.equipment.rig.updateIdFromName();
+                _virtues.equipment.helmet.updateIdFromName();
+            }
+            break;
+        case crtGears:
+            isValid = ( data.size() % sizeof(Gear) == 0 );
+            for( unsigned int j=0; isValid && j<data.size() / sizeof(Gear); j++ )
+            {
+                Gear gear;
+                memcpy( &gear, data.data() + j * sizeof(Gear), sizeof(Gear) );
+                addGear( gear );
+            }
+            break;
+        case crtEvents:
+            {
+                // events are restored from their XML attributes
+                unsigned int offset = 0;
+                unsigned int numAttributes;
+                std::string attributeName, attributeValue;
+                while( isValid && offset < data.size() )
+                {
+                    TiXmlElement eventElement( "event" );
+                    isValid = readRecordValue( data, offset, numAttributes );
+                    for( unsigned int j=0; isValid && j<numAttributes; j++ )
+                    {
+                        isValid = readRecordString( data, offset, attributeName ) &&
+                                  readRecordString( data, offset, attributeValue );
+                        if( isValid ) eventElement.SetAttribute( attributeName.c_str(), attributeValue.c_str() );
+                    }
+                    isValid = isValid && eventElement.Attribute( "class" ) != NULL;
+                    if( isValid )
+                    {
+                        Event* event = Event::createFromXml( this, &eventElement );
+                        assert( event );
+                        _events.push_back( event );
+                    }
+                }
+            }
+            break;
+        case crtGameData:
+            {
+                GameData* gameData = new GameData( data.size() );
+                if( data.size() ) memcpy( gameData->getData(), data.data(), data.size() );
+                _gameDataM.insert( GameDataT( records[i].name, gameData ) );
+            }
+            break;
+        default:
+            isValid = false;
+        }
+        if( !isValid )
+        {
+            throw ccor::Exception( "User database entry corrupted: \"%s\"! Cheating not allowed!", _name.c_str() );
+        }
+    }
+
+    // initialize game walk-through meter
+    initializeWalkthroughMeter();
+}
+
 Career::~Career()
 {
     // remove game data
@@ -286,81 +408,61 @@ void Career::setHome(int homeX, int homeY)
     _homeY = homeY;
 }
     
-void Career::save(TiXmlDocument* xmlDocument)
+void Career::save(CareerRecords& records)
 {
-    unsigned int i;
-    std::string data;
+    CareerRecord record;
 
-    // create career node
-    TiXmlElement* careerElement = new TiXmlElement( "career" );
-    careerElement->SetAttribute( "name", _name.c_str() );
+    // save home
+    int home[3] = { _isHomeDefined ? 1 : 0, _homeX, _homeY };
+    record.type = crtHome;
+    record.data.assign( reinterpret_cast<const char*>( home ), sizeof(home) );
+    records.push_back( record );
 
-    // create virtues node        
-    TiXmlElement* virtuesElement = new TiXmlElement( "virtues" );
-    virtuesElement->SetAttribute( "checksum", checksum( &_virtues, sizeof(Virtues) ) );
-    encrypt( data, &_virtues, sizeof(Virtues), _name.c_str() );
-    virtuesElement->SetAttribute( "data", data.c_str() );
-    careerElement->InsertEndChild( *virtuesElement );
-    delete virtuesElement;
+    // save virtues
+    record.type = crtVirtues;
+    record.data.assign( reinterpret_cast<const char*>( &_virtues ), sizeof(Virtues) );
+    records.push_back( record );
 
     // save gears
-    TiXmlElement* gearsGroupElement = new TiXmlElement( "gears" );
-    for( i=0; i<_gears.size(); i++ )
-    {
-        Gear gear = _gears[i];
-        TiXmlElement* gearElement = new TiXmlElement( "gear" );
-        gearElement->SetAttribute( "checksum", checksum( &gear, sizeof(Gear) ) );
-        encrypt( data, &gear, sizeof(Gear), _name.c_str() );
-        gearElement->SetAttribute( "data", data.c_str() );
-        gearsGroupElement->InsertEndChild( *gearElement );
-        delete gearElement;
-    }
-    careerElement->InsertEndChild( *gearsGroupElement );
-    delete gearsGroupElement;
-
-    // save home
-    if( _isHomeDefined )
+    record.type = crtGears;
+    record.data.erase();
+    if( _gears.size() ) record.data.assign( reinterpret_cast<const char*>( &_gears[0] ), _gears.size() * sizeof(Gear) );
+    records.push_back( record );
+
+    // save events, as attributes of their XML elements
+    record.type = crtEvents;
+    record.data.erase();
+    TiXmlElement eventsGroup( "events" );
+    for( unsigned int i=0; i<_events.size(); i++ )
     {
-        TiXmlElement* homeElement = new TiXmlElement( "home" );
-        homeElement->SetAttribute( "x", _homeX );
-        homeElement->SetAttribute( "y", _homeY );
-        careerElement->InsertEndChild( *homeElement );
-        delete homeElement;
+        _events[i]->saveToXml( &eventsGroup );
     }
-
-    // save events
-    if( _events.size() )
+    for( TiXmlElement* eventElement = eventsGroup.FirstChildElement();
+                       eventElement != NULL;
+                       eventElement = eventElement->NextSiblingElement() )
     {
-        TiXmlElement eventsGroup( "events" );
-        for( unsigned int i=0; i<_events.size(); i++ )
+        unsigned int numAttributes = 0;
+        TiXmlAttribute* attribute;
+        for( attribute = eventElement->FirstAttribute(); attribute; attribute = attribute->Next() ) numAttributes++;
+        record.data.append( reinterpret_cast<const char*>( &numAttributes ), sizeof(unsigned int) );
+        for( attribute = eventElement->FirstAttribute(); attribute; attribute = attribute->Next() )
         {
-            _events[i]->saveToXml( &eventsGroup );
+            writeRecordString( record.data, attribute->Name() );
+            writeRecordString( record.data, attribute->Value() );
         }
-        careerElement->InsertEndChild( eventsGroup );
-    }    
+    }
+    records.push_back( record );
 
     // save game data
-    if( _gameDataM.size() )
+    record.type = crtGameData;
+    for( GameDataI gameDataI = _gameDataM.begin();
+                   gameDataI != _gameDataM.end();
+                   gameDataI++ )
     {
-        TiXmlElement gameDataGroup( "gamedata" );
-        for( GameDataI gameDataI = _gameDataM.begin();
-                       gameDataI != _gameDataM.end();
-                       gameDataI++ )
-        {
-            int cs = ::checksum( gameDataI->second->getData(), gameDataI->second->getSize() );
-            std::string data;
-            ::encrypt( data, gameDataI->second->getData(), gameDataI->second->getSize(), _name.c_str() );
-            TiXmlElement entryElement( "entry" );
-            entryElement.SetAttribute( "name", gameDataI->first.c_str() );
-            entryElement.SetAttribute( "checksum", cs );
-            entryElement.SetAttribute( "data", data.c_str() );
-            gameDataGroup.InsertEndChild( entryElement );
-        }
-        careerElement->InsertEndChild( gameDataGroup );
+        record.name = gameDataI->first;
+        record.data.assign( reinterpret_cast<const char*>( gameDataI->second->getData() ), gameDataI->second->getSize() );
+        records.push_back( record );
     }
-
-    xmlDocument->InsertEndChild( *careerElement );
-    delete careerElement;
 }
 
 /**
@@ -135,6 +135,28 @@ enum Acrobatics
     acroReserved25    = 0x80000000
 };
 
+/**
+ * career record, unit of incremental career storage (see CareerStore)
+ */
+
+enum CareerRecordType
+{
+    crtHome     = 1, // home flag & coordinates
+    crtVirtues  = 2, // virtues structure
+    crtGears    = 3, // array of gears
+    crtEvents   = 4, // attributes of serialized events
+    crtGameData = 5  // game data entry (record name is entry name)
+};
+
+struct CareerRecord
+{
+    unsigned char type;
+    std::string   name;
+    std::string   data;
+};
+
+typedef std::vector<CareerRecord> CareerRecords;
+
 typedef void (*EventCallback)(Event* event, void* data);
 
 class Career
@@ -160,6 +182,7 @@ public:
     // class implementation
     Career(const char* name);
     Career(TiXmlElement* node);
+    Career(const char* name, CareerRecords& records);
     virtual ~Career();
 public:
     // career properties
@@ -189,7 +212,7 @@ public:
 public:
     // career management
     void setHome(int homeX, int homeY);
-    void save(TiXmlDocument* xmlDocument);
+    void save(CareerRecords& records);
 public:
     // career walk-through management
     float getWalkthroughPercent(void);
@@ -0,0 +1,397 @@
+
+#include "headers.h"
+#include "careerstore.h"
+#include "crypt.h"
+#include "../shared/ccor.h"
+#include "../ccor/zlib/zlib.h"
+#include <io.h>
+
+/**
+ * store file layout
+ */
+
+enum StoreRecordType
+{
+    srtRemove = 0x80, // career is removed
+    srtCommit = 0x81  // end of transaction
+};
+
+struct StoreHeader
+{
+    unsigned int magic;
+    unsigned int version;
+};
+
+struct StoreRecordHeader
+{
+    unsigned int   checksum;     // crc32 of the rest of header and record body
+    unsigned int   dataSize;     // record body is: career name, record name, data
+    unsigned char  type;
+    unsigned char  reserved;
+    unsigned short careerLength;
+    unsigned short nameLength;
+    unsigned short padding;
+};
+
+struct StoreOperation
+{
+    std::string  career;
+    CareerRecord record;
+};
+
+typedef std::map<std::string, CareerRecord> LoadedRecords;
+typedef LoadedRecords::iterator LoadedRecordI;
+typedef std::map<std::string, LoadedRecords> LoadedCareers;
+
+/**
+ * file routines
+ */
+
+static std::string getRecordKey(const CareerRecord& record)
+{
+    // record types are ordered as career expects them
+    return std::string( 1, char( record.type ) ) + record.name;
+}
+
+static unsigned int getRecordChecksum(const CareerRecord& record)
+{
+    uLong crc = crc32( 0L, Z_NULL, 0 );
+    if( record.data.size() )
+    {
+        crc = crc32( crc, reinterpret_cast<const Bytef*>( record.data.data() ), record.data.size() );
+    }
+    return crc;
+}
+
+static unsigned int getFileSize(FILE* file)
+{
+    fseek( file, 0, SEEK_END );
+    unsigned int size = ftell( file );
+    fseek( file, 0, SEEK_SET );
+    return size;
+}
+
+static bool flushFile(FILE* file)
+{
+    // data should reach the disk before the next file operation
+    return fflush( file ) == 0 && _commit( _fileno( file ) ) == 0;
+}
+
+static bool writeHeader(FILE* file)
+{
+    StoreHeader header;
+    header.magic   = CAREER_STORE_MAGIC;
+    header.version = CAREER_STORE_VERSION;
+    return fwrite( &header, sizeof(StoreHeader), 1, file ) == 1;
+}
+
+static bool writeRecord(FILE* file, unsigned char type, const std::string& career, const std::string& name, const std::string& data, unsigned int& size)
+{
+    assert( career.size() < 0x10000 && name.size() < 0x10000 );
+
+    // record data is scrambled with career name, as XML entries were
+    std::string body = career + name + data;
+    if( data.size() ) scramble( &body[career.size() + name.size()], data.size(), career.c_str() );
+
+    StoreRecordHeader header;
+    header.dataSize     = data.size();
+    header.type         = type;
+    header.reserved     = 0;
+    header.careerLength = career.size();
+    header.nameLength   = name.size();
+    header.padding      = 0;
+    uLong crc = crc32( 0L, Z_NULL, 0 );
+    crc = crc32( crc, reinterpret_cast<const Bytef*>( &header.dataSize ), sizeof(StoreRecordHeader) - sizeof(unsigned int) );
+    if( body.size() ) crc = crc32( crc, reinterpret_cast<const Bytef*>( body.data() ), body.size() );
+    header.checksum = crc;
+
+    if( fwrite( &header, sizeof(StoreRecordHeader), 1, file ) != 1 ) return false;
+    if( body.size() && fwrite( body.data(), body.size(), 1, file ) != 1 ) return false;
+    size += sizeof(StoreRecordHeader) + body.size();
+    return true;
+}
+
+static void applyOperation(StoreOperation& operation, LoadedCareers& careers, std::vector<std::string>& order)
+{
+    LoadedCareers::iterator careerI = careers.find( operation.career );
+    if( operation.record.type == srtRemove )
+    {
+        if( careerI != careers.end() )
+        {
+            careers.erase( careerI );
+            order.erase( std::find( order.begin(), order.end(), operation.career ) );
+        }
+        return;
+    }
+    if( careerI == careers.end() )
+    {
+        order.push_back( operation.career );
+        careerI = careers.insert( LoadedCareers::value_type( operation.career, LoadedRecords() ) ).first;
+    }
+    careerI->second[getRecordKey( operation.record )] = operation.record;
+}
+
+/**
+ * reads store file, applying committed transactions
+ * @return size of committed part of the file, 0 if file has no valid header
+ */
+
+static unsigned int readStore(FILE* file, unsigned int fileSize, LoadedCareers& careers, std::vector<std::string>& order)
+{
+    StoreHeader header;
+    if( fread( &header, sizeof(StoreHeader), 1, file ) != 1 ||
+        header.magic != CAREER_STORE_MAGIC ||
+        header.version != CAREER_STORE_VERSION )
+    {
+        return 0;
+    }
+
+    unsigned int size = sizeof(StoreHeader);
+    unsigned int committedSize = size;
+    std::vector<StoreOperation> transaction;
+    StoreRecordHeader recordHeader;
+    std::string body;
+    while( fread( &recordHeader, sizeof(StoreRecordHeader), 1, file ) == 1 )
+    {
+        // torn or damaged record ends the file
+        unsigned int bodySize = recordHeader.careerLength + recordHeader.nameLength + recordHeader.dataSize;
+        if( recordHeader.dataSize > fileSize || size + sizeof(StoreRecordHeader) + bodySize > fileSize ) break;
+        body.resize( bodySize );
+        if( bodySize && fread( &body[0], bodySize, 1, file ) != 1 ) break;
+        uLong crc = crc32( 0L, Z_NULL, 0 );
+        crc = crc32( crc, reinterpret_cast<const Bytef*>( &recordHeader.dataSize ), sizeof(StoreRecordHeader) - sizeof(unsigned int) );
+        if( bodySize ) crc = crc32( crc, reinterpret_cast<const Bytef*>( body.data() ), bodySize );
+        if( crc != recordHeader.checksum ) break;
+        size += sizeof(StoreRecordHeader) + bodySize;
+
+        if( recordHeader.type == srtCommit )
+        {
+            for( unsigned int i=0; i<transaction.size(); i++ )
+            {
+                applyOperation( transaction[i], careers, order );
+            }
+            transaction.clear();
+            committedSize = size;
+            continue;
+        }
+
+        StoreOperation operation;
+        operation.career = body.substr( 0, recordHeader.careerLength );
+        operation.record.type = recordHeader.type;
+        operation.record.name = body.substr( recordHeader.careerLength, recordHeader.nameLength );
+        operation.record.data = body.substr( recordHeader.careerLength + recordHeader.nameLength );
+        if( operation.record.data.size() )
+        {
+            unscramble( &operation.record.data[0], operation.record.data.size(), operation.career.c_str() );
+        }
+        transaction.push_back( operation );
+    }
+    return committedSize;
+}
+
+/**
+ * class implementation
+ */
+
+CareerStore::CareerStore(const char* fileName)
+{
+    _snapshotName = fileName; _snapshotName += ".dat";
+    _journalName  = fileName; _journalName  += ".jnl";
+    _tempName     = fileName; _tempName     += ".tmp";
+    _snapshotSize = 0;
+    _journalSize  = 0;
+}
+
+void CareerStore::resetJournal(void)
+{
+    FILE* file = fopen( _journalName.c_str(), "wb" );
+    if( !file ) throw ccor::Exception( "Cannot create career journal \"%s\"", _journalName.c_str() );
+    bool isWritten = writeHeader( file ) && flushFile( file );
+    fclose( file );
+    if( !isWritten ) throw ccor::Exception( "Cannot write career journal \"%s\"", _journalName.c_str() );
+    _journalSize = sizeof(StoreHeader);
+}
+
+void CareerStore::truncateJournal(void)
+{
+    // drop partially written records, so next save() appends after committed ones
+    FILE* file = fopen( _journalName.c_str(), "r+b" );
+    if( !file ) return;
+    _chsize( _fileno( file ), _journalSize );
+    fclose( file );
+}
+
+bool CareerStore::load(std::vector<Career*>& careers)
+{
+    LoadedCareers loadedCareers;
+    std::vector<std::string> order;
+    unsigned int fileSize;
+
+    // read snapshot
+    FILE* file = fopen( _snapshotName.c_str(), "rb" );
+    if( file )
+    {
+        fileSize = getFileSize( file );
+        _snapshotSize = readStore( file, fileSize, loadedCareers, order );
+        fclose( file );
+        if( _snapshotSize != fileSize )
+        {
+            throw ccor::Exception( "User database corrupted: \"%s\"! Cheating not allowed!", _snapshotName.c_str() );
+        }
+    }
+    else
+    {
+        // compaction may be interrupted after old snapshot was removed,
+        // temporary snapshot is complete if it's fully committed
+        file = fopen( _tempName.c_str(), "rb" );
+        if( !file ) return false;
+        fileSize = getFileSize( file );
+        _snapshotSize = readStore( file, fileSize, loadedCareers, order );
+        fclose( file );
+        if( _snapshotSize != fileSize || _snapshotSize == sizeof(StoreHeader) ) return false;
+        if( !MoveFile( _tempName.c_str(), _snapshotName.c_str() ) )
+        {
+            throw ccor::Exception( "Cannot restore career store \"%s\"", _snapshotName.c_str() );
+        }
+    }
+
+    // replay journal, dropping its uncommitted tail
+    _journalSize = 0;
+    file = fopen( _journalName.c_str(), "r+b" );
+    if( file )
+    {
+        fileSize = getFileSize( file );
+        _journalSize = readStore( file, fileSize, loadedCareers, order );
+        if( _journalSize && _journalSize < fileSize ) _chsize( _fileno( file ), _journalSize );
+        fclose( file );
+    }
+    if( !_journalSize ) resetJournal();
+
+    // create careers & remember committed state of their records
+    _careerStates.clear();
+    for( unsigned int i=0; i<order.size(); i++ )
+    {
+        LoadedRecords& loadedRecords = loadedCareers[order[i]];
+        RecordStates& recordStates = _careerStates[order[i]];
+        CareerRecords records;
+        for( LoadedRecordI recordI = loadedRecords.begin();
+                           recordI != loadedRecords.end();
+                           recordI++ )
+        {
+            RecordState state;
+            state.checksum = getRecordChecksum( recordI->second );
+            state.size     = recordI->second.data.size();
+            recordStates[recordI->first] = state;
+            records.push_back( recordI->second );
+        }
+        careers.push_back( new Career( order[i].c_str(), records ) );
+    }
+    return true;
+}
+
+void CareerStore::save(std::vector<Career*>& careers)
+{
+    FILE* file = fopen( _journalName.c_str(), "r+b" );
+    if( !file ) throw ccor::Exception( "Cannot open career journal \"%s\"", _journalName.c_str() );
+    fseek( file, _journalSize, SEEK_SET );
+
+    // append changed records
+    CareerStates careerStates;
+    unsigned int size = 0;
+    bool isWritten = true;
+    for( unsigned int i=0; isWritten && i<careers.size(); i++ )
+    {
+        std::string careerName = careers[i]->getName();
+        CareerRecords records;
+        careers[i]->save( records );
+        RecordStates& committedStates = _careerStates[careerName];
+        RecordStates& recordStates = careerStates[careerName];
+        for( unsigned int j=0; isWritten && j<records.size(); j++ )
+        {
+            std::string key = getRecordKey( records[j] );
+            RecordState state;
+            state.checksum = getRecordChecksum( records[j] );
+            state.size     = records[j].data.size();
+            recordStates[key] = state;
+            RecordStateI committedI = committedStates.find( key );
+            if( committedI == committedStates.end() ||
+                committedI->second.checksum != state.checksum ||
+                committedI->second.size != state.size )
+            {
+                isWritten = writeRecord( file, records[j].type, careerName, records[j].name, records[j].data, size );
+            }
+        }
+    }
+
+    // remove deleted careers
+    for( CareerStateI careerStateI = _careerStates.begin();
+                      isWritten && careerStateI != _careerStates.end();
+                      careerStateI++ )
+    {
+        if( careerStates.find( careerStateI->first ) == careerStates.end() )
+        {
+            isWritten = writeRecord( file, srtRemove, careerStateI->first, "", "", size );
+        }
+    }
+
+    // commit
+    if( isWritten && size )
+    {
+        isWritten = writeRecord( file, srtCommit, "", "", "", size ) && flushFile( file );
+    }
+    fclose( file );
+    if( !isWritten )
+    {
+        truncateJournal();
+        throw ccor::Exception( "Cannot write career journal \"%s\"", _journalName.c_str() );
+    }
+    _journalSize += size;
+    _careerStates = careerStates;
+
+    if( _journalSize > CAREER_JOURNAL_LIMIT && _journalSize > _snapshotSize ) compact( careers );
+}
+
+void CareerStore::compact(std::vector<Career*>& careers)
+{
+    // write new snapshot aside
+    FILE* file = fopen( _tempName.c_str(), "wb" );
+    if( !file ) throw ccor::Exception( "Cannot create career store \"%s\"", _tempName.c_str() );
+
+    CareerStates careerStates;
+    unsigned int size = sizeof(StoreHeader);
+    bool isWritten = writeHeader( file );
+    for( unsigned int i=0; isWritten && i<careers.size(); i++ )
+    {
+        std::string careerName = careers[i]->getName();
+        CareerRecords records;
+        careers[i]->save( records );
+        RecordStates& recordStates = careerStates[careerName];
+        for( unsigned int j=0; isWritten && j<records.size(); j++ )
+        {
+            RecordState state;
+            state.checksum = getRecordChecksum( records[j] );
+            state.size     = records[j].data.size();
+            recordStates[getRecordKey( records[j] )] = state;
+            isWritten = writeRecord( file, records[j].type, careerName, records[j].name, records[j].data, size );
+        }
+    }
+    isWritten = isWritten && writeRecord( file, srtCommit, "", "", "", size ) && flushFile( file );
+    fclose( file );
+    if( !isWritten ) throw ccor::Exception( "Cannot write career store \"%s\"", _tempName.c_str() );
+
+    // replace snapshot, journal replayed over new snapshot gives the same state,
+    // so crash before journal is reset is harmless
+    if( !MoveFileEx( _tempName.c_str(), _snapshotName.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH ) )
+    {
+        // Win9x has no MoveFileEx, load() picks up temporary snapshot if we die here
+        DeleteFile( _snapshotName.c_str() );
+        if( !MoveFile( _tempName.c_str(), _snapshotName.c_str() ) )
+        {
+            throw ccor::Exception( "Cannot replace career store \"%s\"", _snapshotName.c_str() );
+        }
+    }
+    _snapshotSize = size;
+    _careerStates = careerStates;
+
+    resetJournal();
+}
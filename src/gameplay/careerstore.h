@@ -0,0 +1,58 @@
+
+#ifndef CAREER_STORE_INCLUDED
+#define CAREER_STORE_INCLUDED
+
+#include "headers.h"
+#include "career.h"
+
+/**
+ * binary career store:
+ * snapshot file is followed by append-only journal of changed career records,
+ * records are checksummed and applied in transactions terminated by commit record,
+ * so torn write at the end of journal loses only last (uncommitted) save
+ */
+
+#define CAREER_STORE_MAGIC   0x53524143 // "CARS"
+#define CAREER_STORE_VERSION 1
+#define CAREER_JOURNAL_LIMIT 65536      // journal size that causes compaction
+
+class CareerStore
+{
+private:
+    struct RecordState
+    {
+        unsigned int checksum;
+        unsigned int size;
+    };
+    typedef std::map<std::string, RecordState> RecordStates;
+    typedef RecordStates::iterator RecordStateI;
+    typedef std::map<std::string, RecordStates> CareerStates;
+    typedef CareerStates::iterator CareerStateI;
+private:
+    std::string  _snapshotName;
+    std::string  _journalName;
+    std::string  _tempName;
+    CareerStates _careerStates;  // committed state of records
+    unsigned int _snapshotSize;
+    unsigned int _journalSize;
+private:
+    void resetJournal(void);
+    void truncateJournal(void);
+public:
+    CareerStore(const char* fileName);
+public:
+    /**
+     * loads careers, returns false if there is no store on the disk
+     */
+    bool load(std::vector<Career*>& careers);
+    /**
+     * appends records changed since last save to journal
+     */
+    void save(std::vector<Career*>& careers);
+    /**
+     * rewrites snapshot with all careers & empties journal
+     */
+    void compact(std::vector<Career*>& careers);
+};
+
+#endif
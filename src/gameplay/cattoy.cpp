@@ -1,6 +1,7 @@
 
 #include "headers.h"
 #include "jumper.h"
+#include "../ccor/zlib/zlib.h"
 
 
 struct OldGear {
@@ -136,16 +137,30 @@ public:
 };
 
 /**
- * save ghost cat toy (telemetry builder)
+ * ghost telemetry format
+ *
+ * version 1 files are a raw array of GhostState records following the header.
+ * version 2 files split state frames into blocks of ghostBlockFrames frames,
+ * each block starts with a keyframe and is deflated independently, so player
+ * seeks by block index and keeps no more than two decoded blocks in memory.
+ * inside the block times and positions are quantized and delta-encoded,
+ * rotations are stored as smallest-three quaternions
  */
 
-const float ghostFrameRate = 0.1f;
+const float        ghostFrameRate        = 0.1f;
+const unsigned int ghostMagic            = 0x30313233;
+const unsigned int ghostVersion          = 2;
+const unsigned int ghostBlockFrames      = 128;
+const float        ghostTimeSteps        = 10000.0f; // time quantization, steps per second
+const float        ghostPositionSteps    = 10.0f;    // position quantization, steps per centimeter
+const float        ghostRotationSteps    = 32767.0f; // quaternion component quantization
+const unsigned int ghostBlockNotLoaded   = 0xFFFFFFFF;
 
 struct NewGhostHeader
 {
 public:
     unsigned int magic;     // 0x30313233
-    unsigned int version;   // 1
+    unsigned int version;   // 1 - raw state frames, 2 - compressed blocks
     unsigned int numFrames; // number of ghost state frames    
     Matrix4f     jumpPose;  // jump pose of ghost (it is unique for entire telemetry)
     Virtues      virtues;   // ghost virtues 
@@ -159,6 +174,24 @@ public:
     OldVirtues   virtues;   // ghost virtues 
 };
 
+struct GhostStreamHeader
+{
+public:
+    unsigned int numBlocks;   // number of blocks
+    unsigned int blockFrames; // number of state frames per block
+    unsigned int indexOffset; // file offset of block index
+    float        timeToJump;  // time of first non-roaming frame (or negative value)
+};
+
+struct GhostBlock
+{
+public:
+    float        time;       // time of block keyframe
+    unsigned int offset;     // file offset of block data
+    unsigned int packedSize; // size of deflated block data (0 for raw version 1 frames)
+    unsigned int size;       // size of inflated block data
+};
+
 struct GhostState
 {
 public:
@@ -168,15 +201,271 @@ public:
     Matrix4f    currentPose; // current basejumper position
 };
 
+/**
+ * ghost block encoding
+ */
+
+static inline int quantizeGhostValue(float value, float steps)
+{
+    return int( floor( value * steps + 0.5f ) );
+}
+
+static void writeGhostValue(std::vector<unsigned char>& data, int value)
+{
+    // zigzag varint
+    unsigned int bits = ( unsigned int( value ) << 1 ) ^ unsigned int( value >> 31 );
+    while( bits >= 0x80 )
+    {
+        data.push_back( unsigned char( bits | 0x80 ) );
+        bits >>= 7;
+    }
+    data.push_back( unsigned char( bits ) );
+}
+
+static bool readGhostValue(const unsigned char*& data, const unsigned char* end, int& value)
+{
+    unsigned int bits = 0;
+    for( unsigned int shift = 0; shift < 35; shift += 7 )
+    {
+        if( data == end ) return false;
+        unsigned char byte = *data++;
+        bits |= unsigned int( byte & 0x7F ) << shift;
+        if( !( byte & 0x80 ) )
+        {
+            value = int( bits >> 1 ) ^ -int( bits & 1 );
+            return true;
+        }
+    }
+    return false;
+}
+
+static void packGhostRotation(const Matrix4f& pose, unsigned int& largest, unsigned short* packed)
+{
+    // rotation quaternion of pose
+    float q[4];
+    float trace = pose[0][0] + pose[1][1] + pose[2][2];
+    if( trace > 0.0f )
+    {
+        float s = sqrt( trace + 1.0f );
+        q[3] = s * 0.5f;
+        s = 0.5f / s;
+        q[0] = ( pose[1][2] - pose[2][1] ) * s;
+        q[1] = ( pose[2][0] - pose[0][2] ) * s;
+        q[2] = ( pose[0][1] - pose[1][0] ) * s;
+    }
+    else
+    {
+        unsigned int ix = 0;
+        if( pose[1][1] > pose[0][0] ) ix = 1;
+        if( pose[2][2] > pose[ix][ix] ) ix = 2;
+        unsigned int iy = ( ix + 1 ) % 3;
+        unsigned int iz = ( iy + 1 ) % 3;
+        float s = sqrt( pose[ix][ix] - pose[iy][iy] - pose[iz][iz] + 1.0f );
+        q[ix] = s * 0.5f;
+        if( s != 0.0f ) s = 0.5f / s;
+        q[3]  = ( pose[iy][iz] - pose[iz][iy] ) * s;
+        q[iy] = ( pose[ix][iy] + pose[iy][ix] ) * s;
+        q[iz] = ( pose[ix][iz] + pose[iz][ix] ) * s;
+    }
+    float length = sqrt( q[0]*q[0] + q[1]*q[1] + q[2]*q[2] + q[3]*q[3] );
+    if( length > 0.0f ) length = 1.0f / length;
+
+    // smallest three components, largest one is restored from unit length
+    largest = 0;
+    for( unsigned int i=1; i<4; i++ ) if( fabs( q[i] ) > fabs( q[largest] ) ) largest = i;
+    if( q[largest] < 0 ) length = -length;
+    for( unsigned int i=0, j=0; i<4; i++ )
+    {
+        if( i == largest ) continue;
+        float c = q[i] * length * float( sqrt( 2.0f ) );
+        if( c < -1.0f ) c = -1.0f;
+        if( c > 1.0f ) c = 1.0f;
+        packed[j++] = unsigned short( quantizeGhostValue( c, ghostRotationSteps ) + 32768 );
+    }
+}
+
+static void unpackGhostRotation(unsigned int largest, const unsigned short* packed, Matrix4f& pose)
+{
+    float q[4];
+    float sum = 0.0f;
+    for( unsigned int i=0, j=0; i<4; i++ )
+    {
+        if( i == largest ) continue;
+        q[i] = ( int( packed[j++] ) - 32768 ) / ghostRotationSteps / float( sqrt( 2.0f ) );
+        sum += q[i] * q[i];
+    }
+    q[largest] = sum < 1.0f ? sqrt( 1.0f - sum ) : 0.0f;
+
+    float xx = 2*q[0]*q[0], yy = 2*q[1]*q[1], zz = 2*q[2]*q[2];
+    float xy = 2*q[0]*q[1], xz = 2*q[0]*q[2], yz = 2*q[1]*q[2];
+    float wx = 2*q[3]*q[0], wy = 2*q[3]*q[1], wz = 2*q[3]*q[2];
+    pose[0][0] = 1 - yy - zz, pose[0][1] = xy + wz,     pose[0][2] = xz - wy,     pose[0][3] = 0;
+    pose[1][0] = xy - wz,     pose[1][1] = 1 - xx - zz, pose[1][2] = yz + wx,     pose[1][3] = 0;
+    pose[2][0] = xz + wy,     pose[2][1] = yz - wx,     pose[2][2] = 1 - xx - yy, pose[2][3] = 0;
+}
+
+/**
+ * block layout: streams of zigzag varints, each stream holds one field of
+ * all frames (time, flags, position x/y/z, rotation components), first
+ * frame of the block is delta-encoded against zero, so it is a keyframe
+ */
+
+static void encodeGhostBlock(const GhostState* states, unsigned int numStates, std::vector<unsigned char>& data)
+{
+    unsigned int i, j;
+    data.clear();
+
+    // time
+    int prevTime = 0;
+    for( i=0; i<numStates; i++ )
+    {
+        int time = quantizeGhostValue( states[i].time, ghostTimeSteps );
+        writeGhostValue( data, time - prevTime );
+        prevTime = time;
+    }
+
+    // flags & rotations
+    std::vector<unsigned short> rotations( numStates * 3 );
+    for( i=0; i<numStates; i++ )
+    {
+        unsigned int largest;
+        packGhostRotation( states[i].currentPose, largest, &rotations[i*3] );
+        writeGhostValue( data, int( largest | ( states[i].modifier ? 4 : 0 ) | ( states[i].phase << 3 ) ) );
+    }
+
+    // positions
+    for( j=0; j<3; j++ )
+    {
+        int prevPosition = 0;
+        for( i=0; i<numStates; i++ )
+        {
+            int position = quantizeGhostValue( states[i].currentPose[3][j], ghostPositionSteps );
+            writeGhostValue( data, position - prevPosition );
+            prevPosition = position;
+        }
+    }
+
+    // rotations, deltas are wrapped to 16 bits
+    for( j=0; j<3; j++ )
+    {
+        unsigned short prevRotation = 0;
+        for( i=0; i<numStates; i++ )
+        {
+            writeGhostValue( data, short( rotations[i*3+j] - prevRotation ) );
+            prevRotation = rotations[i*3+j];
+        }
+    }
+}
+
+static bool decodeGhostBlock(const unsigned char* data, unsigned int size, unsigned int numStates, std::vector<GhostState>& states)
+{
+    unsigned int i, j;
+    const unsigned char* end = data + size;
+    int value;
+
+    states.resize( numStates );
+
+    // time
+    int time = 0;
+    for( i=0; i<numStates; i++ )
+    {
+        if( !readGhostValue( data, end, value ) ) return false;
+        time += value;
+        states[i].time = time / ghostTimeSteps;
+    }
+
+    // flags
+    std::vector<unsigned int> largest( numStates );
+    for( i=0; i<numStates; i++ )
+    {
+        if( !readGhostValue( data, end, value ) ) return false;
+        largest[i] = value & 3;
+        states[i].modifier = ( value & 4 ) != 0;
+        states[i].phase = JumperPhase( value >> 3 );
+        states[i].currentPose[3][3] = 1.0f;
+    }
+
+    // positions
+    for( j=0; j<3; j++ )
+    {
+        int position = 0;
+        for( i=0; i<numStates; i++ )
+        {
+            if( !readGhostValue( data, end, value ) ) return false;
+            position += value;
+            states[i].currentPose[3][j] = position / ghostPositionSteps;
+        }
+    }
+
+    // rotations
+    std::vector<unsigned short> rotations( numStates * 3 );
+    for( j=0; j<3; j++ )
+    {
+        unsigned short rotation = 0;
+        for( i=0; i<numStates; i++ )
+        {
+            if( !readGhostValue( data, end, value ) ) return false;
+            rotation = unsigned short( rotation + value );
+            rotations[i*3+j] = rotation;
+        }
+    }
+    for( i=0; i<numStates; i++ )
+    {
+        unpackGhostRotation( largest[i], &rotations[i*3], states[i].currentPose );
+    }
+
+    return data == end;
+}
+
+/**
+ * save ghost cat toy (telemetry builder)
+ */
+
 class CatToySaveGhost : public CatToy
 {
 private:
-    Jumper*        _ghost;
-    NewGhostHeader _ghostHeader;
-    GhostState     _ghostState;
-    float          _ghostTime;
-    float          _ghostFrameTime;
-    FILE*          _file;    
+    Jumper*                    _ghost;
+    NewGhostHeader             _ghostHeader;
+    GhostStreamHeader          _streamHeader;
+    GhostState                 _ghostState;
+    float                      _ghostTime;
+    float                      _ghostFrameTime;
+    std::vector<GhostState>    _blockStates; // frames of block under construction
+    std::vector<GhostBlock>    _blocks;      // block index
+    std::vector<unsigned char> _data;        // encoded block
+    std::vector<unsigned char> _packed;      // deflated block
+    FILE*                      _file;    
+    std::string                _fileName;    // telemetry file
+    bool                       _isFailed;    // recording is stopped due to compression error
+private:
+    void writeBlock(void)
+    {
+        if( !_blockStates.size() ) return;
+
+        encodeGhostBlock( &_blockStates[0], _blockStates.size(), _data );
+
+        // zlib 1.1.4 has no compressBound(), use the documented worst case
+        uLongf packedSize = _data.size() + _data.size() / 1000 + 12;
+        _packed.resize( packedSize );
+        if( compress2( &_packed[0], &packedSize, &_data[0], _data.size(), Z_BEST_COMPRESSION ) != Z_OK )
+        {
+            // incomplete telemetry is useless, file is removed on destruction
+            getCore()->logMessage( "Can't compress ghost telemetry block, recording stopped: \"%s\"", _fileName.c_str() );
+            _isFailed = true;
+            _blockStates.clear();
+            return;
+        }
+
+        GhostBlock block;
+        block.time       = _blockStates[0].time;
+        block.offset     = ftell( _file );
+        block.packedSize = packedSize;
+        block.size       = _data.size();
+        _blocks.push_back( block );
+        fwrite( &_packed[0], packedSize, 1, _file );
+
+        _blockStates.clear();
+    }
 public:
     CatToySaveGhost(Jumper* jumper, const char* filename)
     {
@@ -185,24 +474,45 @@ public:
         _ghost = jumper;
         _ghost->registerCatToy( this );        
         // open file for writting
+        _fileName = filename;
+        _isFailed = false;
         _file = fopen( filename, "wb" ); assert( _file );
         // initialize ghost header
-        _ghostHeader.magic = 0x30313233;
-        _ghostHeader.version = 1;
+        _ghostHeader.magic = ghostMagic;
+        _ghostHeader.version = ghostVersion;
         _ghostHeader.numFrames = 0;
         _ghostHeader.virtues = *_ghost->getVirtues();
         _ghostHeader.jumpPose.set( 1,0,0,0,0,1,0,0,0,0,1,0,0,0,0,1 );
-        // save ghost header
+        _streamHeader.numBlocks = 0;
+        _streamHeader.blockFrames = ghostBlockFrames;
+        _streamHeader.indexOffset = 0;
+        _streamHeader.timeToJump = -1.0f;
+        _blockStates.reserve( ghostBlockFrames );
+        // reserve space for ghost headers
         fwrite( &_ghostHeader, sizeof( NewGhostHeader ), 1, _file );
+        fwrite( &_streamHeader, sizeof( GhostStreamHeader ), 1, _file );
         // save initial ghost state
         _ghostFrameTime = _ghostTime = 0.0f;        
         update( 0.0f );
     }
     virtual ~CatToySaveGhost()
     {
-        // save actual ghost header 
+        // save last block & block index
+        writeBlock();
+        if( _isFailed )
+        {
+            fclose( _file );
+            remove( _fileName.c_str() );
+            if( _ghost ) _ghost->unregisterCatToy( this );
+            return;
+        }
+        _streamHeader.numBlocks = _blocks.size();
+        _streamHeader.indexOffset = ftell( _file );
+        if( _blocks.size() ) fwrite( &_blocks[0], sizeof( GhostBlock ), _blocks.size(), _file );
+        // save actual ghost headers 
         fseek( _file, 0, SEEK_SET );
         fwrite( &_ghostHeader, sizeof( NewGhostHeader ), 1, _file );
+        fwrite( &_streamHeader, sizeof( GhostStreamHeader ), 1, _file );
         // close file
         fclose( _file );
         // break jumper connection
@@ -231,7 +541,7 @@ public:
     }
     virtual void update(float dt)
     {
-        if( _ghost )
+        if( _ghost && !_isFailed )
         {
             // increase timers
             _ghostTime += dt;
@@ -254,7 +564,12 @@ public:
                 // save states
                 _ghostFrameTime = 0.0f;
                 _ghostHeader.numFrames++;
-                fwrite( &_ghostState, sizeof( GhostState ), 1, _file );
+                if( _streamHeader.timeToJump < 0 && _ghostState.phase != ::jpRoaming )
+                {
+                    _streamHeader.timeToJump = _ghostState.time;
+                }
+                _blockStates.push_back( _ghostState );
+                if( _blockStates.size() == ghostBlockFrames ) writeBlock();
             }
         }
     }
@@ -275,68 +590,187 @@ public:
 class CatToyLoadGhost : public CatToy
 {
 private:
-    NewGhostHeader  _ghostHeader;  // heading infos
-    GhostState*  _ghostStates;  // state frames
+    struct BlockCache
+    {
+    public:
+        unsigned int            blockId; // decoded block
+        std::vector<GhostState> states;  // decoded frames
+    };
+private:
+    std::string             _fileName;     // telemetry file
+    FILE*                   _file;         // telemetry file stream
+    NewGhostHeader          _ghostHeader;  // heading infos
+    GhostStreamHeader       _streamHeader; // block infos
+    std::vector<GhostBlock> _blocks;       // block index
+    BlockCache              _cache[2];     // decoded blocks, adjacent blocks are kept in different slots
+    std::vector<unsigned char> _packed;    // deflated block
+    std::vector<unsigned char> _data;      // inflated block
     unsigned int _startFrameId; // seaching helper
     float        _ghostTime;    // process time
     float        _timeToJump;   // time left to jump action
     float        _inhibitor;    // damping multiplier
     GhostState   _currentState; // interpolated state frame
+private:
+    void readBlock(unsigned int blockId, std::vector<GhostState>& states)
+    {
+        assert( blockId < _blocks.size() );
+        const GhostBlock& block = _blocks[blockId];
+        unsigned int numStates = std::min<unsigned int>( 
+            _streamHeader.blockFrames,
+            _ghostHeader.numFrames - blockId * _streamHeader.blockFrames
+        );
+
+        fseek( _file, block.offset, SEEK_SET );
+
+        // version 1 frames
+        if( !block.packedSize )
+        {
+            states.resize( numStates );
+            if( fread( &states[0], sizeof( GhostState ), numStates, _file ) != numStates )
+            {
+                throw ccor::Exception( "Ghost telemetry file corrupted: \"%s\"", _fileName.c_str() );
+            }
+            return;
+        }
+
+        // version 2 blocks
+        _packed.resize( block.packedSize );
+        _data.resize( block.size );
+        uLongf size = block.size;
+        if( fread( &_packed[0], block.packedSize, 1, _file ) != 1 ||
+            uncompress( &_data[0], &size, &_packed[0], block.packedSize ) != Z_OK ||
+            size != block.size ||
+            !decodeGhostBlock( &_data[0], block.size, numStates, states ) )
+        {
+            throw ccor::Exception( "Ghost telemetry file corrupted: \"%s\"", _fileName.c_str() );
+        }
+    }
+    const GhostState& getFrame(unsigned int frameId)
+    {
+        unsigned int blockId = frameId / _streamHeader.blockFrames;
+        BlockCache& cache = _cache[blockId & 1];
+        if( cache.blockId != blockId )
+        {
+            cache.blockId = ghostBlockNotLoaded;
+            readBlock( blockId, cache.states );
+            cache.blockId = blockId;
+        }
+        return cache.states[frameId - blockId * _streamHeader.blockFrames];
+    }
+    void indexRawFrames(unsigned int dataOffset)
+    {
+        // version 1 frames are split into blocks of fixed size,
+        // block times & jump time are gathered by single pass over file
+        fseek( _file, 0, SEEK_END );
+        unsigned int fileSize = ftell( _file );
+        unsigned int numFrames = fileSize > dataOffset ? ( fileSize - dataOffset ) / sizeof( GhostState ) : 0;
+        assert( numFrames == _ghostHeader.numFrames );
+        _ghostHeader.numFrames = std::min<unsigned int>( _ghostHeader.numFrames, numFrames );
+        _streamHeader.blockFrames = ghostBlockFrames;
+        _streamHeader.numBlocks = ( _ghostHeader.numFrames + ghostBlockFrames - 1 ) / ghostBlockFrames;
+        _streamHeader.indexOffset = 0;
+        _streamHeader.timeToJump = -1.0f;
+        _blocks.resize( _streamHeader.numBlocks );
+        for( unsigned int i=0; i<_blocks.size(); i++ )
+        {
+            _blocks[i].offset = dataOffset + i * ghostBlockFrames * sizeof( GhostState );
+            _blocks[i].packedSize = 0;
+            _blocks[i].size = 0;
+            const GhostState& keyframe = getFrame( i * ghostBlockFrames );
+            _blocks[i].time = keyframe.time;
+            if( _streamHeader.timeToJump < 0 )
+            {
+                const std::vector<GhostState>& states = _cache[i & 1].states;
+                for( unsigned int j=0; j<states.size(); j++ )
+                {
+                    if( states[j].phase != ::jpRoaming )
+                    {
+                        _streamHeader.timeToJump = states[j].time;
+                        break;
+                    }
+                }
+            }
+        }
+    }
 public:
     CatToyLoadGhost(const char* filename)
     {        
+        _fileName = filename;
+        _cache[0].blockId = _cache[1].blockId = ghostBlockNotLoaded;
         // open file for reading
-        FILE* file = fopen( filename, "rb" ); assert( file );
-        // load ghost header
-        fread( &_ghostHeader, sizeof( NewGhostHeader ), 1, file );
-        // check if it's an old cattoy version
-        if (_ghostHeader.magic != 0x30313233) {
-                fseek(file, 0, SEEK_SET);
-                OldGhostHeader oldHeader;
-                fread( &oldHeader, sizeof( OldGhostHeader ), 1, file );
-                _ghostHeader.magic = 0x30313233;
-                _ghostHeader.version = 1;
-                _ghostHeader.numFrames = oldHeader.numFrames;
-                _ghostHeader.jumpPose = oldHeader.jumpPose;
-                _ghostHeader.virtues.statistics = oldHeader.virtues.statistics;
-                _ghostHeader.virtues.appearance = oldHeader.virtues.appearance;
-                _ghostHeader.virtues.evolution = oldHeader.virtues.evolution;
-                _ghostHeader.virtues.predisp = oldHeader.virtues.predisp;
-                _ghostHeader.virtues.skills = oldHeader.virtues.skills;
-                _ghostHeader.virtues.equipment.canopy = oldHeader.virtues.equipment.canopy.ConvertToGear();
-                _ghostHeader.virtues.equipment.experience = oldHeader.virtues.equipment.experience;
-                _ghostHeader.virtues.equipment.helmet = oldHeader.virtues.equipment.helmet.ConvertToGear();
-                _ghostHeader.virtues.equipment.malfunctions = oldHeader.virtues.equipment.malfunctions;
-                _ghostHeader.virtues.equipment.pilotchute = oldHeader.virtues.equipment.pilotchute;
-                _ghostHeader.virtues.equipment.rig = oldHeader.virtues.equipment.rig.ConvertToGear();
-                _ghostHeader.virtues.equipment.sliderOption = oldHeader.virtues.equipment.sliderOption;
-                _ghostHeader.virtues.equipment.suit = oldHeader.virtues.equipment.suit.ConvertToGear();
+        _file = fopen( filename, "rb" );
+        if( !_file ) throw ccor::Exception( "Can't open ghost telemetry file: \"%s\"", _fileName.c_str() );
+        // destructor isn't called if constructor throws, so file is closed here
+        try
+        {
+            // load ghost header
+            fread( &_ghostHeader, sizeof( NewGhostHeader ), 1, _file );
+            // check if it's an old cattoy version
+            if (_ghostHeader.magic != ghostMagic) {
+                    fseek(_file, 0, SEEK_SET);
+                    OldGhostHeader oldHeader;
+                    fread( &oldHeader, sizeof( OldGhostHeader ), 1, _file );
+                    _ghostHeader.magic = ghostMagic;
+                    _ghostHeader.version = 1;
+                    _ghostHeader.numFrames = oldHeader.numFrames;
+                    _ghostHeader.jumpPose = oldHeader.jumpPose;
+                    _ghostHeader.virtues.statistics = oldHeader.virtues.statistics;
+                    _ghostHeader.virtues.appearance = oldHeader.virtues.appearance;
+                    _ghostHeader.virtues.evolution = oldHeader.virtues.evolution;
+                    _ghostHeader.virtues.predisp = oldHeader.virtues.predisp;
+                    _ghostHeader.virtues.skills = oldHeader.virtues.skills;
+                    _ghostHeader.virtues.equipment.canopy = oldHeader.virtues.equipment.canopy.ConvertToGear();
+                    _ghostHeader.virtues.equipment.experience = oldHeader.virtues.equipment.experience;
+                    _ghostHeader.virtues.equipment.helmet = oldHeader.virtues.equipment.helmet.ConvertToGear();
+                    _ghostHeader.virtues.equipment.malfunctions = oldHeader.virtues.equipment.malfunctions;
+                    _ghostHeader.virtues.equipment.pilotchute = oldHeader.virtues.equipment.pilotchute;
+                    _ghostHeader.virtues.equipment.rig = oldHeader.virtues.equipment.rig.ConvertToGear();
+                    _ghostHeader.virtues.equipment.sliderOption = oldHeader.virtues.equipment.sliderOption;
+                    _ghostHeader.virtues.equipment.suit = oldHeader.virtues.equipment.suit.ConvertToGear();
+            }
+
+            // load block index
+            if( _ghostHeader.version >= ghostVersion )
+            {
+                fread( &_streamHeader, sizeof( GhostStreamHeader ), 1, _file );
+                // block index is validated before allocation, so corrupted header can't force huge one
+                fseek( _file, 0, SEEK_END );
+                unsigned int fileSize = ftell( _file );
+                if( !_streamHeader.blockFrames ||
+                    _streamHeader.numBlocks != ( _ghostHeader.numFrames + _streamHeader.blockFrames - 1 ) / _streamHeader.blockFrames ||
+                    _streamHeader.indexOffset > fileSize ||
+                    _streamHeader.numBlocks > ( fileSize - _streamHeader.indexOffset ) / sizeof( GhostBlock ) )
+                {
+                    throw ccor::Exception( "Ghost telemetry file corrupted: \"%s\"", _fileName.c_str() );
+                }
+                _blocks.resize( _streamHeader.numBlocks );
+                fseek( _file, _streamHeader.indexOffset, SEEK_SET );
+                if( _blocks.size() && fread( &_blocks[0], sizeof( GhostBlock ), _blocks.size(), _file ) != _blocks.size() )
+                {
+                    throw ccor::Exception( "Ghost telemetry file corrupted: \"%s\"", _fileName.c_str() );
+                }
+            }
+            else
+            {
+                indexRawFrames( ftell( _file ) );
+            }
+        }
+        catch( ... )
+        {
+            fclose( _file );
+            throw;
         }
+        assert( _ghostHeader.numFrames );
 
-        // load ghost states
-        _ghostStates = new GhostState[_ghostHeader.numFrames];
-        unsigned int fileResult = fread( _ghostStates, sizeof( GhostState ), _ghostHeader.numFrames, file );
-        assert( fileResult == _ghostHeader.numFrames );
-        _ghostHeader.numFrames = fileResult;
-        fclose( file );
         // initialize ghost timer & time inhibitor
         _ghostTime    = 0.0f;
         _inhibitor    = 0.0f;
         _startFrameId = 0;
-        // calculate time to jump
-        _timeToJump = -1.0f;
-        for( unsigned int i=0; i<_ghostHeader.numFrames; i++ )
-        {
-            if( _ghostStates[i].phase != ::jpRoaming )
-            {
-                _timeToJump = _ghostStates[i].time;
-                break;
-            }
-        }
+        _timeToJump   = _streamHeader.timeToJump;
     }
     virtual ~CatToyLoadGhost()
     {
-        delete[] _ghostStates;
+        fclose( _file );
     }
 public:
     virtual Virtues* getVirtues(void)
@@ -377,13 +811,18 @@ public:
             _timeToJump -= dt * _inhibitor;
             _timeToJump = _timeToJump < 0 ? 0 : _timeToJump;
         }
+
+        // seek block by index, so passed blocks are not decoded
+        unsigned int blockId = _startFrameId / _streamHeader.blockFrames;
+        while( blockId + 1 < _blocks.size() && _blocks[blockId+1].time <= _ghostTime ) blockId++;
+        _startFrameId = std::max<unsigned int>( _startFrameId, blockId * _streamHeader.blockFrames );
         
         // search for couple of interpolation frames
         bool found = false;
         unsigned int frameId = _startFrameId;
         while( frameId < ( _ghostHeader.numFrames - 1 ) )
         {
-            if( _ghostStates[frameId].time <= _ghostTime && _ghostStates[frameId+1].time > _ghostTime )
+            if( getFrame( frameId ).time <= _ghostTime && getFrame( frameId+1 ).time > _ghostTime )
             {                
                 found = true;
                 break;
@@ -396,23 +835,27 @@ public:
             // save helper state
             _startFrameId = frameId;
 
+            // adjacent frames are never evicted by each other
+            const GhostState& state0 = getFrame( frameId );
+            const GhostState& state1 = getFrame( frameId+1 );
+
             // determine interpolation factor
-            float factor = ( _ghostTime - _ghostStates[frameId].time ) / ( _ghostStates[frameId+1].time - _ghostStates[frameId].time );
+            float factor = ( _ghostTime - state0.time ) / ( state1.time - state0.time );
             assert( factor >= 0 && factor <= 1 );
 
             // interpolate states
             _currentState.time        = _ghostTime;
-            _currentState.phase       = factor < 0.5f ? _ghostStates[frameId].phase : _ghostStates[frameId+1].phase;
-            _currentState.modifier    = factor < 0.5f ? _ghostStates[frameId].modifier : _ghostStates[frameId+1].modifier;        
+            _currentState.phase       = factor < 0.5f ? state0.phase : state1.phase;
+            _currentState.modifier    = factor < 0.5f ? state0.modifier : state1.modifier;        
             _currentState.currentPose = Gameplay::iEngine->interpolate( 
-                _ghostStates[frameId].currentPose,
-                _ghostStates[frameId+1].currentPose,
+                state0.currentPose,
+                state1.currentPose,
                 factor
             );
         }
         else
         {
-            _currentState = _ghostStates[_ghostHeader.numFrames-1];
+            _currentState = getFrame( _ghostHeader.numFrames-1 );
         }
 
         // weaken process inhibition
@@ -192,4 +192,28 @@ int checksum(void* in, unsigned int insize)
     int result = 0;
     for( unsigned int i=0; i<insize; i++ ) result += ((unsigned char*)(in))[i];
     return result;
-}
\ No newline at end of file
+}
+
+void scramble(void* data, unsigned int size, const char* key)
+{
+    unsigned int keyLength = strlen( key ); assert( keyLength );
+    unsigned int keyId = 0;
+    for( unsigned int i=0; i<size; i++ )
+    {
+        ((unsigned char*)(data))[i] -= ((unsigned const char*)(key))[keyId];
+        keyId++;
+        if( keyId >= keyLength ) keyId = 0;
+    }
+}
+
+void unscramble(void* data, unsigned int size, const char* key)
+{
+    unsigned int keyLength = strlen( key ); assert( keyLength );
+    unsigned int keyId = 0;
+    for( unsigned int i=0; i<size; i++ )
+    {
+        ((unsigned char*)(data))[i] += ((unsigned const char*)(key))[keyId];
+        keyId++;
+        if( keyId >= keyLength ) keyId = 0;
+    }
+}
@@ -5,5 +5,7 @@
 void encrypt(std::string& out, void* in, unsigned int insize, const char* key);
 void decrypt(void* out, unsigned int outsize, std::string& in, const char* key);
 int checksum(void* in, unsigned int insize);
+void scramble(void* data, unsigned int size, const char* key);
+void unscramble(void* data, unsigned int size, const char* key);
 
 #endif
\ No newline at end of file
@@ -15,37 +15,151 @@
 const float oneDivThree = 1.0f/3.0f;
 const float oneDivTwo   = 1.0f/2.0f;
 
-static Vector3f e0Scaled, e1Scaled;
-static Vector3f e0Pos, e1Pos;
-static Vector3f eCross, eCrossScaled;
+/**
+ * random stream of single surface triangle, seeded by triangle id, 
+ * so scattering doesn't depend on thread count & triangle order
+ */
+
+class ScatterRandom
+{
+private:
+    unsigned int _state;
+public:
+    ScatterRandom(unsigned int triangleId)
+    {
+        // avalanche triangle id to decorrelate neighbouring streams
+        unsigned int h = triangleId + 0x9E3779B9;
+        h ^= h >> 16, h *= 0x85EBCA6B;
+        h ^= h >> 13, h *= 0xC2B2AE35;
+        h ^= h >> 16;
+        _state = h ? h : 0x6D2B79F5;
+    }
+    inline float getUniform(float a, float b)
+    {
+        // xorshift32
+        _state ^= _state << 13;
+        _state ^= _state >> 17;
+        _state ^= _state << 5;
+        return a + ( b - a ) * float( _state >> 8 ) / float( 1 << 24 );
+    }
+};
 
-static Vector3f generateRandomPosition(const Vector3f& v0, const Vector3f& e0, const Vector3f& v1, const Vector3f& e1)
+static Vector3f generateRandomPosition(ScatterRandom& random, const Vector3f& v0, const Vector3f& e0, const Vector3f& v1, const Vector3f& e1)
 {
-    e0Scaled = e0 * getCore()->getRandToolkit()->getUniform( 0,1 );
-    e1Scaled = e1 * getCore()->getRandToolkit()->getUniform( 0,1 );
-    e0Pos = e0Scaled + v0;
-    e1Pos = e1Scaled + v1;
-    eCross = e0Pos - e1Pos;
-    eCrossScaled = eCross * getCore()->getRandToolkit()->getUniform( 0,1 );
-    return e1Pos + eCrossScaled;
+    Vector3f e0Pos = e0 * random.getUniform( 0,1 ) + v0;
+    Vector3f e1Pos = e1 * random.getUniform( 0,1 ) + v1;
+    Vector3f eCross = e0Pos - e1Pos;
+    return e1Pos + eCross * random.getUniform( 0,1 );
 }
 
-Vector3f generateRandomPosition(Vector3f* vertices, Vector3f* edges)
+static Vector3f generateRandomPosition(ScatterRandom& random, Vector3f* vertices, Vector3f* edges)
 {
-    if( getCore()->getRandToolkit()->getUniform( 0,1 ) < oneDivThree )
+    if( random.getUniform( 0,1 ) < oneDivThree )
     {
-        return generateRandomPosition( vertices[0], edges[0], vertices[0], edges[1] );
+        return generateRandomPosition( random, vertices[0], edges[0], vertices[0], edges[1] );
     }
-    else if( getCore()->getRandToolkit()->getUniform( 0,1 ) < oneDivTwo )
+    else if( random.getUniform( 0,1 ) < oneDivTwo )
     {
-        return generateRandomPosition( vertices[0], edges[0], vertices[1], edges[2] );
+        return generateRandomPosition( random, vertices[0], edges[0], vertices[1], edges[2] );
     }
     else
     {
-        return generateRandomPosition( vertices[1], edges[2], vertices[0], edges[1] );
+        return generateRandomPosition( random, vertices[1], edges[2], vertices[0], edges[1] );
     }
 }
 
+/**
+ * compact forest solution (cache record), 16 bytes per tree
+ */
+
+#define FOREST_CACHE_MAGIC   0x45525446 // "FTRE"
+#define FOREST_CACHE_VERSION 1
+
+struct ForestCacheHeader
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int numTrees;
+    float        minScale;
+    float        maxScale;
+};
+
+struct ForestTree
+{
+    float          pos[3];
+    unsigned short yaw;   // [0..360) degrees, quantized
+    unsigned short scale; // [minScale..maxScale], quantized
+};
+
+/**
+ * scattering of surface triangles range
+ */
+
+struct ForestScatter
+{
+public:
+    const Vector3f*                vertices;     // surface vertices in world space
+    const engine::Mesh::Triangle*  triangles;    // surface triangles
+    unsigned int                   firstTriangle;
+    unsigned int                   lastTriangle;
+    float                          density;
+    volatile LONG*                 progress;     // number of processed triangles
+    std::vector<ForestTree>        trees;        // result
+public:
+    void scatterTriangle(unsigned int triangleId)
+    {
+        ScatterRandom random( triangleId );
+
+        // calculate triangle square value...
+        Vector3f vertex[3], edge[3], edgeN[2];
+        vertex[0] = vertices[triangles[triangleId].vertexId[0]];
+        vertex[1] = vertices[triangles[triangleId].vertexId[1]];
+        vertex[2] = vertices[triangles[triangleId].vertexId[2]];
+        edge[0] = vertex[1] - vertex[0];
+        edge[1] = vertex[2] - vertex[0];
+        edge[2] = vertex[2] - vertex[1];
+        edgeN[0] = edge[0]; edgeN[0].normalize();
+        edgeN[1] = edge[1]; edgeN[1].normalize();
+        float angle, cosA = Vector3f::dot( edgeN[0], edgeN[1] );
+        if( cosA > 1.0f ) angle = 0.0f; 
+        else if( cosA < -1.0f ) angle = 180; 
+        else angle = acosf( cosA );
+        float sinA = sin( angle );
+        float square = 0.5f * edge[0].length() * edge[1].length() * sinA / 10000.0f;
+
+        // obtain number of trees in this triangle
+        unsigned int numTreesInTriangle = (unsigned int)( square * density );
+        if( !numTreesInTriangle )
+        {
+            // include probability method to decide to place tree on to this triangle
+            float probability = square / ( 1 / density );
+            assert( probability <= 1.0f );
+            if( probability > 0 && random.getUniform( 0, 1 ) <= probability ) numTreesInTriangle++;
+        }
+
+        // generate trees
+        ForestTree tree;
+        for( unsigned int j=0; j<numTreesInTriangle; j++ )
+        {
+            tree.scale = (unsigned short)( random.getUniform( 0, 65535 ) );
+            Vector3f pos = generateRandomPosition( random, vertex, edge );
+            tree.pos[0] = pos[0], tree.pos[1] = pos[1], tree.pos[2] = pos[2];
+            tree.yaw = (unsigned short)( random.getUniform( 0, 65535 ) );
+            trees.push_back( tree );
+        }
+    }
+    static DWORD WINAPI scatterProc(LPVOID lpParameter)
+    {
+        ForestScatter* scatter = reinterpret_cast<ForestScatter*>( lpParameter );
+        for( unsigned int i=scatter->firstTriangle; i<scatter->lastTriangle; i++ )
+        {
+            scatter->scatterTriangle( i );
+            InterlockedIncrement( scatter->progress );
+        }
+        return 0;
+    }
+};
+
 /**
  * aux
  */
@@ -84,25 +198,11 @@ unsigned int Forest::getClumpLodId(engine::IClump* clump)
  * class implementation
  */
 
-static float getSquaredLength(const Vector3f& v)
-{
-    return v.dot( v );
-}
-
 float Forest::getDistanceToNearestTree(const Vector3f& pos)
 {
-    if( !_treeMatrix.size() ) return NX_MAX_F32;
-
-    Matrix4f& matrix = _treeMatrix[0];
-    float result = getSquaredLength( Vector3f( matrix[3][0], matrix[3][1], matrix[3][2] ) - pos );
-    float squaredDistance;
-    for( unsigned int i=0; i<_treeMatrix.size(); i++ )
-    {
-        matrix = _treeMatrix[i];
-        squaredDistance = getSquaredLength( Vector3f( matrix[3][0], matrix[3][1], matrix[3][2] ) - pos );
-        if( result > squaredDistance ) result = squaredDistance;
-    }
-    return sqrt( result );
+    float distance = NX_MAX_F32;
+    _treeIndex->getNearestTree( pos, &distance );
+    return distance;
 }
 
 Forest::Forest(Actor* parent, ForestDesc* desc) : Actor( parent )
@@ -158,91 +258,100 @@ Forest::Forest(Actor* parent, ForestDesc* desc) : Actor( parent )
     assert( _canopyScheme.isValid() );
 
     // create full cache names
-    std::string instanceCache  = _desc.cache; instanceCache  += ".matrices";
+    std::string instanceCache  = _desc.cache; instanceCache  += ".trees";
     std::string trunkBspCache  = _desc.cache; trunkBspCache  += ".trunk";
     std::string canopyBspCache = _desc.cache; canopyBspCache += ".canopy";
+    std::string indexCache     = _desc.cache; indexCache     += ".index";
 
     // try to load forest from cache
+    std::vector<ForestTree> trees;
+    bool isCached = false;
     IResource* resource = getCore()->getResource( instanceCache.c_str(), "rb" );
     if( resource )
     {
-        unsigned int numTrees;
-        fread( &numTrees, sizeof(unsigned int), 1, resource->getFile() );
-        _treeMatrix.resize( numTrees );
-        fread( &_treeMatrix[0], sizeof(Matrix4f), numTrees, resource->getFile() );
+        ForestCacheHeader header;
+        if( fread( &header, sizeof(ForestCacheHeader), 1, resource->getFile() ) == 1 &&
+            header.magic == FOREST_CACHE_MAGIC && 
+            header.version == FOREST_CACHE_VERSION &&
+            header.minScale == _desc.minScale &&
+            header.maxScale == _desc.maxScale )
+        {
+            trees.resize( header.numTrees );
+            isCached = ( header.numTrees == 0 ) || 
+                       ( fread( &trees[0], sizeof(ForestTree), header.numTrees, resource->getFile() ) == header.numTrees );
+        }
         resource->release();
     }
-    else
+    if( !isCached )
     {
         // obtain surface properties
         Matrix4f ltm = _desc.surface->getFrame()->getLTM();
         engine::IGeometry* geometry = _desc.surface->getGeometry();
         engine::Mesh* mesh = geometry->createMesh();
 
-        float preservedDistance = _desc.collScale * ( geometry->getAABBSup() - geometry->getAABBInf() ).length();
-
-        // iterate surface triangles
-        Vector3f vertex[3];
-        Vector3f edge[3];
-        Vector3f edgeN[2];
-        Vector3f normal;
-        Vector3f pos;
-        float cosA, sinA, angle, square, probability, scale;
-        unsigned int i,j,numTreesInTriangle;
-        Matrix4f instanceM;    
-        for( i=0; i<mesh->numTriangles; i++ )
+        // transform surface vertices to world space
+        unsigned int i;
+        std::vector<Vector3f> vertices( mesh->numVertices );
+        for( i=0; i<mesh->numVertices; i++ )
         {
-            // transform triangle vertices to world space
-            vertex[0] = Gameplay::iEngine->transformCoord( mesh->vertices[mesh->triangles[i].vertexId[0]], ltm );
-            vertex[1] = Gameplay::iEngine->transformCoord( mesh->vertices[mesh->triangles[i].vertexId[1]], ltm );
-            vertex[2] = Gameplay::iEngine->transformCoord( mesh->vertices[mesh->triangles[i].vertexId[2]], ltm );
-            // calculate triangle square value...
-            edge[0] = vertex[1] - vertex[0];
-            edge[1] = vertex[2] - vertex[0];
-            edge[2] = vertex[2] - vertex[1];
-            edgeN[0] = edge[0]; edgeN[0].normalize();
-            edgeN[1] = edge[1]; edgeN[1].normalize();
-            normal.cross( edgeN[0], edgeN[1] );
-            cosA = Vector3f::dot( edgeN[0], edgeN[1] );
-            if( cosA > 1.0f ) angle = 0.0f; 
-            else if( cosA < -1.0f ) angle = 180; 
-            else angle = acosf( cosA );
-            sinA = sin( angle );
-            square = 0.5f * edge[0].length() * edge[1].length() * sinA / 10000.0f;
-            // obtain number of particles in this triangle
-            numTreesInTriangle = unsigned int( square * _desc.density );
-            if( !numTreesInTriangle )
-            {
-                // include probability method to decide to place grass on to this triangle
-                probability = square / ( 1 / _desc.density );
-                assert( probability <= 1.0f );
-                if( probability > 0 && getCore()->getRandToolkit()->getUniform( 0, 1 ) <= probability ) numTreesInTriangle++;
-            }
-            // generate trees
-            for( j=0; j<numTreesInTriangle; j++ )
+            const Vector3f& v = mesh->vertices[i];
+            vertices[i].set(
+                v[0] * ltm[0][0] + v[1] * ltm[1][0] + v[2] * ltm[2][0] + ltm[3][0],
+                v[0] * ltm[0][1] + v[1] * ltm[1][1] + v[2] * ltm[2][1] + ltm[3][1],
+                v[0] * ltm[0][2] + v[1] * ltm[1][2] + v[2] * ltm[2][2] + ltm[3][2]
+            );
+        }
+
+        // split surface triangles in contiguous ranges, one per thread
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo( &systemInfo );
+        unsigned int numThreads = std::max<unsigned int>( systemInfo.dwNumberOfProcessors, 1 );
+        numThreads = std::min<unsigned int>( numThreads, MAXIMUM_WAIT_OBJECTS );
+        numThreads = std::max<unsigned int>( std::min( numThreads, mesh->numTriangles ), 1 );
+        volatile LONG progress = 0;
+        std::vector<ForestScatter> scatters( numThreads );
+        std::vector<HANDLE> threads;
+        for( i=0; i<numThreads; i++ )
+        {
+            scatters[i].vertices      = vertices.size() ? &vertices[0] : NULL;
+            scatters[i].triangles     = mesh->triangles;
+            scatters[i].firstTriangle = mesh->numTriangles * i / numThreads;
+            scatters[i].lastTriangle  = mesh->numTriangles * ( i + 1 ) / numThreads;
+            scatters[i].density       = _desc.density;
+            scatters[i].progress      = &progress;
+        }
+        std::vector<unsigned int> failedScatters;
+        for( i=0; i<numThreads; i++ )
+        {
+            DWORD threadId;
+            HANDLE thread = CreateThread( NULL, 0, ForestScatter::scatterProc, &scatters[i], 0, &threadId );
+            if( thread ) threads.push_back( thread ); else failedScatters.push_back( i );
+        }
+
+        // ranges of threads failed to start are scattered by calling thread
+        for( i=0; i<failedScatters.size(); i++ )
+        {
+            ForestScatter::scatterProc( &scatters[failedScatters[i]] );
+        }
+
+        // report progress while waiting
+        if( threads.size() )
+        {
+            while( WaitForMultipleObjects( threads.size(), &threads[0], TRUE, 100 ) == WAIT_TIMEOUT )
             {
-                // generate scale
-                scale = getCore()->getRandToolkit()->getUniform( _desc.minScale, _desc.maxScale );
-                // generate coordinate
-                pos = generateRandomPosition( vertex, edge );                
-                // generate matrix
-                instanceM.set(
-                    clumpM[0][0] * scale, clumpM[0][1] * scale, clumpM[0][2] * scale, 0.0f,
-                    clumpM[1][0] * scale, clumpM[1][1] * scale, clumpM[1][2] * scale, 0.0f,
-                    clumpM[2][0] * scale, clumpM[2][1] * scale, clumpM[2][2] * scale, 0.0f,
-                    0.0f, 0.0f, 0.0f, 1.0f
+                Scene::progressCallback( 
+                    Gameplay::iLanguage->getUnicodeString(844),
+                    float( progress ) / float( std::max<unsigned int>( mesh->numTriangles, 1 ) ),
+                    getScene()
                 );
-                instanceM = Gameplay::iEngine->rotateMatrix( instanceM, Vector3f(0,1,0), getCore()->getRandToolkit()->getUniform(0,360) );
-                instanceM[3][0] = pos[0];
-                instanceM[3][1] = pos[1];
-                instanceM[3][2] = pos[2];
-                _treeMatrix.push_back( instanceM );
             }
-            Scene::progressCallback( 
-                Gameplay::iLanguage->getUnicodeString(844),
-                float( i ) / float( mesh->numTriangles ),
-                getScene()
-            );
+        }
+        for( i=0; i<threads.size(); i++ ) CloseHandle( threads[i] );
+
+        // gather results in triangle order
+        for( i=0; i<numThreads; i++ )
+        {
+            trees.insert( trees.end(), scatters[i].trees.begin(), scatters[i].trees.end() );
         }
 
         // release temporary resources
@@ -250,11 +359,45 @@ Forest::Forest(Actor* parent, ForestDesc* desc) : Actor( parent )
 
         // write solution
         ccor::IResource* resource = getCore()->getResource( instanceCache.c_str(), "wb" );
-        unsigned int numTrees = _treeMatrix.size();
-        fwrite( &numTrees, sizeof(unsigned int), 1, resource->getFile() );
-        fwrite( &_treeMatrix[0], sizeof(Matrix4f), numTrees, resource->getFile() );
+        ForestCacheHeader header;
+        header.magic    = FOREST_CACHE_MAGIC;
+        header.version  = FOREST_CACHE_VERSION;
+        header.numTrees = trees.size();
+        header.minScale = _desc.minScale;
+        header.maxScale = _desc.maxScale;
+        fwrite( &header, sizeof(ForestCacheHeader), 1, resource->getFile() );
+        if( trees.size() ) fwrite( &trees[0], sizeof(ForestTree), trees.size(), resource->getFile() );
         resource->release();
+
+        // batch trees of previous solution are truncated, so batches rebuild them
+        resource = getCore()->getResource( trunkBspCache.c_str(), "wb" );
+        if( resource ) resource->release();
+        resource = getCore()->getResource( canopyBspCache.c_str(), "wb" );
+        if( resource ) resource->release();
+    }
+
+    // restore tree matrices from compact solution
+    Matrix4f instanceM;
+    float scale;
+    _treeMatrix.resize( trees.size() );
+    for( unsigned int i=0; i<trees.size(); i++ )
+    {
+        scale = _desc.minScale + ( _desc.maxScale - _desc.minScale ) * trees[i].scale / 65535.0f;
+        instanceM.set(
+            clumpM[0][0] * scale, clumpM[0][1] * scale, clumpM[0][2] * scale, 0.0f,
+            clumpM[1][0] * scale, clumpM[1][1] * scale, clumpM[1][2] * scale, 0.0f,
+            clumpM[2][0] * scale, clumpM[2][1] * scale, clumpM[2][2] * scale, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f
+        );
+        instanceM = Gameplay::iEngine->rotateMatrix( instanceM, Vector3f(0,1,0), trees[i].yaw * 360.0f / 65536.0f );
+        instanceM[3][0] = trees[i].pos[0];
+        instanceM[3][1] = trees[i].pos[1];
+        instanceM[3][2] = trees[i].pos[2];
+        _treeMatrix[i] = instanceM;
     }
+
+    // build (or load) spatial index of forest solution
+    _treeIndex = new ForestIndex( _treeMatrix, indexCache.c_str(), isCached );
     
     // build batches
     _trunkBatch  = Gameplay::iEngine->createBatch( _treeMatrix.size(), &_trunkScheme ); assert( _trunkBatch );
@@ -297,6 +440,8 @@ Forest::~Forest()
     _scene->getStage()->remove( _canopyBatch );
     _trunkBatch->release();
     _canopyBatch->release();    
+
+    delete _treeIndex;
 }
 
 void Forest::onUpdateActivity(float dt)
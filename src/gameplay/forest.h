@@ -10,6 +10,7 @@
 #include "headers.h"
 #include "scene.h"
 #include "../shared/audio.h"
+#include "forestindex.h"
 
 struct ForestDesc
 {
@@ -61,6 +62,7 @@ private:
     engine::BatchScheme   _trunkScheme;      // batch scheme of tree trunk
     engine::BatchScheme   _canopyScheme;     // batch scheme of tree canopy    
     std::vector<Matrix4f> _treeMatrix;       // forest solution
+    ForestIndex*          _treeIndex;        // spatial index of forest solution
     engine::IBatch*       _trunkBatch;       // trunk batch renderer
     engine::IBatch*       _canopyBatch;      // canopy batch renderer
     audio::ISound*        _rustleSound;      // sound of rustle
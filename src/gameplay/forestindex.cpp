@@ -0,0 +1,251 @@
+#include "headers.h"
+#include "forestindex.h"
+#include "gameplay.h"
+#include <float.h>
+
+/**
+ * class implementation
+ */
+
+ForestIndex::ForestIndex(const std::vector<Matrix4f>& treeMatrix, const char* cacheName, bool useCache)
+{
+    // try to load index from cache
+    ccor::IResource* resource = useCache ? getCore()->getResource( cacheName, "rb" ) : NULL;
+    if( resource )
+    {
+        bool isValid = read( resource, treeMatrix );
+        resource->release();
+        if( isValid ) return;
+    }
+
+    // build & cache
+    build( treeMatrix );
+    resource = getCore()->getResource( cacheName, "wb" );
+    if( resource )
+    {
+        write( resource );
+        resource->release();
+    }
+}
+
+void ForestIndex::build(const std::vector<Matrix4f>& treeMatrix)
+{
+    unsigned int i;
+
+    // bounds of forest in horizontal plane
+    float infX = FLT_MAX, infZ = FLT_MAX, supX = -FLT_MAX, supZ = -FLT_MAX;
+    for( i=0; i<treeMatrix.size(); i++ )
+    {
+        infX = std::min( infX, treeMatrix[i][3][0] ), supX = std::max( supX, treeMatrix[i][3][0] );
+        infZ = std::min( infZ, treeMatrix[i][3][2] ), supZ = std::max( supZ, treeMatrix[i][3][2] );
+    }
+    if( !treeMatrix.size() ) infX = infZ = supX = supZ = 0.0f;
+
+    // choose cell size to get desired number of trees per cell
+    float sizeX = std::max( supX - infX, 1.0f );
+    float sizeZ = std::max( supZ - infZ, 1.0f );
+    float numCells = std::max( float( treeMatrix.size() ) / FOREST_INDEX_CELL_TREES, 1.0f );
+    float cellSize = sqrt( sizeX * sizeZ / numCells );
+    cellSize = std::max( cellSize, std::max( sizeX, sizeZ ) / FOREST_INDEX_MAX_CELLS );
+
+    _header.version   = FOREST_INDEX_VERSION;
+    _header.numTrees  = treeMatrix.size();
+    _header.numCellsX = std::min<unsigned int>( (unsigned int)( sizeX / cellSize ) + 1, FOREST_INDEX_MAX_CELLS );
+    _header.numCellsZ = std::min<unsigned int>( (unsigned int)( sizeZ / cellSize ) + 1, FOREST_INDEX_MAX_CELLS );
+    _header.infX      = infX;
+    _header.infZ      = infZ;
+    _header.cellSize  = cellSize;
+
+    // counting sort of trees by cell
+    unsigned int numGridCells = _header.numCellsX * _header.numCellsZ;
+    std::vector<unsigned int> treeCell( _header.numTrees );
+    _cellStart.assign( numGridCells + 1, 0 );
+    int x, z;
+    for( i=0; i<_header.numTrees; i++ )
+    {
+        getCell( Vector3f( treeMatrix[i][3][0], treeMatrix[i][3][1], treeMatrix[i][3][2] ), x, z );
+        treeCell[i] = z * _header.numCellsX + x;
+        _cellStart[treeCell[i]+1]++;
+    }
+    for( i=0; i<numGridCells; i++ ) _cellStart[i+1] += _cellStart[i];
+
+    std::vector<unsigned int> cellFill( _cellStart.begin(), _cellStart.end() - 1 );
+    _treeId.resize( _header.numTrees );
+    _treePos.resize( _header.numTrees );
+    for( i=0; i<_header.numTrees; i++ )
+    {
+        unsigned int slot = cellFill[treeCell[i]]++;
+        _treeId[slot]  = i;
+        _treePos[slot] = Vector3f( treeMatrix[i][3][0], treeMatrix[i][3][1], treeMatrix[i][3][2] );
+    }
+}
+
+bool ForestIndex::read(ccor::IResource* resource, const std::vector<Matrix4f>& treeMatrix)
+{
+    if( fread( &_header, sizeof(Header), 1, resource->getFile() ) != 1 ) return false;
+    if( _header.version != FOREST_INDEX_VERSION ||
+        _header.numTrees != treeMatrix.size() ||
+        _header.numCellsX == 0 || _header.numCellsX > FOREST_INDEX_MAX_CELLS ||
+        _header.numCellsZ == 0 || _header.numCellsZ > FOREST_INDEX_MAX_CELLS ||
+        !( _header.cellSize > 0 ) )
+    {
+        return false;
+    }
+
+    unsigned int numGridCells = _header.numCellsX * _header.numCellsZ;
+    _cellStart.resize( numGridCells + 1 );
+    _treeId.resize( _header.numTrees );
+    if( fread( &_cellStart[0], sizeof(unsigned int), numGridCells + 1, resource->getFile() ) != numGridCells + 1 ) return false;
+    if( _header.numTrees && fread( &_treeId[0], sizeof(unsigned int), _header.numTrees, resource->getFile() ) != _header.numTrees ) return false;
+    // cell ranges should start at 0, never decrease and end at number of trees
+    if( _cellStart[0] != 0 || _cellStart[numGridCells] != _header.numTrees ) return false;
+    for( unsigned int cellId=0; cellId<numGridCells; cellId++ )
+    {
+        if( _cellStart[cellId] > _cellStart[cellId+1] ) return false;
+    }
+
+    // positions are restored from forest solution
+    _treePos.resize( _header.numTrees );
+    for( unsigned int i=0; i<_header.numTrees; i++ )
+    {
+        if( _treeId[i] >= _header.numTrees ) return false;
+        const Matrix4f& matrix = treeMatrix[_treeId[i]];
+        _treePos[i] = Vector3f( matrix[3][0], matrix[3][1], matrix[3][2] );
+    }
+    return true;
+}
+
+void ForestIndex::write(ccor::IResource* resource)
+{
+    fwrite( &_header, sizeof(Header), 1, resource->getFile() );
+    fwrite( &_cellStart[0], sizeof(unsigned int), _cellStart.size(), resource->getFile() );
+    if( _treeId.size() ) fwrite( &_treeId[0], sizeof(unsigned int), _treeId.size(), resource->getFile() );
+}
+
+void ForestIndex::getCell(const Vector3f& pos, int& x, int& z)
+{
+    x = int( floor( ( pos[0] - _header.infX ) / _header.cellSize ) );
+    z = int( floor( ( pos[2] - _header.infZ ) / _header.cellSize ) );
+    x = std::max( 0, std::min( x, int( _header.numCellsX ) - 1 ) );
+    z = std::max( 0, std::min( z, int( _header.numCellsZ ) - 1 ) );
+}
+
+void ForestIndex::getRing(int cx, int cz, int ring, std::vector<unsigned int>& cells)
+{
+    cells.clear();
+    int numCellsX = int( _header.numCellsX );
+    int numCellsZ = int( _header.numCellsZ );
+    for( int z=cz-ring; z<=cz+ring; z++ )
+    {
+        if( z < 0 || z >= numCellsZ ) continue;
+        // inner rows of ring contain only two border cells
+        int step = ( z == cz-ring || z == cz+ring ) ? 1 : 2 * ring;
+        if( step == 0 ) step = 1;
+        for( int x=cx-ring; x<=cx+ring; x+=step )
+        {
+            if( x >= 0 && x < numCellsX ) cells.push_back( z * numCellsX + x );
+        }
+    }
+}
+
+/**
+ * queries
+ */
+
+unsigned int ForestIndex::getNearestTree(const Vector3f& pos, float* distance)
+{
+    unsigned int result = 0xFFFFFFFF;
+    float minDistance = FLT_MAX;
+
+    int cx, cz;
+    getCell( pos, cx, cz );
+    int maxRing = int( std::max( _header.numCellsX, _header.numCellsZ ) );
+    for( int ring=0; ring<=maxRing; ring++ )
+    {
+        getRing( cx, cz, ring, _ring );
+        for( unsigned int i=0; i<_ring.size(); i++ )
+        {
+            for( unsigned int j=_cellStart[_ring[i]]; j<_cellStart[_ring[i]+1]; j++ )
+            {
+                Vector3f d = _treePos[j] - pos;
+                float squaredDistance = d.dot( d );
+                if( squaredDistance < minDistance ) minDistance = squaredDistance, result = _treeId[j];
+            }
+        }
+        // trees beyond this ring are at least ring * cellSize away
+        float bound = ring * _header.cellSize;
+        if( result != 0xFFFFFFFF && minDistance <= bound * bound ) break;
+    }
+
+    if( distance ) *distance = ( result == 0xFFFFFFFF ) ? FLT_MAX : sqrt( minDistance );
+    return result;
+}
+
+unsigned int ForestIndex::getNearestTrees(const Vector3f& pos, unsigned int k, std::vector<unsigned int>& result)
+{
+    result.clear();
+    if( !k ) return 0;
+
+    // max-heap of k nearest candidates
+    typedef std::pair<float,unsigned int> Candidate;
+    std::priority_queue<Candidate> candidates;
+
+    int cx, cz;
+    getCell( pos, cx, cz );
+    int maxRing = int( std::max( _header.numCellsX, _header.numCellsZ ) );
+    for( int ring=0; ring<=maxRing; ring++ )
+    {
+        getRing( cx, cz, ring, _ring );
+        for( unsigned int i=0; i<_ring.size(); i++ )
+        {
+            for( unsigned int j=_cellStart[_ring[i]]; j<_cellStart[_ring[i]+1]; j++ )
+            {
+                Vector3f d = _treePos[j] - pos;
+                float squaredDistance = d.dot( d );
+                if( candidates.size() < k )
+                {
+                    candidates.push( Candidate( squaredDistance, _treeId[j] ) );
+                }
+                else if( squaredDistance < candidates.top().first )
+                {
+                    candidates.pop();
+                    candidates.push( Candidate( squaredDistance, _treeId[j] ) );
+                }
+            }
+        }
+        float bound = ring * _header.cellSize;
+        if( candidates.size() == k && candidates.top().first <= bound * bound ) break;
+    }
+
+    result.resize( candidates.size() );
+    for( unsigned int i=result.size(); i>0; i-- )
+    {
+        result[i-1] = candidates.top().second;
+        candidates.pop();
+    }
+    return result.size();
+}
+
+unsigned int ForestIndex::getTreesInRadius(const Vector3f& pos, float radius, std::vector<unsigned int>& result)
+{
+    result.clear();
+    if( !_header.numTrees ) return 0;
+
+    int infX, infZ, supX, supZ;
+    getCell( pos - Vector3f( radius, 0, radius ), infX, infZ );
+    getCell( pos + Vector3f( radius, 0, radius ), supX, supZ );
+    float squaredRadius = radius * radius;
+    for( int z=infZ; z<=supZ; z++ )
+    {
+        for( int x=infX; x<=supX; x++ )
+        {
+            unsigned int cellId = z * _header.numCellsX + x;
+            for( unsigned int j=_cellStart[cellId]; j<_cellStart[cellId+1]; j++ )
+            {
+                Vector3f d = _treePos[j] - pos;
+                if( d.dot( d ) <= squaredRadius ) result.push_back( _treeId[j] );
+            }
+        }
+    }
+    return result.size();
+}
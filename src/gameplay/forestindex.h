@@ -0,0 +1,66 @@
+/**
+ * uniform grid over forest solution, answers nearest, k-nearest
+ * and radius queries without scanning of all trees
+ */
+
+#ifndef FOREST_INDEX_IMPLEMENTATION_INCLUDED
+#define FOREST_INDEX_IMPLEMENTATION_INCLUDED
+
+#include "headers.h"
+#include "../shared/ccor.h"
+#include "../shared/engine.h"
+
+#define FOREST_INDEX_VERSION     1
+#define FOREST_INDEX_CELL_TREES  4    // desired average number of trees per cell
+#define FOREST_INDEX_MAX_CELLS   1024 // limit of cells per axis
+
+class ForestIndex
+{
+private:
+    struct Header
+    {
+        unsigned int version;
+        unsigned int numTrees;
+        unsigned int numCellsX;
+        unsigned int numCellsZ;
+        float        infX;
+        float        infZ;
+        float        cellSize;
+    };
+private:
+    Header                    _header;
+    std::vector<unsigned int> _cellStart; // first tree of cell in _treeId, numCells+1 entries
+    std::vector<unsigned int> _treeId;    // tree ids ordered by cell
+    std::vector<Vector3f>     _treePos;   // tree positions ordered by cell
+    std::vector<unsigned int> _ring;      // cells of current search ring
+private:
+    void build(const std::vector<Matrix4f>& treeMatrix);
+    bool read(ccor::IResource* resource, const std::vector<Matrix4f>& treeMatrix);
+    void write(ccor::IResource* resource);
+    void getCell(const Vector3f& pos, int& x, int& z);
+    void getRing(int cx, int cz, int ring, std::vector<unsigned int>& cells);
+public:
+    /**
+     * loads index from cache file, or builds it and writes cache,
+     * if cache is absent, doesn't match forest solution or isn't allowed to use
+     */
+    ForestIndex(const std::vector<Matrix4f>& treeMatrix, const char* cacheName, bool useCache);
+public:
+    inline unsigned int getNumTrees(void) { return _header.numTrees; }
+    /**
+     * @return id of nearest tree (0xFFFFFFFF for empty forest), distance is returned optionally
+     */
+    unsigned int getNearestTree(const Vector3f& pos, float* distance);
+    /**
+     * fills result with ids of k nearest trees, ordered by distance
+     * @return number of found trees
+     */
+    unsigned int getNearestTrees(const Vector3f& pos, unsigned int k, std::vector<unsigned int>& result);
+    /**
+     * fills result with ids of trees within radius
+     * @return number of found trees
+     */
+    unsigned int getTreesInRadius(const Vector3f& pos, float radius, std::vector<unsigned int>& result);
+};
+
+#endif
@@ -37,6 +37,7 @@ Gameplay::Gameplay()
 
     _isUnsafeCleanup = false;
     _pitchShiftIsEnabled = false;
+    _careerStore = NULL;
 }
 
 Gameplay::~Gameplay()
@@ -72,9 +73,17 @@ Gameplay::~Gameplay()
             }
         }
     
-        // delete careers
-        saveCareers();
+        // delete careers, failed save can't abort shutdown
+        try
+        {
+            saveCareers();
+        }
+        catch( ccor::Exception& exception )
+        {
+            getCore()->logMessage( "Cannot save careers: %s", exception.getMsg() );
+        }
         for( unsigned int i=0; i<_careers.size(); i++ ) delete _careers[i];
+        delete _careerStore;
 
         // delete user events
         cleanupUserCommunityEvents();
@@ -414,24 +423,32 @@ void Gameplay::entityInit(Object * p)
     // generate user community events from XML documents
     generateUserCommunityEvents();
 
-    // open index
-    TiXmlDocument* index = new TiXmlDocument( "./usr/index.xml" );
-    index->LoadFile();
-
-    // enumerate career nodes
-    TiXmlNode* child = index->FirstChild();
-    if( child ) do 
+    // load careers
+    _careerStore = new CareerStore( "./usr/careers" );
+    if( !_careerStore->load( _careers ) )
     {
-        if( child->Type() == TiXmlNode::ELEMENT && strcmp( child->Value(), "career" ) == 0 )
+        // there is no career store yet, import careers from XML index
+        TiXmlDocument* index = new TiXmlDocument( "./usr/index.xml" );
+        index->LoadFile();
+
+        // enumerate career nodes
+        TiXmlNode* child = index->FirstChild();
+        if( child ) do 
         {
-            _careers.push_back( new Career( static_cast<TiXmlElement*>( child ) ) );
+            if( child->Type() == TiXmlNode::ELEMENT && strcmp( child->Value(), "career" ) == 0 )
+            {
+                _careers.push_back( new Career( static_cast<TiXmlElement*>( child ) ) );
+            }
+            child = child->NextSibling();
         }
-        child = child->NextSibling();
-    }
-    while( child != NULL );
+        while( child != NULL );
+
+        // close index document
+        delete index;
 
-    // close index document
-    delete index;
+        // create career store
+        _careerStore->compact( _careers );
+    }
 
     // create career for LICENSED_CHAR
     #ifdef GAMEPLAY_EDITION_ATARI
@@ -655,13 +672,7 @@ void Gameplay::deleteCareer(Career* career)
 
 void Gameplay::saveCareers(void)
 {
-    TiXmlDocument* index = new TiXmlDocument( "./usr/index.xml" );
-    for( unsigned int i=0; i<_careers.size(); i++ )
-    {
-        _careers[i]->save( index );
-    }
-    index->SaveFile();
-    delete index;
+    if( _careerStore ) _careerStore->save( _careers );
 }
 
 /**
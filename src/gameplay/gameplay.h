@@ -16,6 +16,7 @@
 #include "render.h"
 #include "memstream.h"
 #include "actionmap.h"
+#include "careerstore.h"
 
 using namespace ccor;
 
@@ -34,6 +35,7 @@ private:
     OutputStream          _outputStream;    // NX output stream
     std::stack<Activity*> _activities;      // callstack of activities
     std::vector<Career*>  _careers;         // container of careers
+    CareerStore*          _careerStore;     // persistent storage of careers
     RenderTarget*         _renderTarget;    // current render target
     ActionChannelM        _actionChannels;  // input action mapping
     input::IInputDevice*  _inputDevice;     // current input device
@@ -353,6 +353,16 @@ void Geoscape::onReturnFromActivity(Activity* activity)
     {
         // obtain time passed in scene
         _passedTime = scene->getPassedTime();
+        // checkpoint career progress (journal receives changed records only),
+        // progress is saved again on next checkpoint if this one fails
+        try
+        {
+            Gameplay::iGameplay->saveCareers();
+        }
+        catch( ccor::Exception& exception )
+        {
+            getCore()->logMessage( "Cannot save careers: %s", exception.getMsg() );
+        }
         // check player health
         if( _career->getVirtues()->evolution.health == 0.0f )
         {
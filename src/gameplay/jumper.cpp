@@ -760,40 +760,21 @@ void Jumper::onRoaming(float dt)
             maxDistance = ( 0.25f * walkForward->getVelocity() );
         }
 
-        // sense enclosure bounds before the character
-        _sensor->sense(
-            _clump->getFrame()->getPos() + Vector3f(0,25,0), // Vector3f(0,180,0),
-            _clump->getFrame()->getAt() * maxDistance,
-            _enclosure->getCollisionAtomic()
-        );
+        // sense enclosure bounds before and behind the character
+        Vector3f sensePos[2];
+        Vector3f senseDir[2];
+        sensePos[0] = sensePos[1] = _clump->getFrame()->getPos() + Vector3f(0,25,0); // Vector3f(0,180,0),
+        senseDir[0] = _clump->getFrame()->getAt() * maxDistance;
+        senseDir[1] = _clump->getFrame()->getAt() * -maxDistance;
+        _sensor->sense( 2, sensePos, senseDir, _enclosure->getCollisionAtomic() );
         bool isAbyss = false;
-        float distanceToAbyss = maxDistance;
-	unsigned int i;
-        for( i=0; i<_sensor->getNumIntersections(); i++ )
-        {
-            if( strcmp( _sensor->getIntersection(i)->shader->getName(), "EnclosureAbyss" ) == 0 )
-            {
-                distanceToAbyss = _sensor->getIntersection(i)->distance;
-                isAbyss = true;
-                break;
-            }
-        }
-
-        // sense enclosure bounds behind the character
-        _sensor->sense(
-            _clump->getFrame()->getPos() + Vector3f(0,25,0), //Vector3f(0,180,0),
-            _clump->getFrame()->getAt() * -maxDistance,
-            _enclosure->getCollisionAtomic()
-        );
         bool isAbyssBehind = false;
-        distanceToAbyss = maxDistance;
+	unsigned int i;
         for( i=0; i<_sensor->getNumIntersections(); i++ )
         {
             if( strcmp( _sensor->getIntersection(i)->shader->getName(), "EnclosureAbyss" ) == 0 )
             {
-                distanceToAbyss = _sensor->getIntersection(i)->distance;
-                isAbyssBehind = true;
-                break;
+                if( _sensor->getIntersectionRayId(i) == 0 ) isAbyss = true; else isAbyssBehind = true;
             }
         }
         
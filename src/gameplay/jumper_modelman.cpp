@@ -79,24 +79,28 @@ void Jumper::placeCord(Matrix4f& instanceMatrix, const Vector3f& p0, const Vecto
 
 engine::IAtomic* Jumper::getRisers(engine::IClump* clump)
 {
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Parachute_risers03_Parashute_risers_poly" );
     engine::IAtomic* risers;
-    risers = Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "Parachute_risers03_Parashute_risers_poly" ) ); assert( risers );
+    risers = Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) ); assert( risers );
     return risers;
 }
 
 engine::IFrame* Jumper::getChestFrame(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Grud_" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Grud_" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getPelvisFrame(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Taz" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Taz" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getHeadFrame(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Head" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Head" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 unsigned int Jumper::getNumHeads(engine::IClump* clump)
@@ -218,32 +222,38 @@ void Jumper::setNoHelmet(engine::IClump* clump)
 
 engine::IAtomic* Jumper::getLeftHand(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "polySurface619" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "polySurface619" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 engine::IAtomic* Jumper::getRightHand(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "polySurface573" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "polySurface573" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 engine::IAtomic* Jumper::getLeftEye(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "polySurface582" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "polySurface582" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 engine::IAtomic* Jumper::getRightEye(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "polySurface620" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "polySurface620" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 engine::IAtomic* Jumper::getLeftRing(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "LD_poly" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "LD_poly" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 engine::IAtomic* Jumper::getRightRing(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "RD_poly" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "RD_poly" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 unsigned int Jumper::getNumBodies(engine::IClump* clump)
@@ -289,107 +299,128 @@ void Jumper::setBody(engine::IClump* clump, unsigned int bodyId, Jumper* jumper)
 
 engine::IAtomic* Jumper::getCollisionFF(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "CollisionFF" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "CollisionFF" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 engine::IAtomic* Jumper::getCollisionFC(engine::IClump* clump)
 {
-    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), "CollisionFC" ) );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "CollisionFC" );
+    return Gameplay::iEngine->getAtomic( clump, Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle ) );
 }
 
 engine::IFrame* Jumper::getBackBone(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Poyasnitsa" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Poyasnitsa" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getLeftLegBone(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Hip_Joint" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Hip_Joint" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getRightLegBone(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Hip_Joint1" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Hip_Joint1" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getLineHandJoint(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "LineHandJoint" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "LineHandJoint" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getLineRigJoint(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "LineRigJoint" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "LineRigJoint" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getFrontLeftRiser(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Parachute_risers03_LRisers_back_End1" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Parachute_risers03_LRisers_back_End1" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getFrontRightRiser(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Parachute_risers03_RRisers_front_End" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Parachute_risers03_RRisers_front_End" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getRearLeftRiser(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Parachute_risers03_LRisers_back_End" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Parachute_risers03_LRisers_back_End" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getRearRightRiser(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Parachute_risers03_RRisers_back_End" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Parachute_risers03_RRisers_back_End" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getPhysicsJointFrontLeft(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointFrontLeft" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointFrontLeft" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getPhysicsJointFrontRight(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointFrontRight" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointFrontRight" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getPhysicsJointRearLeft(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointRearLeft" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointRearLeft" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getPhysicsJointRearRight(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "PhysicsJointRearRight" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "PhysicsJointRearRight" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getFirstPersonFrame(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "FirstPerson" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "FirstPerson" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getHelmetEquipAnchor(engine::IClump* clump)
 {
-    engine::IFrame* helmetEquipAnchor = Gameplay::iEngine->findFrame( clump->getFrame(), "joint6" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "joint6" );
+    engine::IFrame* helmetEquipAnchor = Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
     assert( helmetEquipAnchor );
     return helmetEquipAnchor;
 }
 
 engine::IFrame* Jumper::getSuitEquipAnchor(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Poyasnitsa" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Poyasnitsa" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getRigEquipAnchor(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "RKluchitsa1" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "RKluchitsa1" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getLeftSmokeJetAnchor(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Ankle_Joint" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Ankle_Joint" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
 
 engine::IFrame* Jumper::getRightSmokeJetAnchor(engine::IClump* clump)
 {
-    return Gameplay::iEngine->findFrame( clump->getFrame(), "Ankle_Joint1" );
+    static engine::FrameHandle frameHandle = Gameplay::iEngine->getFrameHandle( "Ankle_Joint1" );
+    return Gameplay::iEngine->findFrame( clump->getFrame(), frameHandle );
 }
\ No newline at end of file
@@ -708,26 +708,34 @@ void Mission::onUpdateActivity(float dt)
         }
 
         // collect forest actors
-        unsigned int forestId;
         std::vector<Forest*> forests;
         getScene()->getScenery()->happen( this, EVENT_FOREST_ENUMERATE, &forests );
 
         // update physics
         _phTimeLeft += dt;
-        while( _phTimeLeft > simulationStepTime )
+
+        // consume step simulated in background during previous frame
+        if( _scene->fetchPhysicsStep() ) 
         {
-                // begin to simulate physics
-                _scene->getPhScene()->simulate( simulationStepTime );
-                _scene->getPhScene()->flushStream();
-                _scene->getPhScene()->fetchResults( NX_RIGID_BODY_FINISHED, true );
-                updatePhysics();
-                _phTimeLeft -= simulationStepTime;
+                consumePhysicsStep( forests );
+        }
 
-                // forest interaction
-                for( forestId=0; forestId<forests.size(); forestId++ )
-                {
-                        forests[forestId]->simulateInteraction( _player );
-                }
+        // bounded catch-up, time that slow frame can't be simulated in is dropped
+        if( _phTimeLeft > maxSimulationSteps * simulationStepTime )
+        {
+                _phTimeLeft = maxSimulationSteps * simulationStepTime;
+        }
+
+        // in pipelined mode the last step is left to be simulated in background
+        float phReservedTime = _scene->isPhysicsPipelined() ? simulationStepTime : 0.0f;
+        while( _phTimeLeft > simulationStepTime + phReservedTime )
+        {
+                _scene->simulatePhysicsStep();
+                consumePhysicsStep( forests );
+        }
+        if( phReservedTime > 0 && _phTimeLeft > simulationStepTime )
+        {
+                _scene->queryPhysicsStep();
         }
         _scene->getPhScene()->visualize();
 
@@ -848,6 +856,18 @@ bool Mission::endOfMode(void)
         return _endOfMission;
 }
 
+void Mission::consumePhysicsStep(std::vector<Forest*>& forests)
+{
+        updatePhysics();
+        _phTimeLeft -= simulationStepTime;
+
+        // forest interaction
+        for( unsigned int forestId=0; forestId<forests.size(); forestId++ )
+        {
+                forests[forestId]->simulateInteraction( _player );
+        }
+}
+
 /**
 * complex behaviour
 */
@@ -8,6 +8,8 @@
 #include "sensor.h"
 #include "jumper.h"
 
+class Forest;
+
 /**
  * mission mode
  */
@@ -166,6 +168,9 @@ private:
     float                  _fadTimeout;     // flight mode acceleration timeout
     float                  _phTimeLeft;     // it is needs for forced timestep simulation support
     float                  _interruptTimeout; // delays interrupt mode activation
+private:
+    // applies results of physics step
+    void consumePhysicsStep(std::vector<Forest*>& forests);
 public:
     // actor abstracts
     virtual void onUpdateActivity(float dt);
@@ -204,18 +204,17 @@ public:
                      _player->getCanopySimulator()->getInflation() < 0.25f )
             {
                 Vector3f currPos = _player->getClump()->getFrame()->getPos();
+                // sense movement segment in both directions
+                Vector3f sensePos[2] = { _prevPos, currPos };
+                Vector3f senseDir[2] = { currPos - _prevPos, _prevPos - currPos };
                 if( !_overBridge )
                 {
-                    _sensor->sense( _prevPos, currPos - _prevPos, _overBridgeTrigger );
-                    if( _sensor->getNumIntersections() ) _overBridge = true;
-                    _sensor->sense( currPos, _prevPos - currPos, _overBridgeTrigger );
+                    _sensor->sense( 2, sensePos, senseDir, _overBridgeTrigger );
                     if( _sensor->getNumIntersections() ) _overBridge = true;
                 }
                 if( !_underBridge )
                 {
-                    _sensor->sense( _prevPos, currPos - _prevPos, _underBridgeTrigger );
-                    if( _sensor->getNumIntersections() ) _underBridge = true;
-                    _sensor->sense( currPos, _prevPos - currPos, _underBridgeTrigger );
+                    _sensor->sense( 2, sensePos, senseDir, _underBridgeTrigger );
                     if( _sensor->getNumIntersections() ) _underBridge = true;
                 }
                 _prevPos = currPos;
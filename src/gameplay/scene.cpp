@@ -50,10 +50,22 @@ Scene::Scene(Career* career, Location* location, float holdingTime)
     _collisionGeometry = NULL;
     
     _phScene = NULL;
+    _phStepQuery    = false;
+    _phStepInFlight = false;
+    _phStepFetched  = false;
     _phTerrainVerts     = NULL;
     _phTerrainTriangles = NULL;
     _phTerrainMaterials = NULL;
 
+    // pipelined physics stepping is enabled by default
+    int pipelinedPhysics;
+    TiXmlElement* details = Gameplay::iGameplay->getConfigElement( "details" );
+    if( !details || !details->Attribute( "pipelinedPhysics", &pipelinedPhysics ) )
+    {
+        pipelinedPhysics = 1;
+    }
+    _phPipelined = ( pipelinedPhysics != 0 );
+
     // database record for scene location 
     _locationInfo = database::LocationInfo::getRecord( _location->getDatabaseId() );    
     _reverberation = new database::LocationInfo::Reverberation();
@@ -85,6 +97,9 @@ Scene::Scene(Career* career, Location* location, float holdingTime)
 
 Scene::~Scene()
 {
+    // background physics step should be finished before actors are released
+    finishPhysicsStep();
+
     // clipping  helper
     delete _clipRay;
 
@@ -667,6 +682,14 @@ void Scene::updateActivity(float dt)
         return;
     }
 
+    // results of step simulated during previous frame
+    if( _phStepInFlight )
+    {
+        _phScene->fetchResults( NX_RIGID_BODY_FINISHED, true );
+        _phStepInFlight = false;
+        _phStepFetched  = true;
+    }
+
     // tune scene reverberation
     #ifdef GAMEPLAY_DEVELOPER_EDITION
         if( _reverberation )
@@ -762,6 +785,7 @@ void Scene::updateActivity(float dt)
     {
         if( _modes.top()->endOfMode() )
         {
+            _phStepFetched = false;
             _modes.top()->onSuspend();
             delete _modes.top();
             _modes.pop();
@@ -771,6 +795,7 @@ void Scene::updateActivity(float dt)
     // add mode queries
     if( _modeQuery )
     {
+        _phStepFetched = false;
         if( _modes.size() ) _modes.top()->onSuspend();
         _modes.push( _modeQuery );
         _modes.top()->onResume();
@@ -824,6 +849,18 @@ void Scene::updateActivity(float dt)
             _endOfActivity = true;
         }
     }
+
+    // start background physics step, it is simulated while frame is rendered
+    if( _phStepQuery )
+    {
+        _phStepQuery = false;
+        if( !_endOfActivity )
+        {
+            _phScene->simulate( simulationStepTime );
+            _phScene->flushStream();
+            _phStepInFlight = true;
+        }
+    }
 }
 
 bool Scene::endOfActivity(void)
@@ -839,6 +876,8 @@ void Scene::onBecomeActive(void)
 
 void Scene::onBecomeInactive(void)
 {
+    finishPhysicsStep();
+
     // unregister progress callback
     Gameplay::iEngine->setProgressCallback( NULL, NULL );
 }
@@ -847,6 +886,38 @@ void Scene::onBecomeInactive(void)
  * class complicated behaviour 
  */
 
+void Scene::simulatePhysicsStep(void)
+{
+    assert( !_phStepInFlight );
+    _phScene->simulate( simulationStepTime );
+    _phScene->flushStream();
+    _phScene->fetchResults( NX_RIGID_BODY_FINISHED, true );
+}
+
+void Scene::queryPhysicsStep(void)
+{
+    assert( _phPipelined );
+    _phStepQuery = true;
+}
+
+bool Scene::fetchPhysicsStep(void)
+{
+    bool result = _phStepFetched;
+    _phStepFetched = false;
+    return result;
+}
+
+void Scene::finishPhysicsStep(void)
+{
+    _phStepQuery = false;
+    if( _phStepInFlight )
+    {
+        _phScene->fetchResults( NX_RIGID_BODY_FINISHED, true );
+        _phStepInFlight = false;
+        _phStepFetched  = true;
+    }
+}
+
 void Scene::endOfScene(void)
 {
     _endOfActivity = true;
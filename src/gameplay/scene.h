@@ -124,6 +124,7 @@ public:
 #define FRAMETIME(F) ( float(F)*3.0f/100.0f )
 
 const float simulationStepTime = 1.0f/100.0f;
+const unsigned int maxSimulationSteps = 10; // per frame, time of slower frames is dropped
 const float maxHoldingTime = HOURS_TO_MINUTES(12);
 
 class Scene : public Activity,
@@ -204,6 +205,10 @@ private:
     NxMaterial*             _phFleshMaterial;       // generic flesh material
     NxMaterial*             _phMovingFleshMaterial; // moving flesh material (like feets motion)
     NxMaterial*             _phClothMaterial;       // cloth material
+    bool                    _phPipelined;           // pipelined stepping mode
+    bool                    _phStepQuery;           // background step is queried for the end of act cycle
+    bool                    _phStepInFlight;        // background step is simulated
+    bool                    _phStepFetched;         // results of background step are fetched and not consumed
 public:
     // engine progress callback
     static void progressCallback(const wchar_t* description, float progress, void* userData);
@@ -262,6 +267,13 @@ public:
     void addSmokeTrail(engine::IRendering* smokeTrail);
     void removeSmokeTrail(engine::IRendering* smokeTrail);
     bool clipCameraRay(const Vector3f& targetPos, const Vector3f& cameraPos, float& clipDistance);
+    // physics stepping : in pipelined mode the last step of act cycle is simulated 
+    // in background while frame is rendered, its results are fetched at the beginning 
+    // of the next act cycle, before any actor is able to modify physics
+    void simulatePhysicsStep(void);
+    void queryPhysicsStep(void);
+    bool fetchPhysicsStep(void);  // returns true once for each fetched background step
+    void finishPhysicsStep(void); // waits for background step, so physics may be modified
 public:
     // inlinez
     inline Career* getCareer(void) { return _career; }
@@ -279,6 +291,7 @@ public:
     inline NxMaterial* getPhMovingFleshMaterial(void) { return _phMovingFleshMaterial; }
     inline NxMaterial* getPhClothMaterial(void) { return _phClothMaterial; }
     inline bool isHUDEnabled(void) { return _isHUDEnabled; }
+    inline bool isPhysicsPipelined(void) { return _phPipelined; }
     inline database::LocationInfo* getLocationInfo(void) { return _locationInfo; }
     inline database::LocationInfo::Weather* getLocationWeather(void) { return _locationWeather; }
     inline database::LocationInfo::Reverberation* getReverberation(void) { return _reverberation; }
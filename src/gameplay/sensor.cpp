@@ -22,12 +22,28 @@ engine::CollisionTriangle* Sensor::onIntersection(
 {
     Sensor* sensor = (Sensor*)( data );
     sensor->_intersections.push_back( *collTriangle );
+    sensor->_rayIds.push_back( 0 );
+    return collTriangle;
+}
+
+engine::CollisionTriangle* Sensor::onBatchIntersection(
+    unsigned int rayId,
+    engine::CollisionTriangle* collTriangle,
+    engine::IBSPSector* sector,
+    engine::IAtomic* atomic,
+    void* data
+)
+{
+    Sensor* sensor = (Sensor*)( data );
+    sensor->_intersections.push_back( *collTriangle );
+    sensor->_rayIds.push_back( rayId );
     return collTriangle;
 }
 
 void Sensor::sense(const Vector3f& pos, const Vector3f& dir, engine::IBSP* bsp)
 {
     _intersections.clear();
+    _rayIds.clear();
     _rayIntersection->setRay( pos, dir );
     _rayIntersection->intersect( bsp, onIntersection, this );
 }
@@ -35,6 +51,21 @@ void Sensor::sense(const Vector3f& pos, const Vector3f& dir, engine::IBSP* bsp)
 void Sensor::sense(const Vector3f& pos, const Vector3f& dir, engine::IAtomic* atomic)
 {
     _intersections.clear();
+    _rayIds.clear();
     _rayIntersection->setRay( pos, dir );
     _rayIntersection->intersect( atomic, onIntersection, this );
-}
\ No newline at end of file
+}
+
+void Sensor::sense(unsigned int numRays, const Vector3f* pos, const Vector3f* dir, engine::IBSP* bsp)
+{
+    _intersections.clear();
+    _rayIds.clear();
+    _rayIntersection->intersect( numRays, pos, dir, bsp, onBatchIntersection, this );
+}
+
+void Sensor::sense(unsigned int numRays, const Vector3f* pos, const Vector3f* dir, engine::IAtomic* atomic)
+{
+    _intersections.clear();
+    _rayIds.clear();
+    _rayIntersection->intersect( numRays, pos, dir, atomic, onBatchIntersection, this );
+}
@@ -18,6 +18,7 @@ private:
 private:
     engine::IRayIntersection* _rayIntersection;
     IntersectionV             _intersections;
+    std::vector<unsigned int> _rayIds;
     callback::ClumpL          _clumpL;
 private:
     static engine::CollisionTriangle* onIntersection(
@@ -26,12 +27,22 @@ private:
         engine::IAtomic* atomic,
         void* data
     );
+    static engine::CollisionTriangle* onBatchIntersection(
+        unsigned int rayId,
+        engine::CollisionTriangle* collTriangle,
+        engine::IBSPSector* sector,
+        engine::IAtomic* atomic,
+        void* data
+    );
 public:
     Sensor();
     virtual ~Sensor();
 public:
     void sense(const Vector3f& pos, const Vector3f& dir, engine::IBSP* bsp);
     void sense(const Vector3f& pos, const Vector3f& dir, engine::IAtomic* atomic);
+    // batch sensing, intersections of all rays are collected in one list
+    void sense(unsigned int numRays, const Vector3f* pos, const Vector3f* dir, engine::IBSP* bsp);
+    void sense(unsigned int numRays, const Vector3f* pos, const Vector3f* dir, engine::IAtomic* atomic);
 public:
     inline unsigned int getNumIntersections(void) 
     { 
@@ -42,6 +53,11 @@ public:
         assert( iid >= 0 && iid < _intersections.size() );
         return &_intersections[iid];
     }
+    inline unsigned int getIntersectionRayId(unsigned int iid)
+    {
+        assert( iid >= 0 && iid < _rayIds.size() );
+        return _rayIds[iid];
+    }
 };
 
 /**
@@ -40,6 +40,12 @@ const float wishWatchTimeMax  = 10.0f;
 const float wishRelaxTimeMin  = 1.0f;
 const float wishRelaxTimeMax  = 10.0f;
 
+/**
+ * default time granularity of shared spectator poses
+ */
+
+const float defaultPoseGranularity = FRAMETIME(1);
+
 /**
  * actor abstracts
  */
@@ -282,6 +288,15 @@ Spectator::Spectator(Crowd* crowd, engine::IClump* cloneSource, Enclosure* enclo
     );
     _clump->getFrame()->getLTM();
 
+    // share poses with other spectators, granularity is configurable
+    double poseGranularity;
+    TiXmlElement* details = Gameplay::iGameplay->getConfigElement( "details" );
+    if( !details || !details->Attribute( "crowdPoseGranularity", &poseGranularity ) )
+    {
+        poseGranularity = defaultPoseGranularity;
+    }
+    _clump->getAnimationController()->setPoseGranularity( float( poseGranularity ) );
+
     // setup idle action
     _action = new Character::Idle( _clump, &idleSequence, 0.2f, 1.0f );
 
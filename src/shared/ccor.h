@@ -14,6 +14,7 @@
 #include <cstdio>
 #include <cstring>
 #include <cstdarg>
+#include <cstdlib>
 #include "../shared/vector.h"
 #include "../shared/matrix.h"
 #include "../shared/product_version.h"
@@ -27,6 +28,7 @@ struct ManagedTriggerInfo;
 class TriggerObject;
 class EntityBase;
 class Exception;
+class ParamKey;
 class ParamPackListener;
 class IBase;
 class ICore;
@@ -483,6 +485,28 @@ public:
     virtual const char * __stdcall getName() = 0;
 
     virtual void __stdcall release() = 0;
+
+    /**
+     * Direct read-only access to resource contents.
+     * Resources served from packed archives return pointer into mapped archive
+     * (or into buffer inflated once), so no temporary file is involved.
+     * Loose files are mapped into memory on first call.
+     * @return Pointer to getSize() bytes or NULL if resource isn't memory-resident, use getFile() then
+     */
+    virtual const void * __stdcall getData() = 0;
+
+    /**
+     * @return Size of resource contents in bytes
+     */
+    virtual unsigned int __stdcall getSize() = 0;
+
+    /**
+     * Read whole resource into caller's memory, compressed archive entries are
+     * inflated directly into the buffer.
+     * @param buffer Destination, must hold at least getSize() bytes
+     * @return Number of bytes read
+     */
+    virtual unsigned int __stdcall readData(void * buffer, unsigned int bufferSize) = 0;
 };
 
 
@@ -597,6 +621,17 @@ public:
      */
     virtual void __stdcall setActivity(entid_t id, float activityRate) = 0;
 
+    /**
+     * Allow entities of type to act concurrently with entities of other concurrent types.
+     * Types act on main thread by default. Concurrent types act after all others, their
+     * entityAct() must not touch state shared with other types, create or destroy entities
+     * and change activity (core throws then). Log messages of concurrent acts are written
+     * by main thread after all workers are done.
+     * @param type Entity type name
+     * @param concurrent True to act type on worker threads
+     */
+    virtual void __stdcall setConcurrentType(const char * type, bool concurrent) = 0;
+
 //
 // Global ids management
 //
@@ -975,6 +1010,81 @@ public:
 
 
 
+#define PARAM_KEY_SIZE 256
+
+/**
+ * Hash of parameter name (FNV-1a), names are case-sensitive
+ */
+inline unsigned int hashParamName(const char * name) {
+    unsigned int hash = 2166136261u;
+    while(*name) {
+        hash ^= (unsigned char)(*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Normalize qualified name for lookup: index in last brackets is
+ * printed with 4 digits ("a[2]" -> "a[0002]"), zero index is dropped ("a[0]" -> "a")
+ * @return False when normalized name doesn't fit into dest, dest is left empty then
+ */
+inline bool normalizeParamName(char * dest, const char * src, int destSize) {
+    const char * leftBracket = ::strrchr(src, '[');
+    int prefixLength = leftBracket ? leftBracket - src : ::strlen(src);
+    if(prefixLength + 8 > destSize) {
+        if(destSize > 0) dest[0] = '\0';
+        return false;
+    }
+    ::strncpy(dest, src, prefixLength);
+    dest[prefixLength] = '\0';
+    if(leftBracket) {
+        int i = ::atoi(leftBracket + 1);
+        if(i) ::sprintf(dest + prefixLength, "[%04d]", i);
+    }
+    return true;
+}
+
+/**
+ * Precompiled parameter name. Name is normalized & hashed once, 
+ * resolved id is cached until pack revision changes. Use it to read
+ * parameters, which are accessed frequently:
+ *
+ *  static ParamKey key("engine.viewport.width");
+ *  int width = pack->getv(key.resolve(pack), 0);
+ */
+class ParamKey {
+private:
+
+    char name[PARAM_KEY_SIZE];
+    unsigned int hash;
+    IParamPack * pack;
+    unsigned int revision;
+    paramid_t id;
+
+public:
+
+    ParamKey(const char * qualifiedName) {
+        assert(qualifiedName && !::strchr(qualifiedName, '*'));
+        if(!normalizeParamName(name, qualifiedName, PARAM_KEY_SIZE))
+            assert(!"ccor : name of parameter key is too long");
+        hash = hashParamName(name);
+        pack = 0;
+        revision = 0;
+        id = -1;
+    }
+
+    const char * getName() const { return name; }
+
+    unsigned int getHash() const { return hash; }
+
+    /**
+     * Find parameter in pack, id is cached for subsequent calls
+     * @return Parameter id or -1 if no such parameter
+     */
+    inline paramid_t resolve(IParamPack * pack);
+};
+
 /**
  * Pack of parameters
  *
@@ -1410,6 +1520,21 @@ public:
      */
     virtual paramid_t __stdcall find(const char * qualifiedName) = 0;
 
+    /**
+     * Find parameter by precompiled name
+     * @param key Precompiled parameter name
+     * @return Parameter id or -1 if no such parameter
+     */
+    virtual paramid_t __stdcall find(const ParamKey & key) = 0;
+
+    /**
+     * Get structure revision of this pack. Revision is changed when 
+     * parameter ids become invalid (pack is cleared or reloaded),
+     * revisions are never reused by other packs of process.
+     * @return Revision number
+     */
+    virtual unsigned int __stdcall getRevision() = 0;
+
     /**
      * Find parameter by name
      * @param templateName Parameter template (may contain '*')
@@ -1489,6 +1614,16 @@ public:
     /*# ParamPackFactory _ParamPackFactory; */
 };
 
+inline paramid_t ParamKey::resolve(IParamPack * pack) {
+    unsigned int packRevision = pack->getRevision();
+    if(id == -1 || this->pack != pack || revision != packRevision) {
+        id = pack->find(*this);
+        this->pack = pack;
+        revision = packRevision;
+    }
+    return id;
+}
+
 
 /**
  * Listener for pack of parameters.
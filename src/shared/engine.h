@@ -298,6 +298,13 @@ public:
 
 const  unsigned int maxDirtyFrames = 4096;
 
+/**
+ * frame handle is an interned frame name,
+ * it is resolved once and used for fast lookup of named frames (see IEngine::findFrame)
+ */
+
+typedef unsigned int FrameHandle;
+
 class IFrame;
 
 typedef IFrame* (*IFrameCallBack)(IFrame* frame, void* data);
@@ -688,6 +695,13 @@ public:
     virtual WeightSet* __stdcall getWeightSet(const char* weightSetName) = 0;
     virtual WeightSet* __stdcall getAnimationWeightSet(const char* weightSetName, const char* animationName) = 0;    
     virtual void __stdcall forAllAnimationWeightSets(const char* weightSetName, WeightSetCallBack callBack, void* data) = 0;
+public:
+    /**
+     * pose sharing : time of single active track is quantized by specified granularity, 
+     * pose is evaluated once per quantized time and shared by all controllers of the same 
+     * animation set (clones of the same clump); zero granularity disables sharing
+     */
+    virtual void __stdcall setPoseGranularity(float granularity) = 0;
 };
 
 /**
@@ -984,6 +998,19 @@ typedef CollisionTriangle* (*CollisionCallBack)(
     void* data                       // optional user data
 );
 
+/**
+ * batch callback receives index of ray in the batch,
+ * returning NULL stops testing of this ray only
+ */
+
+typedef CollisionTriangle* (*RayBatchCallBack)(
+    unsigned int rayId,              // index of ray in batch
+    CollisionTriangle* collTriangle, // collision triangle data
+    engine::IBSPSector* sector,      // defines collision sector
+    engine::IAtomic* atomic,         // defines collision atomic
+    void* data                       // optional user data
+);
+
 class IRayIntersection
 {
 public:
@@ -993,6 +1020,11 @@ public:
     virtual void __stdcall setRay(const Vector3f& start, const Vector3f& direction) = 0;    
     virtual void __stdcall intersect(IBSP* bsp, CollisionCallBack callBack, void* data) = 0;
     virtual void __stdcall intersect(IAtomic* atomic, CollisionCallBack callBack, void* data) = 0;
+    /**
+     * batch queries: rays (starts[i], directions[i]) are tested in SIMD packets
+     */
+    virtual void __stdcall intersect(unsigned int numRays, const Vector3f* starts, const Vector3f* directions, IBSP* bsp, RayBatchCallBack callBack, void* data) = 0;
+    virtual void __stdcall intersect(unsigned int numRays, const Vector3f* starts, const Vector3f* directions, IAtomic* atomic, RayBatchCallBack callBack, void* data) = 0;
 };
 
 class ISphereIntersection
@@ -1059,6 +1091,10 @@ public:
      */
     virtual void __stdcall suspend(void) = 0;
     virtual void __stdcall resume(void) = 0;
+    /**
+     * cancels loading, getAsset() returns NULL for cancelled loader
+     */
+    virtual void __stdcall cancel(void) = 0;
 };
 
 /**
@@ -1256,6 +1292,8 @@ public:
      * utilites     
      */
     virtual IFrame* __stdcall findFrame(IFrame* root, const char* frameName) = 0;
+    virtual FrameHandle __stdcall getFrameHandle(const char* frameName) = 0;
+    virtual IFrame* __stdcall findFrame(IFrame* root, FrameHandle frameHandle) = 0;
     virtual IAtomic* __stdcall getAtomic(IClump* clump, IFrame* frame) = 0;
     virtual Mesh* __stdcall createMesh(unsigned int numVertices, unsigned int numTriangles, unsigned int numUVs) = 0;
     virtual void __stdcall releaseMesh(Mesh* mesh) = 0;
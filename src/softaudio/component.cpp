@@ -0,0 +1,439 @@
+
+#include "headers.h"
+#include "../shared/ccor.h"
+#include "../shared/product_version.h"
+#include "../shared/audio.h"
+#include "../shared/mainwnd.h"
+
+#include "ogg.h"
+#include "mixer.h"
+#include "sink.h"
+
+using namespace ccor;
+
+/**
+ * software mixer configuration (element "softaudio" of ./cfg/config.xml):
+ *  - sink; "null" discards output, "wave" writes output to file
+ *  - file; name of output file for wave sink
+ *  - rate; output sampling rate
+ */
+
+#define SOFTAUDIO_DEFAULT_RATE 44100
+#define SOFTAUDIO_DEFAULT_FILE "./softaudio.wav"
+#define SOFTAUDIO_MAX_LATENCY  0.5f // longest interval rendered by single act, in seconds
+
+/**
+ * decoded PCM data, shared by static sounds of same resource & reverbs
+ */
+
+class StaticData
+{
+private:
+    typedef std::map<std::string,StaticData*> StaticDataM;
+    typedef StaticDataM::iterator StaticDataI;
+private:
+    static StaticDataM _staticData;
+private:
+    std::string        _key;
+    unsigned int       _numChannels;
+    unsigned int       _samplingRate;
+    std::vector<short> _samples;
+    unsigned int       _refCount;
+private:
+    StaticData(const char* resourceName, const std::string& key, audio::Reverb* reverbs) : _key( key ), _refCount( 0 )
+    {
+        OggFile oggFile( resourceName );
+        _numChannels  = oggFile.getNumChannels();
+        _samplingRate = oggFile.getSamplingRate();
+        _samples.resize( oggFile.getSize() / sizeof( short ) );
+        if( _samples.size() )
+        {
+            _samples.resize( oggFile.readBlock( &_samples[0], _samples.size() * sizeof( short ) ) / sizeof( short ) );
+        }
+        if( reverbs && _samples.size() ) applyReverbs( reverbs );
+    }
+    /**
+     * echoes are baked into samples, same way as OpenAL backend does:
+     * each echo is a copy of original, delayed cyclically by shift & attenuated by gain
+     */
+    void applyReverbs(audio::Reverb* reverbs)
+    {
+        std::vector<short> original( _samples );
+        unsigned int numSamples = _samples.size();
+        unsigned int refSamples = _samplingRate * _numChannels;
+        for( audio::Reverb* reverb = reverbs; reverb->shift != 0.0f && reverb->gain != 0.0f; reverb++ )
+        {
+            unsigned int offset = (unsigned int)( refSamples * reverb->shift ) % numSamples;
+            if( _numChannels == 2 && offset % 2 ) offset--;
+            for( unsigned int i=0; i<numSamples; i++ )
+            {
+                unsigned int j = offset + i;
+                if( j >= numSamples ) j -= numSamples;
+                float sample = float( _samples[j] ) + float( original[i] ) * reverb->gain;
+                sample = sample > 32767 ? 32767 : sample;
+                sample = sample < -32768 ? -32768 : sample;
+                _samples[j] = short( sample );
+            }
+        }
+    }
+    static std::string getKey(const char* resourceName, audio::Reverb* reverbs)
+    {
+        std::string key = resourceName;
+        for( audio::Reverb* reverb = reverbs; reverb && reverb->shift != 0.0f && reverb->gain != 0.0f; reverb++ )
+        {
+            char echo[64];
+            sprintf( echo, "|%g:%g", reverb->shift, reverb->gain );
+            key += echo;
+        }
+        return key;
+    }
+public:
+    inline unsigned int getNumChannels(void) { return _numChannels; }
+    inline unsigned int getSamplingRate(void) { return _samplingRate; }
+    inline unsigned int getNumFrames(void) { return _samples.size() / _numChannels; }
+    inline const short* getSamples(void) { return _samples.size() ? &_samples[0] : NULL; }
+public:
+    static StaticData* acquire(const char* resourceName, audio::Reverb* reverbs = NULL)
+    {
+        StaticData* staticData;
+        std::string key = getKey( resourceName, reverbs );
+        StaticDataI staticDataI = _staticData.find( key );
+        if( staticDataI != _staticData.end() )
+        {
+            staticData = staticDataI->second;
+        }
+        else
+        {
+            staticData = new StaticData( resourceName, key, reverbs );
+            _staticData.insert( StaticDataM::value_type( key, staticData ) );
+        }
+        staticData->_refCount++;
+        return staticData;
+    }
+    void release(void)
+    {
+        assert( _refCount );
+        _refCount--;
+        if( !_refCount )
+        {
+            _staticData.erase( _key );
+            delete this;
+        }
+    }
+};
+
+StaticData::StaticDataM StaticData::_staticData;
+
+/**
+ * mixer sources
+ */
+
+static void deinterleave(const short* samples, unsigned int numChannels, float** channels, unsigned int numFrames)
+{
+    const float scale = 1.0f / 32768.0f;
+    if( numChannels == 1 )
+    {
+        for( unsigned int i=0; i<numFrames; i++ ) channels[0][i] = samples[i] * scale;
+    }
+    else
+    {
+        // extra channels are dropped
+        for( unsigned int i=0; i<numFrames; i++ )
+        {
+            channels[0][i] = samples[i*numChannels] * scale;
+            channels[1][i] = samples[i*numChannels+1] * scale;
+        }
+    }
+}
+
+class StaticSource : public MixerSource
+{
+private:
+    StaticData*  _data;
+    unsigned int _position;
+public:
+    StaticSource(StaticData* data) : _data( data ), _position( 0 ) {}
+    virtual ~StaticSource() { _data->release(); }
+public:
+    virtual unsigned int getNumChannels(void) { return _data->getNumChannels(); }
+    virtual unsigned int getSamplingRate(void) { return _data->getSamplingRate(); }
+    virtual unsigned int read(float** channels, unsigned int numFrames)
+    {
+        numFrames = std::min<unsigned int>( numFrames, _data->getNumFrames() - _position );
+        deinterleave( _data->getSamples() + _position * _data->getNumChannels(), _data->getNumChannels(), channels, numFrames );
+        _position += numFrames;
+        return numFrames;
+    }
+    virtual void rewind(void) { _position = 0; }
+};
+
+class StreamSource : public MixerSource
+{
+private:
+    OggFile*           _oggFile;
+    std::vector<short> _samples;
+public:
+    StreamSource(const char* resourceName, unsigned int bufferSize)
+    {
+        _oggFile = new OggFile( resourceName );
+        _samples.resize( std::max<unsigned int>( bufferSize / sizeof( short ), _oggFile->getNumChannels() ) );
+    }
+    virtual ~StreamSource() { delete _oggFile; }
+public:
+    virtual unsigned int getNumChannels(void) { return _oggFile->getNumChannels(); }
+    virtual unsigned int getSamplingRate(void) { return _oggFile->getSamplingRate(); }
+    virtual unsigned int read(float** channels, unsigned int numFrames)
+    {
+        unsigned int numChannels = _oggFile->getNumChannels();
+        numFrames = std::min<unsigned int>( numFrames, _samples.size() / numChannels );
+        unsigned int numBytes = _oggFile->readBlock( &_samples[0], numFrames * numChannels * sizeof( short ) );
+        numFrames = numBytes / ( numChannels * sizeof( short ) );
+        deinterleave( &_samples[0], numChannels, channels, numFrames );
+        return numFrames;
+    }
+    virtual void rewind(void) { _oggFile->reset(); }
+};
+
+/**
+ * ISound implementation : mixer voice
+ */
+
+class SoftSound : public audio::ISound
+{
+private:
+    Mixer*      _mixer;
+    MixerVoice* _voice;
+public:
+    SoftSound(Mixer* mixer, MixerSource* source) : _mixer( mixer )
+    {
+        _voice = _mixer->createVoice( source );
+    }
+    virtual ~SoftSound()
+    {
+        _mixer->releaseVoice( _voice );
+    }
+public:
+    virtual void __stdcall release(void)
+    {
+        delete this;
+    }
+    virtual bool __stdcall isPlaying(void)
+    {
+        return _voice->playing;
+    }
+    virtual void __stdcall play(void)
+    {
+        _voice->play();
+    }
+    virtual void __stdcall stop(void)
+    {
+        _voice->stop();
+    }
+    virtual void __stdcall setGain(float value)
+    {
+        _voice->gain = value;
+    }
+    virtual void __stdcall setLoop(bool loop)
+    {
+        _voice->looping = loop;
+    }
+    virtual void __stdcall setPitchShift(float value)
+    {
+        _voice->pitch = value;
+    }
+    virtual void __stdcall setDistanceModel(float refDist, float maxDist, float rolloff)
+    {
+        _voice->spatial = true;
+        _voice->refDist = refDist;
+        _voice->maxDist = maxDist;
+        _voice->rolloff = rolloff;
+    }
+    virtual void __stdcall setGainLimits(float minGain, float maxGain)
+    {
+        _voice->minGain = minGain;
+        _voice->maxGain = maxGain;
+    }
+    virtual void __stdcall place(const Vector3f& pos, const Vector3f& dir, float coneInnerAngle, float coneOuterAngle, float coneOuterGain, const Vector3f& vel)
+    {
+        _voice->spatial = true;
+        for( unsigned int i=0; i<3; i++ )
+        {
+            _voice->pos[i] = pos[i];
+            _voice->dir[i] = dir[i];
+            _voice->vel[i] = vel[i];
+        }
+        _voice->coneInnerAngle = coneInnerAngle;
+        _voice->coneOuterAngle = coneOuterAngle;
+        _voice->coneOuterGain  = coneOuterGain;
+    }
+    virtual void __stdcall place(const Vector3f& pos, const Vector3f& dir, float coneInnerAngle, float coneOuterAngle, float coneOuterGain)
+    {
+        place( pos, dir, coneInnerAngle, coneOuterAngle, coneOuterGain, Vector3f( 0,0,0 ) );
+    }
+    virtual void __stdcall place(const Vector3f& pos, const Vector3f& vel)
+    {
+        place( pos, Vector3f( 0,1,0 ), 360, 360, 1.0f, vel );
+    }
+    virtual void __stdcall place(const Vector3f& pos)
+    {
+        place( pos, Vector3f( 0,1,0 ), 360, 360, 1.0f, Vector3f( 0,0,0 ) );
+    }
+    virtual void __stdcall setReverberation(float inGain, float reverbMixDB, float reverbTime, float hfTimeRatio)
+    {
+        // sounds share single reverberation unit, presets are location-wide
+        _voice->reverbSend = inGain;
+        _mixer->setReverberation( reverbMixDB, reverbTime, hfTimeRatio );
+    }
+};
+
+/**
+ * IAudio implementation : software mixer
+ */
+
+const Vector3f zeroV( 0,0,0 );
+
+class Audio : public EntityBase,
+              virtual public audio::IAudio
+{
+private:
+    Mixer*             _mixer;
+    MixerSink*         _sink;
+    std::vector<short> _output;
+    float              _pendingTime;
+public:
+    Audio() : _mixer(NULL), _sink(NULL), _pendingTime(0)
+    {
+    }
+    ~Audio()
+    {
+        if( _sink ) delete _sink;
+        if( _mixer ) delete _mixer;
+    }
+public:
+    // EntityBase
+    virtual void __stdcall entityInit(Object * p)
+    {
+        std::string sinkName = "null";
+        std::string fileName = SOFTAUDIO_DEFAULT_FILE;
+        int rate = SOFTAUDIO_DEFAULT_RATE;
+
+        // read configuration, mixer runs with defaults if it is absent
+        TiXmlDocument* generalConfig = new TiXmlDocument( "./cfg/config.xml" );
+        if( generalConfig->LoadFile() )
+        {
+            TiXmlElement* softaudio = generalConfig->FirstChildElement( "softaudio" );
+            if( softaudio )
+            {
+                if( softaudio->Attribute( "sink" ) ) sinkName = softaudio->Attribute( "sink" );
+                if( softaudio->Attribute( "file" ) ) fileName = softaudio->Attribute( "file" );
+                if( !softaudio->Attribute( "rate", &rate ) || rate <= 0 ) rate = SOFTAUDIO_DEFAULT_RATE;
+            }
+        }
+        delete generalConfig;
+
+        _mixer = new Mixer( rate );
+        if( sinkName == "wave" )
+        {
+            WaveSink* waveSink = new WaveSink( fileName.c_str(), rate );
+            if( !waveSink->isOpen() )
+            {
+                delete waveSink;
+                throw Exception( "Cannot open file '%s' for audio output", fileName.c_str() );
+            }
+            _sink = waveSink;
+        }
+        else
+        {
+            _sink = new NullSink;
+        }
+    }
+    virtual void __stdcall entityAct(float dt)
+    {
+        // render elapsed time, long delays are dropped as device underrun
+        _pendingTime += dt;
+        if( _pendingTime > SOFTAUDIO_MAX_LATENCY ) _pendingTime = SOFTAUDIO_MAX_LATENCY;
+        unsigned int numFrames = unsigned int( _pendingTime * _mixer->getSamplingRate() ) & ~3;
+        if( !numFrames ) return;
+        _pendingTime -= float( numFrames ) / _mixer->getSamplingRate();
+
+        _output.resize( numFrames * 2 );
+        _mixer->render( &_output[0], numFrames );
+        _sink->write( &_output[0], numFrames );
+    }
+    virtual IBase * __stdcall entityAskInterface(iid_t id)
+    {
+        if( id == audio::IAudio::iid ) return this;
+        return NULL;
+    }
+    static EntityBase* creator()
+    {
+        return new Audio;
+    }
+    virtual void __stdcall entityDestroy()
+    {
+        delete this;
+    }
+public:
+    // IAudio
+    virtual void __stdcall setListener(const Vector3f& pos, const Vector3f& up, const Vector3f& at, const Vector3f& vel)
+    {
+        Vector3f normalUp = up; normalUp.normalize();
+        Vector3f normalAt = at; normalAt.normalize();
+        float p[3] = { pos[0], pos[1], pos[2] };
+        float v[3] = { vel[0], vel[1], vel[2] };
+        float u[3] = { normalUp[0], normalUp[1], normalUp[2] };
+        float a[3] = { normalAt[0], normalAt[1], normalAt[2] };
+        _mixer->setListener( p, v, u, a );
+    }
+    virtual void __stdcall setListener(const Matrix4f& matrix, const Vector3f& vel)
+    {
+        setListener(
+            Vector3f( matrix[3][0], matrix[3][1], matrix[3][2] ),
+            Vector3f( matrix[1][0], matrix[1][1], matrix[1][2] ),
+            Vector3f( matrix[2][0], matrix[2][1], matrix[2][2] ),
+            vel
+        );
+    }
+    virtual void __stdcall setListener(const Vector3f& pos, const Vector3f& up, const Vector3f& at)
+    {
+        setListener( pos, up, at, zeroV );
+    }
+    virtual void __stdcall setListener(const Matrix4f& matrix)
+    {
+        setListener( matrix, zeroV );
+    }
+    virtual void __stdcall setListenerGain(float value)
+    {
+        _mixer->setListenerGain( value );
+    }
+    virtual float __stdcall getListenerGain(void)
+    {
+        return _mixer->getListenerGain();
+    }
+    virtual void __stdcall setSpeedOfSound(float value)
+    {
+        _mixer->setSpeedOfSound( value );
+    }
+    virtual void __stdcall setDopplerFactor(float value)
+    {
+        _mixer->setDopplerFactor( value );
+    }
+    virtual audio::ISound* __stdcall createStaticSound(const char* resourceName)
+    {
+        return new SoftSound( _mixer, new StaticSource( StaticData::acquire( resourceName ) ) );
+    }
+    virtual audio::ISound* __stdcall createReverbSound(const char* resourceName, audio::Reverb* reverbs)
+    {
+        return new SoftSound( _mixer, new StaticSource( StaticData::acquire( resourceName, reverbs ) ) );
+    }
+    virtual audio::ISound* __stdcall createStreamSound(const char* resourceName, unsigned int numBuffers, unsigned int bufferSize)
+    {
+        return new SoftSound( _mixer, new StreamSource( resourceName, bufferSize ) );
+    }
+    virtual void __stdcall updateStreamSounds(void)
+    {
+        // streams are decoded by mixer on demand
+    }
+};
+
+SINGLE_ENTITY_COMPONENT(Audio);
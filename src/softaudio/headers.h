@@ -0,0 +1,30 @@
+/**
+ * This source code is a part of Metathrone game project. 
+ * (c) Perfect Play 2003.
+ */
+
+#define _WIN32_WINDOWS 0x0410
+#define WINVER 0x0400
+
+#pragma warning(disable:4786)
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <stack>
+#include <string>
+#include <vector>
+#include <list>
+#include <cstdarg>
+#include <windows.h>
+#include <windef.h>
+#include <winuser.h>
+#include <windowsx.h>
+#include <tchar.h>
+
+#include "tinyxml.h"
+
+#include "ogg/ogg.h"
+#include "vorbis/vorbisfile.h"
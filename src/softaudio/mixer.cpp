@@ -0,0 +1,553 @@
+
+#include <cmath>
+#include <cstring>
+#include <cassert>
+#include "mixer.h"
+
+/**
+ * tunings of reverberation unit (in frames at 44100 Hz)
+ */
+
+static const unsigned int reverbCombTuning[MIXER_REVERB_COMBS]     = { 1116, 1188, 1277, 1356 };
+static const unsigned int reverbAllpassTuning[MIXER_REVERB_PASSES] = { 556, 441 };
+static const unsigned int reverbStereoSpread                       = 23;
+static const float        reverbInputGain                          = 0.125f;
+static const float        reverbAllpassFeedback                    = 0.5f;
+static const float        reverbMaxDamping                         = 0.4f;
+
+/**
+ * SIMD kernels
+ */
+
+// output[i] = linear interpolation of input at pos + i * step
+static void resampleLinear(const float* input, float* output, unsigned int numFrames, float pos, float step)
+{
+    assert( numFrames % 4 == 0 );
+
+    #ifdef SOFTAUDIO_SIMD_SSE
+        float a[4], b[4], t[4];
+        for( unsigned int i=0; i<numFrames; i+=4 )
+        {
+            for( unsigned int j=0; j<4; j++ )
+            {
+                float p = pos + ( i + j ) * step;
+                unsigned int index = static_cast<unsigned int>( p );
+                a[j] = input[index];
+                b[j] = input[index+1];
+                t[j] = p - index;
+            }
+            __m128 va = _mm_loadu_ps( a );
+            __m128 vb = _mm_loadu_ps( b );
+            __m128 vt = _mm_loadu_ps( t );
+            _mm_storeu_ps( output + i, _mm_add_ps( va, _mm_mul_ps( vt, _mm_sub_ps( vb, va ) ) ) );
+        }
+    #else
+        for( unsigned int i=0; i<numFrames; i++ )
+        {
+            float p = pos + i * step;
+            unsigned int index = static_cast<unsigned int>( p );
+            float t = p - index;
+            output[i] = input[index] + t * ( input[index+1] - input[index] );
+        }
+    #endif
+}
+
+// output[i] += input[i] * gain, gain is ramped from gain0 to gain1 over the block
+static void mixRamp(float* output, const float* input, unsigned int numFrames, float gain0, float gain1)
+{
+    assert( numFrames % 4 == 0 );
+
+    if( gain0 == 0.0f && gain1 == 0.0f ) return;
+
+    float dg = ( gain1 - gain0 ) / numFrames;
+
+    #ifdef SOFTAUDIO_SIMD_SSE
+        __m128 g  = _mm_add_ps( _mm_set1_ps( gain0 ), _mm_mul_ps( _mm_set_ps( 3, 2, 1, 0 ), _mm_set1_ps( dg ) ) );
+        __m128 g4 = _mm_set1_ps( dg * 4 );
+        for( unsigned int i=0; i<numFrames; i+=4 )
+        {
+            __m128 o = _mm_loadu_ps( output + i );
+            o = _mm_add_ps( o, _mm_mul_ps( _mm_loadu_ps( input + i ), g ) );
+            _mm_storeu_ps( output + i, o );
+            g = _mm_add_ps( g, g4 );
+        }
+    #else
+        for( unsigned int i=0; i<numFrames; i++ )
+        {
+            output[i] += input[i] * ( gain0 + i * dg );
+        }
+    #endif
+}
+
+// interleaves & saturates stereo output
+static void convertOutput(const float* left, const float* right, short* output, unsigned int numFrames)
+{
+    assert( numFrames % 4 == 0 );
+
+    #ifdef SOFTAUDIO_SIMD_SSE
+        __m128 lo = _mm_set1_ps( -32768.0f );
+        __m128 hi = _mm_set1_ps( 32767.0f );
+        __m128 scale = _mm_set1_ps( 32767.0f );
+        float l[4], r[4];
+        for( unsigned int i=0; i<numFrames; i+=4 )
+        {
+            _mm_storeu_ps( l, _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( left + i ), scale ), lo ), hi ) );
+            _mm_storeu_ps( r, _mm_min_ps( _mm_max_ps( _mm_mul_ps( _mm_loadu_ps( right + i ), scale ), lo ), hi ) );
+            for( unsigned int j=0; j<4; j++ )
+            {
+                output[(i+j)*2]   = short( l[j] );
+                output[(i+j)*2+1] = short( r[j] );
+            }
+        }
+    #else
+        for( unsigned int i=0; i<numFrames; i++ )
+        {
+            float l = left[i] * 32767.0f;
+            float r = right[i] * 32767.0f;
+            output[i*2]   = short( l < -32768.0f ? -32768.0f : ( l > 32767.0f ? 32767.0f : l ) );
+            output[i*2+1] = short( r < -32768.0f ? -32768.0f : ( r > 32767.0f ? 32767.0f : r ) );
+        }
+    #endif
+}
+
+/**
+ * vector helpers
+ */
+
+static inline float dot3(const float* a, const float* b)
+{
+    return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+static inline float length3(const float* a)
+{
+    return sqrt( dot3( a, a ) );
+}
+
+/**
+ * class MixerVoice
+ */
+
+MixerVoice::MixerVoice(MixerSource* source)
+{
+    playing        = false;
+    looping        = false;
+    spatial        = false;
+    gain           = 1.0f;
+    pitch          = 1.0f;
+    minGain        = 0.0f;
+    maxGain        = 1.0f;
+    refDist        = 100.0f;
+    maxDist        = 1.0e11f;
+    rolloff        = 1.0f;
+    pos[0] = pos[1] = pos[2] = 0.0f;
+    dir[0] = 0.0f, dir[1] = 1.0f, dir[2] = 0.0f;
+    vel[0] = vel[1] = vel[2] = 0.0f;
+    coneInnerAngle = 360.0f;
+    coneOuterAngle = 360.0f;
+    coneOuterGain  = 1.0f;
+    reverbSend     = 0.0f;
+
+    _source      = source;
+    _numChannels = source->getNumChannels() > 1 ? 2 : 1;
+    _inputFrames = 0;
+    _inputPos    = 0.0f;
+    _sourceEnded = false;
+    _lastGain[0] = _lastGain[1] = -1.0f;
+    _lastSend    = 0.0f;
+}
+
+MixerVoice::~MixerVoice()
+{
+    delete _source;
+}
+
+void MixerVoice::play(void)
+{
+    if( playing ) return;
+
+    // finished voice is played from the beginning
+    if( _sourceEnded && !_inputFrames )
+    {
+        _source->rewind();
+        _sourceEnded = false;
+        _inputPos = 0.0f;
+    }
+    _lastGain[0] = _lastGain[1] = -1.0f;
+    playing = true;
+}
+
+void MixerVoice::stop(void)
+{
+    playing = false;
+}
+
+/**
+ * class MixerReverb
+ */
+
+MixerReverb::MixerReverb(unsigned int samplingRate)
+{
+    _samplingRate = samplingRate;
+    float scale = samplingRate / 44100.0f;
+    for( unsigned int c=0; c<2; c++ )
+    {
+        unsigned int spread = c ? reverbStereoSpread : 0;
+        for( unsigned int i=0; i<MIXER_REVERB_COMBS; i++ )
+        {
+            _combs[c][i].buffer.resize( static_cast<unsigned int>( ( reverbCombTuning[i] + spread ) * scale ) + 1, 0.0f );
+            _combs[c][i].pos = 0;
+            _combs[c][i].feedback = 0.0f;
+            _combs[c][i].store = 0.0f;
+        }
+        for( unsigned int i=0; i<MIXER_REVERB_PASSES; i++ )
+        {
+            _passes[c][i].buffer.resize( static_cast<unsigned int>( ( reverbAllpassTuning[i] + spread ) * scale ) + 1, 0.0f );
+            _passes[c][i].pos = 0;
+        }
+    }
+    _damping = 0.0f;
+    _wet = 0.0f;
+}
+
+void MixerReverb::setParameters(float reverbMix, float reverbTime, float hfTimeRatio)
+{
+    // comb feedback gives 60 dB decay in reverbTime
+    for( unsigned int c=0; c<2; c++ )
+    {
+        for( unsigned int i=0; i<MIXER_REVERB_COMBS; i++ )
+        {
+            float delay = float( _combs[c][i].buffer.size() ) / _samplingRate;
+            _combs[c][i].feedback = reverbTime > 0.0f ? float( pow( 10.0f, -3.0f * delay / reverbTime ) ) : 0.0f;
+        }
+    }
+
+    // high frequencies decay faster with lower ratio
+    if( hfTimeRatio < 0.0f ) hfTimeRatio = 0.0f;
+    if( hfTimeRatio > 1.0f ) hfTimeRatio = 1.0f;
+    _damping = reverbMaxDamping * ( 1.0f - hfTimeRatio );
+
+    if( reverbMix < 0.0f ) reverbMix = 0.0f;
+    if( reverbMix > 1.0f ) reverbMix = 1.0f;
+    _wet = reverbMix;
+}
+
+void MixerReverb::process(const float* input, float* left, float* right, unsigned int numFrames)
+{
+    float* output[2] = { left, right };
+    for( unsigned int c=0; c<2; c++ )
+    {
+        for( unsigned int f=0; f<numFrames; f++ )
+        {
+            float in = input[f] * reverbInputGain;
+            float out = 0.0f;
+
+            for( unsigned int i=0; i<MIXER_REVERB_COMBS; i++ )
+            {
+                Comb& comb = _combs[c][i];
+                float delayed = comb.buffer[comb.pos];
+                comb.store = delayed * ( 1.0f - _damping ) + comb.store * _damping;
+                comb.buffer[comb.pos] = in + comb.store * comb.feedback;
+                if( ++comb.pos == comb.buffer.size() ) comb.pos = 0;
+                out += delayed;
+            }
+
+            for( unsigned int i=0; i<MIXER_REVERB_PASSES; i++ )
+            {
+                Allpass& pass = _passes[c][i];
+                float delayed = pass.buffer[pass.pos];
+                pass.buffer[pass.pos] = out + delayed * reverbAllpassFeedback;
+                if( ++pass.pos == pass.buffer.size() ) pass.pos = 0;
+                out = delayed - out;
+            }
+
+            output[c][f] += out * _wet;
+        }
+    }
+}
+
+/**
+ * class Mixer
+ */
+
+Mixer::Mixer(unsigned int samplingRate) : _reverb( samplingRate )
+{
+    _samplingRate = samplingRate;
+    _listenerPos[0] = _listenerPos[1] = _listenerPos[2] = 0.0f;
+    _listenerVel[0] = _listenerVel[1] = _listenerVel[2] = 0.0f;
+    _listenerRight[0] = 1.0f, _listenerRight[1] = _listenerRight[2] = 0.0f;
+    _listenerGain  = 1.0f;
+    _speedOfSound  = 34300.0f;
+    _dopplerFactor = 1.0f;
+    _numRenderedFrames = 0;
+    _numMixedVoices = 0;
+}
+
+Mixer::~Mixer()
+{
+    for( VoiceI voiceI = _voices.begin(); voiceI != _voices.end(); voiceI++ )
+    {
+        delete *voiceI;
+    }
+}
+
+MixerVoice* Mixer::createVoice(MixerSource* source)
+{
+    MixerVoice* voice = new MixerVoice( source );
+    _voices.push_back( voice );
+    return voice;
+}
+
+void Mixer::releaseVoice(MixerVoice* voice)
+{
+    _voices.remove( voice );
+    delete voice;
+}
+
+void Mixer::setListener(const float* pos, const float* vel, const float* up, const float* at)
+{
+    for( unsigned int i=0; i<3; i++ )
+    {
+        _listenerPos[i] = pos[i];
+        _listenerVel[i] = vel[i];
+    }
+
+    // left-handed basis, right = up x at
+    _listenerRight[0] = up[1] * at[2] - up[2] * at[1];
+    _listenerRight[1] = up[2] * at[0] - up[0] * at[2];
+    _listenerRight[2] = up[0] * at[1] - up[1] * at[0];
+    float length = length3( _listenerRight );
+    if( length > 0.0f )
+    {
+        for( unsigned int i=0; i<3; i++ ) _listenerRight[i] /= length;
+    }
+}
+
+void Mixer::setReverberation(float reverbMix, float reverbTime, float hfTimeRatio)
+{
+    _reverb.setParameters( reverbMix, reverbTime, hfTimeRatio );
+}
+
+bool Mixer::stageVoice(MixerVoice* voice, unsigned int numFrames, float step)
+{
+    // source frames covering the block, plus interpolation neighbour
+    unsigned int numNeeded = static_cast<unsigned int>( voice->_inputPos + numFrames * step ) + 2;
+    unsigned int c;
+    for( c=0; c<voice->_numChannels; c++ )
+    {
+        if( voice->_input[c].size() < numNeeded ) voice->_input[c].resize( numNeeded );
+    }
+
+    bool rewound = false;
+    while( voice->_inputFrames < numNeeded && !voice->_sourceEnded )
+    {
+        float* channels[2];
+        for( c=0; c<voice->_numChannels; c++ ) channels[c] = &voice->_input[c][voice->_inputFrames];
+        unsigned int numRead = voice->_source->read( channels, numNeeded - voice->_inputFrames );
+        if( numRead )
+        {
+            voice->_inputFrames += numRead;
+            rewound = false;
+        }
+        else if( voice->looping && !rewound )
+        {
+            voice->_source->rewind();
+            rewound = true;
+        }
+        else
+        {
+            voice->_sourceEnded = true;
+        }
+    }
+
+    // nothing left to play
+    if( voice->_inputFrames <= static_cast<unsigned int>( voice->_inputPos ) ) return false;
+
+    // silence after the end of data
+    for( c=0; c<voice->_numChannels; c++ )
+    {
+        for( unsigned int i=voice->_inputFrames; i<numNeeded; i++ ) voice->_input[c][i] = 0.0f;
+    }
+    return true;
+}
+
+void Mixer::mixVoice(MixerVoice* voice, unsigned int numFrames)
+{
+    float gain[2];
+    float send;
+    float doppler = 1.0f;
+
+    // gains
+    gain[0] = gain[1] = voice->gain * _listenerGain;
+    if( voice->spatial && voice->_numChannels == 1 )
+    {
+        float toSource[3] = {
+            voice->pos[0] - _listenerPos[0],
+            voice->pos[1] - _listenerPos[1],
+            voice->pos[2] - _listenerPos[2]
+        };
+        float distance = length3( toSource );
+
+        // inverse distance clamped model
+        float attenuation = 1.0f;
+        float clampedDistance = distance;
+        if( clampedDistance < voice->refDist ) clampedDistance = voice->refDist;
+        if( clampedDistance > voice->maxDist ) clampedDistance = voice->maxDist;
+        float denominator = voice->refDist + voice->rolloff * ( clampedDistance - voice->refDist );
+        if( denominator > 0.0f ) attenuation = voice->refDist / denominator;
+        if( attenuation < voice->minGain ) attenuation = voice->minGain;
+        if( attenuation > voice->maxGain ) attenuation = voice->maxGain;
+
+        float pan = 0.0f;
+        if( distance > 0.0f )
+        {
+            float toListener[3] = { -toSource[0] / distance, -toSource[1] / distance, -toSource[2] / distance };
+
+            // sound cone
+            if( voice->coneInnerAngle < 360.0f )
+            {
+                float dirLength = length3( voice->dir );
+                float cosAngle = dirLength > 0.0f ? dot3( voice->dir, toListener ) / dirLength : 1.0f;
+                if( cosAngle < -1.0f ) cosAngle = -1.0f;
+                if( cosAngle > 1.0f ) cosAngle = 1.0f;
+                float angle = 2.0f * float( acos( cosAngle ) ) * 57.2957795f;
+                if( angle >= voice->coneOuterAngle )
+                {
+                    attenuation *= voice->coneOuterGain;
+                }
+                else if( angle > voice->coneInnerAngle )
+                {
+                    float factor = ( angle - voice->coneInnerAngle ) / ( voice->coneOuterAngle - voice->coneInnerAngle );
+                    attenuation *= 1.0f + factor * ( voice->coneOuterGain - 1.0f );
+                }
+            }
+
+            // doppler shift
+            if( _dopplerFactor > 0.0f && _speedOfSound > 0.0f )
+            {
+                float limit = 0.5f * _speedOfSound / _dopplerFactor;
+                float vls = dot3( toListener, _listenerVel );
+                float vss = dot3( toListener, voice->vel );
+                if( vls > limit ) vls = limit;
+                if( vss > limit ) vss = limit;
+                doppler = ( _speedOfSound - _dopplerFactor * vls ) / ( _speedOfSound - _dopplerFactor * vss );
+            }
+
+            pan = -dot3( toListener, _listenerRight );
+        }
+
+        // equal-power panning
+        gain[0] *= attenuation * float( sqrt( 0.5f * ( 1.0f - pan ) ) );
+        gain[1] *= attenuation * float( sqrt( 0.5f * ( 1.0f + pan ) ) );
+        send = voice->reverbSend * voice->gain * attenuation;
+    }
+    else
+    {
+        send = voice->reverbSend * voice->gain;
+    }
+    if( voice->_numChannels == 2 ) send *= 0.5f;
+
+    // resampling step
+    float step = float( voice->_source->getSamplingRate() ) / _samplingRate * voice->pitch * doppler;
+    if( step <= 0.0f ) step = 1.0f / MIXER_MAX_PITCH;
+    if( step > MIXER_MAX_PITCH ) step = MIXER_MAX_PITCH;
+
+    if( !stageVoice( voice, numFrames, step ) )
+    {
+        voice->playing = false;
+        voice->_inputFrames = 0;
+        voice->_inputPos = 0.0f;
+        return;
+    }
+
+    // first block after play() starts without gain ramp
+    if( voice->_lastGain[0] < 0.0f )
+    {
+        voice->_lastGain[0] = gain[0];
+        voice->_lastGain[1] = gain[1];
+        voice->_lastSend = send;
+    }
+
+    // mix channels
+    float* outputs[2] = { _left, _right };
+    for( unsigned int c=0; c<voice->_numChannels; c++ )
+    {
+        resampleLinear( &voice->_input[c][0], _voiceOutput, numFrames, voice->_inputPos, step );
+        if( voice->_numChannels == 1 )
+        {
+            mixRamp( _left, _voiceOutput, numFrames, voice->_lastGain[0], gain[0] );
+            mixRamp( _right, _voiceOutput, numFrames, voice->_lastGain[1], gain[1] );
+        }
+        else
+        {
+            mixRamp( outputs[c], _voiceOutput, numFrames, voice->_lastGain[c], gain[c] );
+        }
+        if( _reverb.isActive() )
+        {
+            mixRamp( _send, _voiceOutput, numFrames, voice->_lastSend, send );
+        }
+    }
+    voice->_lastGain[0] = gain[0];
+    voice->_lastGain[1] = gain[1];
+    voice->_lastSend = send;
+
+    // consume source frames
+    float position = voice->_inputPos + numFrames * step;
+    unsigned int numConsumed = static_cast<unsigned int>( position );
+    voice->_inputPos = position - numConsumed;
+    if( numConsumed >= voice->_inputFrames )
+    {
+        voice->_inputFrames = 0;
+    }
+    else
+    {
+        for( unsigned int c=0; c<voice->_numChannels; c++ )
+        {
+            memmove(
+                &voice->_input[c][0],
+                &voice->_input[c][numConsumed],
+                ( voice->_inputFrames - numConsumed ) * sizeof( float )
+            );
+        }
+        voice->_inputFrames -= numConsumed;
+    }
+
+    // end of data
+    if( voice->_sourceEnded && !voice->_inputFrames )
+    {
+        voice->playing = false;
+        voice->_inputPos = 0.0f;
+    }
+
+    _numMixedVoices++;
+}
+
+void Mixer::renderBlock(short* output, unsigned int numFrames)
+{
+    memset( _left, 0, sizeof( float ) * numFrames );
+    memset( _right, 0, sizeof( float ) * numFrames );
+    memset( _send, 0, sizeof( float ) * numFrames );
+
+    for( VoiceI voiceI = _voices.begin(); voiceI != _voices.end(); voiceI++ )
+    {
+        if( (*voiceI)->playing ) mixVoice( *voiceI, numFrames );
+    }
+
+    if( _reverb.isActive() ) _reverb.process( _send, _left, _right, numFrames );
+
+    convertOutput( _left, _right, output, numFrames );
+    _numRenderedFrames += numFrames;
+}
+
+void Mixer::render(short* output, unsigned int numFrames)
+{
+    assert( numFrames % 4 == 0 );
+
+    while( numFrames )
+    {
+        unsigned int blockFrames = numFrames < MIXER_BLOCK_FRAMES ? numFrames : MIXER_BLOCK_FRAMES;
+        renderBlock( output, blockFrames );
+        output += blockFrames * 2;
+        numFrames -= blockFrames;
+    }
+}
@@ -0,0 +1,181 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description software spatial mixer
+ *
+ * mixer core doesn't depend on platform headers, so it can be built
+ * and benchmarked without sound device
+ */
+
+#ifndef SOFTWARE_MIXER_INCLUDED
+#define SOFTWARE_MIXER_INCLUDED
+
+#include <vector>
+#include <list>
+
+/**
+ * SSE is used when compiler targets it (/arch:SSE or x64),
+ * otherwise kernels are compiled for scalar lanes
+ */
+
+#if !defined(SOFTAUDIO_NO_SIMD) && ( defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 ) || defined(__SSE__) )
+    #define SOFTAUDIO_SIMD_SSE
+    #include <xmmintrin.h>
+#endif
+
+#define MIXER_BLOCK_FRAMES   256     // frames per mixing block, multiple of 4
+#define MIXER_MAX_PITCH      4.0f    // limit of resampling step
+#define MIXER_REVERB_COMBS   4       // comb filters per reverb channel
+#define MIXER_REVERB_PASSES  2       // allpass filters per reverb channel
+
+/**
+ * source of PCM data for mixer voice
+ */
+
+class MixerSource
+{
+public:
+    virtual ~MixerSource() {}
+public:
+    virtual unsigned int getNumChannels(void) = 0;
+    virtual unsigned int getSamplingRate(void) = 0;
+    /**
+     * reads up to numFrames frames into planar buffers (one per channel)
+     * @return number of frames read, 0 at the end of data
+     */
+    virtual unsigned int read(float** channels, unsigned int numFrames) = 0;
+    virtual void rewind(void) = 0;
+};
+
+/**
+ * mixer voice, follows spatial parameters of SpatialSound
+ * (distances are given in centimeters, velocities in centimeters per second)
+ */
+
+class MixerVoice
+{
+    friend class Mixer;
+public:
+    bool  playing;
+    bool  looping;
+    bool  spatial;       // true, if voice is placed or has distance model
+    float gain;
+    float pitch;
+    float minGain;
+    float maxGain;
+    float refDist;
+    float maxDist;
+    float rolloff;
+    float pos[3];
+    float dir[3];
+    float vel[3];
+    float coneInnerAngle; // degrees
+    float coneOuterAngle; // degrees
+    float coneOuterGain;
+    float reverbSend;     // level of signal sent to reverb
+private:
+    MixerSource*       _source;
+    unsigned int       _numChannels;
+    std::vector<float> _input[2];     // staged source frames, first frame is carried from previous block
+    unsigned int       _inputFrames;  // number of staged frames
+    float              _inputPos;     // fractional position in staged frames
+    bool               _sourceEnded;
+    float              _lastGain[2];  // channel gains of previous block
+    float              _lastSend;     // reverb send of previous block
+private:
+    MixerVoice(MixerSource* source);
+    ~MixerVoice();
+public:
+    void play(void);
+    void stop(void);
+};
+
+/**
+ * reverberation unit (parallel damped combs followed by serial allpasses)
+ */
+
+class MixerReverb
+{
+private:
+    struct Comb
+    {
+        std::vector<float> buffer;
+        unsigned int       pos;
+        float              feedback;
+        float              store;
+    };
+    struct Allpass
+    {
+        std::vector<float> buffer;
+        unsigned int       pos;
+    };
+private:
+    unsigned int _samplingRate;
+    Comb         _combs[2][MIXER_REVERB_COMBS];
+    Allpass      _passes[2][MIXER_REVERB_PASSES];
+    float        _damping;
+    float        _wet;
+public:
+    MixerReverb(unsigned int samplingRate);
+public:
+    void setParameters(float reverbMix, float reverbTime, float hfTimeRatio);
+    void process(const float* input, float* left, float* right, unsigned int numFrames);
+    inline bool isActive(void) { return _wet > 0.0f; }
+};
+
+/**
+ * mixer
+ */
+
+class Mixer
+{
+private:
+    typedef std::list<MixerVoice*> Voices;
+    typedef Voices::iterator VoiceI;
+private:
+    unsigned int _samplingRate;
+    Voices       _voices;
+    MixerReverb  _reverb;
+    float        _listenerPos[3];
+    float        _listenerVel[3];
+    float        _listenerRight[3];
+    float        _listenerGain;
+    float        _speedOfSound;
+    float        _dopplerFactor;
+    float        _left[MIXER_BLOCK_FRAMES];
+    float        _right[MIXER_BLOCK_FRAMES];
+    float        _send[MIXER_BLOCK_FRAMES];
+    float        _voiceOutput[MIXER_BLOCK_FRAMES];
+    unsigned int _numRenderedFrames;
+    unsigned int _numMixedVoices;
+private:
+    bool stageVoice(MixerVoice* voice, unsigned int numFrames, float step);
+    void mixVoice(MixerVoice* voice, unsigned int numFrames);
+    void renderBlock(short* output, unsigned int numFrames);
+public:
+    Mixer(unsigned int samplingRate);
+    ~Mixer();
+public:
+    inline unsigned int getSamplingRate(void) { return _samplingRate; }
+    inline unsigned int getNumRenderedFrames(void) { return _numRenderedFrames; }
+    inline unsigned int getNumMixedVoices(void) { return _numMixedVoices; }
+public:
+    /**
+     * voice takes ownership of the source
+     */
+    MixerVoice* createVoice(MixerSource* source);
+    void releaseVoice(MixerVoice* voice);
+    void setListener(const float* pos, const float* vel, const float* up, const float* at);
+    void setListenerGain(float value) { _listenerGain = value; }
+    float getListenerGain(void) { return _listenerGain; }
+    void setSpeedOfSound(float value) { _speedOfSound = value; }
+    void setDopplerFactor(float value) { _dopplerFactor = value; }
+    void setReverberation(float reverbMix, float reverbTime, float hfTimeRatio);
+    /**
+     * renders interleaved 16-bit stereo frames, number of frames must be multiple of 4
+     */
+    void render(short* output, unsigned int numFrames);
+};
+
+#endif
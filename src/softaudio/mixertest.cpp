@@ -0,0 +1,271 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description regression driver of software mixer: renders fixed scene
+ * of synthesized sources and compares it with reference rendering
+ *
+ *  mixertest <reference.wav>  - renders scene, compares with reference
+ *  mixertest -w <output.wav>  - renders scene to WAV file
+ *  mixertest -b               - mixes 60 seconds of scene into null sink
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "mixer.h"
+#include "sink.h"
+
+#define TEST_SAMPLING_RATE 22050
+#define TEST_BLOCK_FRAMES  512
+#define TEST_NUM_BLOCKS    32    // ~0.75 seconds
+#define TEST_TOLERANCE     4     // SSE & scalar kernels round gain ramps differently
+
+static const double pi = 3.14159265358979323846;
+
+/**
+ * synthesized PCM sources
+ */
+
+class TestSource : public MixerSource
+{
+private:
+    unsigned int       _numChannels;
+    unsigned int       _samplingRate;
+    std::vector<float> _samples[2];
+    unsigned int       _position;
+public:
+    TestSource(unsigned int numChannels, unsigned int samplingRate, unsigned int numFrames) :
+        _numChannels( numChannels ), _samplingRate( samplingRate ), _position( 0 )
+    {
+        for( unsigned int i=0; i<numChannels; i++ ) _samples[i].resize( numFrames );
+    }
+public:
+    inline std::vector<float>& getChannel(unsigned int channelId) { return _samples[channelId]; }
+public:
+    virtual unsigned int getNumChannels(void) { return _numChannels; }
+    virtual unsigned int getSamplingRate(void) { return _samplingRate; }
+    virtual unsigned int read(float** channels, unsigned int numFrames)
+    {
+        unsigned int numSourceFrames = _samples[0].size();
+        if( numFrames > numSourceFrames - _position ) numFrames = numSourceFrames - _position;
+        for( unsigned int i=0; i<_numChannels; i++ )
+        {
+            if( numFrames ) memcpy( channels[i], &_samples[i][_position], numFrames * sizeof( float ) );
+        }
+        _position += numFrames;
+        return numFrames;
+    }
+    virtual void rewind(void) { _position = 0; }
+};
+
+static void synthesizeTone(std::vector<float>& samples, unsigned int samplingRate, double frequency, float amplitude)
+{
+    for( unsigned int i=0; i<samples.size(); i++ )
+    {
+        samples[i] = amplitude * float( sin( 2.0 * pi * frequency * i / samplingRate ) );
+    }
+}
+
+static void synthesizeNoise(std::vector<float>& samples, float amplitude)
+{
+    // LCG, so noise doesn't depend on CRT rand()
+    unsigned int state = 12345;
+    for( unsigned int i=0; i<samples.size(); i++ )
+    {
+        state = state * 1664525 + 1013904223;
+        float decay = 1.0f - float( i ) / samples.size();
+        samples[i] = amplitude * decay * ( float( state >> 8 ) / float( 1 << 24 ) * 2.0f - 1.0f );
+    }
+}
+
+/**
+ * test scene: looped non-spatial tones (mono & stereo), moving source with cone
+ * & Doppler, delayed resampled noise burst, shared reverberation
+ */
+
+static void renderScene(MixerSink* sink, unsigned int numBlocks)
+{
+    Mixer mixer( TEST_SAMPLING_RATE );
+
+    float listenerPos[3] = { 0, 0, 0 };
+    float listenerVel[3] = { 0, 0, 0 };
+    float listenerUp[3]  = { 0, 1, 0 };
+    float listenerAt[3]  = { 0, 0, 1 };
+    mixer.setListener( listenerPos, listenerVel, listenerUp, listenerAt );
+    mixer.setReverberation( 0.2f, 1.5f, 0.5f );
+
+    TestSource* toneSource = new TestSource( 1, TEST_SAMPLING_RATE, 4096 );
+    synthesizeTone( toneSource->getChannel( 0 ), TEST_SAMPLING_RATE, 441.0, 0.5f );
+    MixerVoice* tone = mixer.createVoice( toneSource );
+    tone->looping = true;
+    tone->gain    = 0.2f;
+    tone->play();
+
+    // stereo sources are never spatialized
+    TestSource* ambientSource = new TestSource( 2, 16000, 3000 );
+    synthesizeTone( ambientSource->getChannel( 0 ), 16000, 220.0, 0.5f );
+    synthesizeTone( ambientSource->getChannel( 1 ), 16000, 330.0, 0.5f );
+    MixerVoice* ambient = mixer.createVoice( ambientSource );
+    ambient->looping    = true;
+    ambient->gain       = 0.15f;
+    ambient->pitch      = 0.8f;
+    ambient->reverbSend = 0.3f;
+    ambient->play();
+
+    TestSource* flybySource = new TestSource( 1, 32000, 32000 );
+    synthesizeTone( flybySource->getChannel( 0 ), 32000, 660.0, 0.5f );
+    MixerVoice* flyby = mixer.createVoice( flybySource );
+    flyby->spatial        = true;
+    flyby->pitch          = 1.25f;
+    flyby->refDist        = 300.0f;
+    flyby->maxDist        = 10000.0f;
+    flyby->dir[0]         = 0.0f, flyby->dir[1] = 0.0f, flyby->dir[2] = -1.0f;
+    flyby->coneInnerAngle = 90.0f;
+    flyby->coneOuterAngle = 180.0f;
+    flyby->coneOuterGain  = 0.25f;
+    flyby->reverbSend     = 0.5f;
+    flyby->play();
+
+    TestSource* burstSource = new TestSource( 1, 11025, 8000 );
+    synthesizeNoise( burstSource->getChannel( 0 ), 0.6f );
+    MixerVoice* burst = mixer.createVoice( burstSource );
+    burst->spatial    = true;
+    burst->pos[0]     = 200.0f, burst->pos[1] = 0.0f, burst->pos[2] = -500.0f;
+    burst->refDist    = 200.0f;
+    burst->reverbSend = 1.0f;
+
+    // flyby passes in front of listener at 4000 cm/s
+    float blockTime = float( TEST_BLOCK_FRAMES ) / TEST_SAMPLING_RATE;
+    std::vector<short> output( TEST_BLOCK_FRAMES * 2 );
+    for( unsigned int blockId=0; blockId<numBlocks; blockId++ )
+    {
+        float time = ( blockId % TEST_NUM_BLOCKS ) * blockTime;
+        flyby->pos[0] = -1500.0f + 4000.0f * time;
+        flyby->pos[1] = 0.0f;
+        flyby->pos[2] = 1000.0f;
+        flyby->vel[0] = 4000.0f, flyby->vel[1] = 0.0f, flyby->vel[2] = 0.0f;
+        if( blockId % TEST_NUM_BLOCKS == 10 ) burst->play();
+        mixer.render( &output[0], TEST_BLOCK_FRAMES );
+        sink->write( &output[0], TEST_BLOCK_FRAMES );
+    }
+}
+
+/**
+ * reference comparison
+ */
+
+class CompareSink : public MixerSink
+{
+private:
+    std::vector<short> _frames;
+public:
+    inline const std::vector<short>& getFrames(void) { return _frames; }
+public:
+    virtual void write(const short* frames, unsigned int numFrames)
+    {
+        _frames.insert( _frames.end(), frames, frames + numFrames * 2 );
+    }
+};
+
+static unsigned int readWaveValue(const unsigned char* data, unsigned int size)
+{
+    unsigned int value = 0;
+    for( unsigned int i=0; i<size; i++ ) value |= data[i] << ( i * 8 );
+    return value;
+}
+
+static bool readWave(const char* fileName, std::vector<short>& samples)
+{
+    FILE* file = fopen( fileName, "rb" );
+    if( !file ) return false;
+
+    // header layout is the one written by WaveSink
+    unsigned char header[44];
+    bool result = fread( header, sizeof( header ), 1, file ) == 1 &&
+                  !memcmp( header, "RIFF", 4 ) && !memcmp( header + 8, "WAVE", 4 ) &&
+                  !memcmp( header + 36, "data", 4 ) &&
+                  readWaveValue( header + 22, 2 ) == 2 && readWaveValue( header + 34, 2 ) == 16 &&
+                  readWaveValue( header + 24, 4 ) == TEST_SAMPLING_RATE;
+    if( result )
+    {
+        unsigned int numSamples = readWaveValue( header + 40, 4 ) / 2;
+        std::vector<unsigned char> data( numSamples * 2 );
+        result = numSamples && fread( &data[0], data.size(), 1, file ) == 1;
+        samples.resize( numSamples );
+        for( unsigned int i=0; result && i<numSamples; i++ )
+        {
+            samples[i] = short( readWaveValue( &data[i*2], 2 ) );
+        }
+    }
+    fclose( file );
+    return result;
+}
+
+static int compareWithReference(const char* fileName)
+{
+    std::vector<short> reference;
+    if( !readWave( fileName, reference ) )
+    {
+        printf( "mixertest: can't read reference \"%s\"\n", fileName );
+        return 1;
+    }
+
+    CompareSink sink;
+    renderScene( &sink, TEST_NUM_BLOCKS );
+    const std::vector<short>& frames = sink.getFrames();
+    if( frames.size() != reference.size() )
+    {
+        printf( "mixertest: %d samples rendered, reference has %d\n", int( frames.size() ), int( reference.size() ) );
+        return 1;
+    }
+
+    int maxError = 0;
+    unsigned int maxErrorId = 0;
+    for( unsigned int i=0; i<frames.size(); i++ )
+    {
+        int error = abs( int( frames[i] ) - int( reference[i] ) );
+        if( error > maxError ) maxError = error, maxErrorId = i;
+    }
+    printf(
+        "mixertest: %d frames, max. error %d at frame %d (%s channel): %s\n",
+        int( frames.size() / 2 ), maxError, maxErrorId / 2, maxErrorId % 2 ? "right" : "left",
+        maxError <= TEST_TOLERANCE ? "passed" : "FAILED"
+    );
+    return maxError <= TEST_TOLERANCE ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    if( argc == 3 && !strcmp( argv[1], "-w" ) )
+    {
+        WaveSink sink( argv[2], TEST_SAMPLING_RATE );
+        if( !sink.isOpen() )
+        {
+            printf( "mixertest: can't write \"%s\"\n", argv[2] );
+            return 1;
+        }
+        renderScene( &sink, TEST_NUM_BLOCKS );
+        return 0;
+    }
+    else if( argc == 2 && !strcmp( argv[1], "-b" ) )
+    {
+        unsigned int numBlocks = 60 * TEST_SAMPLING_RATE / TEST_BLOCK_FRAMES;
+        NullSink sink;
+        clock_t time = clock();
+        renderScene( &sink, numBlocks );
+        float seconds = float( clock() - time ) / CLOCKS_PER_SEC;
+        printf( "mixertest: 60 s of scene mixed in %.3f s\n", seconds );
+        return 0;
+    }
+    else if( argc == 2 )
+    {
+        return compareWithReference( argv[1] );
+    }
+
+    printf( "usage: mixertest <reference.wav> | -w <output.wav> | -b\n" );
+    return 1;
+}
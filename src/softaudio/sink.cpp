@@ -0,0 +1,64 @@
+
+#include "sink.h"
+
+/**
+ * class WaveSink
+ */
+
+static void writeWaveValue(FILE* file, unsigned int value, unsigned int size)
+{
+    // little-endian
+    for( unsigned int i=0; i<size; i++ )
+    {
+        fputc( ( value >> ( i * 8 ) ) & 0xFF, file );
+    }
+}
+
+WaveSink::WaveSink(const char* fileName, unsigned int samplingRate)
+{
+    _file = fopen( fileName, "wb" );
+    _samplingRate = samplingRate;
+    _numFrames = 0;
+    if( _file ) writeHeader();
+}
+
+WaveSink::~WaveSink()
+{
+    if( _file )
+    {
+        // actualize chunk sizes
+        fseek( _file, 0, SEEK_SET );
+        writeHeader();
+        fclose( _file );
+    }
+}
+
+void WaveSink::writeHeader(void)
+{
+    unsigned int dataSize = _numFrames * 2 * sizeof( short );
+    fwrite( "RIFF", 4, 1, _file );
+    writeWaveValue( _file, 36 + dataSize, 4 );
+    fwrite( "WAVE", 4, 1, _file );
+    fwrite( "fmt ", 4, 1, _file );
+    writeWaveValue( _file, 16, 4 );                  // chunk size
+    writeWaveValue( _file, 1, 2 );                   // PCM
+    writeWaveValue( _file, 2, 2 );                   // channels
+    writeWaveValue( _file, _samplingRate, 4 );       // frames per second
+    writeWaveValue( _file, _samplingRate * 4, 4 );   // bytes per second
+    writeWaveValue( _file, 4, 2 );                   // bytes per frame
+    writeWaveValue( _file, 16, 2 );                  // bits per sample
+    fwrite( "data", 4, 1, _file );
+    writeWaveValue( _file, dataSize, 4 );
+}
+
+void WaveSink::write(const short* frames, unsigned int numFrames)
+{
+    if( !_file ) return;
+
+    // samples are stored in little-endian order
+    for( unsigned int i=0; i<numFrames*2; i++ )
+    {
+        writeWaveValue( _file, static_cast<unsigned short>( frames[i] ), 2 );
+    }
+    _numFrames += numFrames;
+}
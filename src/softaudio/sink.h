@@ -0,0 +1,56 @@
+/**
+ * This source code is a part of D3 game project.
+ * (c) Digital Dimension Development, 2004-2005
+ *
+ * @description output sinks of software mixer
+ */
+
+#ifndef MIXER_SINK_INCLUDED
+#define MIXER_SINK_INCLUDED
+
+#include <cstdio>
+
+/**
+ * abstract sink of interleaved 16-bit stereo frames
+ */
+
+class MixerSink
+{
+public:
+    virtual ~MixerSink() {}
+public:
+    virtual void write(const short* frames, unsigned int numFrames) = 0;
+};
+
+/**
+ * discards output (mixing cost only)
+ */
+
+class NullSink : public MixerSink
+{
+public:
+    virtual void write(const short*, unsigned int) {}
+};
+
+/**
+ * writes output to RIFF WAVE file
+ */
+
+class WaveSink : public MixerSink
+{
+private:
+    FILE*        _file;
+    unsigned int _samplingRate;
+    unsigned int _numFrames;
+private:
+    void writeHeader(void);
+public:
+    WaveSink(const char* fileName, unsigned int samplingRate);
+    virtual ~WaveSink();
+public:
+    inline bool isOpen(void) { return _file != NULL; }
+public:
+    virtual void write(const short* frames, unsigned int numFrames);
+};
+
+#endif